@@ -0,0 +1,43 @@
+#include "GLCore/Core/Log.h"
+#include "GLCore/Util/AssetPack.h"
+
+#include <filesystem>
+#include <string>
+#include <vector>
+
+using namespace GLCore;
+using namespace GLCore::Utils;
+
+// Usage: AssetPacker <output.pak> <directory|file>...
+// Run from the directory the application is started in, so the packed paths match the
+// paths it loads assets by. Import caches (.tex, .dds) next to their sources are packed as
+// well; run the application once beforehand so they exist.
+int main(int argc, char** argv)
+{
+	Log::Init();
+
+	if (argc < 3)
+	{
+		LOG_ERROR("Usage: AssetPacker <output.pak> <directory|file>...");
+		return 1;
+	}
+
+	std::vector<std::string> files;
+	for (int i = 2; i < argc; i++)
+	{
+		std::filesystem::path input = argv[i];
+		if (!std::filesystem::is_directory(input))
+		{
+			files.push_back(input.generic_string());
+			continue;
+		}
+
+		for (const auto& entry : std::filesystem::recursive_directory_iterator(input))
+		{
+			if (entry.is_regular_file() && entry.path().extension() != ".pak")
+				files.push_back(entry.path().generic_string());
+		}
+	}
+
+	return BuildAssetPack(files, argv[1]) ? 0 : 1;
+}
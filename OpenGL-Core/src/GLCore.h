@@ -9,4 +9,5 @@
 #include <imgui.h>
 
 #include "GLCore/Core/Application.h"
-#include "GLCore/Core/Input.h"
\ No newline at end of file
+#include "GLCore/Core/Input.h"
+#include "GLCore/Scene/Scene.h"
\ No newline at end of file
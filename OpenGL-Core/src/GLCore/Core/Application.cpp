@@ -27,6 +27,8 @@ namespace GLCore {
 		m_Window = std::unique_ptr<Window>(Window::Create({ name, width, height }));
 		m_Window->SetEventCallback(BIND_EVENT_FN(OnEvent));
 
+		m_WorkerPool = std::make_unique<Utils::WorkerPool>();
+
 		// Renderer::Init();
 
 		m_ImGuiLayer = new ImGuiLayer();
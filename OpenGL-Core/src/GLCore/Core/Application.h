@@ -10,6 +10,7 @@
 #include "Timestep.h"
 
 #include "../ImGui/ImGuiLayer.h"
+#include "../Util/WorkerPool.h"
 
 namespace GLCore {
 
@@ -27,12 +28,15 @@ namespace GLCore {
 		void PushOverlay(Layer* layer);
 
 		inline Window& GetWindow() { return *m_Window; }
+		// Persistent threads for per-frame parallel work
+		inline Utils::WorkerPool& GetWorkerPool() { return *m_WorkerPool; }
 
 		inline static Application& Get() { return *s_Instance; }
 	private:
 		bool OnWindowClose(WindowCloseEvent& e);
 	private:
 		std::unique_ptr<Window> m_Window;
+		std::unique_ptr<Utils::WorkerPool> m_WorkerPool;
 		ImGuiLayer* m_ImGuiLayer;
 		bool m_Running = true;
 		LayerStack m_LayerStack;
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+namespace GLCore {
+
+	using Entity = uint32_t;
+	static const Entity NullEntity = 0xFFFFFFFF;
+
+	class ComponentPoolBase
+	{
+	public:
+		virtual ~ComponentPoolBase() = default;
+
+		virtual bool Has(Entity entity) const = 0;
+		virtual void Remove(Entity entity) = 0;
+		virtual void Clear() = 0;
+	};
+
+	// Sparse set: components are packed contiguously in insertion order with the owning entity
+	// alongside, looked up through a sparse table indexed by entity. Removal swaps the last
+	// component into the hole, so iteration order is not stable.
+	template<typename T>
+	class ComponentPool : public ComponentPoolBase
+	{
+	public:
+		T& Add(Entity entity, const T& component)
+		{
+			if (entity >= m_Sparse.size())
+				m_Sparse.resize(entity + 1, INVALID_SLOT);
+
+			if (m_Sparse[entity] != INVALID_SLOT)
+				return m_Components[m_Sparse[entity]] = component;
+
+			m_Sparse[entity] = (uint32_t)m_Components.size();
+			m_Entities.push_back(entity);
+			m_Components.push_back(component);
+			return m_Components.back();
+		}
+
+		virtual bool Has(Entity entity) const override
+		{
+			return entity < m_Sparse.size() && m_Sparse[entity] != INVALID_SLOT;
+		}
+
+		T& Get(Entity entity) { return m_Components[m_Sparse[entity]]; }
+		const T& Get(Entity entity) const { return m_Components[m_Sparse[entity]]; }
+
+		virtual void Remove(Entity entity) override
+		{
+			if (!Has(entity))
+				return;
+
+			uint32_t slot = m_Sparse[entity];
+			uint32_t last = (uint32_t)m_Components.size() - 1;
+			if (slot != last)
+			{
+				m_Components[slot] = std::move(m_Components[last]);
+				m_Entities[slot] = m_Entities[last];
+				m_Sparse[m_Entities[slot]] = slot;
+			}
+			m_Components.pop_back();
+			m_Entities.pop_back();
+			m_Sparse[entity] = INVALID_SLOT;
+		}
+
+		virtual void Clear() override
+		{
+			m_Components.clear();
+			m_Entities.clear();
+			m_Sparse.clear();
+		}
+
+		// Dense arrays, GetEntities()[i] owns GetComponents()[i]
+		const std::vector<Entity>& GetEntities() const { return m_Entities; }
+		std::vector<T>& GetComponents() { return m_Components; }
+		const std::vector<T>& GetComponents() const { return m_Components; }
+		uint32_t GetSize() const { return (uint32_t)m_Components.size(); }
+	private:
+		static constexpr uint32_t INVALID_SLOT = 0xFFFFFFFF;
+
+		std::vector<T> m_Components;
+		std::vector<Entity> m_Entities;
+		std::vector<uint32_t> m_Sparse;
+	};
+
+}
@@ -0,0 +1,235 @@
+#include "glpch.h"
+#include "Scene.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "GLCore/Util/ParallelFor.h"
+
+namespace GLCore {
+
+	// Depth levels smaller than this are not worth the thread start-up
+	static const uint32_t MIN_PARALLEL_TRANSFORMS = 4096;
+
+	// Dirty flag of a changed subtree root once UpdateTransforms has collected it
+	static const uint8_t DIRTY_EXPANDED = 2;
+
+	Entity Scene::CreateEntity(Entity parent)
+	{
+		Entity entity;
+		if (!m_FreeEntities.empty())
+		{
+			entity = m_FreeEntities.back();
+			m_FreeEntities.pop_back();
+		}
+		else
+		{
+			entity = (Entity)m_Alive.size();
+			m_Positions.emplace_back();
+			m_Rotations.emplace_back();
+			m_Scales.emplace_back();
+			m_WorldMatrices.emplace_back();
+			m_NormalMatrices.emplace_back();
+			m_Parents.emplace_back();
+			m_FirstChildren.emplace_back();
+			m_NextSiblings.emplace_back();
+			m_PreviousSiblings.emplace_back();
+			m_Alive.emplace_back();
+			m_Dirty.emplace_back();
+		}
+
+		m_Positions[entity] = glm::vec3(0.0f);
+		m_Rotations[entity] = glm::quat(1.0f, 0.0f, 0.0f, 0.0f);
+		m_Scales[entity] = glm::vec3(1.0f);
+		m_WorldMatrices[entity] = glm::mat4(1.0f);
+		m_NormalMatrices[entity] = glm::mat3(1.0f);
+		m_Parents[entity] = NullEntity;
+		m_FirstChildren[entity] = NullEntity;
+		m_NextSiblings[entity] = NullEntity;
+		m_PreviousSiblings[entity] = NullEntity;
+		m_Alive[entity] = 1;
+		m_Dirty[entity] = 0;
+		m_EntityCount++;
+
+		if (parent != NullEntity)
+			LinkChild(entity, parent);
+		MarkDirty(entity);
+		return entity;
+	}
+
+	void Scene::DestroyEntity(Entity entity)
+	{
+		if (!IsValid(entity))
+			return;
+
+		UnlinkChild(entity);
+
+		std::vector<Entity> stack = { entity };
+		while (!stack.empty())
+		{
+			Entity current = stack.back();
+			stack.pop_back();
+			for (Entity child = m_FirstChildren[current]; child != NullEntity; child = m_NextSiblings[child])
+				stack.push_back(child);
+
+			for (auto& [type, pool] : m_Pools)
+				pool->Remove(current);
+
+			m_Alive[current] = 0;
+			m_Dirty[current] = 0;
+			m_FreeEntities.push_back(current);
+			m_EntityCount--;
+		}
+	}
+
+	void Scene::Clear()
+	{
+		m_Positions.clear();
+		m_Rotations.clear();
+		m_Scales.clear();
+		m_WorldMatrices.clear();
+		m_NormalMatrices.clear();
+		m_Parents.clear();
+		m_FirstChildren.clear();
+		m_NextSiblings.clear();
+		m_PreviousSiblings.clear();
+		m_Alive.clear();
+		m_Dirty.clear();
+		m_DirtyEntities.clear();
+		m_FreeEntities.clear();
+		m_Changed.clear();
+		m_EntityCount = 0;
+
+		for (auto& [type, pool] : m_Pools)
+			pool->Clear();
+	}
+
+	void Scene::SetParent(Entity entity, Entity parent)
+	{
+		if (m_Parents[entity] == parent)
+			return;
+
+		for (Entity ancestor = parent; ancestor != NullEntity; ancestor = m_Parents[ancestor])
+		{
+			if (ancestor == entity)
+			{
+				LOG_WARN("Entity {0} cannot be parented to its own descendant {1}", entity, parent);
+				return;
+			}
+		}
+
+		UnlinkChild(entity);
+		if (parent != NullEntity)
+			LinkChild(entity, parent);
+		MarkDirty(entity);
+	}
+
+	void Scene::MarkDirty(Entity entity)
+	{
+		if (m_Dirty[entity])
+			return;
+
+		m_Dirty[entity] = 1;
+		m_DirtyEntities.push_back(entity);
+	}
+
+	void Scene::LinkChild(Entity entity, Entity parent)
+	{
+		m_Parents[entity] = parent;
+		m_PreviousSiblings[entity] = NullEntity;
+		m_NextSiblings[entity] = m_FirstChildren[parent];
+		if (m_FirstChildren[parent] != NullEntity)
+			m_PreviousSiblings[m_FirstChildren[parent]] = entity;
+		m_FirstChildren[parent] = entity;
+	}
+
+	void Scene::UnlinkChild(Entity entity)
+	{
+		Entity parent = m_Parents[entity];
+		if (parent == NullEntity)
+			return;
+
+		if (m_PreviousSiblings[entity] != NullEntity)
+			m_NextSiblings[m_PreviousSiblings[entity]] = m_NextSiblings[entity];
+		else
+			m_FirstChildren[parent] = m_NextSiblings[entity];
+		if (m_NextSiblings[entity] != NullEntity)
+			m_PreviousSiblings[m_NextSiblings[entity]] = m_PreviousSiblings[entity];
+
+		m_Parents[entity] = NullEntity;
+		m_NextSiblings[entity] = NullEntity;
+		m_PreviousSiblings[entity] = NullEntity;
+	}
+
+	uint32_t Scene::UpdateTransforms(uint32_t threadCount)
+	{
+		m_Changed.clear();
+		if (m_DirtyEntities.empty())
+			return 0;
+
+		for (std::vector<Entity>& level : m_Levels)
+			level.clear();
+
+		// Only the topmost dirty entity of each changed subtree is expanded, the rest are reached through it.
+		// Entities of the same level depend only on the level above, so each level can be split across threads.
+		for (Entity root : m_DirtyEntities)
+		{
+			// Indices are reused, so a destroyed and recreated entity can be listed twice
+			if (!IsValid(root) || m_Dirty[root] == DIRTY_EXPANDED)
+				continue;
+
+			bool covered = false;
+			for (Entity ancestor = m_Parents[root]; ancestor != NullEntity && !covered; ancestor = m_Parents[ancestor])
+				covered = m_Dirty[ancestor] != 0;
+			if (covered)
+				continue;
+			m_Dirty[root] = DIRTY_EXPANDED;
+
+			if (m_Levels.empty())
+				m_Levels.emplace_back();
+			size_t begin = m_Levels[0].size();
+			m_Levels[0].push_back(root);
+			for (size_t depth = 0; begin < m_Levels[depth].size(); depth++)
+			{
+				if (depth + 1 == m_Levels.size())
+					m_Levels.emplace_back();
+
+				size_t end = m_Levels[depth].size();
+				size_t nextBegin = m_Levels[depth + 1].size();
+				for (size_t i = begin; i < end; i++)
+				{
+					for (Entity child = m_FirstChildren[m_Levels[depth][i]]; child != NullEntity; child = m_NextSiblings[child])
+						m_Levels[depth + 1].push_back(child);
+				}
+				begin = nextBegin;
+			}
+		}
+
+		for (Entity entity : m_DirtyEntities)
+			m_Dirty[entity] = 0;
+		m_DirtyEntities.clear();
+
+		for (const std::vector<Entity>& level : m_Levels)
+		{
+			uint32_t count = (uint32_t)level.size();
+			uint32_t threads = count >= MIN_PARALLEL_TRANSFORMS ? Utils::GetWorkerThreadCount(threadCount) : 1;
+			Utils::ParallelFor(count, threads, [this, &level](uint32_t begin, uint32_t end)
+			{
+				for (uint32_t i = begin; i < end; i++)
+				{
+					Entity entity = level[i];
+					glm::mat4 local = glm::translate(glm::mat4(1.0f), m_Positions[entity]) * glm::mat4_cast(m_Rotations[entity]);
+					local = glm::scale(local, m_Scales[entity]);
+
+					Entity parent = m_Parents[entity];
+					m_WorldMatrices[entity] = parent != NullEntity ? m_WorldMatrices[parent] * local : local;
+					m_NormalMatrices[entity] = glm::transpose(glm::inverse(glm::mat3(m_WorldMatrices[entity])));
+				}
+			});
+
+			m_Changed.insert(m_Changed.end(), level.begin(), level.end());
+		}
+
+		return (uint32_t)m_Changed.size();
+	}
+
+}
@@ -0,0 +1,109 @@
+#pragma once
+
+#include <memory>
+#include <typeindex>
+#include <unordered_map>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include "ComponentPool.h"
+
+namespace GLCore {
+
+	// Entity store with a built-in transform component kept as structure of arrays, one slot per
+	// entity index, and any other component type in its own sparse-set pool.
+	//
+	// Changing a local transform marks the entity dirty. UpdateTransforms recomputes the world
+	// and normal matrices of the dirty entities and their descendants only, one hierarchy depth
+	// at a time with each depth split across worker threads, so a static scene costs nothing.
+	// Destroyed entity indices are reused, handles are not versioned.
+	class Scene
+	{
+	public:
+		Entity CreateEntity(Entity parent = NullEntity);
+		// Destroys the entity and all of its descendants
+		void DestroyEntity(Entity entity);
+		void Clear();
+
+		bool IsValid(Entity entity) const { return entity < m_Alive.size() && m_Alive[entity]; }
+		uint32_t GetEntityCount() const { return m_EntityCount; }
+
+		// Moves the entity with its subtree under a new parent (or to the root), keeping its local transform
+		void SetParent(Entity entity, Entity parent);
+		Entity GetParent(Entity entity) const { return m_Parents[entity]; }
+
+		void SetPosition(Entity entity, const glm::vec3& position) { m_Positions[entity] = position; MarkDirty(entity); }
+		void SetRotation(Entity entity, const glm::quat& rotation) { m_Rotations[entity] = rotation; MarkDirty(entity); }
+		void SetScale(Entity entity, const glm::vec3& scale) { m_Scales[entity] = scale; MarkDirty(entity); }
+
+		const glm::vec3& GetPosition(Entity entity) const { return m_Positions[entity]; }
+		const glm::quat& GetRotation(Entity entity) const { return m_Rotations[entity]; }
+		const glm::vec3& GetScale(Entity entity) const { return m_Scales[entity]; }
+
+		// Valid after UpdateTransforms
+		const glm::mat4& GetWorldMatrix(Entity entity) const { return m_WorldMatrices[entity]; }
+		const glm::mat3& GetNormalMatrix(Entity entity) const { return m_NormalMatrices[entity]; }
+		glm::vec3 GetWorldPosition(Entity entity) const { return glm::vec3(m_WorldMatrices[entity][3]); }
+
+		// Returns the number of entities whose world matrix was recomputed, listed in GetChangedEntities
+		uint32_t UpdateTransforms(uint32_t threadCount = 0);
+		const std::vector<Entity>& GetChangedEntities() const { return m_Changed; }
+
+		template<typename T>
+		T& AddComponent(Entity entity, const T& component = T()) { return GetPool<T>().Add(entity, component); }
+
+		template<typename T>
+		bool HasComponent(Entity entity) const
+		{
+			auto it = m_Pools.find(typeid(T));
+			return it != m_Pools.end() && it->second->Has(entity);
+		}
+
+		template<typename T>
+		T& GetComponent(Entity entity) { return GetPool<T>().Get(entity); }
+
+		template<typename T>
+		void RemoveComponent(Entity entity) { GetPool<T>().Remove(entity); }
+
+		// Every component of a type, packed for iteration
+		template<typename T>
+		ComponentPool<T>& GetPool()
+		{
+			std::unique_ptr<ComponentPoolBase>& pool = m_Pools[typeid(T)];
+			if (!pool)
+				pool = std::make_unique<ComponentPool<T>>();
+			return static_cast<ComponentPool<T>&>(*pool);
+		}
+	private:
+		void MarkDirty(Entity entity);
+		void LinkChild(Entity entity, Entity parent);
+		void UnlinkChild(Entity entity);
+	private:
+		// Transform component, indexed by entity
+		std::vector<glm::vec3> m_Positions;
+		std::vector<glm::quat> m_Rotations;
+		std::vector<glm::vec3> m_Scales;
+		std::vector<glm::mat4> m_WorldMatrices;
+		std::vector<glm::mat3> m_NormalMatrices;
+
+		// Hierarchy as intrusive child lists
+		std::vector<Entity> m_Parents;
+		std::vector<Entity> m_FirstChildren;
+		std::vector<Entity> m_NextSiblings;
+		std::vector<Entity> m_PreviousSiblings;
+
+		std::vector<uint8_t> m_Alive;
+		std::vector<uint8_t> m_Dirty;
+		std::vector<Entity> m_DirtyEntities;
+		std::vector<Entity> m_FreeEntities;
+		uint32_t m_EntityCount = 0;
+
+		// Scratch for UpdateTransforms: the changed subtrees bucketed by depth below their dirty root
+		std::vector<std::vector<Entity>> m_Levels;
+		std::vector<Entity> m_Changed;
+
+		std::unordered_map<std::type_index, std::unique_ptr<ComponentPoolBase>> m_Pools;
+	};
+
+}
@@ -0,0 +1,200 @@
+#include "glpch.h"
+#include "AssetPack.h"
+
+#include <filesystem>
+#include <fstream>
+
+namespace GLCore::Utils {
+
+	static const char ASSET_PACK_MAGIC[4] = { 'G', 'L', 'P', 'K' };
+	static const uint32_t ASSET_PACK_VERSION = 1;
+
+	// Payloads start on this boundary so mapped data can be handed to memcpy / GL uploads as is
+	static const uint64_t PAYLOAD_ALIGNMENT = 256;
+
+	struct PackHeader
+	{
+		char Magic[4];
+		uint32_t Version;
+		uint32_t EntryCount;
+		uint32_t Reserved;
+		uint64_t IndexOffset;
+		uint64_t NamesOffset;
+	};
+
+	// Index entries are sorted by PathHash
+	struct PackEntry
+	{
+		uint64_t PathHash;
+		uint64_t Offset;
+		uint64_t Size;
+		uint32_t NameOffset;
+		uint32_t NameLength;
+	};
+
+	std::unique_ptr<AssetPack> AssetPack::s_Mounted;
+
+	// 64-bit FNV-1a
+	static uint64_t HashPath(const std::string& path)
+	{
+		uint64_t hash = 14695981039346656037ull;
+		for (char c : path)
+		{
+			hash ^= (uint8_t)c;
+			hash *= 1099511628211ull;
+		}
+		return hash;
+	}
+
+	std::string NormalizeAssetPath(const std::string& path)
+	{
+		std::string result = path;
+		std::replace(result.begin(), result.end(), '\\', '/');
+		while (result.compare(0, 2, "./") == 0)
+			result.erase(0, 2);
+		return result;
+	}
+
+	std::unique_ptr<AssetPack> AssetPack::Open(const std::string& path)
+	{
+		std::unique_ptr<AssetPack> pack(new AssetPack());
+		if (!pack->m_File.Open(path))
+			return nullptr;
+
+		const uint8_t* data = pack->m_File.GetData();
+		size_t size = pack->m_File.GetSize();
+
+		const PackHeader* header = (const PackHeader*)data;
+		if (size < sizeof(PackHeader) || memcmp(header->Magic, ASSET_PACK_MAGIC, sizeof(ASSET_PACK_MAGIC)) != 0 || header->Version != ASSET_PACK_VERSION ||
+			header->IndexOffset > size || header->IndexOffset % alignof(PackEntry) != 0 ||
+			header->EntryCount > (size - header->IndexOffset) / sizeof(PackEntry) || header->NamesOffset > size)
+		{
+			LOG_ERROR("'{0}' is not a valid asset pack", path);
+			return nullptr;
+		}
+
+		// Every span handed out later must lie inside the mapping, a truncated pack is rejected here
+		const PackEntry* entries = (const PackEntry*)(data + header->IndexOffset);
+		size_t namesSize = size - header->NamesOffset;
+		for (uint32_t i = 0; i < header->EntryCount; i++)
+		{
+			const PackEntry& entry = entries[i];
+			if (entry.Offset > size || entry.Size > size - entry.Offset ||
+				entry.NameOffset > namesSize || entry.NameLength > namesSize - entry.NameOffset)
+			{
+				LOG_ERROR("Asset pack '{0}' is truncated or corrupt (entry {1})", path, i);
+				return nullptr;
+			}
+		}
+
+		pack->m_Entries = entries;
+		pack->m_Names = (const char*)(data + header->NamesOffset);
+		pack->m_EntryCount = header->EntryCount;
+		return pack;
+	}
+
+	AssetSpan AssetPack::Find(const std::string& path) const
+	{
+		std::string normalized = NormalizeAssetPath(path);
+		uint64_t hash = HashPath(normalized);
+
+		const PackEntry* end = m_Entries + m_EntryCount;
+		const PackEntry* it = std::lower_bound(m_Entries, end, hash, [](const PackEntry& entry, uint64_t hash) { return entry.PathHash < hash; });
+		for (; it != end && it->PathHash == hash; ++it)
+		{
+			if (std::string_view(m_Names + it->NameOffset, it->NameLength) == normalized)
+				return { m_File.GetData() + it->Offset, (size_t)it->Size };
+		}
+		return {};
+	}
+
+	bool AssetPack::Mount(const std::string& path)
+	{
+		s_Mounted = Open(path);
+		if (s_Mounted)
+			LOG_INFO("Mounted asset pack '{0}' ({1} assets)", path, s_Mounted->GetEntryCount());
+		return s_Mounted != nullptr;
+	}
+
+	void AssetPack::Unmount()
+	{
+		s_Mounted.reset();
+	}
+
+	AssetSpan AssetPack::FindMounted(const std::string& path)
+	{
+		if (!s_Mounted)
+			return {};
+
+#ifdef GLCORE_DEBUG
+		// Loose files override the pack in debug builds, so edits (and shader hot reload) are picked up
+		std::error_code error;
+		if (std::filesystem::exists(path, error))
+			return {};
+#endif
+		return s_Mounted->Find(path);
+	}
+
+	bool BuildAssetPack(const std::vector<std::string>& files, const std::string& outputPath)
+	{
+		std::ofstream out(outputPath, std::ios::out | std::ios::binary);
+		if (!out)
+		{
+			LOG_ERROR("Could not open file '{0}'", outputPath);
+			return false;
+		}
+
+		PackHeader header = {};
+		memcpy(header.Magic, ASSET_PACK_MAGIC, sizeof(ASSET_PACK_MAGIC));
+		header.Version = ASSET_PACK_VERSION;
+		out.write((const char*)&header, sizeof(header));
+
+		std::vector<PackEntry> entries;
+		std::string names;
+		std::vector<char> buffer;
+		uint64_t offset = sizeof(header);
+		for (const std::string& file : files)
+		{
+			std::ifstream in(file, std::ios::in | std::ios::binary | std::ios::ate);
+			if (!in)
+			{
+				LOG_ERROR("Could not open file '{0}'", file);
+				return false;
+			}
+
+			buffer.resize((size_t)in.tellg());
+			in.seekg(0, std::ios::beg);
+			in.read(buffer.data(), buffer.size());
+
+			uint64_t aligned = (offset + PAYLOAD_ALIGNMENT - 1) & ~(PAYLOAD_ALIGNMENT - 1);
+			static const char payloadPadding[PAYLOAD_ALIGNMENT] = {};
+			out.write(payloadPadding, aligned - offset);
+			out.write(buffer.data(), buffer.size());
+
+			std::string name = NormalizeAssetPath(file);
+			entries.push_back({ HashPath(name), aligned, buffer.size(), (uint32_t)names.size(), (uint32_t)name.size() });
+			names += name;
+
+			offset = aligned + buffer.size();
+		}
+
+		std::sort(entries.begin(), entries.end(), [](const PackEntry& a, const PackEntry& b) { return a.PathHash < b.PathHash; });
+
+		static const char padding[8] = {};
+		uint64_t indexOffset = (offset + 7) & ~7ull;
+		out.write(padding, indexOffset - offset);
+
+		header.EntryCount = (uint32_t)entries.size();
+		header.IndexOffset = indexOffset;
+		header.NamesOffset = indexOffset + entries.size() * sizeof(PackEntry);
+		out.write((const char*)entries.data(), entries.size() * sizeof(PackEntry));
+		out.write(names.data(), names.size());
+
+		out.seekp(0, std::ios::beg);
+		out.write((const char*)&header, sizeof(header));
+
+		LOG_INFO("Wrote {0} assets to '{1}' ({2} KB)", entries.size(), outputPath, (header.NamesOffset + names.size()) / 1024);
+		return (bool)out;
+	}
+
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include "MappedFile.h"
+
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace GLCore::Utils {
+
+	// Bytes of one packed asset, valid while its pack stays mounted
+	struct AssetSpan
+	{
+		const uint8_t* Data = nullptr;
+		size_t Size = 0;
+
+		explicit operator bool() const { return Data != nullptr; }
+		std::string_view AsString() const { return std::string_view((const char*)Data, Size); }
+	};
+
+	struct PackEntry;
+
+	// Read-only archive of assets addressed by their relative path ("assets/shaders/pbr.vert.glsl").
+	// The pack is memory mapped and lookups return spans into the mapping, so loading an asset is
+	// a binary search plus the page faults of touching it.
+	class AssetPack
+	{
+	public:
+		static std::unique_ptr<AssetPack> Open(const std::string& path);
+
+		AssetSpan Find(const std::string& path) const;
+		uint32_t GetEntryCount() const { return m_EntryCount; }
+
+		// Process-wide pack the shader and texture loaders consult before the file system.
+		// Debug builds only use it for assets that have no loose file.
+		static bool Mount(const std::string& path);
+		static void Unmount();
+		static AssetSpan FindMounted(const std::string& path);
+	private:
+		AssetPack() = default;
+	private:
+		MappedFile m_File;
+		const PackEntry* m_Entries = nullptr;
+		const char* m_Names = nullptr;
+		uint32_t m_EntryCount = 0;
+
+		static std::unique_ptr<AssetPack> s_Mounted;
+	};
+
+	std::string NormalizeAssetPath(const std::string& path);
+
+	// Writes files (paths relative to the working directory) into a pack at outputPath
+	bool BuildAssetPack(const std::vector<std::string>& files, const std::string& outputPath);
+
+}
@@ -0,0 +1,636 @@
+#include "glpch.h"
+#include "BlockCompression.h"
+
+#include "DDSFile.h"
+#include "ParallelFor.h"
+
+#include <filesystem>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/packing.hpp>
+#include <stb_image.h>
+
+#ifndef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+	#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT 0x83F0
+#endif
+#ifndef GL_COMPRESSED_SRGB_S3TC_DXT1_EXT
+	#define GL_COMPRESSED_SRGB_S3TC_DXT1_EXT 0x8C4C
+#endif
+
+namespace GLCore::Utils {
+
+	// Interpolation weights shared by BC6H and BC7 4-bit indices
+	static const int WEIGHTS4[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+	// Largest finite half float
+	static const float MAX_HALF_BITS = 31743.0f;
+
+	GLenum GetBlockInternalFormat(BlockFormat format, bool srgb)
+	{
+		switch (format)
+		{
+		case BlockFormat::BC1:  return srgb ? GL_COMPRESSED_SRGB_S3TC_DXT1_EXT : GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+		case BlockFormat::BC4:  return GL_COMPRESSED_RED_RGTC1;
+		case BlockFormat::BC5:  return GL_COMPRESSED_RG_RGTC2;
+		case BlockFormat::BC6H: return GL_COMPRESSED_RGB_BPTC_UNSIGNED_FLOAT;
+		case BlockFormat::BC7:  return srgb ? GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM : GL_COMPRESSED_RGBA_BPTC_UNORM;
+		case BlockFormat::None: break;
+		}
+		GLCORE_ASSERT(false, "Unknown block format");
+		return 0;
+	}
+
+	uint32_t GetBlockSize(BlockFormat format)
+	{
+		switch (format)
+		{
+		case BlockFormat::BC1:
+		case BlockFormat::BC4:
+			return 8;
+		case BlockFormat::BC5:
+		case BlockFormat::BC6H:
+		case BlockFormat::BC7:
+			return 16;
+		case BlockFormat::None:
+			break;
+		}
+		return 0;
+	}
+
+	const char* GetBlockFormatName(BlockFormat format)
+	{
+		switch (format)
+		{
+		case BlockFormat::None: return "None";
+		case BlockFormat::BC1:  return "BC1";
+		case BlockFormat::BC4:  return "BC4";
+		case BlockFormat::BC5:  return "BC5";
+		case BlockFormat::BC6H: return "BC6H";
+		case BlockFormat::BC7:  return "BC7";
+		}
+		return "Unknown";
+	}
+
+	uint32_t GetCompressedMipWidth(const CompressedImage& image, uint32_t level)
+	{
+		return std::max(image.Width >> level, 1u);
+	}
+
+	uint32_t GetCompressedMipHeight(const CompressedImage& image, uint32_t level)
+	{
+		return std::max(image.Height >> level, 1u);
+	}
+
+	size_t GetCompressedMipSize(const CompressedImage& image, uint32_t level)
+	{
+		size_t blocksX = (GetCompressedMipWidth(image, level) + 3) / 4;
+		size_t blocksY = (GetCompressedMipHeight(image, level) + 3) / 4;
+		return blocksX * blocksY * GetBlockSize(image.Format);
+	}
+
+	size_t GetCompressedMipOffset(const CompressedImage& image, uint32_t level)
+	{
+		size_t offset = 0;
+		for (uint32_t i = 0; i < level; i++)
+			offset += GetCompressedMipSize(image, i);
+		return offset;
+	}
+
+	// Writes fields LSB first into a 128-bit block
+	class BitWriter
+	{
+	public:
+		BitWriter(uint8_t* block, uint32_t size)
+			: m_Block(block)
+		{
+			memset(block, 0, size);
+		}
+
+		void Write(uint32_t value, uint32_t bits)
+		{
+			for (uint32_t i = 0; i < bits; i++, m_Position++)
+			{
+				if (value & (1u << i))
+					m_Block[m_Position >> 3] |= (uint8_t)(1u << (m_Position & 7));
+			}
+		}
+	private:
+		uint8_t* m_Block;
+		uint32_t m_Position = 0;
+	};
+
+	// Principal axis of a point set by power iteration on its covariance
+	template<typename Vec>
+	static Vec PrincipalAxis(const Vec* points, uint32_t count, const Vec& mean)
+	{
+		constexpr int N = Vec::length();
+		float covariance[N][N] = {};
+		for (uint32_t i = 0; i < count; i++)
+		{
+			Vec d = points[i] - mean;
+			for (int r = 0; r < N; r++)
+				for (int c = 0; c < N; c++)
+					covariance[r][c] += d[r] * d[c];
+		}
+
+		Vec axis(1.0f);
+		for (int iteration = 0; iteration < 8; iteration++)
+		{
+			Vec next(0.0f);
+			for (int r = 0; r < N; r++)
+				for (int c = 0; c < N; c++)
+					next[r] += covariance[r][c] * axis[c];
+
+			float length = glm::length(next);
+			if (length < 1e-6f)
+				break;
+			axis = next / length;
+		}
+
+		float length = glm::length(axis);
+		return length > 0.0f ? axis / length : Vec(0.0f);
+	}
+
+	template<typename Vec>
+	static void FitEndpoints(const Vec* points, uint32_t count, Vec& start, Vec& end)
+	{
+		Vec mean(0.0f);
+		for (uint32_t i = 0; i < count; i++)
+			mean += points[i];
+		mean /= (float)count;
+
+		Vec axis = PrincipalAxis(points, count, mean);
+		float minT = FLT_MAX, maxT = -FLT_MAX;
+		for (uint32_t i = 0; i < count; i++)
+		{
+			float t = glm::dot(points[i] - mean, axis);
+			minT = std::min(minT, t);
+			maxT = std::max(maxT, t);
+		}
+
+		start = mean + axis * minT;
+		end = mean + axis * maxT;
+	}
+
+	template<typename Vec>
+	static uint32_t FindClosest(const Vec& value, const Vec* palette, uint32_t count)
+	{
+		uint32_t best = 0;
+		float bestDistance = FLT_MAX;
+		for (uint32_t i = 0; i < count; i++)
+		{
+			Vec d = value - palette[i];
+			float distance = glm::dot(d, d);
+			if (distance < bestDistance)
+			{
+				bestDistance = distance;
+				best = i;
+			}
+		}
+		return best;
+	}
+
+	static uint16_t PackRGB565(const glm::vec3& color)
+	{
+		glm::vec3 c = glm::clamp(color, 0.0f, 255.0f);
+		uint32_t r = (uint32_t)(c.r * 31.0f / 255.0f + 0.5f);
+		uint32_t g = (uint32_t)(c.g * 63.0f / 255.0f + 0.5f);
+		uint32_t b = (uint32_t)(c.b * 31.0f / 255.0f + 0.5f);
+		return (uint16_t)((r << 11) | (g << 5) | b);
+	}
+
+	static glm::vec3 UnpackRGB565(uint16_t color)
+	{
+		uint32_t r = (color >> 11) & 31, g = (color >> 5) & 63, b = color & 31;
+		return glm::vec3((float)((r << 3) | (r >> 2)), (float)((g << 2) | (g >> 4)), (float)((b << 3) | (b >> 2)));
+	}
+
+	static void EncodeBC1(const glm::vec4 texels[16], uint8_t* block)
+	{
+		glm::vec3 colors[16];
+		for (int i = 0; i < 16; i++)
+			colors[i] = glm::vec3(texels[i]);
+
+		glm::vec3 start, end;
+		FitEndpoints(colors, 16, start, end);
+
+		uint16_t color0 = PackRGB565(end), color1 = PackRGB565(start);
+		if (color0 < color1)
+			std::swap(color0, color1);
+
+		uint32_t indices = 0;
+		if (color0 != color1)
+		{
+			// color0 > color1 selects the four colour mode
+			glm::vec3 palette[4];
+			palette[0] = UnpackRGB565(color0);
+			palette[1] = UnpackRGB565(color1);
+			palette[2] = (2.0f * palette[0] + palette[1]) / 3.0f;
+			palette[3] = (palette[0] + 2.0f * palette[1]) / 3.0f;
+
+			for (int i = 0; i < 16; i++)
+				indices |= FindClosest(colors[i], palette, 4) << (2 * i);
+		}
+
+		memcpy(block + 0, &color0, 2);
+		memcpy(block + 2, &color1, 2);
+		memcpy(block + 4, &indices, 4);
+	}
+
+	static void EncodeBC4(const float values[16], uint8_t* block)
+	{
+		float minValue = 255.0f, maxValue = 0.0f;
+		for (int i = 0; i < 16; i++)
+		{
+			minValue = std::min(minValue, values[i]);
+			maxValue = std::max(maxValue, values[i]);
+		}
+
+		uint8_t red0 = (uint8_t)(glm::clamp(maxValue, 0.0f, 255.0f) + 0.5f);
+		uint8_t red1 = (uint8_t)(glm::clamp(minValue, 0.0f, 255.0f) + 0.5f);
+
+		uint64_t indices = 0;
+		if (red0 > red1)
+		{
+			// red0 > red1 selects eight interpolated values
+			glm::vec1 palette[8];
+			palette[0].x = red0;
+			palette[1].x = red1;
+			for (int k = 2; k < 8; k++)
+				palette[k].x = ((8 - k) * red0 + (k - 1) * red1) / 7.0f;
+
+			for (int i = 0; i < 16; i++)
+				indices |= (uint64_t)FindClosest(glm::vec1(values[i]), palette, 8) << (3 * i);
+		}
+
+		block[0] = red0;
+		block[1] = red1;
+		for (int i = 0; i < 6; i++)
+			block[2 + i] = (uint8_t)(indices >> (8 * i));
+	}
+
+	static int QuantizeBC7Endpoint(const glm::vec4& value, int pBit, glm::ivec4& quantized)
+	{
+		int error = 0;
+		for (int c = 0; c < 4; c++)
+		{
+			quantized[c] = glm::clamp((int)std::round((value[c] - pBit) / 2.0f), 0, 127);
+			int reconstructed = (quantized[c] << 1) | pBit;
+			error += (reconstructed - (int)value[c]) * (reconstructed - (int)value[c]);
+		}
+		return error;
+	}
+
+	static float EvaluateBC7(const glm::vec4 texels[16], const glm::ivec4 endpoints[2], const int pBits[2], uint32_t indices[16])
+	{
+		glm::vec4 e0 = glm::vec4((endpoints[0] << 1) | pBits[0]);
+		glm::vec4 e1 = glm::vec4((endpoints[1] << 1) | pBits[1]);
+
+		glm::vec4 palette[16];
+		for (int i = 0; i < 16; i++)
+			palette[i] = glm::floor(((64.0f - WEIGHTS4[i]) * e0 + (float)WEIGHTS4[i] * e1 + 32.0f) / 64.0f);
+
+		float error = 0.0f;
+		for (int i = 0; i < 16; i++)
+		{
+			indices[i] = FindClosest(texels[i], palette, 16);
+			glm::vec4 d = texels[i] - palette[indices[i]];
+			error += glm::dot(d, d);
+		}
+		return error;
+	}
+
+	static void QuantizeBC7Endpoints(const glm::vec4& start, const glm::vec4& end, glm::ivec4 endpoints[2], int pBits[2])
+	{
+		const glm::vec4 values[2] = { glm::clamp(start, 0.0f, 255.0f), glm::clamp(end, 0.0f, 255.0f) };
+		for (int e = 0; e < 2; e++)
+		{
+			glm::ivec4 q0, q1;
+			int error0 = QuantizeBC7Endpoint(values[e], 0, q0);
+			int error1 = QuantizeBC7Endpoint(values[e], 1, q1);
+			pBits[e] = error1 < error0 ? 1 : 0;
+			endpoints[e] = error1 < error0 ? q1 : q0;
+		}
+	}
+
+	// Mode 6 only: one subset, RGBA 7777 endpoints with a p-bit each, 4-bit indices
+	static void EncodeBC7(const glm::vec4 texels[16], uint8_t* block)
+	{
+		glm::vec4 start, end;
+		FitEndpoints(texels, 16, start, end);
+
+		glm::ivec4 endpoints[2];
+		int pBits[2];
+		uint32_t indices[16];
+		QuantizeBC7Endpoints(start, end, endpoints, pBits);
+		float error = EvaluateBC7(texels, endpoints, pBits, indices);
+
+		// One least-squares refit of the endpoints against the chosen weights
+		float aa = 0.0f, ab = 0.0f, bb = 0.0f;
+		glm::vec4 ax(0.0f), bx(0.0f);
+		for (int i = 0; i < 16; i++)
+		{
+			float b = WEIGHTS4[indices[i]] / 64.0f, a = 1.0f - b;
+			aa += a * a; ab += a * b; bb += b * b;
+			ax += a * texels[i]; bx += b * texels[i];
+		}
+		float determinant = aa * bb - ab * ab;
+		if (std::abs(determinant) > 1e-6f)
+		{
+			glm::vec4 refinedStart = (ax * bb - bx * ab) / determinant;
+			glm::vec4 refinedEnd = (bx * aa - ax * ab) / determinant;
+
+			glm::ivec4 refinedEndpoints[2];
+			int refinedPBits[2];
+			uint32_t refinedIndices[16];
+			QuantizeBC7Endpoints(refinedStart, refinedEnd, refinedEndpoints, refinedPBits);
+			if (EvaluateBC7(texels, refinedEndpoints, refinedPBits, refinedIndices) < error)
+			{
+				endpoints[0] = refinedEndpoints[0]; endpoints[1] = refinedEndpoints[1];
+				pBits[0] = refinedPBits[0]; pBits[1] = refinedPBits[1];
+				memcpy(indices, refinedIndices, sizeof(indices));
+			}
+		}
+
+		// The anchor index is stored without its top bit, swap the endpoints to keep it below 8
+		if (indices[0] >= 8)
+		{
+			std::swap(endpoints[0], endpoints[1]);
+			std::swap(pBits[0], pBits[1]);
+			for (int i = 0; i < 16; i++)
+				indices[i] = 15 - indices[i];
+		}
+
+		BitWriter writer(block, 16);
+		writer.Write(1 << 6, 7);
+		for (int c = 0; c < 4; c++)
+		{
+			writer.Write(endpoints[0][c], 7);
+			writer.Write(endpoints[1][c], 7);
+		}
+		writer.Write(pBits[0], 1);
+		writer.Write(pBits[1], 1);
+		for (int i = 0; i < 16; i++)
+			writer.Write(indices[i], i == 0 ? 3 : 4);
+	}
+
+	// Unsigned BC6H endpoint dequantization and final scaling to half float bits
+	static int UnquantizeBC6H(int value)
+	{
+		if (value == 0)
+			return 0;
+		if (value == 1023)
+			return 0xFFFF;
+		return ((value << 16) + 0x8000) >> 10;
+	}
+
+	static int FinishBC6H(int value)
+	{
+		return (value * 31) >> 6;
+	}
+
+	static int QuantizeBC6H(float halfBits)
+	{
+		int estimate = glm::clamp((int)((halfBits - 15.5f) / 31.0f + 0.5f), 0, 1023);
+		int best = estimate;
+		float bestError = FLT_MAX;
+		for (int candidate = std::max(estimate - 1, 0); candidate <= std::min(estimate + 1, 1023); candidate++)
+		{
+			float error = std::abs(FinishBC6H(UnquantizeBC6H(candidate)) - halfBits);
+			if (error < bestError)
+			{
+				bestError = error;
+				best = candidate;
+			}
+		}
+		return best;
+	}
+
+	// Mode 11 only: one region, 10-bit endpoints without deltas, 4-bit indices.
+	// Fitting happens on the half float bit patterns, which are close to logarithmic.
+	static void EncodeBC6H(const glm::vec3 texels[16], uint8_t* block)
+	{
+		glm::vec3 start, end;
+		FitEndpoints(texels, 16, start, end);
+
+		glm::ivec3 endpoints[2];
+		for (int c = 0; c < 3; c++)
+		{
+			endpoints[0][c] = QuantizeBC6H(glm::clamp(start[c], 0.0f, MAX_HALF_BITS));
+			endpoints[1][c] = QuantizeBC6H(glm::clamp(end[c], 0.0f, MAX_HALF_BITS));
+		}
+
+		glm::vec3 palette[16];
+		for (int i = 0; i < 16; i++)
+		{
+			for (int c = 0; c < 3; c++)
+			{
+				int a = UnquantizeBC6H(endpoints[0][c]), b = UnquantizeBC6H(endpoints[1][c]);
+				palette[i][c] = (float)FinishBC6H(((64 - WEIGHTS4[i]) * a + WEIGHTS4[i] * b + 32) >> 6);
+			}
+		}
+
+		uint32_t indices[16];
+		for (int i = 0; i < 16; i++)
+			indices[i] = FindClosest(texels[i], palette, 16);
+
+		if (indices[0] >= 8)
+		{
+			std::swap(endpoints[0], endpoints[1]);
+			for (int i = 0; i < 16; i++)
+				indices[i] = 15 - indices[i];
+		}
+
+		BitWriter writer(block, 16);
+		writer.Write(0x03, 5);
+		for (int e = 0; e < 2; e++)
+			for (int c = 0; c < 3; c++)
+				writer.Write(endpoints[e][c], 10);
+		for (int i = 0; i < 16; i++)
+			writer.Write(indices[i], i == 0 ? 3 : 4);
+	}
+
+	static void FetchBlock(const uint8_t* pixels, uint32_t width, uint32_t height, uint32_t channels, uint32_t blockX, uint32_t blockY, glm::vec4 texels[16])
+	{
+		for (uint32_t y = 0; y < 4; y++)
+		{
+			for (uint32_t x = 0; x < 4; x++)
+			{
+				// Partial edge blocks repeat the last row / column
+				uint32_t px = std::min(blockX * 4 + x, width - 1);
+				uint32_t py = std::min(blockY * 4 + y, height - 1);
+				const uint8_t* texel = &pixels[((size_t)py * width + px) * channels];
+
+				glm::vec4 value(0.0f, 0.0f, 0.0f, 255.0f);
+				for (uint32_t c = 0; c < std::min(channels, 4u); c++)
+					value[c] = texel[c];
+				texels[y * 4 + x] = value;
+			}
+		}
+	}
+
+	void CompressImage(const ImageData& image, BlockFormat format, CompressedImage& result, uint32_t threadCount)
+	{
+		GLCORE_ASSERT(format != BlockFormat::None && format != BlockFormat::BC6H, "CompressImage encodes LDR formats only");
+
+		result.Format = format;
+		result.Width = image.Width;
+		result.Height = image.Height;
+		result.MipCount = image.MipCount;
+		result.Data.resize(GetCompressedMipOffset(result, result.MipCount));
+
+		uint32_t blockSize = GetBlockSize(format);
+		threadCount = GetWorkerThreadCount(threadCount);
+		for (uint32_t level = 0; level < image.MipCount; level++)
+		{
+			uint32_t width = GetMipWidth(image, level), height = GetMipHeight(image, level);
+			uint32_t blocksX = (width + 3) / 4, blocksY = (height + 3) / 4;
+			const uint8_t* pixels = &image.Pixels[GetMipOffset(image, level)];
+			uint8_t* blocks = &result.Data[GetCompressedMipOffset(result, level)];
+
+			ParallelFor(blocksY, threadCount, [&](uint32_t begin, uint32_t end)
+			{
+				glm::vec4 texels[16];
+				float values[16];
+				for (uint32_t by = begin; by < end; by++)
+				{
+					for (uint32_t bx = 0; bx < blocksX; bx++)
+					{
+						FetchBlock(pixels, width, height, image.Channels, bx, by, texels);
+						uint8_t* block = blocks + ((size_t)by * blocksX + bx) * blockSize;
+						switch (format)
+						{
+						case BlockFormat::BC1:
+							EncodeBC1(texels, block);
+							break;
+						case BlockFormat::BC4:
+							for (int i = 0; i < 16; i++)
+								values[i] = texels[i].r;
+							EncodeBC4(values, block);
+							break;
+						case BlockFormat::BC5:
+							for (int c = 0; c < 2; c++)
+							{
+								for (int i = 0; i < 16; i++)
+									values[i] = texels[i][c];
+								EncodeBC4(values, block + c * 8);
+							}
+							break;
+						case BlockFormat::BC7:
+							EncodeBC7(texels, block);
+							break;
+						case BlockFormat::BC6H:     // HDR sources go through CompressHDRImage
+						case BlockFormat::None:
+							break;
+						}
+					}
+				}
+			});
+		}
+	}
+
+	void CompressHDRImage(const float* rgb, uint32_t width, uint32_t height, CompressedImage& result, uint32_t threadCount)
+	{
+		result.Format = BlockFormat::BC6H;
+		result.SRGB = false;
+		result.Width = width;
+		result.Height = height;
+		result.MipCount = 1;
+		result.Data.resize(GetCompressedMipSize(result, 0));
+
+		uint32_t blocksX = (width + 3) / 4, blocksY = (height + 3) / 4;
+		ParallelFor(blocksY, GetWorkerThreadCount(threadCount), [&](uint32_t begin, uint32_t end)
+		{
+			glm::vec3 texels[16];
+			for (uint32_t by = begin; by < end; by++)
+			{
+				for (uint32_t bx = 0; bx < blocksX; bx++)
+				{
+					for (uint32_t i = 0; i < 16; i++)
+					{
+						uint32_t px = std::min(bx * 4 + i % 4, width - 1);
+						uint32_t py = std::min(by * 4 + i / 4, height - 1);
+						const float* texel = &rgb[((size_t)py * width + px) * 3];
+						for (int c = 0; c < 3; c++)
+						{
+							float value = texel[c] > 0.0f ? texel[c] : 0.0f;   // also rejects NaN
+							texels[i][c] = std::min((float)glm::packHalf1x16(value), MAX_HALF_BITS);
+						}
+					}
+					EncodeBC6H(texels, &result.Data[((size_t)by * blocksX + bx) * 16]);
+				}
+			}
+		});
+	}
+
+	// Build settings stored with the cache, the high byte tells tagged caches from untagged ones
+	static uint32_t GetCacheTag(BlockFormat format, const MipChainSettings& mipSettings, bool flipVertically)
+	{
+		uint32_t tag = (1u << 24) | ((uint32_t)flipVertically << 16);
+		if (format != BlockFormat::BC6H)
+			tag |= ((uint32_t)mipSettings.Filter << 8) | (uint32_t)mipSettings.Content;
+		return tag;
+	}
+
+	static bool IsCacheValid(const std::string& sourcePath, const std::string& cachePath, BlockFormat format, uint32_t tag)
+	{
+		std::error_code error;
+		auto cacheTime = std::filesystem::last_write_time(cachePath, error);
+		if (error)
+			return false;
+
+		auto sourceTime = std::filesystem::last_write_time(sourcePath, error);
+		if (error || sourceTime > cacheTime)
+			return false;
+
+		CompressedImage header;
+		return ReadDDSHeader(cachePath, header) && header.Format == format && header.Tag == tag;
+	}
+
+	bool LoadCompressedTexture(const std::string& sourcePath, const std::string& cachePath, BlockFormat format,
+		const MipChainSettings& mipSettings, bool flipVertically, CompressedImage& image)
+	{
+		uint32_t tag = GetCacheTag(format, mipSettings, flipVertically);
+		if (IsCacheValid(sourcePath, cachePath, format, tag) && ReadDDS(cachePath, image))
+			return true;
+
+		stbi_set_flip_vertically_on_load_thread(flipVertically);
+		int width, height, channels;
+		size_t sourceSize;
+		if (format == BlockFormat::BC6H)
+		{
+			float* pixels = stbi_loadf(sourcePath.c_str(), &width, &height, &channels, 3);
+			if (!pixels)
+				return false;
+
+			CompressHDRImage(pixels, width, height, image, mipSettings.ThreadCount);
+			sourceSize = (size_t)width * height * 3 * sizeof(uint16_t);
+			stbi_image_free(pixels);
+		}
+		else
+		{
+			uint8_t* pixels = stbi_load(sourcePath.c_str(), &width, &height, &channels, 0);
+			if (!pixels)
+				return false;
+
+			ImageData source;
+			source.Width = width;
+			source.Height = height;
+			source.Channels = channels;
+			source.Pixels.assign(pixels, pixels + (size_t)width * height * channels);
+			stbi_image_free(pixels);
+
+			BuildMipChain(source, mipSettings);
+			CompressImage(source, format, image, mipSettings.ThreadCount);
+			sourceSize = source.Pixels.size();
+		}
+
+		image.Tag = tag;
+		LOG_INFO("Compressed '{0}' to {1}: {2} KB -> {3} KB", sourcePath, GetBlockFormatName(format), sourceSize / 1024, image.Data.size() / 1024);
+
+		if (!WriteDDS(cachePath, image))
+			LOG_WARN("Could not write compressed cache '{0}'", cachePath);
+		return true;
+	}
+
+}
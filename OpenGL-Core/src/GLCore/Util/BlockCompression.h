@@ -0,0 +1,56 @@
+#pragma once
+
+#include "ImageCache.h"
+#include "MipChainBuilder.h"
+
+#include <string>
+#include <vector>
+
+#include <glad/glad.h>
+
+namespace GLCore::Utils {
+
+	enum class BlockFormat
+	{
+		None = 0,
+		BC1,     // RGB, 4 bpp
+		BC4,     // single channel (roughness, AO, height, ...), 4 bpp
+		BC5,     // two channels (tangent-space normal XY), 8 bpp
+		BC6H,    // unsigned half-float RGB (environments), 8 bpp
+		BC7      // RGBA (albedo), 8 bpp
+	};
+
+	// 4x4 block compressed image, MipCount levels back to back, largest first
+	struct CompressedImage
+	{
+		BlockFormat Format = BlockFormat::None;
+		bool SRGB = false;
+		uint32_t Width = 0;
+		uint32_t Height = 0;
+		uint32_t MipCount = 1;
+		uint32_t Tag = 0;          // free for the producer, e.g. to detect changed build settings
+		std::vector<uint8_t> Data;
+	};
+
+	GLenum GetBlockInternalFormat(BlockFormat format, bool srgb = false);
+	uint32_t GetBlockSize(BlockFormat format);
+	const char* GetBlockFormatName(BlockFormat format);
+
+	uint32_t GetCompressedMipWidth(const CompressedImage& image, uint32_t level);
+	uint32_t GetCompressedMipHeight(const CompressedImage& image, uint32_t level);
+	size_t GetCompressedMipSize(const CompressedImage& image, uint32_t level);
+	size_t GetCompressedMipOffset(const CompressedImage& image, uint32_t level);
+
+	// Encodes every level of an 8-bit image. BC4 reads channel 0, BC5 channels 0 and 1.
+	void CompressImage(const ImageData& image, BlockFormat format, CompressedImage& result, uint32_t threadCount = 0);
+
+	// Encodes a single level of linear RGB radiance as BC6H
+	void CompressHDRImage(const float* rgb, uint32_t width, uint32_t height, CompressedImage& result, uint32_t threadCount = 0);
+
+	// Loads a compressed texture from cachePath (DDS), encoding it from the source image first
+	// when the cache is missing, stale, in another format or built with other settings. BC6H reads
+	// the source as HDR; every other format builds a mip chain with the given settings before encoding.
+	bool LoadCompressedTexture(const std::string& sourcePath, const std::string& cachePath, BlockFormat format,
+		const MipChainSettings& mipSettings, bool flipVertically, CompressedImage& image);
+
+}
@@ -0,0 +1,111 @@
+#include "glpch.h"
+#include "BoundingVolumeHierarchy.h"
+
+namespace GLCore::Utils {
+
+	void BoundingVolumeHierarchy::Build(const std::vector<BoundingBox>& bounds, uint32_t maxLeafSize)
+	{
+		m_Bounds = bounds;
+		m_Nodes.clear();
+		m_Objects.resize(bounds.size());
+		for (uint32_t i = 0; i < bounds.size(); i++)
+			m_Objects[i] = i;
+
+		if (bounds.empty())
+			return;
+
+		m_Nodes.reserve(bounds.size() * 2 / std::max(maxLeafSize, 1u) + 1);
+
+		std::vector<glm::vec3> centers(bounds.size());
+		for (size_t i = 0; i < bounds.size(); i++)
+			centers[i] = bounds[i].GetCenter();
+
+		// Nodes still to be split, as ranges of m_Objects
+		struct Range
+		{
+			uint32_t Node, First, Count;
+		};
+		std::vector<Range> stack;
+
+		m_Nodes.push_back({});
+		stack.push_back({ 0, 0, (uint32_t)bounds.size() });
+		while (!stack.empty())
+		{
+			Range range = stack.back();
+			stack.pop_back();
+
+			BoundingBox nodeBounds, centroidBounds;
+			for (uint32_t i = range.First; i < range.First + range.Count; i++)
+			{
+				nodeBounds.Expand(m_Bounds[m_Objects[i]]);
+				centroidBounds.Expand(centers[m_Objects[i]]);
+			}
+
+			Node& node = m_Nodes[range.Node];
+			node.Bounds = nodeBounds;
+			node.First = range.First;
+			node.Count = range.Count;
+			node.Children = 0;
+
+			glm::vec3 size = centroidBounds.Max - centroidBounds.Min;
+			if (range.Count <= maxLeafSize || glm::max(size.x, glm::max(size.y, size.z)) <= 0.0f)
+				continue;
+
+			int axis = size.x > size.y ? (size.x > size.z ? 0 : 2) : (size.y > size.z ? 1 : 2);
+			uint32_t half = range.Count / 2;
+			auto first = m_Objects.begin() + range.First;
+			std::nth_element(first, first + half, first + range.Count, [&centers, axis](uint32_t a, uint32_t b)
+			{
+				return centers[a][axis] < centers[b][axis];
+			});
+
+			uint32_t children = (uint32_t)m_Nodes.size();
+			node.Children = children;
+			m_Nodes.push_back({});
+			m_Nodes.push_back({});
+			stack.push_back({ children, range.First, half });
+			stack.push_back({ children + 1, range.First + half, range.Count - half });
+		}
+	}
+
+	void BoundingVolumeHierarchy::Cull(const Frustum& frustum, std::vector<uint32_t>& visible) const
+	{
+		m_TestCount = 0;
+		if (m_Nodes.empty())
+			return;
+
+		uint32_t stack[64];
+		uint32_t depth = 0;
+		stack[depth++] = 0;
+		while (depth > 0)
+		{
+			const Node& node = m_Nodes[stack[--depth]];
+
+			m_TestCount++;
+			FrustumTest test = frustum.Test(node.Bounds);
+			if (test == FrustumTest::Outside)
+				continue;
+
+			if (test == FrustumTest::Inside)
+			{
+				visible.insert(visible.end(), m_Objects.begin() + node.First, m_Objects.begin() + node.First + node.Count);
+				continue;
+			}
+
+			if (node.Children == 0)
+			{
+				for (uint32_t i = node.First; i < node.First + node.Count; i++)
+				{
+					m_TestCount++;
+					if (frustum.IsVisible(m_Bounds[m_Objects[i]]))
+						visible.push_back(m_Objects[i]);
+				}
+				continue;
+			}
+
+			stack[depth++] = node.Children + 1;
+			stack[depth++] = node.Children;
+		}
+	}
+
+}
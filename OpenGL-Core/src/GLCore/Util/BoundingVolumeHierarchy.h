@@ -0,0 +1,41 @@
+#pragma once
+
+#include <vector>
+
+#include "Frustum.h"
+
+namespace GLCore::Utils {
+
+	// Binary tree of axis-aligned boxes over a static set of object bounds, split at the median
+	// of the longest centroid axis. Rebuild when objects move.
+	class BoundingVolumeHierarchy
+	{
+	public:
+		void Build(const std::vector<BoundingBox>& bounds, uint32_t maxLeafSize = 4);
+
+		// Appends the index of every object whose bounds touch the frustum. Subtrees fully inside
+		// are accepted without testing their objects.
+		void Cull(const Frustum& frustum, std::vector<uint32_t>& visible) const;
+
+		uint32_t GetObjectCount() const { return (uint32_t)m_Objects.size(); }
+		uint32_t GetNodeCount() const { return (uint32_t)m_Nodes.size(); }
+		// Box tests performed by the last Cull
+		uint32_t GetTestCount() const { return m_TestCount; }
+	private:
+		// Every node covers m_Objects[First, First + Count), inner nodes have their children at
+		// Children and Children + 1, leaves have Children == 0
+		struct Node
+		{
+			BoundingBox Bounds;
+			uint32_t First;
+			uint32_t Count;
+			uint32_t Children;
+		};
+	private:
+		std::vector<Node> m_Nodes;
+		std::vector<uint32_t> m_Objects;
+		std::vector<BoundingBox> m_Bounds;
+		mutable uint32_t m_TestCount = 0;
+	};
+
+}
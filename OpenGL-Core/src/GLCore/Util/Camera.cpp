@@ -65,6 +65,7 @@ void Camera::CalculateViewMatrix()
     m_ViewMatrix = glm::translate(glm::mat4(1.0f), m_Position) * glm::toMat4(m_Orientation);
     m_ViewMatrix = glm::inverse(m_ViewMatrix);
     m_ViewProjection = m_ProjectionMatrix * m_ViewMatrix;
+    m_Frustum = Frustum(m_ViewProjection);
 }
 
 void Camera::SetDirections()
@@ -4,6 +4,7 @@
 #include <glm/gtc/quaternion.hpp>
 
 #include "GLCore/Core/Timestep.h"
+#include "GLCore/Util/Frustum.h"
 
 #include "GLCore/Events/Event.h"
 #include "GLCore/Events/MouseEvent.h"
@@ -24,6 +25,7 @@ public:
     const glm::mat4& GetViewMatrix() const { return m_ViewMatrix; }
     const glm::mat4& GetProjectionMatrix() const { return m_ProjectionMatrix; }
     const glm::mat4& GetViewProjection() const { return m_ViewProjection; }
+    const Frustum& GetFrustum() const { return m_Frustum; }
 
     const glm::vec3& GetPosition() const { return m_Position; }
     const glm::quat& GetOrientation() const { return m_Orientation; }
@@ -48,6 +50,7 @@ public:
 
 private:
     glm::mat4 m_ViewMatrix, m_ProjectionMatrix, m_ViewProjection;
+    Frustum m_Frustum;
     glm::vec3 m_Position, m_FocalPoint;
     glm::quat m_Orientation;
     glm::vec3 m_UpDirection, m_RightDirection, m_ForwardDirection;
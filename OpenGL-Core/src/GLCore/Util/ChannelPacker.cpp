@@ -0,0 +1,133 @@
+#include "glpch.h"
+#include "ChannelPacker.h"
+
+#include "AssetPack.h"
+#include "ImageCache.h"
+#include "MipChainBuilder.h"
+
+#include <filesystem>
+#include <future>
+
+#include <stb_image.h>
+
+namespace GLCore::Utils {
+
+	struct SourceImage
+	{
+		uint8_t* Pixels = nullptr;
+		int Width = 0, Height = 0, Channels = 0;
+	};
+
+	static bool IsUpToDate(const std::vector<ChannelSource>& sources, const std::string& outputPath)
+	{
+		std::error_code error;
+		auto outputTime = std::filesystem::last_write_time(outputPath, error);
+		if (error)
+			return false;
+
+		ImageData header;
+		if (!ReadImageCacheHeader(outputPath, header) || header.Channels != sources.size() || header.MipCount == 1)
+			return false;
+
+		for (const ChannelSource& source : sources)
+		{
+			if (source.Path.empty())
+				continue;
+
+			auto sourceTime = std::filesystem::last_write_time(source.Path, error);
+			if (error || sourceTime > outputTime)
+				return false;
+		}
+		return true;
+	}
+
+	bool PackChannels(const std::vector<ChannelSource>& sources, const std::string& outputPath, uint32_t threadCount)
+	{
+		GLCORE_ASSERT(!sources.empty() && sources.size() <= 4, "Can only pack 1 to 4 channels");
+
+		// A packed map was imported when the pack was built
+		if (AssetPack::FindMounted(outputPath) || IsUpToDate(sources, outputPath))
+			return true;
+
+		// Decode the sources in parallel, PNG inflate dominates the import time
+		std::vector<std::future<SourceImage>> decodes;
+		for (const ChannelSource& source : sources)
+		{
+			decodes.push_back(std::async(std::launch::async, [path = source.Path]()
+			{
+				SourceImage image;
+				if (!path.empty())
+					image.Pixels = stbi_load(path.c_str(), &image.Width, &image.Height, &image.Channels, 0);
+				return image;
+			}));
+		}
+
+		std::vector<SourceImage> images;
+		for (auto& decode : decodes)
+			images.push_back(decode.get());
+
+		ImageData packed;
+		packed.Channels = (uint32_t)sources.size();
+
+		bool valid = true;
+		for (size_t i = 0; i < sources.size(); i++)
+		{
+			if (sources[i].Path.empty())
+				continue;
+
+			if (!images[i].Pixels)
+			{
+				LOG_ERROR("Texture failed to load at path: {0}", sources[i].Path);
+				valid = false;
+			}
+			else if (packed.Width == 0)
+			{
+				packed.Width = images[i].Width;
+				packed.Height = images[i].Height;
+			}
+			else if (packed.Width != (uint32_t)images[i].Width || packed.Height != (uint32_t)images[i].Height)
+			{
+				LOG_ERROR("Cannot pack '{0}': {1}x{2} does not match {3}x{4}", sources[i].Path, images[i].Width, images[i].Height, packed.Width, packed.Height);
+				valid = false;
+			}
+		}
+
+		if (valid && packed.Width > 0)
+		{
+			size_t texelCount = (size_t)packed.Width * packed.Height;
+			packed.Pixels.resize(texelCount * packed.Channels);
+			for (size_t c = 0; c < sources.size(); c++)
+			{
+				const SourceImage& image = images[c];
+				if (!image.Pixels)
+				{
+					for (size_t i = 0; i < texelCount; i++)
+						packed.Pixels[i * packed.Channels + c] = sources[c].Default;
+					continue;
+				}
+
+				uint32_t channel = std::min(sources[c].Channel, (uint32_t)image.Channels - 1);
+				for (size_t i = 0; i < texelCount; i++)
+					packed.Pixels[i * packed.Channels + c] = image.Pixels[i * image.Channels + channel];
+			}
+		}
+
+		for (SourceImage& image : images)
+			stbi_image_free(image.Pixels);
+
+		if (!valid || packed.Width == 0)
+			return false;
+
+		// Packed channels are all data, so the chain is filtered without any colour space conversion
+		MipChainSettings settings;
+		settings.ThreadCount = threadCount;
+		BuildMipChain(packed, settings);
+
+		if (!WriteImageCache(outputPath, packed))
+			return false;
+
+		LOG_INFO("Packed {0} channels into '{1}' ({2}x{3})", packed.Channels, outputPath, packed.Width, packed.Height);
+		return true;
+	}
+
+}
@@ -0,0 +1,22 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+namespace GLCore::Utils {
+
+	struct ChannelSource
+	{
+		std::string Path;
+		uint32_t Channel = 0;      // channel of the source image to take
+		uint8_t Default = 255;     // used when the path is empty
+	};
+
+	// Import step that interleaves single-channel maps (e.g. AO / roughness / metallic / height)
+	// into one image cache with a prebuilt mip chain, so a material needs one fetch and one
+	// file instead of several.
+	// The output is rebuilt only when it is missing or older than one of its sources.
+	// threadCount bounds the mip chain filtering, 0 = hardware concurrency.
+	bool PackChannels(const std::vector<ChannelSource>& sources, const std::string& outputPath, uint32_t threadCount = 0);
+
+}
@@ -0,0 +1,298 @@
+#include "glpch.h"
+#include "CommandBuffer.h"
+
+#include <glad/glad.h>
+
+namespace GLCore::Utils {
+
+	struct BindCommand
+	{
+		uint32_t Target;
+		uint32_t Object;
+	};
+
+	struct BindVertexBufferCommand
+	{
+		uint32_t VertexArray;
+		uint32_t Binding;
+		uint32_t Buffer;
+		uint32_t Stride;
+		uint64_t Offset;
+	};
+
+	struct BindBufferCommand
+	{
+		uint32_t Binding;
+		uint32_t Buffer;
+		uint64_t Offset;
+		uint64_t Size;
+	};
+
+	struct UniformCommand
+	{
+		uint32_t Program;
+		int32_t Location;
+		uint32_t Type;
+		uint32_t Padding;
+	};
+
+	struct DrawCommand
+	{
+		uint32_t Primitive;
+		uint32_t Count;
+		uint32_t First;
+		int32_t BaseVertex;
+		uint32_t InstanceCount;
+		uint32_t BaseInstance;
+	};
+
+	struct DrawIndirectCommand
+	{
+		uint32_t Primitive;
+		uint32_t Buffer;
+		uint64_t Offset;
+		uint32_t DrawCount;
+		uint32_t Stride;
+	};
+
+	struct DispatchCommand
+	{
+		uint32_t GroupsX;
+		uint32_t GroupsY;
+		uint32_t GroupsZ;
+		uint32_t Barriers;
+	};
+
+	static GLenum ToGLPrimitive(uint32_t primitive)
+	{
+		switch ((PrimitiveType)primitive)
+		{
+			case PrimitiveType::Points:        return GL_POINTS;
+			case PrimitiveType::Lines:         return GL_LINES;
+			case PrimitiveType::Triangles:     return GL_TRIANGLES;
+			case PrimitiveType::TriangleStrip: return GL_TRIANGLE_STRIP;
+		}
+		return GL_TRIANGLES;
+	}
+
+	static GLbitfield ToGLBarriers(uint32_t barriers)
+	{
+		GLbitfield result = 0;
+		if (barriers & BarrierStorage)      result |= GL_SHADER_STORAGE_BARRIER_BIT;
+		if (barriers & BarrierIndirect)     result |= GL_COMMAND_BARRIER_BIT;
+		if (barriers & BarrierTextureFetch) result |= GL_TEXTURE_FETCH_BARRIER_BIT;
+		if (barriers & BarrierUniform)      result |= GL_UNIFORM_BARRIER_BIT;
+		return result;
+	}
+
+	void CommandBuffer::UseProgram(uint32_t program)
+	{
+		Push(CommandType::UseProgram, BindCommand{ 0, program });
+	}
+
+	void CommandBuffer::BindVertexArray(uint32_t vertexArray)
+	{
+		Push(CommandType::BindVertexArray, BindCommand{ 0, vertexArray });
+	}
+
+	void CommandBuffer::BindVertexBuffer(uint32_t vertexArray, uint32_t binding, uint32_t buffer, uint64_t offset, uint32_t stride)
+	{
+		Push(CommandType::BindVertexBuffer, BindVertexBufferCommand{ vertexArray, binding, buffer, stride, offset });
+	}
+
+	void CommandBuffer::BindTexture(uint32_t unit, uint32_t texture)
+	{
+		Push(CommandType::BindTexture, BindCommand{ unit, texture });
+	}
+
+	void CommandBuffer::BindUniformBuffer(uint32_t binding, uint32_t buffer, uint64_t offset, uint64_t size)
+	{
+		Push(CommandType::BindUniformBuffer, BindBufferCommand{ binding, buffer, offset, size });
+	}
+
+	void CommandBuffer::BindStorageBuffer(uint32_t binding, uint32_t buffer, uint64_t offset, uint64_t size)
+	{
+		Push(CommandType::BindStorageBuffer, BindBufferCommand{ binding, buffer, offset, size });
+	}
+
+	void CommandBuffer::PushUniform(const Shader& shader, UniformName name, UniformType type, const void* data, uint32_t size)
+	{
+		// Recording may run on any thread, so the program must have been resolved on the GL thread
+		// beforehand; the reflected table is then only read
+		GLCORE_ASSERT(!shader.IsLinkPending(), "Wait on the program before recording uniforms for it");
+		GLint location = shader.GetUniformLocation(name);
+		if (location < 0)
+			return;
+
+		Push(CommandType::SetUniform, UniformCommand{ shader.GetRendererID(), location, (uint32_t)type, 0 }, data, size);
+	}
+
+	void CommandBuffer::SetInt(const Shader& shader, UniformName name, int value)
+	{
+		PushUniform(shader, name, UniformType::Int, &value, sizeof(value));
+	}
+
+	void CommandBuffer::SetFloat(const Shader& shader, UniformName name, float value)
+	{
+		PushUniform(shader, name, UniformType::Float, &value, sizeof(value));
+	}
+
+	void CommandBuffer::SetFloat3(const Shader& shader, UniformName name, const glm::vec3& value)
+	{
+		PushUniform(shader, name, UniformType::Float3, &value, sizeof(value));
+	}
+
+	void CommandBuffer::SetFloat4(const Shader& shader, UniformName name, const glm::vec4& value)
+	{
+		PushUniform(shader, name, UniformType::Float4, &value, sizeof(value));
+	}
+
+	void CommandBuffer::SetMat4(const Shader& shader, UniformName name, const glm::mat4& value)
+	{
+		PushUniform(shader, name, UniformType::Mat4, &value, sizeof(value));
+	}
+
+	void CommandBuffer::Draw(PrimitiveType primitive, uint32_t vertexCount, uint32_t firstVertex, uint32_t instanceCount)
+	{
+		Push(CommandType::Draw, DrawCommand{ (uint32_t)primitive, vertexCount, firstVertex, 0, instanceCount, 0 });
+	}
+
+	void CommandBuffer::DrawIndexed(PrimitiveType primitive, uint32_t indexCount, uint32_t firstIndex, int32_t baseVertex,
+		uint32_t instanceCount, uint32_t baseInstance)
+	{
+		Push(CommandType::DrawIndexed, DrawCommand{ (uint32_t)primitive, indexCount, firstIndex, baseVertex, instanceCount, baseInstance });
+	}
+
+	void CommandBuffer::DrawIndexedIndirect(PrimitiveType primitive, uint32_t buffer, uint64_t offset, uint32_t drawCount, uint32_t stride)
+	{
+		Push(CommandType::DrawIndexedIndirect, DrawIndirectCommand{ (uint32_t)primitive, buffer, offset, drawCount, stride });
+	}
+
+	void CommandBuffer::Dispatch(uint32_t groupsX, uint32_t groupsY, uint32_t groupsZ)
+	{
+		Push(CommandType::Dispatch, DispatchCommand{ groupsX, groupsY, groupsZ, 0 });
+	}
+
+	void CommandBuffer::Barrier(uint32_t barriers)
+	{
+		Push(CommandType::Barrier, DispatchCommand{ 0, 0, 0, barriers });
+	}
+
+	void CommandBuffer::Reset()
+	{
+		m_Data.clear();
+		m_CommandCount = 0;
+	}
+
+	template<typename T>
+	static T ReadPayload(const uint8_t* data)
+	{
+		T payload;
+		memcpy(&payload, data, sizeof(T));
+		return payload;
+	}
+
+	static void BindBuffer(GLenum target, const BindBufferCommand& command)
+	{
+		if (command.Size > 0)
+			glBindBufferRange(target, command.Binding, command.Buffer, (GLintptr)command.Offset, (GLsizeiptr)command.Size);
+		else
+			glBindBufferBase(target, command.Binding, command.Buffer);
+	}
+
+	void CommandBuffer::Execute(RenderStateCache& state) const
+	{
+		const uint8_t* data = m_Data.data();
+		const uint8_t* end = data + m_Data.size();
+		while (data < end)
+		{
+			CommandHeader header = ReadPayload<CommandHeader>(data);
+			const uint8_t* payload = data + sizeof(CommandHeader);
+			data = payload + header.Size;
+
+			switch (header.Type)
+			{
+				case CommandType::UseProgram:
+					state.UseProgram(ReadPayload<BindCommand>(payload).Object);
+					break;
+				case CommandType::BindVertexArray:
+					state.BindVertexArray(ReadPayload<BindCommand>(payload).Object);
+					break;
+				case CommandType::BindVertexBuffer:
+				{
+					BindVertexBufferCommand command = ReadPayload<BindVertexBufferCommand>(payload);
+					glVertexArrayVertexBuffer(command.VertexArray, command.Binding, command.Buffer, (GLintptr)command.Offset, command.Stride);
+					break;
+				}
+				case CommandType::BindTexture:
+				{
+					BindCommand command = ReadPayload<BindCommand>(payload);
+					state.BindTextureUnit(command.Target, command.Object);
+					break;
+				}
+				case CommandType::BindUniformBuffer:
+					BindBuffer(GL_UNIFORM_BUFFER, ReadPayload<BindBufferCommand>(payload));
+					break;
+				case CommandType::BindStorageBuffer:
+					BindBuffer(GL_SHADER_STORAGE_BUFFER, ReadPayload<BindBufferCommand>(payload));
+					break;
+				case CommandType::SetUniform:
+				{
+					UniformCommand command = ReadPayload<UniformCommand>(payload);
+					const uint8_t* value = payload + sizeof(UniformCommand);
+					switch ((UniformType)command.Type)
+					{
+						case UniformType::Int:
+							glProgramUniform1iv(command.Program, command.Location, 1, (const GLint*)value);
+							break;
+						case UniformType::Float:
+							glProgramUniform1fv(command.Program, command.Location, 1, (const GLfloat*)value);
+							break;
+						case UniformType::Float3:
+							glProgramUniform3fv(command.Program, command.Location, 1, (const GLfloat*)value);
+							break;
+						case UniformType::Float4:
+							glProgramUniform4fv(command.Program, command.Location, 1, (const GLfloat*)value);
+							break;
+						case UniformType::Mat4:
+							glProgramUniformMatrix4fv(command.Program, command.Location, 1, GL_FALSE, (const GLfloat*)value);
+							break;
+					}
+					break;
+				}
+				case CommandType::Draw:
+				{
+					DrawCommand command = ReadPayload<DrawCommand>(payload);
+					glDrawArraysInstanced(ToGLPrimitive(command.Primitive), command.First, command.Count, command.InstanceCount);
+					break;
+				}
+				case CommandType::DrawIndexed:
+				{
+					DrawCommand command = ReadPayload<DrawCommand>(payload);
+					glDrawElementsInstancedBaseVertexBaseInstance(ToGLPrimitive(command.Primitive), command.Count, GL_UNSIGNED_INT,
+						(const void*)(command.First * sizeof(uint32_t)), command.InstanceCount, command.BaseVertex, command.BaseInstance);
+					break;
+				}
+				case CommandType::DrawIndexedIndirect:
+				{
+					DrawIndirectCommand command = ReadPayload<DrawIndirectCommand>(payload);
+					glBindBuffer(GL_DRAW_INDIRECT_BUFFER, command.Buffer);
+					glMultiDrawElementsIndirect(ToGLPrimitive(command.Primitive), GL_UNSIGNED_INT, (const void*)command.Offset,
+						command.DrawCount, command.Stride);
+					glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+					break;
+				}
+				case CommandType::Dispatch:
+				{
+					DispatchCommand command = ReadPayload<DispatchCommand>(payload);
+					glDispatchCompute(command.GroupsX, command.GroupsY, command.GroupsZ);
+					break;
+				}
+				case CommandType::Barrier:
+					glMemoryBarrier(ToGLBarriers(ReadPayload<DispatchCommand>(payload).Barriers));
+					break;
+			}
+		}
+	}
+
+}
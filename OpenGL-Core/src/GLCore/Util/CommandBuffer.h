@@ -0,0 +1,129 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "RenderState.h"
+#include "Shader.h"
+#include "WorkerPool.h"
+
+namespace GLCore::Utils {
+
+	enum class PrimitiveType
+	{
+		Points = 0, Lines, Triangles, TriangleStrip
+	};
+
+	enum BarrierFlags : uint32_t
+	{
+		BarrierStorage = 1 << 0,
+		BarrierIndirect = 1 << 1,
+		BarrierTextureFetch = 1 << 2,
+		BarrierUniform = 1 << 3
+	};
+
+	// Linear list of render commands: recorded on any thread, replayed on the GL thread. Recording
+	// only appends plain data to a byte array, no GL call is made until Execute. One buffer must
+	// be recorded by one thread at a time; Reset keeps the memory, so a buffer reused every frame
+	// stops allocating once it has grown to its working size.
+	//
+	// Indices are always 32-bit. Uniforms are written with glProgramUniform at replay, so they do
+	// not depend on the program that is bound when they are recorded. Their program must already be
+	// linked (Shader::Wait on the GL thread) before recording starts.
+	class CommandBuffer
+	{
+	public:
+		void UseProgram(uint32_t program);
+		void BindVertexArray(uint32_t vertexArray);
+		void BindVertexBuffer(uint32_t vertexArray, uint32_t binding, uint32_t buffer, uint64_t offset, uint32_t stride);
+		void BindTexture(uint32_t unit, uint32_t texture);
+		// size 0 binds the whole buffer
+		void BindUniformBuffer(uint32_t binding, uint32_t buffer, uint64_t offset = 0, uint64_t size = 0);
+		void BindStorageBuffer(uint32_t binding, uint32_t buffer, uint64_t offset = 0, uint64_t size = 0);
+
+		void SetInt(const Shader& shader, UniformName name, int value);
+		void SetFloat(const Shader& shader, UniformName name, float value);
+		void SetFloat3(const Shader& shader, UniformName name, const glm::vec3& value);
+		void SetFloat4(const Shader& shader, UniformName name, const glm::vec4& value);
+		void SetMat4(const Shader& shader, UniformName name, const glm::mat4& value);
+
+		void Draw(PrimitiveType primitive, uint32_t vertexCount, uint32_t firstVertex = 0, uint32_t instanceCount = 1);
+		void DrawIndexed(PrimitiveType primitive, uint32_t indexCount, uint32_t firstIndex = 0, int32_t baseVertex = 0,
+			uint32_t instanceCount = 1, uint32_t baseInstance = 0);
+		// drawCount commands of the DrawElementsIndirectCommand layout, stride 0 for tightly packed
+		void DrawIndexedIndirect(PrimitiveType primitive, uint32_t buffer, uint64_t offset, uint32_t drawCount, uint32_t stride = 0);
+		void Dispatch(uint32_t groupsX, uint32_t groupsY = 1, uint32_t groupsZ = 1);
+		void Barrier(uint32_t barriers);
+
+		// GL thread only; program, vertex array and texture binds go through the state cache
+		void Execute(RenderStateCache& state) const;
+		void Reset();
+
+		bool IsEmpty() const { return m_Data.empty(); }
+		uint32_t GetCommandCount() const { return m_CommandCount; }
+		size_t GetSize() const { return m_Data.size(); }
+	private:
+		enum class CommandType : uint32_t
+		{
+			UseProgram = 0, BindVertexArray, BindVertexBuffer, BindTexture, BindUniformBuffer, BindStorageBuffer,
+			SetUniform, Draw, DrawIndexed, DrawIndexedIndirect, Dispatch, Barrier
+		};
+
+		enum class UniformType : uint32_t
+		{
+			Int = 0, Float, Float3, Float4, Mat4
+		};
+
+		struct CommandHeader
+		{
+			CommandType Type;
+			// Payload bytes following the header
+			uint32_t Size;
+		};
+
+		template<typename T>
+		void Push(CommandType type, const T& payload, const void* extra = nullptr, uint32_t extraSize = 0)
+		{
+			CommandHeader header = { type, (uint32_t)sizeof(T) + extraSize };
+			size_t offset = m_Data.size();
+			m_Data.resize(offset + sizeof(CommandHeader) + header.Size);
+			memcpy(m_Data.data() + offset, &header, sizeof(CommandHeader));
+			memcpy(m_Data.data() + offset + sizeof(CommandHeader), &payload, sizeof(T));
+			if (extraSize)
+				memcpy(m_Data.data() + offset + sizeof(CommandHeader) + sizeof(T), extra, extraSize);
+			m_CommandCount++;
+		}
+
+		void PushUniform(const Shader& shader, UniformName name, UniformType type, const void* data, uint32_t size);
+	private:
+		std::vector<uint8_t> m_Data;
+		uint32_t m_CommandCount = 0;
+	};
+
+	// Records [0, count) into one buffer per contiguous range, the ranges spread over the pool's
+	// threads, by calling fn(buffer, begin, end). Executing the buffers in order replays the
+	// commands in the order a single thread would have recorded them. Buffers are reused across
+	// calls. With a threadCount of 1 everything is recorded inline on the calling thread, so
+	// callers size it by the work per range.
+	template<typename Fn>
+	void RecordParallel(WorkerPool& pool, std::vector<CommandBuffer>& buffers, uint32_t count, uint32_t threadCount, Fn&& fn)
+	{
+		threadCount = std::max(std::min(threadCount, count), 1u);
+		uint32_t chunk = (count + threadCount - 1) / threadCount;
+		uint32_t chunkCount = count > 0 ? (count + chunk - 1) / chunk : 0;
+
+		buffers.resize(chunkCount);
+		for (CommandBuffer& buffer : buffers)
+			buffer.Reset();
+
+		pool.ParallelFor(chunkCount, chunkCount, [&](uint32_t begin, uint32_t end)
+		{
+			for (uint32_t i = begin; i < end; i++)
+				fn(buffers[i], i * chunk, std::min((i + 1) * chunk, count));
+		});
+	}
+
+}
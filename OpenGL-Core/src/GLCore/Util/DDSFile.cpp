@@ -0,0 +1,246 @@
+#include "glpch.h"
+#include "DDSFile.h"
+
+#include <fstream>
+
+namespace GLCore::Utils {
+
+	static const uint32_t DDS_MAGIC = 0x20534444;   // "DDS "
+
+	static const uint32_t DDSD_CAPS = 0x1, DDSD_HEIGHT = 0x2, DDSD_WIDTH = 0x4, DDSD_PIXELFORMAT = 0x1000;
+	static const uint32_t DDSD_MIPMAPCOUNT = 0x20000, DDSD_LINEARSIZE = 0x80000;
+	static const uint32_t DDPF_FOURCC = 0x4;
+	static const uint32_t DDSCAPS_COMPLEX = 0x8, DDSCAPS_TEXTURE = 0x1000, DDSCAPS_MIPMAP = 0x400000;
+	static const uint32_t DDS_DIMENSION_TEXTURE2D = 3;
+
+	// CompressedImage::Tag is kept in the reserved words, marked so foreign files read as untagged
+	static const uint32_t TAG_MARKER = 0x54434C47;  // "GLCT"
+
+	enum DXGIFormat : uint32_t
+	{
+		DXGI_FORMAT_BC1_UNORM = 71,
+		DXGI_FORMAT_BC1_UNORM_SRGB = 72,
+		DXGI_FORMAT_BC4_UNORM = 80,
+		DXGI_FORMAT_BC5_UNORM = 83,
+		DXGI_FORMAT_BC6H_UF16 = 95,
+		DXGI_FORMAT_BC7_UNORM = 98,
+		DXGI_FORMAT_BC7_UNORM_SRGB = 99
+	};
+
+	struct DDSPixelFormat
+	{
+		uint32_t Size;
+		uint32_t Flags;
+		uint32_t FourCC;
+		uint32_t RGBBitCount;
+		uint32_t RBitMask, GBitMask, BBitMask, ABitMask;
+	};
+
+	struct DDSHeader
+	{
+		uint32_t Size;
+		uint32_t Flags;
+		uint32_t Height;
+		uint32_t Width;
+		uint32_t PitchOrLinearSize;
+		uint32_t Depth;
+		uint32_t MipMapCount;
+		uint32_t Reserved1[11];
+		DDSPixelFormat PixelFormat;
+		uint32_t Caps, Caps2, Caps3, Caps4;
+		uint32_t Reserved2;
+	};
+
+	struct DDSHeaderDX10
+	{
+		uint32_t DXGIFormat;
+		uint32_t ResourceDimension;
+		uint32_t MiscFlag;
+		uint32_t ArraySize;
+		uint32_t MiscFlags2;
+	};
+
+	static constexpr uint32_t MakeFourCC(char a, char b, char c, char d)
+	{
+		return (uint32_t)(uint8_t)a | ((uint32_t)(uint8_t)b << 8) | ((uint32_t)(uint8_t)c << 16) | ((uint32_t)(uint8_t)d << 24);
+	}
+
+	static uint32_t ToDXGIFormat(BlockFormat format, bool srgb)
+	{
+		switch (format)
+		{
+		case BlockFormat::BC1:  return srgb ? DXGI_FORMAT_BC1_UNORM_SRGB : DXGI_FORMAT_BC1_UNORM;
+		case BlockFormat::BC4:  return DXGI_FORMAT_BC4_UNORM;
+		case BlockFormat::BC5:  return DXGI_FORMAT_BC5_UNORM;
+		case BlockFormat::BC6H: return DXGI_FORMAT_BC6H_UF16;
+		case BlockFormat::BC7:  return srgb ? DXGI_FORMAT_BC7_UNORM_SRGB : DXGI_FORMAT_BC7_UNORM;
+		case BlockFormat::None: break;
+		}
+		return 0;
+	}
+
+	static bool FromDXGIFormat(uint32_t dxgiFormat, BlockFormat& format, bool& srgb)
+	{
+		srgb = dxgiFormat == DXGI_FORMAT_BC1_UNORM_SRGB || dxgiFormat == DXGI_FORMAT_BC7_UNORM_SRGB;
+		switch (dxgiFormat)
+		{
+		case DXGI_FORMAT_BC1_UNORM:
+		case DXGI_FORMAT_BC1_UNORM_SRGB: format = BlockFormat::BC1;  return true;
+		case DXGI_FORMAT_BC4_UNORM:      format = BlockFormat::BC4;  return true;
+		case DXGI_FORMAT_BC5_UNORM:      format = BlockFormat::BC5;  return true;
+		case DXGI_FORMAT_BC6H_UF16:      format = BlockFormat::BC6H; return true;
+		case DXGI_FORMAT_BC7_UNORM:
+		case DXGI_FORMAT_BC7_UNORM_SRGB: format = BlockFormat::BC7;  return true;
+		}
+		return false;
+	}
+
+	static const size_t MAX_HEADER_SIZE = sizeof(uint32_t) + sizeof(DDSHeader) + sizeof(DDSHeaderDX10);
+
+	static bool ParseHeaders(const uint8_t* data, size_t size, const std::string& path, CompressedImage& image, size_t& headerSize)
+	{
+		uint32_t magic;
+		DDSHeader header;
+		if (size < sizeof(magic) + sizeof(header))
+		{
+			LOG_WARN("'{0}' is not a DDS file", path);
+			return false;
+		}
+
+		memcpy(&magic, data, sizeof(magic));
+		memcpy(&header, data + sizeof(magic), sizeof(header));
+		headerSize = sizeof(magic) + sizeof(header);
+		if (magic != DDS_MAGIC || header.Size != sizeof(DDSHeader))
+		{
+			LOG_WARN("'{0}' is not a DDS file", path);
+			return false;
+		}
+
+		image.SRGB = false;
+		uint32_t fourCC = (header.PixelFormat.Flags & DDPF_FOURCC) ? header.PixelFormat.FourCC : 0;
+		if (fourCC == MakeFourCC('D', 'X', '1', '0'))
+		{
+			DDSHeaderDX10 header10;
+			if (size < headerSize + sizeof(header10))
+			{
+				LOG_WARN("'{0}' is truncated", path);
+				return false;
+			}
+
+			memcpy(&header10, data + headerSize, sizeof(header10));
+			headerSize += sizeof(header10);
+			if (header10.ResourceDimension != DDS_DIMENSION_TEXTURE2D || header10.ArraySize != 1 ||
+				!FromDXGIFormat(header10.DXGIFormat, image.Format, image.SRGB))
+			{
+				LOG_WARN("'{0}' uses an unsupported DXGI format or layout", path);
+				return false;
+			}
+		}
+		else if (fourCC == MakeFourCC('D', 'X', 'T', '1'))
+			image.Format = BlockFormat::BC1;
+		else if (fourCC == MakeFourCC('A', 'T', 'I', '1') || fourCC == MakeFourCC('B', 'C', '4', 'U'))
+			image.Format = BlockFormat::BC4;
+		else if (fourCC == MakeFourCC('A', 'T', 'I', '2') || fourCC == MakeFourCC('B', 'C', '5', 'U'))
+			image.Format = BlockFormat::BC5;
+		else
+		{
+			LOG_WARN("'{0}' is not block compressed", path);
+			return false;
+		}
+
+		image.Width = header.Width;
+		image.Height = header.Height;
+		image.MipCount = (header.Flags & DDSD_MIPMAPCOUNT) ? std::max(header.MipMapCount, 1u) : 1;
+		image.Tag = header.Reserved1[0] == TAG_MARKER ? header.Reserved1[1] : 0;
+		return true;
+	}
+
+	static bool ReadHeaders(std::ifstream& in, const std::string& path, CompressedImage& image)
+	{
+		uint8_t buffer[MAX_HEADER_SIZE];
+		in.read((char*)buffer, sizeof(buffer));
+
+		size_t headerSize;
+		if (!ParseHeaders(buffer, (size_t)in.gcount(), path, image, headerSize))
+			return false;
+
+		in.clear();
+		in.seekg(headerSize, std::ios::beg);
+		return true;
+	}
+
+	bool ReadDDSHeader(const std::string& path, CompressedImage& image)
+	{
+		std::ifstream in(path, std::ios::in | std::ios::binary);
+		return in && ReadHeaders(in, path, image);
+	}
+
+	bool ReadDDS(const std::string& path, CompressedImage& image)
+	{
+		std::ifstream in(path, std::ios::in | std::ios::binary);
+		if (!in || !ReadHeaders(in, path, image))
+			return false;
+
+		image.Data.resize(GetCompressedMipOffset(image, image.MipCount));
+		in.read((char*)image.Data.data(), image.Data.size());
+		if (!in)
+		{
+			LOG_WARN("DDS file '{0}' is truncated", path);
+			return false;
+		}
+
+		return true;
+	}
+
+	bool ParseDDS(const uint8_t* data, size_t size, const std::string& path, CompressedImage& image, const uint8_t*& blocks)
+	{
+		size_t headerSize;
+		if (!ParseHeaders(data, size, path, image, headerSize))
+			return false;
+
+		if (headerSize + GetCompressedMipOffset(image, image.MipCount) > size)
+		{
+			LOG_WARN("DDS file '{0}' is truncated", path);
+			return false;
+		}
+
+		blocks = data + headerSize;
+		return true;
+	}
+
+	bool WriteDDS(const std::string& path, const CompressedImage& image)
+	{
+		std::ofstream out(path, std::ios::out | std::ios::binary);
+		if (!out)
+		{
+			LOG_ERROR("Could not open file '{0}'", path);
+			return false;
+		}
+
+		DDSHeader header = {};
+		header.Size = sizeof(DDSHeader);
+		header.Flags = DDSD_CAPS | DDSD_HEIGHT | DDSD_WIDTH | DDSD_PIXELFORMAT | DDSD_MIPMAPCOUNT | DDSD_LINEARSIZE;
+		header.Height = image.Height;
+		header.Width = image.Width;
+		header.PitchOrLinearSize = (uint32_t)GetCompressedMipSize(image, 0);
+		header.MipMapCount = image.MipCount;
+		header.Reserved1[0] = TAG_MARKER;
+		header.Reserved1[1] = image.Tag;
+		header.PixelFormat.Size = sizeof(DDSPixelFormat);
+		header.PixelFormat.Flags = DDPF_FOURCC;
+		header.PixelFormat.FourCC = MakeFourCC('D', 'X', '1', '0');
+		header.Caps = DDSCAPS_TEXTURE | (image.MipCount > 1 ? DDSCAPS_COMPLEX | DDSCAPS_MIPMAP : 0);
+
+		DDSHeaderDX10 header10 = {};
+		header10.DXGIFormat = ToDXGIFormat(image.Format, image.SRGB);
+		header10.ResourceDimension = DDS_DIMENSION_TEXTURE2D;
+		header10.ArraySize = 1;
+
+		out.write((const char*)&DDS_MAGIC, sizeof(DDS_MAGIC));
+		out.write((const char*)&header, sizeof(header));
+		out.write((const char*)&header10, sizeof(header10));
+		out.write((const char*)image.Data.data(), image.Data.size());
+		return (bool)out;
+	}
+
+}
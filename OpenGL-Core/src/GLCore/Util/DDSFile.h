@@ -0,0 +1,18 @@
+#pragma once
+
+#include "BlockCompression.h"
+
+#include <string>
+
+namespace GLCore::Utils {
+
+	// DirectDraw Surface container with the DX10 extension header, limited to the
+	// block compressed 2D formats in BlockFormat
+	bool ReadDDS(const std::string& path, CompressedImage& image);
+	bool ReadDDSHeader(const std::string& path, CompressedImage& image);
+	// Parses a DDS file already in memory without copying, blocks points at the level data
+	// inside data and image.Data is left empty
+	bool ParseDDS(const uint8_t* data, size_t size, const std::string& path, CompressedImage& image, const uint8_t*& blocks);
+	bool WriteDDS(const std::string& path, const CompressedImage& image);
+
+}
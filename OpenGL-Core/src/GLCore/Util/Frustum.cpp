@@ -0,0 +1,84 @@
+#include "glpch.h"
+#include "Frustum.h"
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#define GLCORE_FRUSTUM_SSE
+#include <xmmintrin.h>
+#endif
+
+namespace GLCore::Utils {
+
+	Frustum::Frustum()
+		: Frustum(glm::mat4(1.0f))
+	{
+	}
+
+	Frustum::Frustum(const glm::mat4& viewProjection)
+	{
+		// Gribb/Hartmann: each plane is the last row plus or minus one of the others
+		glm::vec4 rows[4];
+		for (int i = 0; i < 4; i++)
+			rows[i] = glm::vec4(viewProjection[0][i], viewProjection[1][i], viewProjection[2][i], viewProjection[3][i]);
+
+		m_Planes[0] = rows[3] + rows[0];
+		m_Planes[1] = rows[3] - rows[0];
+		m_Planes[2] = rows[3] + rows[1];
+		m_Planes[3] = rows[3] - rows[1];
+		m_Planes[4] = rows[3] + rows[2];
+		m_Planes[5] = rows[3] - rows[2];
+
+		for (int i = 0; i < 8; i++)
+		{
+			glm::vec4 plane(0.0f, 0.0f, 0.0f, FLT_MAX);
+			if (i < 6)
+			{
+				m_Planes[i] /= glm::length(glm::vec3(m_Planes[i]));
+				plane = m_Planes[i];
+			}
+
+			m_PlaneX[i] = plane.x;
+			m_PlaneY[i] = plane.y;
+			m_PlaneZ[i] = plane.z;
+			m_PlaneW[i] = plane.w;
+		}
+	}
+
+	FrustumTest Frustum::Test(const BoundingBox& box) const
+	{
+		glm::vec3 center = box.GetCenter();
+		glm::vec3 extent = box.GetExtent();
+
+		// Signed distance of the center against the projected radius of the box on the plane normal
+#ifdef GLCORE_FRUSTUM_SSE
+		const __m128 signMask = _mm_set1_ps(-0.0f);
+		__m128 cx = _mm_set1_ps(center.x), cy = _mm_set1_ps(center.y), cz = _mm_set1_ps(center.z);
+		__m128 ex = _mm_set1_ps(extent.x), ey = _mm_set1_ps(extent.y), ez = _mm_set1_ps(extent.z);
+
+		int outside = 0, intersecting = 0;
+		for (int i = 0; i < 8; i += 4)
+		{
+			__m128 nx = _mm_load_ps(m_PlaneX + i), ny = _mm_load_ps(m_PlaneY + i), nz = _mm_load_ps(m_PlaneZ + i);
+			__m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(nx, cx), _mm_mul_ps(ny, cy)), _mm_add_ps(_mm_mul_ps(nz, cz), _mm_load_ps(m_PlaneW + i)));
+			__m128 radius = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_andnot_ps(signMask, nx), ex), _mm_mul_ps(_mm_andnot_ps(signMask, ny), ey)),
+				_mm_mul_ps(_mm_andnot_ps(signMask, nz), ez));
+
+			outside |= _mm_movemask_ps(_mm_cmplt_ps(_mm_add_ps(distance, radius), _mm_setzero_ps()));
+			intersecting |= _mm_movemask_ps(_mm_cmplt_ps(_mm_sub_ps(distance, radius), _mm_setzero_ps()));
+		}
+#else
+		bool outside = false, intersecting = false;
+		for (int i = 0; i < 6; i++)
+		{
+			float distance = m_PlaneX[i] * center.x + m_PlaneY[i] * center.y + m_PlaneZ[i] * center.z + m_PlaneW[i];
+			float radius = std::abs(m_PlaneX[i]) * extent.x + std::abs(m_PlaneY[i]) * extent.y + std::abs(m_PlaneZ[i]) * extent.z;
+			outside |= distance + radius < 0.0f;
+			intersecting |= distance - radius < 0.0f;
+		}
+#endif
+
+		if (outside)
+			return FrustumTest::Outside;
+		return intersecting ? FrustumTest::Intersecting : FrustumTest::Inside;
+	}
+
+}
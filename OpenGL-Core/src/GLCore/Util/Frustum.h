@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cfloat>
+
+#include <glm/glm.hpp>
+
+namespace GLCore::Utils {
+
+	struct BoundingBox
+	{
+		glm::vec3 Min = glm::vec3(FLT_MAX);
+		glm::vec3 Max = glm::vec3(-FLT_MAX);
+
+		BoundingBox() = default;
+		BoundingBox(const glm::vec3& min, const glm::vec3& max) : Min(min), Max(max) {}
+
+		static BoundingBox FromSphere(const glm::vec3& center, float radius) { return BoundingBox(center - radius, center + radius); }
+
+		glm::vec3 GetCenter() const { return (Min + Max) * 0.5f; }
+		glm::vec3 GetExtent() const { return (Max - Min) * 0.5f; }
+
+		void Expand(const glm::vec3& point) { Min = glm::min(Min, point); Max = glm::max(Max, point); }
+		void Expand(const BoundingBox& box) { Min = glm::min(Min, box.Min); Max = glm::max(Max, box.Max); }
+	};
+
+	enum class FrustumTest
+	{
+		Outside = 0, Intersecting = 1, Inside = 2
+	};
+
+	// Six planes (left, right, bottom, top, near, far) pointing inwards, extracted from a
+	// view-projection matrix with OpenGL clip space. Box tests run against four planes at a time.
+	class Frustum
+	{
+	public:
+		Frustum();
+		explicit Frustum(const glm::mat4& viewProjection);
+
+		FrustumTest Test(const BoundingBox& box) const;
+		bool IsVisible(const BoundingBox& box) const { return Test(box) != FrustumTest::Outside; }
+
+		const glm::vec4& GetPlane(uint32_t index) const { return m_Planes[index]; }
+	private:
+		glm::vec4 m_Planes[6];
+
+		// Planes as structure of arrays, padded to eight with planes that accept everything
+		alignas(16) float m_PlaneX[8];
+		alignas(16) float m_PlaneY[8];
+		alignas(16) float m_PlaneZ[8];
+		alignas(16) float m_PlaneW[8];
+	};
+
+}
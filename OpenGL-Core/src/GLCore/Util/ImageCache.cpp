@@ -0,0 +1,136 @@
+#include "glpch.h"
+#include "ImageCache.h"
+
+#include <fstream>
+
+namespace GLCore::Utils {
+
+	static const char IMAGE_CACHE_MAGIC[4] = { 'G', 'L', 'T', 'X' };
+	static const uint32_t IMAGE_CACHE_VERSION = 2;
+
+	struct ImageCacheHeader
+	{
+		char Magic[4];
+		uint32_t Version;
+		uint32_t Width;
+		uint32_t Height;
+		uint32_t Channels;
+		uint32_t MipCount;
+		uint32_t Tag;
+	};
+
+	bool IsImageCachePath(const std::string& path)
+	{
+		static const std::string extension = ".tex";
+		return path.size() >= extension.size() && path.compare(path.size() - extension.size(), extension.size(), extension) == 0;
+	}
+
+	uint32_t GetMipWidth(const ImageData& image, uint32_t level)
+	{
+		return std::max(image.Width >> level, 1u);
+	}
+
+	uint32_t GetMipHeight(const ImageData& image, uint32_t level)
+	{
+		return std::max(image.Height >> level, 1u);
+	}
+
+	size_t GetMipSize(const ImageData& image, uint32_t level)
+	{
+		return (size_t)GetMipWidth(image, level) * GetMipHeight(image, level) * image.Channels;
+	}
+
+	size_t GetMipOffset(const ImageData& image, uint32_t level)
+	{
+		size_t offset = 0;
+		for (uint32_t i = 0; i < level; i++)
+			offset += GetMipSize(image, i);
+		return offset;
+	}
+
+	static bool ParseHeader(const void* data, size_t size, const std::string& path, ImageData& image)
+	{
+		const ImageCacheHeader* header = (const ImageCacheHeader*)data;
+		if (size < sizeof(ImageCacheHeader) || memcmp(header->Magic, IMAGE_CACHE_MAGIC, sizeof(IMAGE_CACHE_MAGIC)) != 0 || header->Version != IMAGE_CACHE_VERSION)
+		{
+			LOG_WARN("'{0}' is not a valid image cache", path);
+			return false;
+		}
+
+		image.Width = header->Width;
+		image.Height = header->Height;
+		image.Channels = header->Channels;
+		image.MipCount = header->MipCount;
+		image.Tag = header->Tag;
+		return true;
+	}
+
+	static bool ReadHeader(std::ifstream& in, const std::string& path, ImageData& image)
+	{
+		ImageCacheHeader header;
+		in.read((char*)&header, sizeof(header));
+		return ParseHeader(&header, in ? sizeof(header) : 0, path, image);
+	}
+
+	bool ParseImageCache(const uint8_t* data, size_t size, const std::string& path, ImageData& image, const uint8_t*& pixels)
+	{
+		if (!ParseHeader(data, size, path, image))
+			return false;
+
+		if (sizeof(ImageCacheHeader) + GetMipOffset(image, image.MipCount) > size)
+		{
+			LOG_WARN("Image cache '{0}' is truncated", path);
+			return false;
+		}
+
+		pixels = data + sizeof(ImageCacheHeader);
+		return true;
+	}
+
+	bool ReadImageCacheHeader(const std::string& path, ImageData& image)
+	{
+		std::ifstream in(path, std::ios::in | std::ios::binary);
+		return in && ReadHeader(in, path, image);
+	}
+
+	bool ReadImageCache(const std::string& path, ImageData& image)
+	{
+		std::ifstream in(path, std::ios::in | std::ios::binary);
+		if (!in || !ReadHeader(in, path, image))
+			return false;
+
+		image.Pixels.resize(GetMipOffset(image, image.MipCount));
+		in.read((char*)image.Pixels.data(), image.Pixels.size());
+		if (!in)
+		{
+			LOG_WARN("Image cache '{0}' is truncated", path);
+			return false;
+		}
+
+		return true;
+	}
+
+	bool WriteImageCache(const std::string& path, const ImageData& image)
+	{
+		std::ofstream out(path, std::ios::out | std::ios::binary);
+		if (!out)
+		{
+			LOG_ERROR("Could not open file '{0}'", path);
+			return false;
+		}
+
+		ImageCacheHeader header;
+		memcpy(header.Magic, IMAGE_CACHE_MAGIC, sizeof(IMAGE_CACHE_MAGIC));
+		header.Version = IMAGE_CACHE_VERSION;
+		header.Width = image.Width;
+		header.Height = image.Height;
+		header.Channels = image.Channels;
+		header.MipCount = image.MipCount;
+		header.Tag = image.Tag;
+
+		out.write((const char*)&header, sizeof(header));
+		out.write((const char*)image.Pixels.data(), image.Pixels.size());
+		return (bool)out;
+	}
+
+}
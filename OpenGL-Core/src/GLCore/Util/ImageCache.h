@@ -0,0 +1,35 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+namespace GLCore::Utils {
+
+	// 8-bit image stored uncompressed, loads with a single read and no decode.
+	// Pixels holds MipCount levels back to back, largest first.
+	struct ImageData
+	{
+		uint32_t Width = 0;
+		uint32_t Height = 0;
+		uint32_t Channels = 0;
+		uint32_t MipCount = 1;
+		uint32_t Tag = 0;          // free for the producer, e.g. to detect changed build settings
+		std::vector<uint8_t> Pixels;
+	};
+
+	bool IsImageCachePath(const std::string& path);
+
+	uint32_t GetMipWidth(const ImageData& image, uint32_t level);
+	uint32_t GetMipHeight(const ImageData& image, uint32_t level);
+	size_t GetMipOffset(const ImageData& image, uint32_t level);
+	size_t GetMipSize(const ImageData& image, uint32_t level);
+
+	// Fills everything except Pixels, for cheap validation of an existing cache
+	bool ReadImageCacheHeader(const std::string& path, ImageData& image);
+	bool ReadImageCache(const std::string& path, ImageData& image);
+	// Parses an image cache already in memory (e.g. a mapped asset pack) without copying,
+	// pixels points at the level data inside data and image.Pixels is left empty
+	bool ParseImageCache(const uint8_t* data, size_t size, const std::string& path, ImageData& image, const uint8_t*& pixels);
+	bool WriteImageCache(const std::string& path, const ImageData& image);
+
+}
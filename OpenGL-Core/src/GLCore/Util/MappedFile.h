@@ -0,0 +1,33 @@
+#pragma once
+
+#include <string>
+
+namespace GLCore::Utils {
+
+	// Read-only view of a whole file mapped into the address space
+	class MappedFile
+	{
+	public:
+		MappedFile() = default;
+		~MappedFile();
+
+		MappedFile(const MappedFile&) = delete;
+		MappedFile& operator=(const MappedFile&) = delete;
+
+		bool Open(const std::string& path);
+		void Close();
+
+		const uint8_t* GetData() const { return m_Data; }
+		size_t GetSize() const { return m_Size; }
+		bool IsOpen() const { return m_Data != nullptr; }
+	private:
+		const uint8_t* m_Data = nullptr;
+		size_t m_Size = 0;
+
+	#ifdef GLCORE_PLATFORM_WINDOWS
+		void* m_FileHandle = nullptr;
+		void* m_MappingHandle = nullptr;
+	#endif
+	};
+
+}
@@ -0,0 +1,149 @@
+#include "glpch.h"
+#include "MeshCache.h"
+
+#include <fstream>
+
+namespace GLCore::Utils {
+
+	static const char MESH_CACHE_MAGIC[4] = { 'G', 'L', 'M', 'S' };
+	static const uint32_t MESH_CACHE_VERSION = 2;
+
+	struct MeshCacheHeader
+	{
+		char Magic[4];
+		uint32_t Version;
+		uint32_t VertexCount;
+		uint32_t IndexCount;
+		uint32_t SubMeshCount;
+		uint32_t Tag;
+		glm::vec3 BoundsMin;
+		glm::vec3 BoundsMax;
+	};
+
+	bool IsMeshCachePath(const std::string& path)
+	{
+		static const std::string extension = ".mesh";
+		return path.size() >= extension.size() && path.compare(path.size() - extension.size(), extension.size(), extension) == 0;
+	}
+
+	static bool IsHeaderValid(const MeshCacheHeader& header, size_t size, const std::string& path)
+	{
+		if (size < sizeof(MeshCacheHeader) || memcmp(header.Magic, MESH_CACHE_MAGIC, sizeof(MESH_CACHE_MAGIC)) != 0 || header.Version != MESH_CACHE_VERSION)
+		{
+			LOG_WARN("'{0}' is not a valid mesh cache", path);
+			return false;
+		}
+
+		return true;
+	}
+
+	static bool ReadHeader(std::ifstream& in, const std::string& path, MeshCacheHeader& header)
+	{
+		in.read((char*)&header, sizeof(header));
+		return IsHeaderValid(header, in ? sizeof(header) : 0, path);
+	}
+
+	static size_t GetPayloadSize(const MeshCacheHeader& header)
+	{
+		return (size_t)header.VertexCount * sizeof(MeshVertex) + (size_t)header.IndexCount * sizeof(uint32_t)
+			+ (size_t)header.SubMeshCount * sizeof(SubMesh);
+	}
+
+	static void AllocateMesh(const MeshCacheHeader& header, MeshData& mesh)
+	{
+		mesh.Vertices.resize(header.VertexCount);
+		mesh.Indices.resize(header.IndexCount);
+		mesh.SubMeshes.resize(header.SubMeshCount);
+		mesh.BoundsMin = header.BoundsMin;
+		mesh.BoundsMax = header.BoundsMax;
+		mesh.Tag = header.Tag;
+	}
+
+	bool ReadMeshCacheTag(const std::string& path, uint32_t& tag)
+	{
+		std::ifstream in(path, std::ios::in | std::ios::binary);
+		if (!in)
+			return false;
+
+		MeshCacheHeader header;
+		if (!ReadHeader(in, path, header))
+			return false;
+
+		tag = header.Tag;
+		return true;
+	}
+
+	bool ReadMeshCache(const std::string& path, MeshData& mesh)
+	{
+		std::ifstream in(path, std::ios::in | std::ios::binary);
+		if (!in)
+			return false;
+
+		MeshCacheHeader header;
+		if (!ReadHeader(in, path, header))
+			return false;
+
+		AllocateMesh(header, mesh);
+		in.read((char*)mesh.Vertices.data(), mesh.Vertices.size() * sizeof(MeshVertex));
+		in.read((char*)mesh.Indices.data(), mesh.Indices.size() * sizeof(uint32_t));
+		in.read((char*)mesh.SubMeshes.data(), mesh.SubMeshes.size() * sizeof(SubMesh));
+		if (!in)
+		{
+			LOG_WARN("Mesh cache '{0}' is truncated", path);
+			return false;
+		}
+
+		return true;
+	}
+
+	bool ParseMeshCache(const uint8_t* data, size_t size, const std::string& path, MeshData& mesh)
+	{
+		MeshCacheHeader header;
+		if (size >= sizeof(header))
+			memcpy(&header, data, sizeof(header));
+		if (!IsHeaderValid(header, size, path))
+			return false;
+
+		if (sizeof(MeshCacheHeader) + GetPayloadSize(header) > size)
+		{
+			LOG_WARN("Mesh cache '{0}' is truncated", path);
+			return false;
+		}
+
+		AllocateMesh(header, mesh);
+		const uint8_t* payload = data + sizeof(MeshCacheHeader);
+		memcpy(mesh.Vertices.data(), payload, mesh.Vertices.size() * sizeof(MeshVertex));
+		payload += mesh.Vertices.size() * sizeof(MeshVertex);
+		memcpy(mesh.Indices.data(), payload, mesh.Indices.size() * sizeof(uint32_t));
+		payload += mesh.Indices.size() * sizeof(uint32_t);
+		memcpy(mesh.SubMeshes.data(), payload, mesh.SubMeshes.size() * sizeof(SubMesh));
+		return true;
+	}
+
+	bool WriteMeshCache(const std::string& path, const MeshData& mesh)
+	{
+		std::ofstream out(path, std::ios::out | std::ios::binary);
+		if (!out)
+		{
+			LOG_ERROR("Could not open file '{0}'", path);
+			return false;
+		}
+
+		MeshCacheHeader header;
+		memcpy(header.Magic, MESH_CACHE_MAGIC, sizeof(MESH_CACHE_MAGIC));
+		header.Version = MESH_CACHE_VERSION;
+		header.VertexCount = (uint32_t)mesh.Vertices.size();
+		header.IndexCount = (uint32_t)mesh.Indices.size();
+		header.SubMeshCount = (uint32_t)mesh.SubMeshes.size();
+		header.Tag = mesh.Tag;
+		header.BoundsMin = mesh.BoundsMin;
+		header.BoundsMax = mesh.BoundsMax;
+
+		out.write((const char*)&header, sizeof(header));
+		out.write((const char*)mesh.Vertices.data(), mesh.Vertices.size() * sizeof(MeshVertex));
+		out.write((const char*)mesh.Indices.data(), mesh.Indices.size() * sizeof(uint32_t));
+		out.write((const char*)mesh.SubMeshes.data(), mesh.SubMeshes.size() * sizeof(SubMesh));
+		return (bool)out;
+	}
+
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+namespace GLCore::Utils {
+
+	struct MeshVertex
+	{
+		glm::vec3 Position;
+		glm::vec3 Normal;
+		glm::vec4 Tangent;   // w is the bitangent sign
+		glm::vec2 TexCoord;
+	};
+
+	// Index range of one source mesh, indices are relative to BaseVertex.
+	// Coarser LODs index the same vertices, LOD 0 is FirstIndex / IndexCount.
+	struct SubMesh
+	{
+		static const uint32_t MAX_LODS = 4;
+
+		uint32_t FirstIndex = 0;
+		uint32_t IndexCount = 0;
+		uint32_t BaseVertex = 0;
+		uint32_t VertexCount = 0;
+		uint32_t MaterialIndex = 0;
+		glm::vec3 BoundsMin = glm::vec3(0.0f);
+		glm::vec3 BoundsMax = glm::vec3(0.0f);
+		uint32_t LODCount = 1;
+		uint32_t LODFirstIndex[MAX_LODS] = {};
+		uint32_t LODIndexCount[MAX_LODS] = {};
+	};
+
+	// Imported triangle mesh stored as one vertex and index array, loads with a single read and no processing
+	struct MeshData
+	{
+		std::vector<MeshVertex> Vertices;
+		std::vector<uint32_t> Indices;
+		std::vector<SubMesh> SubMeshes;
+		glm::vec3 BoundsMin = glm::vec3(0.0f);
+		glm::vec3 BoundsMax = glm::vec3(0.0f);
+		uint32_t Tag = 0;          // free for the producer, e.g. to detect changed import settings
+	};
+
+	bool IsMeshCachePath(const std::string& path);
+
+	// Reads only the tag, for cheap validation of an existing cache
+	bool ReadMeshCacheTag(const std::string& path, uint32_t& tag);
+	bool ReadMeshCache(const std::string& path, MeshData& mesh);
+	bool ParseMeshCache(const uint8_t* data, size_t size, const std::string& path, MeshData& mesh);
+	bool WriteMeshCache(const std::string& path, const MeshData& mesh);
+
+}
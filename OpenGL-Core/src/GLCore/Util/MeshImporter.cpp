@@ -0,0 +1,381 @@
+#include "glpch.h"
+#include "MeshImporter.h"
+
+#include "AssetPack.h"
+#include "MeshLOD.h"
+#include "MeshOptimizer.h"
+#include "ParallelFor.h"
+
+#include <filesystem>
+
+#include <assimp/Importer.hpp>
+#include <assimp/postprocess.h>
+#include <assimp/scene.h>
+
+namespace GLCore::Utils {
+
+	static const uint32_t IMPORT_FLAGS = aiProcess_Triangulate | aiProcess_GenSmoothNormals | aiProcess_CalcTangentSpace
+		| aiProcess_JoinIdenticalVertices | aiProcess_SortByPType | aiProcess_PreTransformVertices
+		| aiProcess_FindInvalidData | aiProcess_ValidateDataStructure;
+
+	static uint32_t GetSettingsTag(const MeshImportSettings& settings)
+	{
+		return (uint32_t)settings.FlipUVs | ((uint32_t)settings.OptimizeIndices << 1) | (std::min(settings.LODCount, SubMesh::MAX_LODS) << 2);
+	}
+
+	static bool IsCacheValid(const std::string& sourcePath, const std::string& cachePath, uint32_t tag)
+	{
+		std::error_code error;
+		auto cacheTime = std::filesystem::last_write_time(cachePath, error);
+		if (error)
+			return false;
+
+		auto sourceTime = std::filesystem::last_write_time(sourcePath, error);
+		if (error || sourceTime > cacheTime)
+			return false;
+
+		uint32_t cacheTag;
+		return ReadMeshCacheTag(cachePath, cacheTag) && cacheTag == tag;
+	}
+
+	static void ConvertScene(const aiScene* scene, MeshData& mesh)
+	{
+		mesh.BoundsMin = glm::vec3(FLT_MAX);
+		mesh.BoundsMax = glm::vec3(-FLT_MAX);
+
+		for (uint32_t m = 0; m < scene->mNumMeshes; m++)
+		{
+			const aiMesh* source = scene->mMeshes[m];
+			if (!(source->mPrimitiveTypes & aiPrimitiveType_TRIANGLE))
+				continue;
+
+			SubMesh subMesh;
+			subMesh.FirstIndex = (uint32_t)mesh.Indices.size();
+			subMesh.BaseVertex = (uint32_t)mesh.Vertices.size();
+			subMesh.VertexCount = source->mNumVertices;
+			subMesh.MaterialIndex = source->mMaterialIndex;
+			subMesh.BoundsMin = glm::vec3(FLT_MAX);
+			subMesh.BoundsMax = glm::vec3(-FLT_MAX);
+
+			for (uint32_t i = 0; i < source->mNumVertices; i++)
+			{
+				MeshVertex vertex;
+				vertex.Position = glm::vec3(source->mVertices[i].x, source->mVertices[i].y, source->mVertices[i].z);
+				vertex.Normal = source->HasNormals() ? glm::vec3(source->mNormals[i].x, source->mNormals[i].y, source->mNormals[i].z) : glm::vec3(0.0f, 1.0f, 0.0f);
+				vertex.Tangent = glm::vec4(1.0f, 0.0f, 0.0f, 1.0f);
+				if (source->HasTangentsAndBitangents())
+				{
+					glm::vec3 tangent(source->mTangents[i].x, source->mTangents[i].y, source->mTangents[i].z);
+					glm::vec3 bitangent(source->mBitangents[i].x, source->mBitangents[i].y, source->mBitangents[i].z);
+					float sign = glm::dot(glm::cross(vertex.Normal, tangent), bitangent) < 0.0f ? -1.0f : 1.0f;
+					vertex.Tangent = glm::vec4(tangent, sign);
+				}
+				vertex.TexCoord = source->HasTextureCoords(0) ? glm::vec2(source->mTextureCoords[0][i].x, source->mTextureCoords[0][i].y) : glm::vec2(0.0f);
+				mesh.Vertices.push_back(vertex);
+
+				subMesh.BoundsMin = glm::min(subMesh.BoundsMin, vertex.Position);
+				subMesh.BoundsMax = glm::max(subMesh.BoundsMax, vertex.Position);
+			}
+
+			for (uint32_t f = 0; f < source->mNumFaces; f++)
+			{
+				const aiFace& face = source->mFaces[f];
+				if (face.mNumIndices == 3)
+					mesh.Indices.insert(mesh.Indices.end(), { face.mIndices[0], face.mIndices[1], face.mIndices[2] });
+			}
+
+			subMesh.IndexCount = (uint32_t)mesh.Indices.size() - subMesh.FirstIndex;
+			subMesh.LODFirstIndex[0] = subMesh.FirstIndex;
+			subMesh.LODIndexCount[0] = subMesh.IndexCount;
+			mesh.BoundsMin = glm::min(mesh.BoundsMin, subMesh.BoundsMin);
+			mesh.BoundsMax = glm::max(mesh.BoundsMax, subMesh.BoundsMax);
+			mesh.SubMeshes.push_back(subMesh);
+		}
+	}
+
+	// Submeshes own disjoint vertex and index ranges, so they are optimized in parallel
+	static void OptimizeSubMeshes(MeshData& mesh)
+	{
+		ParallelFor((uint32_t)mesh.SubMeshes.size(), GetWorkerThreadCount(), [&mesh](uint32_t begin, uint32_t end)
+		{
+			for (uint32_t s = begin; s < end; s++)
+			{
+				const SubMesh& subMesh = mesh.SubMeshes[s];
+				auto first = mesh.Indices.begin() + subMesh.FirstIndex;
+
+				std::vector<uint32_t> indices(first, first + subMesh.IndexCount);
+				indices = OptimizeVertexCache(indices, subMesh.VertexCount);
+
+				std::vector<uint32_t> remap = GenerateVertexFetchRemap(indices, subMesh.VertexCount);
+				RemapVertexBuffer((uint8_t*)&mesh.Vertices[subMesh.BaseVertex], subMesh.VertexCount, sizeof(MeshVertex), remap);
+				RemapIndexBuffer(indices, remap);
+				std::copy(indices.begin(), indices.end(), first);
+			}
+		});
+	}
+
+	// Coarser levels are simplified per submesh in parallel and appended after all full-detail indices
+	static void BuildSubMeshLODs(MeshData& mesh, uint32_t lodCount, bool optimize)
+	{
+		std::vector<std::vector<std::vector<uint32_t>>> chains(mesh.SubMeshes.size());
+		ParallelFor((uint32_t)mesh.SubMeshes.size(), GetWorkerThreadCount(), [&](uint32_t begin, uint32_t end)
+		{
+			std::vector<glm::vec3> positions;
+			for (uint32_t s = begin; s < end; s++)
+			{
+				const SubMesh& subMesh = mesh.SubMeshes[s];
+				positions.resize(subMesh.VertexCount);
+				for (uint32_t i = 0; i < subMesh.VertexCount; i++)
+					positions[i] = mesh.Vertices[subMesh.BaseVertex + i].Position;
+
+				auto first = mesh.Indices.begin() + subMesh.FirstIndex;
+				std::vector<uint32_t> indices(first, first + subMesh.IndexCount);
+				chains[s] = BuildLODChain(positions.data(), positions.size(), indices, lodCount);
+
+				// Vertices are shared with LOD 0, so only the triangle order is optimized
+				if (optimize)
+				{
+					for (size_t lod = 1; lod < chains[s].size(); lod++)
+						chains[s][lod] = OptimizeVertexCache(chains[s][lod], subMesh.VertexCount);
+				}
+			}
+		});
+
+		for (size_t s = 0; s < mesh.SubMeshes.size(); s++)
+		{
+			SubMesh& subMesh = mesh.SubMeshes[s];
+			subMesh.LODCount = (uint32_t)chains[s].size();
+			for (uint32_t lod = 1; lod < subMesh.LODCount; lod++)
+			{
+				subMesh.LODFirstIndex[lod] = (uint32_t)mesh.Indices.size();
+				subMesh.LODIndexCount[lod] = (uint32_t)chains[s][lod].size();
+				mesh.Indices.insert(mesh.Indices.end(), chains[s][lod].begin(), chains[s][lod].end());
+			}
+		}
+	}
+
+	bool ImportMesh(const std::string& path, MeshData& mesh, const MeshImportSettings& settings)
+	{
+		std::string cachePath = path + ".mesh";
+		uint32_t tag = GetSettingsTag(settings);
+
+		if (AssetSpan span = AssetPack::FindMounted(cachePath))
+		{
+			if (ParseMeshCache(span.Data, span.Size, cachePath, mesh) && mesh.Tag == tag)
+				return true;
+		}
+
+		if (IsCacheValid(path, cachePath, tag) && ReadMeshCache(cachePath, mesh))
+			return true;
+
+		auto start = std::chrono::high_resolution_clock::now();
+
+		Assimp::Importer importer;
+		importer.SetPropertyInteger(AI_CONFIG_PP_SBP_REMOVE, aiPrimitiveType_POINT | aiPrimitiveType_LINE);
+		uint32_t flags = IMPORT_FLAGS | (settings.FlipUVs ? (uint32_t)aiProcess_FlipUVs : 0u);
+
+		// Packed sources are read from the mapping, Assimp only needs the extension as a format hint
+		const aiScene* scene;
+		AssetSpan source = AssetPack::FindMounted(path);
+		if (source)
+		{
+			std::string extension = path.substr(path.find_last_of('.') + 1);
+			scene = importer.ReadFileFromMemory(source.Data, source.Size, flags, extension.c_str());
+		}
+		else
+		{
+			scene = importer.ReadFile(path, flags);
+		}
+
+		if (!scene || (scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE) || !scene->HasMeshes())
+		{
+			LOG_ERROR("Could not import '{0}': {1}", path, importer.GetErrorString());
+			return false;
+		}
+
+		mesh = MeshData();
+		ConvertScene(scene, mesh);
+		if (mesh.Indices.empty())
+		{
+			LOG_ERROR("'{0}' contains no triangles", path);
+			return false;
+		}
+
+		if (settings.OptimizeIndices)
+			OptimizeSubMeshes(mesh);
+		if (settings.LODCount > 1)
+			BuildSubMeshLODs(mesh, std::min(settings.LODCount, SubMesh::MAX_LODS), settings.OptimizeIndices);
+
+		mesh.Tag = tag;
+
+		float milliseconds = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+		LOG_INFO("Imported '{0}' ({1} vertices, {2} triangles, {3} submeshes) in {4} ms", path, mesh.Vertices.size(), mesh.Indices.size() / 3, mesh.SubMeshes.size(), milliseconds);
+
+		// The pack is read-only, sources found there are imported every run
+		if (!source && !WriteMeshCache(cachePath, mesh))
+			LOG_WARN("Could not write mesh cache '{0}'", cachePath);
+		return true;
+	}
+
+	Mesh::~Mesh()
+	{
+		if (m_VertexArray)
+		{
+			glDeleteVertexArrays(1, &m_VertexArray);
+			glDeleteBuffers(1, &m_VertexBuffer);
+			glDeleteBuffers(1, &m_IndexBuffer);
+		}
+	}
+
+	uint32_t Mesh::GetTriangleCount(uint32_t lod) const
+	{
+		uint32_t indexCount = 0;
+		for (const SubMesh& subMesh : m_SubMeshes)
+			indexCount += subMesh.LODIndexCount[std::min(lod, subMesh.LODCount - 1)];
+		return indexCount / 3;
+	}
+
+	void Mesh::Draw(uint32_t lod) const
+	{
+		if (!m_Loaded)
+			return;
+
+		glBindVertexArray(m_VertexArray);
+		DrawSubMeshes(lod);
+	}
+
+	void Mesh::DrawSubMeshes(uint32_t lod) const
+	{
+		if (!m_Loaded)
+			return;
+
+		for (const SubMesh& subMesh : m_SubMeshes)
+		{
+			uint32_t level = std::min(lod, subMesh.LODCount - 1);
+			glDrawElementsBaseVertex(GL_TRIANGLES, subMesh.LODIndexCount[level], GL_UNSIGNED_INT,
+				(const void*)(subMesh.LODFirstIndex[level] * sizeof(uint32_t)), subMesh.BaseVertex);
+		}
+	}
+
+	MeshLoader::MeshLoader(uint32_t workerCount)
+	{
+		// Imports are few and large, half the cores leaves room for the texture workers
+		if (workerCount == 0)
+			workerCount = std::max(std::thread::hardware_concurrency() / 2, 1u);
+
+		for (uint32_t i = 0; i < workerCount; i++)
+			m_Workers.emplace_back(&MeshLoader::WorkerThread, this);
+	}
+
+	MeshLoader::~MeshLoader()
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_RequestMutex);
+			m_Running = false;
+		}
+		m_RequestCondition.notify_all();
+		for (std::thread& worker : m_Workers)
+			worker.join();
+	}
+
+	std::shared_ptr<Mesh> MeshLoader::Load(const std::string& path, const MeshImportSettings& settings)
+	{
+		auto mesh = std::make_shared<Mesh>();
+		mesh->m_Path = path;
+
+		Request request;
+		request.Target = mesh;
+		request.Settings = settings;
+		request.Start = std::chrono::high_resolution_clock::now();
+
+		m_PendingCount++;
+		{
+			std::lock_guard<std::mutex> lock(m_RequestMutex);
+			m_Requests.push_back(std::move(request));
+		}
+		m_RequestCondition.notify_one();
+
+		return mesh;
+	}
+
+	void MeshLoader::WorkerThread()
+	{
+		while (true)
+		{
+			Request request;
+			{
+				std::unique_lock<std::mutex> lock(m_RequestMutex);
+				m_RequestCondition.wait(lock, [this]() { return !m_Running || !m_Requests.empty(); });
+				if (!m_Running)
+					return;
+
+				request = std::move(m_Requests.front());
+				m_Requests.pop_front();
+			}
+
+			request.Success = ImportMesh(request.Target->m_Path, request.Data, request.Settings);
+
+			std::lock_guard<std::mutex> lock(m_ImportedMutex);
+			m_Imported.push_back(std::move(request));
+		}
+	}
+
+	void MeshLoader::Update()
+	{
+		std::deque<Request> imported;
+		{
+			std::lock_guard<std::mutex> lock(m_ImportedMutex);
+			std::swap(imported, m_Imported);
+		}
+
+		for (Request& request : imported)
+		{
+			if (request.Success)
+				Upload(request);
+			else
+				request.Target->m_Failed = true;
+
+			m_PendingCount--;
+		}
+	}
+
+	void MeshLoader::Upload(Request& request)
+	{
+		Mesh& mesh = *request.Target;
+		const MeshData& data = request.Data;
+
+		// Uniform scale so normals stay valid under the dequantize transform
+		glm::vec3 center = (data.BoundsMin + data.BoundsMax) * 0.5f;
+		glm::vec3 halfExtent = (data.BoundsMax - data.BoundsMin) * 0.5f;
+		float scale = std::max(std::max(halfExtent.x, halfExtent.y), std::max(halfExtent.z, 1e-6f));
+		mesh.m_Dequantize = glm::scale(glm::translate(glm::mat4(1.0f), center), glm::vec3(scale));
+
+		std::vector<uint8_t> vertices(data.Vertices.size() * MeshVertexLayout::Stride);
+		for (size_t i = 0; i < data.Vertices.size(); i++)
+		{
+			const MeshVertex& vertex = data.Vertices[i];
+			MeshVertexLayout::Write(&vertices[i * MeshVertexLayout::Stride], (vertex.Position - center) / scale,
+				{ vertex.Normal, glm::vec3(vertex.Tangent), vertex.Tangent.w }, vertex.TexCoord);
+		}
+
+		glCreateBuffers(1, &mesh.m_VertexBuffer);
+		glNamedBufferStorage(mesh.m_VertexBuffer, vertices.size(), vertices.data(), 0);
+
+		glCreateBuffers(1, &mesh.m_IndexBuffer);
+		glNamedBufferStorage(mesh.m_IndexBuffer, data.Indices.size() * sizeof(uint32_t), data.Indices.data(), 0);
+
+		glCreateVertexArrays(1, &mesh.m_VertexArray);
+		MeshVertexLayout::Apply(mesh.m_VertexArray, mesh.m_VertexBuffer);
+		glVertexArrayElementBuffer(mesh.m_VertexArray, mesh.m_IndexBuffer);
+
+		mesh.m_SubMeshes = data.SubMeshes;
+		mesh.m_VertexCount = (uint32_t)data.Vertices.size();
+		for (const SubMesh& subMesh : data.SubMeshes)
+			mesh.m_LODCount = std::max(mesh.m_LODCount, subMesh.LODCount);
+		mesh.m_BoundsMin = data.BoundsMin;
+		mesh.m_BoundsMax = data.BoundsMax;
+		mesh.m_LoadTime = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - request.Start).count();
+		mesh.m_Loaded = true;
+	}
+
+}
@@ -0,0 +1,121 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <glad/glad.h>
+
+#include "MeshCache.h"
+#include "VertexLayout.h"
+
+namespace GLCore::Utils {
+
+	struct MeshImportSettings
+	{
+		bool FlipUVs = false;
+		// Reorder each submesh for the vertex cache and vertex fetch (see MeshOptimizer.h)
+		bool OptimizeIndices = true;
+		// Levels of detail per submesh built with the quadric simplifier (see MeshLOD.h), up to SubMesh::MAX_LODS
+		uint32_t LODCount = SubMesh::MAX_LODS;
+	};
+
+	// Imports a model through Assimp: triangulated, with smooth normals and tangents, identical vertices
+	// merged, the node hierarchy baked into the vertices and a simplified LOD chain appended to the
+	// indices of each submesh. The result is cached next to the source
+	// (<path>.mesh) and reused while it is newer than the source. A mounted AssetPack is searched
+	// first for the cache, then for the source.
+	bool ImportMesh(const std::string& path, MeshData& mesh, const MeshImportSettings& settings = MeshImportSettings());
+
+	// GPU vertex, 20 bytes. Positions are quantized to the mesh bounds, see Mesh::GetDequantize.
+	using MeshVertexLayout = VertexLayout<SNorm16Position, OctahedralTangentFrame, Float2>;
+
+	class Mesh
+	{
+	public:
+		~Mesh();
+
+		bool IsLoaded() const { return m_Loaded; }
+		bool IsFailed() const { return m_Failed; }
+
+		const std::string& GetPath() const { return m_Path; }
+		GLuint GetVertexArray() const { return m_VertexArray; }
+		const std::vector<SubMesh>& GetSubMeshes() const { return m_SubMeshes; }
+		uint32_t GetVertexCount() const { return m_VertexCount; }
+		uint32_t GetTriangleCount(uint32_t lod = 0) const;
+		uint32_t GetLODCount() const { return m_LODCount; }
+		const glm::vec3& GetBoundsMin() const { return m_BoundsMin; }
+		const glm::vec3& GetBoundsMax() const { return m_BoundsMax; }
+		// Maps quantized positions back to model space, applied before the model matrix
+		const glm::mat4& GetDequantize() const { return m_Dequantize; }
+		// Milliseconds from the load request to the upload
+		float GetLoadTime() const { return m_LoadTime; }
+
+		// Draws every submesh with the currently bound program, submeshes with fewer levels use their coarsest
+		void Draw(uint32_t lod = 0) const;
+		// Same with the vertex array of GetVertexArray already bound by the caller
+		void DrawSubMeshes(uint32_t lod = 0) const;
+	private:
+		friend class MeshLoader;
+
+		std::string m_Path;
+		GLuint m_VertexArray = 0;
+		GLuint m_VertexBuffer = 0;
+		GLuint m_IndexBuffer = 0;
+		std::vector<SubMesh> m_SubMeshes;
+		uint32_t m_VertexCount = 0;
+		uint32_t m_LODCount = 1;
+		glm::vec3 m_BoundsMin = glm::vec3(0.0f);
+		glm::vec3 m_BoundsMax = glm::vec3(0.0f);
+		glm::mat4 m_Dequantize = glm::mat4(1.0f);
+		float m_LoadTime = 0.0f;
+		bool m_Loaded = false;
+		bool m_Failed = false;
+	};
+
+	// Imports meshes (see ImportMesh) on worker threads and uploads them on the GL thread.
+	// Update() must be called once per frame on the GL thread.
+	class MeshLoader
+	{
+	public:
+		MeshLoader(uint32_t workerCount = 0);
+		~MeshLoader();
+
+		std::shared_ptr<Mesh> Load(const std::string& path, const MeshImportSettings& settings = MeshImportSettings());
+
+		void Update();
+
+		uint32_t GetPendingCount() const { return m_PendingCount; }
+	private:
+		struct Request
+		{
+			std::shared_ptr<Mesh> Target;
+			MeshImportSettings Settings;
+			MeshData Data;
+			bool Success = false;
+			std::chrono::high_resolution_clock::time_point Start;
+		};
+
+		void WorkerThread();
+		void Upload(Request& request);
+	private:
+		std::vector<std::thread> m_Workers;
+		std::atomic<bool> m_Running = true;
+
+		std::mutex m_RequestMutex;
+		std::condition_variable m_RequestCondition;
+		std::deque<Request> m_Requests;
+
+		std::mutex m_ImportedMutex;
+		std::deque<Request> m_Imported;
+
+		std::atomic<uint32_t> m_PendingCount = 0;
+	};
+
+}
@@ -0,0 +1,312 @@
+#include "glpch.h"
+#include "MeshLOD.h"
+
+#include <unordered_map>
+
+namespace GLCore::Utils {
+
+	namespace {
+
+		// Symmetric 4x4 matrix, sum of squared distances to a set of planes
+		struct Quadric
+		{
+			double A00 = 0, A01 = 0, A02 = 0, A11 = 0, A12 = 0, A22 = 0;
+			double B0 = 0, B1 = 0, B2 = 0;
+			double C = 0;
+
+			static Quadric FromPlane(const glm::dvec3& n, double d, double weight)
+			{
+				Quadric q;
+				q.A00 = n.x * n.x * weight; q.A01 = n.x * n.y * weight; q.A02 = n.x * n.z * weight;
+				q.A11 = n.y * n.y * weight; q.A12 = n.y * n.z * weight; q.A22 = n.z * n.z * weight;
+				q.B0 = n.x * d * weight; q.B1 = n.y * d * weight; q.B2 = n.z * d * weight;
+				q.C = d * d * weight;
+				return q;
+			}
+
+			Quadric& operator+=(const Quadric& o)
+			{
+				A00 += o.A00; A01 += o.A01; A02 += o.A02; A11 += o.A11; A12 += o.A12; A22 += o.A22;
+				B0 += o.B0; B1 += o.B1; B2 += o.B2;
+				C += o.C;
+				return *this;
+			}
+
+			double Evaluate(const glm::vec3& p) const
+			{
+				double x = p.x, y = p.y, z = p.z;
+				double error = A00 * x * x + 2.0 * A01 * x * y + 2.0 * A02 * x * z + A11 * y * y + 2.0 * A12 * y * z + A22 * z * z
+					+ 2.0 * (B0 * x + B1 * y + B2 * z) + C;
+				return error > 0.0 ? error : 0.0;
+			}
+		};
+
+		struct Collapse
+		{
+			uint32_t From, To;
+			double Cost;
+		};
+
+		struct PositionHash
+		{
+			size_t operator()(const glm::vec3& p) const
+			{
+				uint32_t bits[3];
+				memcpy(bits, &p, sizeof(bits));
+				return (bits[0] * 73856093u) ^ (bits[1] * 19349663u) ^ (bits[2] * 83492791u);
+			}
+		};
+
+		uint64_t EdgeKey(uint32_t a, uint32_t b)
+		{
+			return a < b ? (uint64_t)a << 32 | b : (uint64_t)b << 32 | a;
+		}
+
+	}
+
+	std::vector<uint32_t> SimplifyMesh(const glm::vec3* positions, size_t vertexCount, const std::vector<uint32_t>& indices,
+		size_t targetIndexCount, float* error)
+	{
+		GLCORE_ASSERT(indices.size() % 3 == 0, "SimplifyMesh expects a triangle list");
+
+		if (error)
+			*error = 0.0f;
+
+		std::vector<uint32_t> result = indices;
+		if (result.size() <= targetIndexCount)
+			return result;
+
+		// Vertices that only differ in attributes share a position, they are simplified as one
+		// point and, since only one of them could be moved at a time, locked
+		std::vector<uint32_t> remap(vertexCount);
+		std::vector<uint32_t> wedgeCount(vertexCount, 0);
+		{
+			std::unordered_map<glm::vec3, uint32_t, PositionHash> unique;
+			unique.reserve(vertexCount);
+			for (uint32_t i = 0; i < vertexCount; i++)
+			{
+				remap[i] = unique.emplace(positions[i], i).first->second;
+				wedgeCount[remap[i]]++;
+			}
+		}
+
+		std::vector<bool> locked(vertexCount, false);
+		for (uint32_t i = 0; i < vertexCount; i++)
+			locked[i] = wedgeCount[remap[i]] > 1;
+
+		// Edges used by a single triangle are on an open border
+		{
+			std::unordered_map<uint64_t, uint32_t> edgeUse;
+			edgeUse.reserve(result.size());
+			for (size_t i = 0; i < result.size(); i += 3)
+				for (int e = 0; e < 3; e++)
+					edgeUse[EdgeKey(remap[result[i + e]], remap[result[i + (e + 1) % 3]])]++;
+
+			for (size_t i = 0; i < result.size(); i += 3)
+			{
+				for (int e = 0; e < 3; e++)
+				{
+					uint32_t a = result[i + e], b = result[i + (e + 1) % 3];
+					if (edgeUse[EdgeKey(remap[a], remap[b])] == 1)
+						locked[a] = locked[b] = true;
+				}
+			}
+		}
+
+		// Area weighted plane quadrics, accumulated on the shared position
+		std::vector<Quadric> quadrics(vertexCount);
+		for (size_t i = 0; i < result.size(); i += 3)
+		{
+			glm::dvec3 p0 = positions[result[i]], p1 = positions[result[i + 1]], p2 = positions[result[i + 2]];
+			glm::dvec3 n = glm::cross(p1 - p0, p2 - p0);
+			double area = glm::length(n);
+			if (area <= 0.0)
+				continue;
+
+			n /= area;
+			Quadric q = Quadric::FromPlane(n, -glm::dot(n, p0), area * 0.5);
+			for (int k = 0; k < 3; k++)
+				quadrics[remap[result[i + k]]] += q;
+		}
+
+		auto flips = [&](const uint32_t* triangle, uint32_t from, uint32_t to)
+		{
+			glm::vec3 before[3], after[3];
+			for (int k = 0; k < 3; k++)
+			{
+				before[k] = positions[triangle[k]];
+				after[k] = triangle[k] == from ? positions[to] : before[k];
+			}
+
+			glm::vec3 n0 = glm::cross(before[1] - before[0], before[2] - before[0]);
+			glm::vec3 n1 = glm::cross(after[1] - after[0], after[2] - after[0]);
+			return glm::dot(n0, n1) <= 0.25f * glm::length(n0) * glm::length(n1);
+		};
+
+		std::vector<uint32_t> triangleOffsets(vertexCount + 1);
+		std::vector<uint32_t> vertexTriangles;
+		std::vector<Collapse> collapses;
+		std::vector<bool> touched(vertexCount);
+		double maxError = 0.0;
+
+		// Each pass collapses the cheapest edges whose neighbourhoods do not overlap, so the
+		// adjacency built at the start of the pass stays valid for every collapse in it
+		while (result.size() > targetIndexCount)
+		{
+			size_t triangleCount = result.size() / 3;
+
+			std::fill(triangleOffsets.begin(), triangleOffsets.end(), 0);
+			for (uint32_t index : result)
+				triangleOffsets[index + 1]++;
+			for (size_t i = 0; i < vertexCount; i++)
+				triangleOffsets[i + 1] += triangleOffsets[i];
+
+			vertexTriangles.resize(result.size());
+			std::vector<uint32_t> fill(triangleOffsets.begin(), triangleOffsets.end() - 1);
+			for (size_t i = 0; i < result.size(); i++)
+				vertexTriangles[fill[result[i]]++] = (uint32_t)(i / 3);
+
+			collapses.clear();
+			for (size_t i = 0; i < result.size(); i += 3)
+			{
+				for (int e = 0; e < 3; e++)
+				{
+					uint32_t a = result[i + e], b = result[i + (e + 1) % 3];
+					Quadric q = quadrics[remap[a]];
+					q += quadrics[remap[b]];
+					if (!locked[a])
+						collapses.push_back({ a, b, q.Evaluate(positions[b]) });
+					if (!locked[b])
+						collapses.push_back({ b, a, q.Evaluate(positions[a]) });
+				}
+			}
+
+			if (collapses.empty())
+				break;
+
+			std::sort(collapses.begin(), collapses.end(), [](const Collapse& a, const Collapse& b) { return a.Cost < b.Cost; });
+
+			std::fill(touched.begin(), touched.end(), false);
+			size_t removed = 0;
+			size_t toRemove = triangleCount - targetIndexCount / 3;
+
+			for (const Collapse& collapse : collapses)
+			{
+				if (removed >= toRemove)
+					break;
+
+				if (touched[collapse.From] || touched[collapse.To])
+					continue;
+
+				uint32_t first = triangleOffsets[collapse.From], last = triangleOffsets[collapse.From + 1];
+
+				bool valid = true;
+				uint32_t degenerate = 0;
+				for (uint32_t t = first; t < last && valid; t++)
+				{
+					const uint32_t* triangle = &result[vertexTriangles[t] * 3];
+					bool shared = false;
+					for (int k = 0; k < 3; k++)
+					{
+						shared |= remap[triangle[k]] == remap[collapse.To];
+						valid &= !touched[triangle[k]];
+					}
+
+					if (shared)
+						degenerate++;
+					else if (valid)
+						valid = !flips(triangle, collapse.From, collapse.To);
+				}
+
+				if (!valid)
+					continue;
+
+				for (uint32_t t = first; t < last; t++)
+				{
+					uint32_t* triangle = &result[vertexTriangles[t] * 3];
+					for (int k = 0; k < 3; k++)
+					{
+						touched[triangle[k]] = true;
+						if (triangle[k] == collapse.From)
+							triangle[k] = collapse.To;
+					}
+				}
+
+				quadrics[remap[collapse.To]] += quadrics[remap[collapse.From]];
+				maxError = std::max(maxError, collapse.Cost);
+				removed += degenerate;
+			}
+
+			if (removed == 0)
+				break;
+
+			size_t write = 0;
+			for (size_t i = 0; i < result.size(); i += 3)
+			{
+				uint32_t a = remap[result[i]], b = remap[result[i + 1]], c = remap[result[i + 2]];
+				if (a == b || b == c || a == c)
+					continue;
+
+				result[write++] = result[i];
+				result[write++] = result[i + 1];
+				result[write++] = result[i + 2];
+			}
+			result.resize(write);
+		}
+
+		if (error)
+			*error = (float)maxError;
+
+		return result;
+	}
+
+	std::vector<std::vector<uint32_t>> BuildLODChain(const glm::vec3* positions, size_t vertexCount, const std::vector<uint32_t>& indices,
+		uint32_t maxLODCount, float ratio)
+	{
+		std::vector<std::vector<uint32_t>> lods;
+		lods.push_back(indices);
+
+		while (lods.size() < maxLODCount)
+		{
+			const std::vector<uint32_t>& previous = lods.back();
+			size_t target = (size_t)(previous.size() / 3 * ratio) * 3;
+
+			float error;
+			std::vector<uint32_t> lod = SimplifyMesh(positions, vertexCount, previous, target, &error);
+			if (lod.empty() || lod.size() > previous.size() * 0.9f)
+				break;
+
+			LOG_INFO("LOD {0}: {1} triangles, error {2}", lods.size(), lod.size() / 3, std::sqrt(error));
+			lods.push_back(std::move(lod));
+		}
+
+		return lods;
+	}
+
+	float GetProjectedSize(const glm::vec3& center, float radius, const glm::vec3& viewPosition, float projectionScale)
+	{
+		float distance = glm::length(center - viewPosition);
+		if (distance <= radius)
+			return FLT_MAX;
+
+		return 2.0f * radius * projectionScale / distance;
+	}
+
+	uint32_t SelectLOD(float projectedSize, uint32_t currentLOD, const float* thresholds, uint32_t thresholdCount, float hysteresis)
+	{
+		uint32_t lod = 0;
+		while (lod < thresholdCount && projectedSize < thresholds[lod])
+			lod++;
+
+		if (lod == currentLOD || currentLOD > thresholdCount)
+			return lod;
+
+		float lower = currentLOD < thresholdCount ? thresholds[currentLOD] * (1.0f - hysteresis) : 0.0f;
+		float upper = currentLOD > 0 ? thresholds[currentLOD - 1] * (1.0f + hysteresis) : FLT_MAX;
+		if (projectedSize >= lower && projectedSize < upper)
+			return currentLOD;
+
+		return lod;
+	}
+
+}
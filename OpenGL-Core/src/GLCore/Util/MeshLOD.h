@@ -0,0 +1,30 @@
+#pragma once
+
+#include <vector>
+
+#include <glm/glm.hpp>
+
+namespace GLCore::Utils {
+
+	// Quadric error edge collapse on an indexed triangle list. Vertices are only ever merged into
+	// existing vertices, so the result indexes the same vertex buffer and attributes stay valid.
+	// Vertices on open borders and on attribute seams (several vertices at one position) are kept.
+	// Stops at targetIndexCount or when no collapse keeps every triangle facing the same way.
+	// error receives the largest quadric error (squared distance) that was accepted.
+	std::vector<uint32_t> SimplifyMesh(const glm::vec3* positions, size_t vertexCount, const std::vector<uint32_t>& indices,
+		size_t targetIndexCount, float* error = nullptr);
+
+	// LOD 0 is indices itself, each further level keeps about ratio of the triangles of the previous one.
+	// Ends early once a level no longer gets noticeably smaller.
+	std::vector<std::vector<uint32_t>> BuildLODChain(const glm::vec3* positions, size_t vertexCount, const std::vector<uint32_t>& indices,
+		uint32_t maxLODCount, float ratio = 0.5f);
+
+	// Diameter in pixels of a bounding sphere, projectionScale = projection[1][1] * viewportHeight / 2
+	float GetProjectedSize(const glm::vec3& center, float radius, const glm::vec3& viewPosition, float projectionScale);
+
+	// thresholds[i] is the smallest projected size LOD i is used at (descending, one per LOD except
+	// the last). The current LOD is kept until the size leaves its range by more than hysteresis
+	// (relative), so objects near a boundary do not switch back and forth every frame.
+	uint32_t SelectLOD(float projectedSize, uint32_t currentLOD, const float* thresholds, uint32_t thresholdCount, float hysteresis = 0.15f);
+
+}
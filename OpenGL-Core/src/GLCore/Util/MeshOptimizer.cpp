@@ -0,0 +1,310 @@
+#include "glpch.h"
+#include "MeshOptimizer.h"
+
+namespace GLCore::Utils {
+
+	namespace {
+
+		// Forsyth's scoring, tuned for a 32 entry LRU cache
+		static const int32_t CACHE_SIZE = 32;
+		static const float CACHE_DECAY_POWER = 1.5f;
+		static const float LAST_TRIANGLE_SCORE = 0.75f;
+		static const float VALENCE_BOOST_SCALE = 2.0f;
+		static const float VALENCE_BOOST_POWER = 0.5f;
+
+		float VertexScore(int32_t cachePosition, uint32_t remainingTriangles)
+		{
+			if (remainingTriangles == 0)
+				return -1.0f;
+
+			float score = 0.0f;
+			if (cachePosition >= 0)
+			{
+				// The last triangle's vertices get a fixed score so it is not simply repeated
+				if (cachePosition < 3)
+					score = LAST_TRIANGLE_SCORE;
+				else
+					score = std::pow(1.0f - (float)(cachePosition - 3) / (float)(CACHE_SIZE - 3), CACHE_DECAY_POWER);
+			}
+
+			// Vertices with few triangles left are finished off first to avoid isolated leftovers
+			return score + VALENCE_BOOST_SCALE * std::pow((float)remainingTriangles, -VALENCE_BOOST_POWER);
+		}
+
+	}
+
+	VertexCacheStats AnalyzeVertexCache(const std::vector<uint32_t>& indices, size_t vertexCount, uint32_t cacheSize)
+	{
+		VertexCacheStats stats;
+		if (indices.empty())
+			return stats;
+
+		// Timestamp of the vertex's entry into the cache, it is resident while fewer than cacheSize misses followed
+		std::vector<uint32_t> entry(vertexCount, 0);
+		std::vector<bool> referenced(vertexCount, false);
+		uint32_t misses = 0;
+		uint32_t unique = 0;
+
+		for (uint32_t index : indices)
+		{
+			if (!referenced[index])
+			{
+				referenced[index] = true;
+				unique++;
+			}
+
+			if (entry[index] == 0 || misses - entry[index] >= cacheSize)
+			{
+				misses++;
+				entry[index] = misses;
+			}
+		}
+
+		stats.ACMR = (float)misses / (float)(indices.size() / 3);
+		stats.ATVR = (float)misses / (float)unique;
+		return stats;
+	}
+
+	std::vector<uint32_t> ConvertStripToList(const std::vector<uint32_t>& strip)
+	{
+		std::vector<uint32_t> list;
+		list.reserve(strip.size() > 2 ? (strip.size() - 2) * 3 : 0);
+
+		for (size_t i = 2; i < strip.size(); i++)
+		{
+			uint32_t a = strip[i - 2], b = strip[i - 1], c = strip[i];
+			if (a == b || b == c || a == c)
+				continue;
+
+			// Every other triangle of a strip is wound the other way
+			if (i % 2 == 0)
+				list.insert(list.end(), { a, b, c });
+			else
+				list.insert(list.end(), { b, a, c });
+		}
+
+		return list;
+	}
+
+	std::vector<uint32_t> OptimizeVertexCache(const std::vector<uint32_t>& indices, size_t vertexCount)
+	{
+		GLCORE_ASSERT(indices.size() % 3 == 0, "OptimizeVertexCache expects a triangle list");
+
+		size_t triangleCount = indices.size() / 3;
+		std::vector<uint32_t> result;
+		result.reserve(indices.size());
+
+		// Triangles of each vertex, entries of emitted triangles are swapped out of the live range
+		std::vector<uint32_t> offsets(vertexCount + 1, 0);
+		for (uint32_t index : indices)
+			offsets[index + 1]++;
+		for (size_t i = 0; i < vertexCount; i++)
+			offsets[i + 1] += offsets[i];
+
+		std::vector<uint32_t> liveCount(vertexCount, 0);
+		std::vector<uint32_t> vertexTriangles(indices.size());
+		for (size_t i = 0; i < indices.size(); i++)
+		{
+			uint32_t vertex = indices[i];
+			vertexTriangles[offsets[vertex] + liveCount[vertex]++] = (uint32_t)(i / 3);
+		}
+
+		std::vector<int32_t> cachePosition(vertexCount, -1);
+		std::vector<float> vertexScores(vertexCount);
+		for (size_t i = 0; i < vertexCount; i++)
+			vertexScores[i] = VertexScore(-1, liveCount[i]);
+
+		std::vector<float> triangleScores(triangleCount);
+		for (size_t t = 0; t < triangleCount; t++)
+			triangleScores[t] = vertexScores[indices[t * 3]] + vertexScores[indices[t * 3 + 1]] + vertexScores[indices[t * 3 + 2]];
+
+		std::vector<bool> emitted(triangleCount, false);
+		std::vector<uint32_t> cache, nextCache;
+		cache.reserve(CACHE_SIZE + 3);
+		nextCache.reserve(CACHE_SIZE + 3);
+
+		int64_t best = -1;
+		size_t cursor = 0;
+		for (size_t emittedCount = 0; emittedCount < triangleCount; emittedCount++)
+		{
+			// Nothing in the cache has triangles left, continue with the next unemitted triangle
+			if (best < 0)
+			{
+				while (emitted[cursor])
+					cursor++;
+				best = (int64_t)cursor;
+			}
+
+			const uint32_t* triangle = &indices[best * 3];
+			result.insert(result.end(), triangle, triangle + 3);
+			emitted[best] = true;
+
+			for (int k = 0; k < 3; k++)
+			{
+				uint32_t vertex = triangle[k];
+				uint32_t* live = &vertexTriangles[offsets[vertex]];
+				for (uint32_t i = 0; i < liveCount[vertex]; i++)
+				{
+					if (live[i] == (uint32_t)best)
+					{
+						std::swap(live[i], live[liveCount[vertex] - 1]);
+						liveCount[vertex]--;
+						break;
+					}
+				}
+			}
+
+			// Most recently used first, the vertices pushed past the end leave the cache
+			nextCache.assign(triangle, triangle + 3);
+			for (uint32_t vertex : cache)
+				if (vertex != triangle[0] && vertex != triangle[1] && vertex != triangle[2])
+					nextCache.push_back(vertex);
+
+			for (size_t i = 0; i < nextCache.size(); i++)
+			{
+				uint32_t vertex = nextCache[i];
+				cachePosition[vertex] = i < CACHE_SIZE ? (int32_t)i : -1;
+				vertexScores[vertex] = VertexScore(cachePosition[vertex], liveCount[vertex]);
+			}
+
+			// Only triangles around vertices whose score changed need to be rescored
+			best = -1;
+			float bestScore = -1.0f;
+			for (uint32_t vertex : nextCache)
+			{
+				const uint32_t* live = &vertexTriangles[offsets[vertex]];
+				for (uint32_t i = 0; i < liveCount[vertex]; i++)
+				{
+					uint32_t t = live[i];
+					float score = vertexScores[indices[t * 3]] + vertexScores[indices[t * 3 + 1]] + vertexScores[indices[t * 3 + 2]];
+					triangleScores[t] = score;
+					if (score > bestScore)
+					{
+						bestScore = score;
+						best = t;
+					}
+				}
+			}
+
+			if (nextCache.size() > CACHE_SIZE)
+				nextCache.resize(CACHE_SIZE);
+			std::swap(cache, nextCache);
+		}
+
+		return result;
+	}
+
+	std::vector<uint32_t> OptimizeOverdraw(const std::vector<uint32_t>& indices, const glm::vec3* positions, size_t vertexCount,
+		float threshold)
+	{
+		GLCORE_ASSERT(indices.size() % 3 == 0, "OptimizeOverdraw expects a triangle list");
+
+		static const uint32_t CLUSTER_CACHE_SIZE = 16;
+
+		size_t triangleCount = indices.size() / 3;
+		if (triangleCount < 2)
+			return indices;
+
+		// A triangle missing on all three vertices starts a cold cache, reordering there costs nothing
+		std::vector<uint32_t> clusters;
+		{
+			std::vector<uint32_t> entry(vertexCount, 0);
+			uint32_t misses = 0;
+			for (size_t t = 0; t < triangleCount; t++)
+			{
+				uint32_t triangleMisses = 0;
+				for (int k = 0; k < 3; k++)
+				{
+					uint32_t index = indices[t * 3 + k];
+					if (entry[index] == 0 || misses - entry[index] >= CLUSTER_CACHE_SIZE)
+					{
+						misses++;
+						triangleMisses++;
+						entry[index] = misses;
+					}
+				}
+
+				if (t == 0 || triangleMisses == 3)
+					clusters.push_back((uint32_t)t);
+			}
+		}
+		clusters.push_back((uint32_t)triangleCount);
+
+		if (clusters.size() <= 2)
+			return indices;
+
+		glm::vec3 meshCentroid(0.0f);
+		for (size_t i = 0; i < vertexCount; i++)
+			meshCentroid += positions[i];
+		meshCentroid /= (float)vertexCount;
+
+		// Clusters facing away from the centre are most likely to occlude the rest of the mesh
+		struct Cluster
+		{
+			uint32_t First, Last;
+			float SortKey;
+		};
+		std::vector<Cluster> sorted(clusters.size() - 1);
+		for (size_t c = 0; c + 1 < clusters.size(); c++)
+		{
+			glm::vec3 centroid(0.0f), normal(0.0f);
+			float area = 0.0f;
+			for (uint32_t t = clusters[c]; t < clusters[c + 1]; t++)
+			{
+				glm::vec3 p0 = positions[indices[t * 3]], p1 = positions[indices[t * 3 + 1]], p2 = positions[indices[t * 3 + 2]];
+				glm::vec3 n = glm::cross(p1 - p0, p2 - p0);
+				float triangleArea = glm::length(n);
+				centroid += (p0 + p1 + p2) * (triangleArea / 3.0f);
+				normal += n;
+				area += triangleArea;
+			}
+
+			centroid = area > 0.0f ? centroid / area : positions[indices[clusters[c] * 3]];
+			float normalLength = glm::length(normal);
+			normal = normalLength > 0.0f ? normal / normalLength : glm::vec3(0.0f);
+			sorted[c] = { clusters[c], clusters[c + 1], glm::dot(centroid - meshCentroid, normal) };
+		}
+
+		std::stable_sort(sorted.begin(), sorted.end(), [](const Cluster& a, const Cluster& b) { return a.SortKey > b.SortKey; });
+
+		std::vector<uint32_t> result;
+		result.reserve(indices.size());
+		for (const Cluster& cluster : sorted)
+			result.insert(result.end(), indices.begin() + cluster.First * 3, indices.begin() + cluster.Last * 3);
+
+		float before = AnalyzeVertexCache(indices, vertexCount, CLUSTER_CACHE_SIZE).ACMR;
+		float after = AnalyzeVertexCache(result, vertexCount, CLUSTER_CACHE_SIZE).ACMR;
+		return after <= before * threshold ? result : indices;
+	}
+
+	std::vector<uint32_t> GenerateVertexFetchRemap(const std::vector<uint32_t>& indices, size_t vertexCount)
+	{
+		static const uint32_t UNUSED = ~0u;
+
+		std::vector<uint32_t> remap(vertexCount, UNUSED);
+		uint32_t next = 0;
+		for (uint32_t index : indices)
+			if (remap[index] == UNUSED)
+				remap[index] = next++;
+
+		for (uint32_t& target : remap)
+			if (target == UNUSED)
+				target = next++;
+
+		return remap;
+	}
+
+	void RemapVertexBuffer(uint8_t* vertices, size_t vertexCount, size_t stride, const std::vector<uint32_t>& remap)
+	{
+		std::vector<uint8_t> source(vertices, vertices + vertexCount * stride);
+		for (size_t i = 0; i < vertexCount; i++)
+			memcpy(vertices + remap[i] * stride, &source[i * stride], stride);
+	}
+
+	void RemapIndexBuffer(std::vector<uint32_t>& indices, const std::vector<uint32_t>& remap)
+	{
+		for (uint32_t& index : indices)
+			index = remap[index];
+	}
+
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <vector>
+
+#include <glm/glm.hpp>
+
+namespace GLCore::Utils {
+
+	struct VertexCacheStats
+	{
+		float ACMR = 0.0f;   // transformed vertices per triangle, 0.5 is the lower bound on closed meshes
+		float ATVR = 0.0f;   // transformed vertices per referenced vertex, 1.0 is ideal
+	};
+
+	// Simulates a FIFO post-transform cache over a triangle list
+	VertexCacheStats AnalyzeVertexCache(const std::vector<uint32_t>& indices, size_t vertexCount, uint32_t cacheSize = 16);
+
+	// Triangle list from a strip, restarting winding on every triangle and dropping the degenerate ones
+	std::vector<uint32_t> ConvertStripToList(const std::vector<uint32_t>& strip);
+
+	// Reorders triangles for the post-transform cache (Forsyth, "Linear-Speed Vertex Cache Optimisation")
+	std::vector<uint32_t> OptimizeVertexCache(const std::vector<uint32_t>& indices, size_t vertexCount);
+
+	// Reorders clusters of a cache optimized list so outward facing parts of the mesh draw first.
+	// Clusters are split where the cache starts cold, the result is kept only if the ACMR grows
+	// by less than threshold.
+	std::vector<uint32_t> OptimizeOverdraw(const std::vector<uint32_t>& indices, const glm::vec3* positions, size_t vertexCount,
+		float threshold = 1.05f);
+
+	// Vertex order in which indices first reference them, unreferenced vertices are moved to the end.
+	// remap[old] = new, the same table can be applied to every index buffer drawing from the vertices.
+	std::vector<uint32_t> GenerateVertexFetchRemap(const std::vector<uint32_t>& indices, size_t vertexCount);
+	void RemapVertexBuffer(uint8_t* vertices, size_t vertexCount, size_t stride, const std::vector<uint32_t>& remap);
+	void RemapIndexBuffer(std::vector<uint32_t>& indices, const std::vector<uint32_t>& remap);
+
+}
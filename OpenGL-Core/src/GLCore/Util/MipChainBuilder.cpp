@@ -0,0 +1,278 @@
+#include "glpch.h"
+#include "MipChainBuilder.h"
+
+#include "ParallelFor.h"
+#include "TextureFormat.h"
+
+#include <filesystem>
+
+#include <glm/glm.hpp>
+#include <stb_image.h>
+
+#if defined(_M_X64) || defined(__SSE2__)
+	#include <xmmintrin.h>
+	#define GLCORE_MIP_SSE 1
+#endif
+
+namespace GLCore::Utils {
+
+	static const float PI = 3.14159265359f;
+
+	// 2:1 kernels, taps per side in source texels
+	static const int BOX_RADIUS = 1;
+	static const int KAISER_RADIUS = 4;
+	static const float KAISER_ALPHA = 4.0f;
+
+	struct FloatImage
+	{
+		uint32_t Width = 0, Height = 0;
+		std::vector<glm::vec4> Texels;
+	};
+
+	static uint32_t GetSettingsTag(const MipChainSettings& settings)
+	{
+		return ((uint32_t)settings.Filter << 8) | (uint32_t)settings.Content;
+	}
+
+	static inline uint32_t Wrap(int index, uint32_t size)
+	{
+		int n = (int)size;
+		return (uint32_t)(((index % n) + n) % n);
+	}
+
+	// Zeroth-order modified Bessel function of the first kind
+	static float BesselI0(float x)
+	{
+		float sum = 1.0f, term = 1.0f;
+		for (int k = 1; k < 16; k++)
+		{
+			term *= (x / (2.0f * k)) * (x / (2.0f * k));
+			sum += term;
+		}
+		return sum;
+	}
+
+	static std::vector<float> CreateKernel(MipFilter filter)
+	{
+		int radius = filter == MipFilter::Kaiser ? KAISER_RADIUS : BOX_RADIUS;
+
+		// Taps sit at source offsets -radius + 1 ... radius around 2x, i.e. j - 0.5 texels from the destination centre
+		std::vector<float> weights;
+		float sum = 0.0f;
+		for (int j = -radius + 1; j <= radius; j++)
+		{
+			float weight = 1.0f;
+			if (filter == MipFilter::Kaiser)
+			{
+				float t = (j - 0.5f) * 0.5f;     // in destination texels
+				float window = t / (radius * 0.5f);
+				float sinc = std::sin(PI * t) / (PI * t);
+				weight = sinc * BesselI0(KAISER_ALPHA * std::sqrt(std::max(1.0f - window * window, 0.0f))) / BesselI0(KAISER_ALPHA);
+			}
+			weights.push_back(weight);
+			sum += weight;
+		}
+
+		for (float& weight : weights)
+			weight /= sum;
+		return weights;
+	}
+
+	static inline void Accumulate(glm::vec4& result, const std::vector<float>& kernel, const glm::vec4* const* taps)
+	{
+	#if GLCORE_MIP_SSE
+		__m128 acc = _mm_setzero_ps();
+		for (size_t k = 0; k < kernel.size(); k++)
+			acc = _mm_add_ps(acc, _mm_mul_ps(_mm_loadu_ps(&taps[k]->x), _mm_set1_ps(kernel[k])));
+		_mm_storeu_ps(&result.x, acc);
+	#else
+		result = glm::vec4(0.0f);
+		for (size_t k = 0; k < kernel.size(); k++)
+			result += *taps[k] * kernel[k];
+	#endif
+	}
+
+	static FloatImage Downsample(const FloatImage& source, const std::vector<float>& kernel, uint32_t threadCount)
+	{
+		int radius = (int)kernel.size() / 2;
+		bool horizontal = source.Width > 1, vertical = source.Height > 1;
+
+		FloatImage temp;
+		temp.Width = std::max(source.Width / 2, 1u);
+		temp.Height = source.Height;
+		temp.Texels.resize((size_t)temp.Width * temp.Height);
+
+		// Horizontal pass, wrapping at the edges since material textures tile
+		ParallelFor(temp.Height, threadCount, [&](uint32_t begin, uint32_t end)
+		{
+			std::vector<const glm::vec4*> taps(kernel.size());
+			for (uint32_t y = begin; y < end; y++)
+			{
+				const glm::vec4* row = &source.Texels[(size_t)y * source.Width];
+				for (uint32_t x = 0; x < temp.Width; x++)
+				{
+					if (!horizontal)
+					{
+						temp.Texels[(size_t)y * temp.Width + x] = row[x];
+						continue;
+					}
+					for (int k = 0; k < (int)kernel.size(); k++)
+						taps[k] = &row[Wrap(2 * (int)x + k - radius + 1, source.Width)];
+					Accumulate(temp.Texels[(size_t)y * temp.Width + x], kernel, taps.data());
+				}
+			}
+		});
+
+		FloatImage result;
+		result.Width = temp.Width;
+		result.Height = std::max(source.Height / 2, 1u);
+		result.Texels.resize((size_t)result.Width * result.Height);
+
+		ParallelFor(result.Height, threadCount, [&](uint32_t begin, uint32_t end)
+		{
+			std::vector<const glm::vec4*> taps(kernel.size());
+			for (uint32_t y = begin; y < end; y++)
+			{
+				for (uint32_t x = 0; x < result.Width; x++)
+				{
+					if (!vertical)
+					{
+						result.Texels[(size_t)y * result.Width + x] = temp.Texels[(size_t)y * temp.Width + x];
+						continue;
+					}
+					for (int k = 0; k < (int)kernel.size(); k++)
+						taps[k] = &temp.Texels[(size_t)Wrap(2 * (int)y + k - radius + 1, temp.Height) * temp.Width + x];
+					Accumulate(result.Texels[(size_t)y * result.Width + x], kernel, taps.data());
+				}
+			}
+		});
+
+		return result;
+	}
+
+	static float SRGBToLinear(float value)
+	{
+		return value <= 0.04045f ? value / 12.92f : std::pow((value + 0.055f) / 1.055f, 2.4f);
+	}
+
+	static float LinearToSRGB(float value)
+	{
+		return value <= 0.0031308f ? value * 12.92f : 1.055f * std::pow(value, 1.0f / 2.4f) - 0.055f;
+	}
+
+	static FloatImage Decode(const ImageData& image, MipContent content)
+	{
+		float srgbTable[256];
+		for (int i = 0; i < 256; i++)
+			srgbTable[i] = SRGBToLinear(i / 255.0f);
+
+		FloatImage result;
+		result.Width = image.Width;
+		result.Height = image.Height;
+		result.Texels.resize((size_t)image.Width * image.Height);
+
+		uint32_t colorChannels = std::min(image.Channels, 3u);
+		for (size_t i = 0; i < result.Texels.size(); i++)
+		{
+			const uint8_t* texel = &image.Pixels[i * image.Channels];
+			glm::vec4 value(0.0f, 0.0f, 0.0f, 1.0f);
+			for (uint32_t c = 0; c < image.Channels; c++)
+			{
+				if (c < colorChannels && content == MipContent::SRGB)
+					value[c] = srgbTable[texel[c]];
+				else if (c < colorChannels && content == MipContent::Normal)
+					value[c] = texel[c] / 127.5f - 1.0f;
+				else
+					value[c] = texel[c] / 255.0f;
+			}
+			result.Texels[i] = value;
+		}
+
+		return result;
+	}
+
+	static void Encode(const FloatImage& image, uint32_t channels, MipContent content, uint8_t* destination)
+	{
+		uint32_t colorChannels = std::min(channels, 3u);
+		for (size_t i = 0; i < image.Texels.size(); i++)
+		{
+			glm::vec4 value = image.Texels[i];
+			if (content == MipContent::Normal && colorChannels == 3)
+			{
+				glm::vec3 normal = glm::vec3(value);
+				float length = glm::length(normal);
+				normal = length > 0.0f ? normal / length : glm::vec3(0.0f, 0.0f, 1.0f);
+				value = glm::vec4(normal * 0.5f + 0.5f, value.w);
+			}
+
+			for (uint32_t c = 0; c < channels; c++)
+			{
+				float v = value[c];
+				if (c < colorChannels && content == MipContent::SRGB)
+					v = LinearToSRGB(std::max(v, 0.0f));
+				destination[i * channels + c] = (uint8_t)(glm::clamp(v, 0.0f, 1.0f) * 255.0f + 0.5f);
+			}
+		}
+	}
+
+	void BuildMipChain(ImageData& image, const MipChainSettings& settings)
+	{
+		GLCORE_ASSERT(image.MipCount == 1, "Image already has a mip chain");
+
+		uint32_t threadCount = GetWorkerThreadCount(settings.ThreadCount);
+		std::vector<float> kernel = CreateKernel(settings.Filter);
+
+		uint32_t mipCount = CalculateMipCount(image.Width, image.Height);
+		image.MipCount = mipCount;
+		image.Tag = GetSettingsTag(settings);
+
+		// Level 0 is kept as is, every other level is filtered from the float copy of its parent
+		FloatImage level = Decode(image, settings.Content);
+		image.Pixels.resize(GetMipOffset(image, mipCount));
+		for (uint32_t mip = 1; mip < mipCount; mip++)
+		{
+			level = Downsample(level, kernel, threadCount);
+			Encode(level, image.Channels, settings.Content, &image.Pixels[GetMipOffset(image, mip)]);
+		}
+	}
+
+	static bool IsCacheValid(const std::string& sourcePath, const std::string& cachePath, const MipChainSettings& settings)
+	{
+		std::error_code error;
+		auto cacheTime = std::filesystem::last_write_time(cachePath, error);
+		if (error)
+			return false;
+
+		auto sourceTime = std::filesystem::last_write_time(sourcePath, error);
+		if (error || sourceTime > cacheTime)
+			return false;
+
+		ImageData header;
+		return ReadImageCacheHeader(cachePath, header) && header.Tag == GetSettingsTag(settings) && header.MipCount > 1;
+	}
+
+	bool LoadMipChain(const std::string& sourcePath, const std::string& cachePath, const MipChainSettings& settings, ImageData& image)
+	{
+		if (IsCacheValid(sourcePath, cachePath, settings) && ReadImageCache(cachePath, image))
+			return true;
+
+		int width, height, channels;
+		uint8_t* pixels = stbi_load(sourcePath.c_str(), &width, &height, &channels, 0);
+		if (!pixels)
+			return false;
+
+		image = ImageData();
+		image.Width = width;
+		image.Height = height;
+		image.Channels = channels;
+		image.Pixels.assign(pixels, pixels + (size_t)width * height * channels);
+		stbi_image_free(pixels);
+
+		BuildMipChain(image, settings);
+
+		if (!WriteImageCache(cachePath, image))
+			LOG_WARN("Could not write mip cache '{0}'", cachePath);
+		return true;
+	}
+
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include "ImageCache.h"
+
+#include <string>
+
+namespace GLCore::Utils {
+
+	enum class MipFilter
+	{
+		Box = 0, Kaiser = 1
+	};
+
+	// How the texel values are interpreted while filtering
+	enum class MipContent
+	{
+		Linear = 0,    // data maps (roughness, AO, ...)
+		SRGB = 1,      // colour stored gamma encoded, filtered in linear space
+		Normal = 2     // tangent-space normals in [0, 1], renormalized per level
+	};
+
+	struct MipChainSettings
+	{
+		MipFilter Filter = MipFilter::Kaiser;
+		MipContent Content = MipContent::Linear;
+		uint32_t ThreadCount = 0;  // 0 = hardware concurrency
+	};
+
+	// Replaces the single level in image with a full mip chain down to 1x1.
+	// Each level is filtered from the previous one in float with SSE, rows split across threads.
+	void BuildMipChain(ImageData& image, const MipChainSettings& settings);
+
+	// Loads the mip chain for an 8-bit source image from cachePath, building and writing it
+	// first when the cache is missing, older than the source or built with other settings.
+	bool LoadMipChain(const std::string& sourcePath, const std::string& cachePath, const MipChainSettings& settings, ImageData& image);
+
+}
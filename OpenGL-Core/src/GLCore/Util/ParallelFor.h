@@ -0,0 +1,33 @@
+#pragma once
+
+#include <algorithm>
+#include <thread>
+#include <vector>
+
+namespace GLCore::Utils {
+
+	inline uint32_t GetWorkerThreadCount(uint32_t requested = 0)
+	{
+		return requested ? requested : std::max(std::thread::hardware_concurrency(), 1u);
+	}
+
+	// Splits [0, count) into contiguous ranges and calls fn(begin, end) for each on its own thread
+	template<typename Fn>
+	void ParallelFor(uint32_t count, uint32_t threadCount, Fn&& fn)
+	{
+		threadCount = std::min(threadCount, count);
+		if (threadCount <= 1)
+		{
+			fn(0u, count);
+			return;
+		}
+
+		std::vector<std::thread> threads;
+		uint32_t chunk = (count + threadCount - 1) / threadCount;
+		for (uint32_t begin = 0; begin < count; begin += chunk)
+			threads.emplace_back(fn, begin, std::min(begin + chunk, count));
+		for (std::thread& thread : threads)
+			thread.join();
+	}
+
+}
@@ -0,0 +1,236 @@
+#include "glpch.h"
+#include "ProgramCache.h"
+
+#include <GLFW/glfw3.h>
+
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+namespace GLCore::Utils {
+
+	static const char PROGRAM_CACHE_MAGIC[4] = { 'G', 'L', 'P', 'B' };
+	static const uint32_t PROGRAM_CACHE_VERSION = 1;
+	// Binaries from stale sources that no reload removed (edits made between launches, variants
+	// no longer selected) are evicted past this size
+	static const uint64_t PROGRAM_CACHE_MAX_SIZE = 64ull * 1024 * 1024;
+
+	// From the GL_KHR_parallel_shader_compile specification
+	static const GLenum GL_COMPLETION_STATUS_KHR_VALUE = 0x91B1;
+	typedef void (APIENTRYP MaxShaderCompilerThreadsProc)(GLuint count);
+
+	struct ProgramCacheHeader
+	{
+		char Magic[4];
+		uint32_t Version;
+		uint64_t Key;
+		uint32_t BinaryFormat;
+		uint32_t BinarySize;
+	};
+
+	static std::string s_Directory = "assets/shaders/cache";
+	static ProgramCacheStats s_Stats;
+	static bool s_ParallelCompileChecked = false;
+	static bool s_ParallelCompileSupported = false;
+
+	void SetProgramCacheDirectory(const std::string& directory)
+	{
+		s_Directory = directory;
+	}
+
+	static std::string GetCachePath(uint64_t key)
+	{
+		char name[32];
+		snprintf(name, sizeof(name), "%016llx.bin", (unsigned long long)key);
+		return s_Directory + "/" + name;
+	}
+
+	static uint64_t HashBytes(uint64_t hash, const void* data, size_t size)
+	{
+		// FNV-1a, 64-bit
+		const uint8_t* bytes = (const uint8_t*)data;
+		for (size_t i = 0; i < size; i++)
+		{
+			hash ^= bytes[i];
+			hash *= 1099511628211ull;
+		}
+		return hash;
+	}
+
+	uint64_t GetProgramCacheKey(const std::vector<std::string_view>& sources)
+	{
+		uint64_t hash = 14695981039346656037ull;
+		for (GLenum name : { GL_VENDOR, GL_RENDERER, GL_VERSION })
+		{
+			const char* value = (const char*)glGetString(name);
+			if (value)
+				hash = HashBytes(hash, value, strlen(value) + 1);
+		}
+
+		// Lengths keep the stage boundaries apart
+		for (std::string_view source : sources)
+		{
+			uint64_t length = source.size();
+			hash = HashBytes(hash, &length, sizeof(length));
+			hash = HashBytes(hash, source.data(), source.size());
+		}
+		return hash;
+	}
+
+	bool LoadProgramBinary(GLuint program, uint64_t key)
+	{
+		std::ifstream in(GetCachePath(key), std::ios::in | std::ios::binary);
+		if (!in)
+			return false;
+
+		ProgramCacheHeader header;
+		in.read((char*)&header, sizeof(header));
+		if (!in || memcmp(header.Magic, PROGRAM_CACHE_MAGIC, sizeof(PROGRAM_CACHE_MAGIC)) != 0 ||
+			header.Version != PROGRAM_CACHE_VERSION || header.Key != key)
+			return false;
+
+		std::vector<uint8_t> binary(header.BinarySize);
+		in.read((char*)binary.data(), binary.size());
+		if (!in)
+			return false;
+
+		glProgramBinary(program, header.BinaryFormat, binary.data(), (GLsizei)binary.size());
+
+		GLint isLinked = 0;
+		glGetProgramiv(program, GL_LINK_STATUS, &isLinked);
+		if (isLinked == GL_FALSE)
+			return false;
+
+		// The write time doubles as the last use for eviction
+		std::error_code error;
+		std::filesystem::last_write_time(GetCachePath(key), std::filesystem::file_time_type::clock::now(), error);
+
+		s_Stats.Loaded++;
+		return true;
+	}
+
+	static void TrimProgramCache()
+	{
+		struct CacheFile
+		{
+			std::filesystem::path Path;
+			std::filesystem::file_time_type LastUse;
+			uint64_t Size;
+		};
+
+		std::error_code error;
+		std::vector<CacheFile> files;
+		uint64_t totalSize = 0;
+		for (const auto& entry : std::filesystem::directory_iterator(s_Directory, error))
+		{
+			if (!entry.is_regular_file(error) || entry.path().extension() != ".bin")
+				continue;
+
+			CacheFile& file = files.emplace_back();
+			file.Path = entry.path();
+			file.LastUse = entry.last_write_time(error);
+			file.Size = entry.file_size(error);
+			totalSize += file.Size;
+		}
+
+		if (totalSize <= PROGRAM_CACHE_MAX_SIZE)
+			return;
+
+		std::sort(files.begin(), files.end(), [](const CacheFile& a, const CacheFile& b) { return a.LastUse < b.LastUse; });
+		for (const CacheFile& file : files)
+		{
+			if (totalSize <= PROGRAM_CACHE_MAX_SIZE)
+				break;
+			if (std::filesystem::remove(file.Path, error))
+				totalSize -= file.Size;
+		}
+	}
+
+	void SaveProgramBinary(GLuint program, uint64_t key)
+	{
+		s_Stats.Compiled++;
+
+		GLint size = 0;
+		glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &size);
+		if (size <= 0)
+			return;
+
+		std::vector<uint8_t> binary(size);
+		GLenum format = 0;
+		glGetProgramBinary(program, size, &size, &format, binary.data());
+
+		std::error_code error;
+		std::filesystem::create_directories(s_Directory, error);
+
+		std::string path = GetCachePath(key);
+		std::ofstream out(path, std::ios::out | std::ios::binary);
+		if (!out)
+		{
+			LOG_WARN("Could not write program cache '{0}'", path);
+			return;
+		}
+
+		ProgramCacheHeader header;
+		memcpy(header.Magic, PROGRAM_CACHE_MAGIC, sizeof(PROGRAM_CACHE_MAGIC));
+		header.Version = PROGRAM_CACHE_VERSION;
+		header.Key = key;
+		header.BinaryFormat = format;
+		header.BinarySize = (uint32_t)size;
+		out.write((const char*)&header, sizeof(header));
+		out.write((const char*)binary.data(), size);
+		out.close();
+
+		TrimProgramCache();
+	}
+
+	void RemoveProgramBinary(uint64_t key)
+	{
+		std::error_code error;
+		std::filesystem::remove(GetCachePath(key), error);
+	}
+
+	const ProgramCacheStats& GetProgramCacheStats()
+	{
+		return s_Stats;
+	}
+
+	void EnableParallelShaderCompile()
+	{
+		if (s_ParallelCompileChecked)
+			return;
+		s_ParallelCompileChecked = true;
+
+		const char* extensions[] = { "GL_KHR_parallel_shader_compile", "GL_ARB_parallel_shader_compile" };
+		const char* functions[] = { "glMaxShaderCompilerThreadsKHR", "glMaxShaderCompilerThreadsARB" };
+		for (int i = 0; i < 2 && !s_ParallelCompileSupported; i++)
+		{
+			if (!glfwExtensionSupported(extensions[i]))
+				continue;
+
+			auto maxShaderCompilerThreads = (MaxShaderCompilerThreadsProc)glfwGetProcAddress(functions[i]);
+			if (!maxShaderCompilerThreads)
+				continue;
+
+			// As many threads as the driver wants
+			maxShaderCompilerThreads(0xFFFFFFFF);
+			s_ParallelCompileSupported = true;
+			LOG_INFO("Parallel shader compilation enabled ({0})", extensions[i]);
+		}
+	}
+
+	bool IsParallelShaderCompileSupported()
+	{
+		return s_ParallelCompileSupported;
+	}
+
+	bool IsProgramLinkComplete(GLuint program)
+	{
+		if (!s_ParallelCompileSupported)
+			return true;
+
+		GLint complete = GL_TRUE;
+		glGetProgramiv(program, GL_COMPLETION_STATUS_KHR_VALUE, &complete);
+		return complete == GL_TRUE;
+	}
+
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <glad/glad.h>
+
+namespace GLCore::Utils {
+
+	// Linked program binaries kept on disk, one file per key, so a program whose sources and
+	// driver have not changed skips compilation on the next launch. A binary the driver rejects
+	// (e.g. after a driver update with the same version string) is treated as a miss. The least
+	// recently used binaries are evicted once the directory outgrows its size limit.
+	struct ProgramCacheStats
+	{
+		uint32_t Loaded = 0;
+		uint32_t Compiled = 0;
+	};
+
+	// Defaults to assets/shaders/cache, created on the first write
+	void SetProgramCacheDirectory(const std::string& directory);
+
+	// Hash of the stage sources together with the vendor, renderer and version strings of the context
+	uint64_t GetProgramCacheKey(const std::vector<std::string_view>& sources);
+
+	// Loads the binary into program and returns true if it linked
+	bool LoadProgramBinary(GLuint program, uint64_t key);
+	// Call on a linked program created with GL_PROGRAM_BINARY_RETRIEVABLE_HINT
+	void SaveProgramBinary(GLuint program, uint64_t key);
+	// Drops a binary whose sources have been replaced, e.g. by a hot reload
+	void RemoveProgramBinary(uint64_t key);
+
+	const ProgramCacheStats& GetProgramCacheStats();
+
+	// GL_KHR_parallel_shader_compile: compiles and links are handed to driver threads and their
+	// status queried without blocking. Not in the generated loader, so it is loaded here; without
+	// it every program reports complete and the first status query blocks as usual.
+	void EnableParallelShaderCompile();
+	bool IsParallelShaderCompileSupported();
+	bool IsProgramLinkComplete(GLuint program);
+
+}
@@ -0,0 +1,85 @@
+#include "glpch.h"
+#include "RenderQueue.h"
+
+#include <cstring>
+
+namespace GLCore::Utils {
+
+	uint64_t MakeSortKey(uint32_t pass, uint32_t program, uint32_t material, float depth, bool backToFront)
+	{
+		uint32_t depthBits;
+		float clamped = std::max(depth, 0.0f);
+		memcpy(&depthBits, &clamped, sizeof(depthBits));
+		if (backToFront)
+			depthBits = ~depthBits;
+
+		return ((uint64_t)(pass & 0xF) << 60)
+			| ((uint64_t)(program & 0xFFF) << 48)
+			| ((uint64_t)(material & 0xFFFF) << 32)
+			| depthBits;
+	}
+
+	void RenderQueue::Submit(uint64_t key, uint32_t program, uint32_t vertexArray, const std::vector<TextureBinding>& textures,
+		std::function<void()> draw)
+	{
+		DrawCommand& command = m_Commands.emplace_back();
+		command.Key = key;
+		command.Program = program;
+		command.VertexArray = vertexArray;
+		command.FirstTexture = (uint32_t)m_Textures.size();
+		command.TextureCount = (uint32_t)textures.size();
+		command.Draw = std::move(draw);
+		m_Textures.insert(m_Textures.end(), textures.begin(), textures.end());
+		m_Sorted = false;
+	}
+
+	void RenderQueue::Sort()
+	{
+		m_Order.resize(m_Commands.size());
+		for (uint32_t i = 0; i < m_Order.size(); i++)
+			m_Order[i] = i;
+
+		// Indices are sorted rather than the commands, each holds a std::function
+		std::stable_sort(m_Order.begin(), m_Order.end(), [this](uint32_t a, uint32_t b)
+		{
+			return m_Commands[a].Key < m_Commands[b].Key;
+		});
+		m_Sorted = true;
+	}
+
+	void RenderQueue::Execute(RenderStateCache& state, uint32_t pass)
+	{
+		if (!m_Sorted)
+			Sort();
+
+		auto first = std::lower_bound(m_Order.begin(), m_Order.end(), pass, [this](uint32_t index, uint32_t value)
+		{
+			return GetSortKeyPass(m_Commands[index].Key) < value;
+		});
+
+		for (auto it = first; it != m_Order.end(); ++it)
+		{
+			const DrawCommand& command = m_Commands[*it];
+			if (GetSortKeyPass(command.Key) != pass)
+				break;
+
+			state.UseProgram(command.Program);
+			state.BindVertexArray(command.VertexArray);
+			for (uint32_t i = 0; i < command.TextureCount; i++)
+			{
+				const TextureBinding& binding = m_Textures[command.FirstTexture + i];
+				state.BindTextureUnit(binding.Unit, binding.Texture);
+			}
+			command.Draw();
+		}
+	}
+
+	void RenderQueue::Clear()
+	{
+		m_Commands.clear();
+		m_Textures.clear();
+		m_Order.clear();
+		m_Sorted = true;
+	}
+
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+#include "RenderState.h"
+
+namespace GLCore::Utils {
+
+	// 64-bit draw order, compared as a whole:
+	//   pass     4 bits  [60, 64)  passes execute in order
+	//   program 12 bits  [48, 60)  fewest program switches within a pass
+	//   material 16 bits [32, 48)  then the fewest texture switches
+	//   depth   32 bits  [ 0, 32)  then front to back, or back to front for blended passes
+	// Depth is the bit pattern of a non-negative float, which sorts like the float itself;
+	// backToFront stores its complement.
+	uint64_t MakeSortKey(uint32_t pass, uint32_t program, uint32_t material, float depth, bool backToFront = false);
+	inline uint32_t GetSortKeyPass(uint64_t key) { return (uint32_t)(key >> 60); }
+
+	struct TextureBinding
+	{
+		uint32_t Unit;
+		uint32_t Texture;
+	};
+
+	// Draws collected over a frame with the state each needs, sorted by key and executed through
+	// a RenderStateCache so consecutive draws that share a program, vertex array or texture do
+	// not bind it again. Execute runs one pass at a time so work that is not a draw (render target
+	// switches, timer queries) can go between passes.
+	class RenderQueue
+	{
+	public:
+		// draw issues the draw calls (and any uniforms) with the state below already bound
+		void Submit(uint64_t key, uint32_t program, uint32_t vertexArray, const std::vector<TextureBinding>& textures,
+			std::function<void()> draw);
+
+		// Executes the commands of one pass in key order, submission order among equal keys
+		void Execute(RenderStateCache& state, uint32_t pass);
+		// Drops every command, executed or not
+		void Clear();
+
+		uint32_t GetSize() const { return (uint32_t)m_Commands.size(); }
+	private:
+		void Sort();
+	private:
+		struct DrawCommand
+		{
+			uint64_t Key;
+			uint32_t Program;
+			uint32_t VertexArray;
+			uint32_t FirstTexture;
+			uint32_t TextureCount;
+			std::function<void()> Draw;
+		};
+
+		std::vector<DrawCommand> m_Commands;
+		std::vector<TextureBinding> m_Textures;
+		std::vector<uint32_t> m_Order;
+		bool m_Sorted = true;
+	};
+
+}
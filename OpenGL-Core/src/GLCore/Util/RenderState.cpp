@@ -0,0 +1,58 @@
+#include "glpch.h"
+#include "RenderState.h"
+
+#include <glad/glad.h>
+
+namespace GLCore::Utils {
+
+	void RenderStateCache::UseProgram(uint32_t program)
+	{
+		if (m_Program == program)
+		{
+			m_Stats.ProgramSkips++;
+			return;
+		}
+
+		glUseProgram(program);
+		m_Program = program;
+		m_Stats.ProgramChanges++;
+	}
+
+	void RenderStateCache::BindVertexArray(uint32_t vertexArray)
+	{
+		if (m_VertexArray == vertexArray)
+		{
+			m_Stats.VertexArraySkips++;
+			return;
+		}
+
+		glBindVertexArray(vertexArray);
+		m_VertexArray = vertexArray;
+		m_Stats.VertexArrayChanges++;
+	}
+
+	void RenderStateCache::BindTextureUnit(uint32_t unit, uint32_t texture)
+	{
+		if (unit < MAX_TEXTURE_UNITS)
+		{
+			if (m_Textures[unit] == texture)
+			{
+				m_Stats.TextureSkips++;
+				return;
+			}
+			m_Textures[unit] = texture;
+		}
+
+		glBindTextureUnit(unit, texture);
+		m_Stats.TextureChanges++;
+	}
+
+	void RenderStateCache::Invalidate()
+	{
+		m_Program = UNKNOWN;
+		m_VertexArray = UNKNOWN;
+		for (uint32_t& texture : m_Textures)
+			texture = UNKNOWN;
+	}
+
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstdint>
+
+namespace GLCore::Utils {
+
+	// Bind counts since the last ResetStats, split into calls that reached GL and calls that
+	// matched the tracked state and were dropped
+	struct RenderStateStats
+	{
+		uint32_t ProgramChanges = 0;
+		uint32_t ProgramSkips = 0;
+		uint32_t VertexArrayChanges = 0;
+		uint32_t VertexArraySkips = 0;
+		uint32_t TextureChanges = 0;
+		uint32_t TextureSkips = 0;
+
+		uint32_t GetChanges() const { return ProgramChanges + VertexArrayChanges + TextureChanges; }
+		uint32_t GetSkips() const { return ProgramSkips + VertexArraySkips + TextureSkips; }
+	};
+
+	// Shadow copy of the program, vertex array and texture unit bindings. Binds through it are
+	// issued only when they differ from the last bind it saw. Anything that binds through GL
+	// directly in between leaves the copy stale, so call Invalidate after such code.
+	class RenderStateCache
+	{
+	public:
+		static constexpr uint32_t MAX_TEXTURE_UNITS = 32;
+
+		RenderStateCache() { Invalidate(); }
+
+		void UseProgram(uint32_t program);
+		void BindVertexArray(uint32_t vertexArray);
+		// Units past MAX_TEXTURE_UNITS are passed through untracked
+		void BindTextureUnit(uint32_t unit, uint32_t texture);
+
+		// Forgets every tracked binding, the next bind of each is always issued
+		void Invalidate();
+
+		const RenderStateStats& GetStats() const { return m_Stats; }
+		void ResetStats() { m_Stats = RenderStateStats(); }
+	private:
+		static constexpr uint32_t UNKNOWN = 0xFFFFFFFF;
+
+		uint32_t m_Program;
+		uint32_t m_VertexArray;
+		uint32_t m_Textures[MAX_TEXTURE_UNITS];
+		RenderStateStats m_Stats;
+	};
+
+}
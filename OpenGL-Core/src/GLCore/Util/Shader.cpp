@@ -1,6 +1,10 @@
 #include "glpch.h"
 #include "Shader.h"
 
+#include "AssetPack.h"
+#include "ProgramCache.h"
+#include "ShaderPreprocessor.h"
+
 #include <fstream>
 
 namespace GLCore::Utils {
@@ -25,20 +29,38 @@ namespace GLCore::Utils {
 		return result;
 	}
 
+	// Packed sources are used straight from the mapping, loose files are read into storage
+	static std::string_view ReadShaderSource(const std::string& filepath, std::string& storage)
+	{
+		if (AssetSpan span = AssetPack::FindMounted(filepath))
+			return span.AsString();
+
+		storage = ReadFileAsString(filepath);
+		return storage;
+	}
+
 	Shader::~Shader()
 	{
+		for (GLuint shader : m_PendingShaders)
+			glDeleteShader(shader);
 		glDeleteProgram(m_RendererID);
 	}
 
-	GLuint Shader::CompileShader(GLenum type, const std::string& source)
+	static GLuint CompileShader(GLenum type, std::string_view source)
 	{
 		GLuint shader = glCreateShader(type);
 
-		const GLchar* sourceCStr = source.c_str();
-		glShaderSource(shader, 1, &sourceCStr, 0);
+		const GLchar* sourceCStr = source.data();
+		GLint sourceLength = (GLint)source.size();
+		glShaderSource(shader, 1, &sourceCStr, &sourceLength);
 
+		// The status is checked when the program is resolved so the compile can run in the background
 		glCompileShader(shader);
+		return shader;
+	}
 
+	static bool CheckCompileStatus(GLuint shader, const ShaderStageSource& source)
+	{
 		GLint isCompiled = 0;
 		glGetShaderiv(shader, GL_COMPILE_STATUS, &isCompiled);
 		if (isCompiled == GL_FALSE)
@@ -46,73 +68,333 @@ namespace GLCore::Utils {
 			GLint maxLength = 0;
 			glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &maxLength);
 
-			std::vector<GLchar> infoLog(maxLength);
+			std::vector<GLchar> infoLog(std::max(maxLength, 1));
 			glGetShaderInfoLog(shader, maxLength, &maxLength, &infoLog[0]);
 
-			glDeleteShader(shader);
-
+			// Errors are reported as file(line), file 0 being the stage itself
 			LOG_ERROR("{0}", infoLog.data());
+			LOG_ERROR("  0: {0}", source.Path);
+			for (size_t i = 0; i < source.Includes.size(); i++)
+				LOG_ERROR("  {0}: {1}", i + 1, source.Includes[i]);
 			// HZ_CORE_ASSERT(false, "Shader compilation failure!");
+			return false;
 		}
+		return true;
+	}
 
-		return shader;
+	bool Shader::BeginProgram(const std::vector<std::string_view>& sources)
+	{
+		EnableParallelShaderCompile();
+
+		std::vector<std::string> processed(m_Sources.size());
+		for (size_t i = 0; i < m_Sources.size(); i++)
+		{
+			m_Sources[i].Includes.clear();
+			if (!PreprocessShader(m_Sources[i].Path, sources[i], m_Defines, processed[i], m_Sources[i].Includes))
+			{
+				m_RendererID = 0;
+				return false;
+			}
+		}
+
+		m_CacheKey = GetProgramCacheKey({ processed.begin(), processed.end() });
+
+		m_RendererID = glCreateProgram();
+		if (LoadProgramBinary(m_RendererID, m_CacheKey))
+		{
+			ReflectUniforms(m_RendererID);
+			return true;
+		}
+
+		glProgramParameteri(m_RendererID, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+		for (size_t i = 0; i < m_Sources.size(); i++)
+		{
+			GLuint shader = CompileShader(m_Sources[i].Type, processed[i]);
+			glAttachShader(m_RendererID, shader);
+			m_PendingShaders.push_back(shader);
+		}
+		glLinkProgram(m_RendererID);
+		m_LinkPending = true;
+		return false;
 	}
 
-	Shader* Shader::FromGLSLTextFiles(const std::string& vertexShaderPath, const std::string& fragmentShaderPath, const std::string& geometryShaderPath)
+	bool Shader::IsReady() const
 	{
-		Shader* shader = new Shader();
-		shader->LoadFromGLSLTextFiles(vertexShaderPath, fragmentShaderPath, geometryShaderPath);
-		return shader;
+		return !m_LinkPending || IsProgramLinkComplete(m_RendererID);
 	}
-	
-	void Shader::LoadFromGLSLTextFiles(const std::string& vertexShaderPath, const std::string& fragmentShaderPath, const std::string& geometryShaderPath)
+
+	void Shader::Resolve() const
 	{
-		std::string vertexSource = ReadFileAsString(vertexShaderPath);
-		std::string fragmentSource = ReadFileAsString(fragmentShaderPath);
-		std::string geometrySource = "";
-		if (!geometryShaderPath.empty())
-			geometrySource = ReadFileAsString(geometryShaderPath);
-
-		GLuint program = glCreateProgram();
-		int glShaderIDIndex = 0;
-			
-		GLuint vertexShader = CompileShader(GL_VERTEX_SHADER, vertexSource);
-		glAttachShader(program, vertexShader);
-		GLuint fragmentShader = CompileShader(GL_FRAGMENT_SHADER, fragmentSource);
-		glAttachShader(program, fragmentShader);
-		if (!geometrySource.empty())
+		m_LinkPending = false;
+
+		bool compiled = true;
+		for (size_t i = 0; i < m_PendingShaders.size(); i++)
+			compiled = CheckCompileStatus(m_PendingShaders[i], m_Sources[i]) && compiled;
+
+		GLint isLinked = 0;
+		glGetProgramiv(m_RendererID, GL_LINK_STATUS, (int*)&isLinked);
+		if (isLinked == GL_FALSE)
 		{
-			GLuint geometryShader = CompileShader(GL_GEOMETRY_SHADER, geometrySource);
-			glAttachShader(program, geometryShader);
+			// A failed compile already explains the link failure
+			if (compiled)
+			{
+				GLint maxLength = 0;
+				glGetProgramiv(m_RendererID, GL_INFO_LOG_LENGTH, &maxLength);
+
+				std::vector<GLchar> infoLog(std::max(maxLength, 1));
+				glGetProgramInfoLog(m_RendererID, maxLength, &maxLength, &infoLog[0]);
+
+				LOG_ERROR("{0}", infoLog.data());
+			}
+			// HZ_CORE_ASSERT(false, "Shader link failure!");
+		}
+		else
+		{
+			for (GLuint shader : m_PendingShaders)
+				glDetachShader(m_RendererID, shader);
+			ReflectUniforms(m_RendererID);
+			SaveProgramBinary(m_RendererID, m_CacheKey);
 		}
 
-		glLinkProgram(program);
+		for (GLuint shader : m_PendingShaders)
+			glDeleteShader(shader);
+		m_PendingShaders.clear();
 
-		GLint isLinked = 0;
-		glGetProgramiv(program, GL_LINK_STATUS, (int*)&isLinked);
 		if (isLinked == GL_FALSE)
 		{
-			GLint maxLength = 0;
-			glGetProgramiv(program, GL_INFO_LOG_LENGTH, &maxLength);
+			glDeleteProgram(m_RendererID);
+			m_RendererID = 0;
+		}
+	}
+
+	void Shader::BeginReload(const std::vector<std::string>& sources)
+	{
+		m_Reload.reset(new Shader());
+		m_Reload->m_Sources = m_Sources;
+		m_Reload->m_Defines = m_Defines;
+		m_Reload->BeginProgram({ sources.begin(), sources.end() });
+	}
+
+	ShaderReloadStatus Shader::UpdateReload()
+	{
+		if (!m_Reload)
+			return ShaderReloadStatus::None;
+		if (!m_Reload->IsReady())
+			return ShaderReloadStatus::Pending;
 
-			std::vector<GLchar> infoLog(maxLength);
-			glGetProgramInfoLog(program, maxLength, &maxLength, &infoLog[0]);
+		m_Reload->Wait();
+		if (m_Reload->m_RendererID == 0)
+		{
+			m_Reload.reset();
+			return ShaderReloadStatus::Failed;
+		}
 
-			glDeleteProgram(program);
+		// The previous program goes with the reload object, GL keeps it alive for draws already submitted
+		Wait();
+		std::swap(m_RendererID, m_Reload->m_RendererID);
+		std::swap(m_CacheKey, m_Reload->m_CacheKey);
+		m_Sources.swap(m_Reload->m_Sources);
+		m_Uniforms.swap(m_Reload->m_Uniforms);
+		m_UniformBlockSizes.swap(m_Reload->m_UniformBlockSizes);
+		// The old sources are gone, so is any use for their binary
+		if (m_Reload->m_CacheKey != m_CacheKey)
+			RemoveProgramBinary(m_Reload->m_CacheKey);
+		m_Reload.reset();
+		return ShaderReloadStatus::Swapped;
+	}
 
-			glDeleteShader(vertexShader);
-			glDeleteShader(fragmentShader);
+	void Shader::ReflectUniforms(GLuint program) const
+	{
+		m_Uniforms.clear();
 
-			LOG_ERROR("{0}", infoLog.data());
-			// HZ_CORE_ASSERT(false, "Shader link failure!");
+		GLint count = 0, maxLength = 0;
+		glGetProgramiv(program, GL_ACTIVE_UNIFORMS, &count);
+		glGetProgramiv(program, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+
+		std::vector<GLchar> buffer(std::max(maxLength, 1));
+		for (GLint i = 0; i < count; i++)
+		{
+			GLsizei length = 0;
+			UniformInfo info;
+			glGetActiveUniform(program, (GLuint)i, maxLength, &length, &info.Size, &info.Type, buffer.data());
+			std::string name(buffer.data(), length);
+
+			// Members of uniform blocks have no location
+			info.Location = glGetUniformLocation(program, name.c_str());
+			if (info.Location < 0)
+				continue;
+
+			// Arrays are reported as "name[0]"
+			static const std::string arraySuffix = "[0]";
+			if (name.size() > arraySuffix.size() && name.compare(name.size() - arraySuffix.size(), arraySuffix.size(), arraySuffix) == 0)
+			{
+				std::string base = name.substr(0, name.size() - arraySuffix.size());
+				AddUniform(base, info);
+				GLint size = info.Size;
+				for (GLint element = 0; element < size; element++)
+				{
+					std::string elementName = base + "[" + std::to_string(element) + "]";
+					AddUniform(elementName, { glGetUniformLocation(program, elementName.c_str()), info.Type, size - element });
+				}
+				continue;
+			}
+
+			AddUniform(name, info);
+		}
+
+		m_UniformBlockSizes.clear();
+		GLint blockCount = 0, maxBlockNameLength = 0;
+		glGetProgramiv(program, GL_ACTIVE_UNIFORM_BLOCKS, &blockCount);
+		glGetProgramiv(program, GL_ACTIVE_UNIFORM_BLOCK_MAX_NAME_LENGTH, &maxBlockNameLength);
+
+		std::vector<GLchar> blockName(std::max(maxBlockNameLength, 1));
+		for (GLint i = 0; i < blockCount; i++)
+		{
+			GLsizei length = 0;
+			GLint size = 0;
+			glGetActiveUniformBlockName(program, (GLuint)i, maxBlockNameLength, &length, blockName.data());
+			glGetActiveUniformBlockiv(program, (GLuint)i, GL_UNIFORM_BLOCK_DATA_SIZE, &size);
+			m_UniformBlockSizes[HashUniformName(std::string_view(blockName.data(), length))] = size;
 		}
-		
-		glDetachShader(program, vertexShader);
-		glDetachShader(program, fragmentShader);
-		glDeleteShader(vertexShader);
-		glDeleteShader(fragmentShader);
+	}
+
+	void Shader::AddUniform(const std::string& name, const UniformInfo& info) const
+	{
+		if (!m_Uniforms.try_emplace(HashUniformName(name), info).second)
+			LOG_WARN("Uniform '{0}' collides with another uniform name hash", name);
+	}
+
+	GLint Shader::GetUniformLocation(UniformName name) const
+	{
+		Wait();
+		auto it = m_Uniforms.find(name.Hash);
+		return it != m_Uniforms.end() ? it->second.Location : -1;
+	}
+
+	GLint Shader::GetUniformBlockSize(UniformName block) const
+	{
+		Wait();
+		auto it = m_UniformBlockSizes.find(block.Hash);
+		return it != m_UniformBlockSizes.end() ? it->second : -1;
+	}
+
+	// Setters look the location up before reading m_RendererID, the lookup may resolve the link
+	// and drop a program that failed
+	void Shader::SetInt(UniformName name, int value)
+	{
+		GLint location = GetUniformLocation(name);
+		glProgramUniform1i(m_RendererID, location, value);
+	}
+
+	void Shader::SetInt2(UniformName name, const glm::ivec2& value)
+	{
+		GLint location = GetUniformLocation(name);
+		glProgramUniform2i(m_RendererID, location, value.x, value.y);
+	}
+
+	void Shader::SetUInt(UniformName name, uint32_t value)
+	{
+		GLint location = GetUniformLocation(name);
+		glProgramUniform1ui(m_RendererID, location, value);
+	}
+
+	void Shader::SetFloat(UniformName name, float value)
+	{
+		GLint location = GetUniformLocation(name);
+		glProgramUniform1f(m_RendererID, location, value);
+	}
+
+	void Shader::SetFloat2(UniformName name, const glm::vec2& value)
+	{
+		GLint location = GetUniformLocation(name);
+		glProgramUniform2f(m_RendererID, location, value.x, value.y);
+	}
+
+	void Shader::SetFloat3(UniformName name, const glm::vec3& value)
+	{
+		GLint location = GetUniformLocation(name);
+		glProgramUniform3f(m_RendererID, location, value.x, value.y, value.z);
+	}
+
+	void Shader::SetFloat4(UniformName name, const glm::vec4& value)
+	{
+		GLint location = GetUniformLocation(name);
+		glProgramUniform4f(m_RendererID, location, value.x, value.y, value.z, value.w);
+	}
+
+	void Shader::SetMat3(UniformName name, const glm::mat3& value)
+	{
+		GLint location = GetUniformLocation(name);
+		glProgramUniformMatrix3fv(m_RendererID, location, 1, GL_FALSE, &value[0][0]);
+	}
+
+	void Shader::SetMat4(UniformName name, const glm::mat4& value)
+	{
+		GLint location = GetUniformLocation(name);
+		glProgramUniformMatrix4fv(m_RendererID, location, 1, GL_FALSE, &value[0][0]);
+	}
+
+	void Shader::SetIntArray(UniformName name, const int* values, uint32_t count)
+	{
+		GLint location = GetUniformLocation(name);
+		glProgramUniform1iv(m_RendererID, location, count, values);
+	}
+
+	void Shader::SetFloatArray(UniformName name, const float* values, uint32_t count)
+	{
+		GLint location = GetUniformLocation(name);
+		glProgramUniform1fv(m_RendererID, location, count, values);
+	}
+
+	void Shader::SetFloat3Array(UniformName name, const glm::vec3* values, uint32_t count)
+	{
+		GLint location = GetUniformLocation(name);
+		glProgramUniform3fv(m_RendererID, location, count, &values[0].x);
+	}
+
+	void Shader::SetFloat4Array(UniformName name, const glm::vec4* values, uint32_t count)
+	{
+		GLint location = GetUniformLocation(name);
+		glProgramUniform4fv(m_RendererID, location, count, &values[0].x);
+	}
+
+	Shader* Shader::FromGLSLTextFiles(const std::string& vertexShaderPath, const std::string& fragmentShaderPath, const std::string& geometryShaderPath, const ShaderDefines& defines)
+	{
+		Shader* shader = new Shader();
+		shader->m_Defines = defines;
+		shader->LoadFromGLSLTextFiles(vertexShaderPath, fragmentShaderPath, geometryShaderPath);
+		return shader;
+	}
+	
+	void Shader::LoadFromGLSLTextFiles(const std::string& vertexShaderPath, const std::string& fragmentShaderPath, const std::string& geometryShaderPath)
+	{
+		m_Sources.push_back({ GL_VERTEX_SHADER, vertexShaderPath, {} });
+		m_Sources.push_back({ GL_FRAGMENT_SHADER, fragmentShaderPath, {} });
+		if (!geometryShaderPath.empty())
+			m_Sources.push_back({ GL_GEOMETRY_SHADER, geometryShaderPath, {} });
+
+		std::vector<std::string> storage(m_Sources.size());
+		std::vector<std::string_view> sources;
+		for (size_t i = 0; i < m_Sources.size(); i++)
+			sources.push_back(ReadShaderSource(m_Sources[i].Path, storage[i]));
+
+		BeginProgram(sources);
+	}
+
+	Shader* Shader::FromGLSLComputeFile(const std::string& computeShaderPath, const ShaderDefines& defines)
+	{
+		Shader* shader = new Shader();
+		shader->m_Defines = defines;
+		shader->LoadFromGLSLComputeFile(computeShaderPath);
+		return shader;
+	}
+
+	void Shader::LoadFromGLSLComputeFile(const std::string& computeShaderPath)
+	{
+		m_Sources.push_back({ GL_COMPUTE_SHADER, computeShaderPath, {} });
 
-		m_RendererID = program;
+		std::string computeStorage;
+		BeginProgram({ ReadShaderSource(computeShaderPath, computeStorage) });
 	}
 
-}
\ No newline at end of file
+}
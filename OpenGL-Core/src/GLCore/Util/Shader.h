@@ -1,26 +1,137 @@
 #pragma once
 
+#include <memory>
 #include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
 
 #include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "ShaderPreprocessor.h"
 
 namespace GLCore::Utils {
 
+	// FNV-1a of a uniform name, usable at compile time
+	constexpr uint32_t HashUniformName(std::string_view name)
+	{
+		uint32_t hash = 2166136261u;
+		for (char c : name)
+		{
+			hash ^= (uint8_t)c;
+			hash *= 16777619u;
+		}
+		return hash;
+	}
+
+	// Uniform name reduced to its hash. Declare as static constexpr for names set in hot loops,
+	// string literals passed directly are usually folded by the compiler as well.
+	struct UniformName
+	{
+		uint32_t Hash;
+
+		constexpr UniformName(const char* name) : Hash(HashUniformName(name)) {}
+		constexpr UniformName(std::string_view name) : Hash(HashUniformName(name)) {}
+	};
+
+	struct UniformInfo
+	{
+		GLint Location;
+		GLenum Type;
+		GLint Size;   // array elements from this location on
+	};
+
+	struct ShaderStageSource
+	{
+		GLenum Type;
+		std::string Path;
+		// Files pulled in by #include, from the last build
+		std::vector<std::string> Includes;
+	};
+
+	enum class ShaderReloadStatus
+	{
+		None, Pending, Swapped, Failed
+	};
+
 	class Shader
 	{
 	public:
 		~Shader();
 
-		GLuint GetRendererID() { return m_RendererID; }
+		// Programs are linked asynchronously where the driver allows it and loaded from the program
+		// binary cache when possible. The first call that needs the linked program (the renderer ID,
+		// a uniform lookup or a setter) waits for the link, so create every program up front and use
+		// them afterwards. Must be called on the thread that owns the context.
+		GLuint GetRendererID() const { Wait(); return m_RendererID; }
+		// True once using the program will not stall on the link
+		bool IsReady() const;
+		void Wait() const { if (m_LinkPending) Resolve(); }
+		// The accessors above resolve a pending link, which makes GL calls; code that may run off the
+		// GL thread (command buffer recording) checks this instead
+		bool IsLinkPending() const { return m_LinkPending; }
+
+		// Active uniforms are reflected at link time, arrays under both "name" and every "name[i]".
+		// Names the linker removed resolve to -1 and their setters do nothing, like glUniform*.
+		GLint GetUniformLocation(UniformName name) const;
+		const std::unordered_map<uint32_t, UniformInfo>& GetUniforms() const { Wait(); return m_Uniforms; }
+		// Data size of an active uniform block, -1 if the program has no such block
+		GLint GetUniformBlockSize(UniformName block) const;
+
+		void SetInt(UniformName name, int value);
+		void SetInt2(UniformName name, const glm::ivec2& value);
+		void SetUInt(UniformName name, uint32_t value);
+		void SetFloat(UniformName name, float value);
+		void SetFloat2(UniformName name, const glm::vec2& value);
+		void SetFloat3(UniformName name, const glm::vec3& value);
+		void SetFloat4(UniformName name, const glm::vec4& value);
+		void SetMat3(UniformName name, const glm::mat3& value);
+		void SetMat4(UniformName name, const glm::mat4& value);
+		void SetIntArray(UniformName name, const int* values, uint32_t count);
+		void SetFloatArray(UniformName name, const float* values, uint32_t count);
+		void SetFloat3Array(UniformName name, const glm::vec3* values, uint32_t count);
+		void SetFloat4Array(UniformName name, const glm::vec4* values, uint32_t count);
+
+		// Stages in the order they were loaded
+		const std::vector<ShaderStageSource>& GetSources() const { return m_Sources; }
+
+		// Starts building a new program from one source per stage (in GetSources order) while the
+		// current program stays in use. A reload started while another is pending replaces it.
+		void BeginReload(const std::vector<std::string>& sources);
+		// Swaps the new program in once it has linked, or drops it and keeps the current program if
+		// it failed. Call once per frame while a reload is pending; uniforms set on the previous
+		// program are not carried over.
+		ShaderReloadStatus UpdateReload();
+		bool IsReloadPending() const { return m_Reload != nullptr; }
+
+		const ShaderDefines& GetDefines() const { return m_Defines; }
 
-		static Shader* FromGLSLTextFiles(const std::string& vertexShaderPath, const std::string& fragmentShaderPath, const std::string& geometryShaderPath = "");
+		// Sources go through PreprocessShader, defines select a permutation (see ShaderVariantCache)
+		static Shader* FromGLSLTextFiles(const std::string& vertexShaderPath, const std::string& fragmentShaderPath, const std::string& geometryShaderPath = "",
+			const ShaderDefines& defines = ShaderDefines());
+		static Shader* FromGLSLComputeFile(const std::string& computeShaderPath, const ShaderDefines& defines = ShaderDefines());
 	private:
 		Shader() = default;
 
 		void LoadFromGLSLTextFiles(const std::string& vertexShaderPath, const std::string& fragmentShaderPath, const std::string& geometryShaderPath);
-		GLuint CompileShader(GLenum type, const std::string& source);
+		void LoadFromGLSLComputeFile(const std::string& computeShaderPath);
+		// Returns true if the program came from the cache, otherwise starts the link
+		bool BeginProgram(const std::vector<std::string_view>& sources);
+		void Resolve() const;
+		void ReflectUniforms(GLuint program) const;
+		void AddUniform(const std::string& name, const UniformInfo& info) const;
 	private:
-		GLuint m_RendererID;
+		// Written by Resolve on first use
+		mutable GLuint m_RendererID = 0;
+		mutable bool m_LinkPending = false;
+		mutable std::vector<GLuint> m_PendingShaders;
+		uint64_t m_CacheKey = 0;
+		std::vector<ShaderStageSource> m_Sources;
+		ShaderDefines m_Defines;
+		std::unique_ptr<Shader> m_Reload;
+		mutable std::unordered_map<uint32_t, UniformInfo> m_Uniforms;
+		mutable std::unordered_map<uint32_t, GLint> m_UniformBlockSizes;
 	};
 
 }
\ No newline at end of file
@@ -0,0 +1,131 @@
+#include "glpch.h"
+#include "ShaderPreprocessor.h"
+
+#include "AssetPack.h"
+
+#include <filesystem>
+#include <fstream>
+
+namespace GLCore::Utils {
+
+	static bool ReadInclude(const std::string& filepath, std::string& result)
+	{
+		if (AssetSpan span = AssetPack::FindMounted(filepath))
+		{
+			result = span.AsString();
+			return true;
+		}
+
+		std::ifstream in(filepath, std::ios::in | std::ios::binary);
+		if (!in)
+			return false;
+
+		in.seekg(0, std::ios::end);
+		result.resize((size_t)in.tellg());
+		in.seekg(0, std::ios::beg);
+		in.read(&result[0], result.size());
+		return true;
+	}
+
+	// Returns the quoted path if line is an #include directive
+	static bool ParseInclude(std::string_view line, std::string_view& includePath)
+	{
+		size_t start = line.find_first_not_of(" \t");
+		if (start == std::string_view::npos || line[start] != '#')
+			return false;
+
+		size_t directive = line.find_first_not_of(" \t", start + 1);
+		if (directive == std::string_view::npos || line.compare(directive, 7, "include") != 0)
+			return false;
+
+		size_t open = line.find('"', directive + 7);
+		size_t close = open == std::string_view::npos ? open : line.find('"', open + 1);
+		if (close == std::string_view::npos)
+			return false;
+
+		includePath = line.substr(open + 1, close - open - 1);
+		return true;
+	}
+
+	static bool IsVersionDirective(std::string_view line)
+	{
+		size_t start = line.find_first_not_of(" \t");
+		return start != std::string_view::npos && line.compare(start, 8, "#version") == 0;
+	}
+
+	static bool ExpandIncludes(const std::string& path, std::string_view source, uint32_t fileIndex, const ShaderDefines* defines,
+		std::string& result, std::vector<std::string>& includes)
+	{
+		std::filesystem::path directory = std::filesystem::path(path).parent_path();
+
+		uint32_t lineNumber = 0;
+		size_t position = 0;
+		while (position < source.size())
+		{
+			size_t end = source.find('\n', position);
+			if (end == std::string_view::npos)
+				end = source.size();
+			std::string_view line = source.substr(position, end - position);
+			position = end + 1;
+			lineNumber++;
+
+			std::string_view includePath;
+			if (!ParseInclude(line, includePath))
+			{
+				result.append(line);
+				result += '\n';
+
+				// Defines go right after #version, which must stay the first directive
+				if (defines && IsVersionDirective(line))
+				{
+					for (const ShaderDefine& define : *defines)
+						result += "#define " + define.Name + " " + define.Value + "\n";
+					result += "#line " + std::to_string(lineNumber + 1) + " " + std::to_string(fileIndex) + "\n";
+					defines = nullptr;
+				}
+				continue;
+			}
+
+			std::string includeFile = (directory / std::string(includePath)).lexically_normal().generic_string();
+			if (includeFile == path || std::find(includes.begin(), includes.end(), includeFile) != includes.end())
+				continue;
+
+			std::string includeSource;
+			if (!ReadInclude(includeFile, includeSource))
+			{
+				LOG_ERROR("Could not open shader include '{0}' from '{1}'", includeFile, path);
+				return false;
+			}
+
+			includes.push_back(includeFile);
+			uint32_t includeIndex = (uint32_t)includes.size();
+			result += "#line 1 " + std::to_string(includeIndex) + "\n";
+			if (!ExpandIncludes(includeFile, includeSource, includeIndex, nullptr, result, includes))
+				return false;
+			result += "#line " + std::to_string(lineNumber + 1) + " " + std::to_string(fileIndex) + "\n";
+		}
+		return true;
+	}
+
+	bool PreprocessShader(const std::string& path, std::string_view source, const ShaderDefines& defines,
+		std::string& result, std::vector<std::string>& includes)
+	{
+		result.clear();
+		result.reserve(source.size());
+		return ExpandIncludes(path, source, 0, &defines, result, includes);
+	}
+
+	std::string GetShaderDefinesKey(const ShaderDefines& defines)
+	{
+		std::vector<const ShaderDefine*> sorted;
+		for (const ShaderDefine& define : defines)
+			sorted.push_back(&define);
+		std::sort(sorted.begin(), sorted.end(), [](const ShaderDefine* a, const ShaderDefine* b) { return a->Name < b->Name; });
+
+		std::string key;
+		for (const ShaderDefine* define : sorted)
+			key += define->Name + "=" + define->Value + ";";
+		return key;
+	}
+
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace GLCore::Utils {
+
+	struct ShaderDefine
+	{
+		std::string Name;
+		std::string Value;
+	};
+
+	using ShaderDefines = std::vector<ShaderDefine>;
+
+	// Expands #include "path" (relative to the including file, each file at most once) and inserts
+	// the defines after #version. Every file included is appended to includes. #line directives
+	// number the stage file 0 and includes[i] i + 1, so compile errors name the right file and line.
+	// Returns false if an include cannot be read.
+	bool PreprocessShader(const std::string& path, std::string_view source, const ShaderDefines& defines,
+		std::string& result, std::vector<std::string>& includes);
+
+	// "NAME=VALUE;" for each define, sorted by name, so equal sets give equal keys
+	std::string GetShaderDefinesKey(const ShaderDefines& defines);
+
+}
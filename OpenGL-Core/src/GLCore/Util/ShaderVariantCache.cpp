@@ -0,0 +1,23 @@
+#include "glpch.h"
+#include "ShaderVariantCache.h"
+
+namespace GLCore::Utils {
+
+	ShaderVariantCache::ShaderVariantCache(const std::string& vertexShaderPath, const std::string& fragmentShaderPath, ShaderWatcher* watcher)
+		: m_VertexShaderPath(vertexShaderPath), m_FragmentShaderPath(fragmentShaderPath), m_Watcher(watcher)
+	{
+	}
+
+	Shader* ShaderVariantCache::Get(const ShaderDefines& defines)
+	{
+		std::unique_ptr<Shader>& variant = m_Variants[GetShaderDefinesKey(defines)];
+		if (!variant)
+		{
+			variant.reset(Shader::FromGLSLTextFiles(m_VertexShaderPath, m_FragmentShaderPath, "", defines));
+			if (m_Watcher)
+				m_Watcher->Watch(variant.get());
+		}
+		return variant.get();
+	}
+
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+#include "Shader.h"
+#include "ShaderWatcher.h"
+
+namespace GLCore::Utils {
+
+	// Permutations of one program, each built on first request with its own set of #defines and
+	// kept for reuse, so switching features at runtime picks a specialized program instead of
+	// branching on uniforms in the shader. New variants are handed to the watcher if one is given.
+	class ShaderVariantCache
+	{
+	public:
+		ShaderVariantCache(const std::string& vertexShaderPath, const std::string& fragmentShaderPath, ShaderWatcher* watcher = nullptr);
+
+		// Starts the build of a new variant; check IsReady() to avoid waiting on it
+		Shader* Get(const ShaderDefines& defines);
+
+		uint32_t GetVariantCount() const { return (uint32_t)m_Variants.size(); }
+	private:
+		std::string m_VertexShaderPath;
+		std::string m_FragmentShaderPath;
+		ShaderWatcher* m_Watcher;
+		std::unordered_map<std::string, std::unique_ptr<Shader>> m_Variants;
+	};
+
+}
@@ -0,0 +1,175 @@
+#include "glpch.h"
+#include "ShaderWatcher.h"
+
+#include <fstream>
+
+namespace GLCore::Utils {
+
+	static bool ReadSource(const std::string& filepath, std::string& result)
+	{
+		std::ifstream in(filepath, std::ios::in | std::ios::binary);
+		if (!in)
+			return false;
+
+		in.seekg(0, std::ios::end);
+		result.resize((size_t)in.tellg());
+		in.seekg(0, std::ios::beg);
+		in.read(&result[0], result.size());
+		return (bool)in;
+	}
+
+	ShaderWatcher::ShaderWatcher(uint32_t pollIntervalMs)
+		: m_PollInterval(pollIntervalMs)
+	{
+		m_Thread = std::thread(&ShaderWatcher::WatchThread, this);
+	}
+
+	ShaderWatcher::~ShaderWatcher()
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_EntryMutex);
+			m_Running = false;
+		}
+		m_StopCondition.notify_all();
+		m_Thread.join();
+	}
+
+	void ShaderWatcher::CollectFiles(const Shader* shader, Entry& entry)
+	{
+		std::vector<std::string> paths;
+		for (const ShaderStageSource& source : shader->GetSources())
+		{
+			paths.push_back(source.Path);
+			paths.insert(paths.end(), source.Includes.begin(), source.Includes.end());
+		}
+
+		std::vector<WatchedFile> files;
+		for (const std::string& path : paths)
+		{
+			auto known = std::find_if(entry.Files.begin(), entry.Files.end(), [&](const WatchedFile& file) { return file.Path == path; });
+			if (known != entry.Files.end())
+			{
+				files.push_back(*known);
+				continue;
+			}
+
+			std::error_code error;
+			std::filesystem::file_time_type writeTime = std::filesystem::last_write_time(path, error);
+			if (!error)
+				files.push_back({ path, writeTime });
+		}
+		entry.Files = std::move(files);
+	}
+
+	void ShaderWatcher::Watch(Shader* shader)
+	{
+		Entry entry;
+		entry.Target = shader;
+		for (const ShaderStageSource& source : shader->GetSources())
+			entry.Stages.push_back(source.Path);
+		CollectFiles(shader, entry);
+		if (entry.Files.empty())
+			return;
+
+		std::lock_guard<std::mutex> lock(m_EntryMutex);
+		m_Entries.push_back(std::move(entry));
+		m_WatchedCount = (uint32_t)m_Entries.size();
+	}
+
+	void ShaderWatcher::WatchThread()
+	{
+		std::unique_lock<std::mutex> lock(m_EntryMutex);
+		while (m_Running)
+		{
+			m_StopCondition.wait_for(lock, std::chrono::milliseconds(m_PollInterval), [this] { return !m_Running; });
+			if (!m_Running)
+				break;
+
+			for (Entry& entry : m_Entries)
+			{
+				bool changed = false;
+				for (WatchedFile& file : entry.Files)
+				{
+					// Files being replaced briefly fail to stat, they are picked up on a later poll
+					std::error_code error;
+					std::filesystem::file_time_type writeTime = std::filesystem::last_write_time(file.Path, error);
+					if (!error && writeTime != file.WriteTime)
+					{
+						file.WriteTime = writeTime;
+						changed = true;
+					}
+				}
+				if (!changed)
+					continue;
+
+				// A stage that cannot be read (e.g. mid-save) fails the rebuild, the next save retries
+				Change change;
+				change.Target = entry.Target;
+				for (const std::string& stage : entry.Stages)
+				{
+					std::string& text = change.Sources.emplace_back();
+					if (!ReadSource(stage, text))
+						LOG_WARN("Could not read shader source '{0}'", stage);
+				}
+
+				std::lock_guard<std::mutex> changeLock(m_ChangeMutex);
+				m_Changes.push_back(std::move(change));
+			}
+		}
+	}
+
+	const std::vector<Shader*>& ShaderWatcher::Update()
+	{
+		m_Swapped.clear();
+
+		std::vector<Change> changes;
+		{
+			std::lock_guard<std::mutex> lock(m_ChangeMutex);
+			changes.swap(m_Changes);
+		}
+
+		for (Change& change : changes)
+		{
+			change.Target->BeginReload(change.Sources);
+			if (std::find(m_Reloading.begin(), m_Reloading.end(), change.Target) == m_Reloading.end())
+				m_Reloading.push_back(change.Target);
+		}
+
+		for (size_t i = 0; i < m_Reloading.size();)
+		{
+			Shader* shader = m_Reloading[i];
+			std::string name = shader->GetSources().back().Path;
+			ShaderReloadStatus status = shader->UpdateReload();
+			if (status == ShaderReloadStatus::Pending)
+			{
+				i++;
+				continue;
+			}
+
+			if (status == ShaderReloadStatus::Swapped)
+			{
+				// The new sources may include different files
+				{
+					std::lock_guard<std::mutex> lock(m_EntryMutex);
+					for (Entry& entry : m_Entries)
+					{
+						if (entry.Target == shader)
+							CollectFiles(shader, entry);
+					}
+				}
+
+				LOG_INFO("Reloaded shader '{0}'", name);
+				m_Swapped.push_back(shader);
+				m_ReloadCount++;
+			}
+			else if (status == ShaderReloadStatus::Failed)
+			{
+				LOG_WARN("Shader '{0}' failed to rebuild, keeping the previous program", name);
+				m_FailedCount++;
+			}
+			m_Reloading.erase(m_Reloading.begin() + i);
+		}
+		return m_Swapped;
+	}
+
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Shader.h"
+
+namespace GLCore::Utils {
+
+	// Rebuilds shaders whose source files or includes change on disk. A background thread polls the
+	// modification times of the watched files and reads the changed stages; Update() starts the
+	// rebuild on the GL thread and swaps each program in once it has linked, keeping the previous
+	// one if it fails. Polling instead of OS change notifications keeps it portable, and a few
+	// dozen timestamps every interval cost nothing. Sources only present in a mounted pack are
+	// not watched. Watched shaders must outlive the watcher.
+	class ShaderWatcher
+	{
+	public:
+		ShaderWatcher(uint32_t pollIntervalMs = 250);
+		~ShaderWatcher();
+
+		void Watch(Shader* shader);
+
+		// GL thread, once per frame. Returns the shaders swapped to a new program this frame.
+		const std::vector<Shader*>& Update();
+
+		uint32_t GetWatchedCount() const { return m_WatchedCount; }
+		uint32_t GetPendingCount() const { return (uint32_t)m_Reloading.size(); }
+		uint32_t GetReloadCount() const { return m_ReloadCount; }
+		uint32_t GetFailedCount() const { return m_FailedCount; }
+	private:
+		struct WatchedFile
+		{
+			std::string Path;
+			std::filesystem::file_time_type WriteTime;
+		};
+
+		struct Entry
+		{
+			Shader* Target;
+			// Copied so the watch thread never reads the shader while it is swapped
+			std::vector<std::string> Stages;
+			std::vector<WatchedFile> Files;
+		};
+
+		struct Change
+		{
+			Shader* Target;
+			std::vector<std::string> Sources;
+		};
+
+		// Stage files and their includes, keeping the times already known
+		static void CollectFiles(const Shader* shader, Entry& entry);
+		void WatchThread();
+	private:
+		std::thread m_Thread;
+		std::atomic<bool> m_Running = true;
+		uint32_t m_PollInterval;
+
+		std::mutex m_EntryMutex;
+		std::condition_variable m_StopCondition;
+		std::vector<Entry> m_Entries;
+		std::atomic<uint32_t> m_WatchedCount = 0;
+
+		std::mutex m_ChangeMutex;
+		std::vector<Change> m_Changes;
+
+		std::vector<Shader*> m_Reloading;
+		std::vector<Shader*> m_Swapped;
+		uint32_t m_ReloadCount = 0;
+		uint32_t m_FailedCount = 0;
+	};
+
+}
@@ -0,0 +1,160 @@
+#include "glpch.h"
+#include "TextureFormat.h"
+
+#include <glm/glm.hpp>
+#include <glm/gtc/packing.hpp>
+
+namespace GLCore::Utils {
+
+	uint32_t CalculateMipCount(uint32_t width, uint32_t height)
+	{
+		uint32_t size = std::max(width, height);
+		uint32_t mipCount = 1;
+		while (size > 1)
+		{
+			size >>= 1;
+			mipCount++;
+		}
+		return mipCount;
+	}
+
+	void GetTextureFormats(int channels, bool hdr, bool srgb, GLenum& internalFormat, GLenum& dataFormat)
+	{
+		switch (channels)
+		{
+		case 1:
+			internalFormat = hdr ? GL_R16F : GL_R8;
+			dataFormat = GL_RED;
+			break;
+		case 2:
+			internalFormat = hdr ? GL_RG16F : GL_RG8;
+			dataFormat = GL_RG;
+			break;
+		case 3:
+			if (hdr)
+				internalFormat = GL_RGB16F;
+			else
+				internalFormat = srgb ? GL_SRGB8 : GL_RGB8;
+			dataFormat = GL_RGB;
+			break;
+		default:
+			if (hdr)
+				internalFormat = GL_RGBA16F;
+			else
+				internalFormat = srgb ? GL_SRGB8_ALPHA8 : GL_RGBA8;
+			dataFormat = GL_RGBA;
+			break;
+		}
+	}
+
+	uint32_t GetBytesPerTexel(GLenum internalFormat)
+	{
+		switch (internalFormat)
+		{
+		case GL_R8:
+		case GL_RED:
+			return 1;
+		case GL_RG8:
+		case GL_R16F:
+			return 2;
+		case GL_RGB8:
+		case GL_RGB:
+		case GL_SRGB8:
+		case GL_SRGB:
+		case GL_RGBA8:
+		case GL_RGBA:
+		case GL_SRGB8_ALPHA8:
+		case GL_SRGB_ALPHA:
+		case GL_RG16F:
+		case GL_R32F:
+		case GL_R11F_G11F_B10F:
+		case GL_RGB9_E5:
+			return 4;
+		case GL_RGB16F:
+		case GL_RGBA16F:
+		case GL_RG32F:
+			return 8;
+		case GL_RGB32F:
+		case GL_RGBA32F:
+			return 16;
+		}
+
+		LOG_WARN("Unknown texel size for internal format 0x{0:x}", internalFormat);
+		return 4;
+	}
+
+	uint64_t CalculateTextureSize(GLenum internalFormat, uint32_t width, uint32_t height, uint32_t mipCount, uint32_t layers)
+	{
+		uint64_t bytesPerTexel = GetBytesPerTexel(internalFormat);
+		uint64_t size = 0;
+		for (uint32_t mip = 0; mip < mipCount; mip++)
+		{
+			uint64_t mipWidth = std::max(width >> mip, 1u);
+			uint64_t mipHeight = std::max(height >> mip, 1u);
+			size += mipWidth * mipHeight * bytesPerTexel;
+		}
+		return size * layers;
+	}
+
+	bool IsColorRenderable(GLenum internalFormat)
+	{
+		// Shared-exponent storage can be sampled but not rendered to
+		return internalFormat != GL_RGB9_E5;
+	}
+
+	const char* GetFormatName(GLenum internalFormat)
+	{
+		switch (internalFormat)
+		{
+		case GL_RGB16F:         return "RGB16F";
+		case GL_RGBA16F:        return "RGBA16F";
+		case GL_R11F_G11F_B10F: return "R11F_G11F_B10F";
+		case GL_RGB9_E5:        return "RGB9_E5";
+		case GL_RG16F:          return "RG16F";
+		}
+		return "Unknown";
+	}
+
+	static glm::vec3 Quantize(GLenum internalFormat, const glm::vec3& value)
+	{
+		switch (internalFormat)
+		{
+		case GL_R11F_G11F_B10F:
+			return glm::unpackF2x11_1x10(glm::packF2x11_1x10(value));
+		case GL_RGB9_E5:
+			return glm::unpackF3x9_E1x5(glm::packF3x9_E1x5(value));
+		case GL_RGB16F:
+		case GL_RGBA16F:
+			return glm::vec3(
+				glm::unpackHalf1x16(glm::packHalf1x16(value.r)),
+				glm::unpackHalf1x16(glm::packHalf1x16(value.g)),
+				glm::unpackHalf1x16(glm::packHalf1x16(value.b)));
+		}
+		return value;
+	}
+
+	PackingError MeasurePackingError(GLenum internalFormat, const float* rgb, size_t texelCount)
+	{
+		PackingError error;
+		if (texelCount == 0)
+			return error;
+
+		double sum = 0.0;
+		for (size_t i = 0; i < texelCount; i++)
+		{
+			glm::vec3 value = glm::max(glm::vec3(rgb[i * 3 + 0], rgb[i * 3 + 1], rgb[i * 3 + 2]), glm::vec3(0.0f));
+			glm::vec3 quantized = Quantize(internalFormat, value);
+
+			float reference = std::max(std::max(value.r, value.g), std::max(value.b, 1e-4f));
+			glm::vec3 delta = glm::abs(quantized - value);
+			float relative = std::max(std::max(delta.r, delta.g), delta.b) / reference;
+
+			error.MaxRelative = std::max(error.MaxRelative, relative);
+			sum += relative;
+		}
+		error.MeanRelative = (float)(sum / (double)texelCount);
+
+		return error;
+	}
+
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstdint>
+
+#include <glad/glad.h>
+
+namespace GLCore::Utils {
+
+	struct PackingError
+	{
+		float MaxRelative = 0.0f;
+		float MeanRelative = 0.0f;
+	};
+
+	uint32_t CalculateMipCount(uint32_t width, uint32_t height);
+
+	// Storage and upload formats for a decoded image with the given channel count
+	void GetTextureFormats(int channels, bool hdr, bool srgb, GLenum& internalFormat, GLenum& dataFormat);
+
+	// Bytes per texel as allocated by the driver (GL_RGB16F is padded to 8 bytes)
+	uint32_t GetBytesPerTexel(GLenum internalFormat);
+	uint64_t CalculateTextureSize(GLenum internalFormat, uint32_t width, uint32_t height, uint32_t mipCount, uint32_t layers = 1);
+
+	bool IsColorRenderable(GLenum internalFormat);
+	const char* GetFormatName(GLenum internalFormat);
+
+	// Error introduced by storing linear RGB radiance in the given format, relative to
+	// the brightest channel of each texel (shared-exponent formats lose the dim channels)
+	PackingError MeasurePackingError(GLenum internalFormat, const float* rgb, size_t texelCount);
+
+}
@@ -0,0 +1,318 @@
+#include "glpch.h"
+#include "TextureRegistry.h"
+
+#include "AssetPack.h"
+#include "DDSFile.h"
+#include "TextureFormat.h"
+
+#include <stb_image.h>
+
+namespace GLCore::Utils {
+
+	// Frames a released texture is kept alive for, covers the frames the driver may still have queued
+	static const uint64_t DELETION_LATENCY = 3;
+
+	static std::string GetCacheKey(const std::string& path, const TextureImportSettings& settings)
+	{
+		std::string key = path;
+		key += '|';
+		key += settings.HDR ? 'h' : '-';
+		key += settings.SRGB ? 's' : '-';
+		key += settings.FlipVertically ? 'f' : '-';
+		key += (char)('0' + (int)settings.Compression);
+		key += (char)('0' + (int)settings.Mips.Filter);
+		key += (char)('0' + (int)settings.Mips.Content);
+		return key;
+	}
+
+	// 64-bit FNV-1a
+	static uint64_t HashBytes(const void* data, size_t size, uint64_t hash = 14695981039346656037ull)
+	{
+		const uint8_t* bytes = (const uint8_t*)data;
+		for (size_t i = 0; i < size; i++)
+		{
+			hash ^= bytes[i];
+			hash *= 1099511628211ull;
+		}
+		return hash;
+	}
+
+	// Second, independent hash of the decoded source, 8 bytes at a time with a multiply-xorshift mix
+	static uint64_t HashSource(const void* data, size_t size)
+	{
+		const uint8_t* bytes = (const uint8_t*)data;
+		uint64_t hash = 0x9E3779B97F4A7C15ull ^ size;
+		for (size_t i = 0; i < size; i += sizeof(uint64_t))
+		{
+			uint64_t word = 0;
+			memcpy(&word, bytes + i, std::min(sizeof(uint64_t), size - i));
+			hash = (hash ^ word) * 0xBF58476D1CE4E5B9ull;
+			hash ^= hash >> 31;
+		}
+		return hash;
+	}
+
+	// The hash only finds a candidate, its texels are read back and compared before the texture is shared.
+	// Only exact for formats that store the source texels unchanged, see Load for HDR.
+	static bool HasPixels(const RegisteredTexture& texture, GLenum internalFormat, GLenum dataFormat, GLenum type, const void* data, size_t size)
+	{
+		GLint format;
+		glGetTextureLevelParameteriv(texture.GetRendererID(), 0, GL_TEXTURE_INTERNAL_FORMAT, &format);
+		if ((GLenum)format != internalFormat)
+			return false;
+
+		std::vector<uint8_t> pixels(size);
+		glPixelStorei(GL_PACK_ALIGNMENT, 1);
+		glGetTextureImage(texture.GetRendererID(), 0, dataFormat, type, (GLsizei)size, pixels.data());
+		glPixelStorei(GL_PACK_ALIGNMENT, 4);
+		return memcmp(pixels.data(), data, size) == 0;
+	}
+
+	static bool HasBlocks(const RegisteredTexture& texture, GLenum internalFormat, const CompressedImage& image, const uint8_t* blocks)
+	{
+		GLint format, levels;
+		glGetTextureLevelParameteriv(texture.GetRendererID(), 0, GL_TEXTURE_INTERNAL_FORMAT, &format);
+		glGetTextureParameteriv(texture.GetRendererID(), GL_TEXTURE_IMMUTABLE_LEVELS, &levels);
+		if ((GLenum)format != internalFormat || (uint32_t)levels != image.MipCount)
+			return false;
+
+		std::vector<uint8_t> level;
+		for (uint32_t i = 0; i < image.MipCount; i++)
+		{
+			size_t size = GetCompressedMipSize(image, i);
+			level.resize(size);
+			glGetCompressedTextureImage(texture.GetRendererID(), i, (GLsizei)size, level.data());
+			if (memcmp(level.data(), blocks + GetCompressedMipOffset(image, i), size) != 0)
+				return false;
+		}
+		return true;
+	}
+
+	TextureRegistry::TextureRegistry()
+		: m_DeletionQueue(std::make_shared<DeletionQueue>())
+	{
+	}
+
+	TextureRegistry::~TextureRegistry()
+	{
+		for (PendingDeletion& deletion : m_DeletionQueue->Pending)
+			glDeleteTextures(1, &deletion.RendererID);
+		m_DeletionQueue->Pending.clear();
+
+		// Handles still held elsewhere delete their texture directly from now on
+		m_DeletionQueue->Closed = true;
+	}
+
+	std::shared_ptr<RegisteredTexture> TextureRegistry::CreateHandle(GLuint rendererID, uint32_t width, uint32_t height, uint64_t contentHash)
+	{
+		std::shared_ptr<DeletionQueue> queue = m_DeletionQueue;
+		std::shared_ptr<RegisteredTexture> texture(new RegisteredTexture(), [queue](RegisteredTexture* texture)
+		{
+			if (queue->Closed)
+				glDeleteTextures(1, &texture->m_RendererID);
+			else
+				queue->Pending.push_back({ texture->m_RendererID, queue->FrameIndex });
+			delete texture;
+		});
+
+		texture->m_RendererID = rendererID;
+		texture->m_Width = width;
+		texture->m_Height = height;
+		texture->m_ContentHash = contentHash;
+		return texture;
+	}
+
+	std::shared_ptr<RegisteredTexture> TextureRegistry::Load(const std::string& path, const TextureImportSettings& settings)
+	{
+		std::string key = GetCacheKey(path, settings);
+
+		std::error_code error;
+		std::filesystem::file_time_type writeTime = std::filesystem::last_write_time(path, error);
+
+		auto it = m_PathCache.find(key);
+		// Files only present in a mounted pack report the same error time on every call
+		if (it != m_PathCache.end() && it->second.WriteTime == writeTime)
+		{
+			if (std::shared_ptr<RegisteredTexture> texture = it->second.Texture.lock())
+				return texture;
+		}
+
+		if (settings.Compression != BlockFormat::None)
+		{
+			std::shared_ptr<RegisteredTexture> texture = LoadCompressed(path, settings);
+			if (texture)
+				m_PathCache[key] = { texture, writeTime };
+			return texture;
+		}
+
+		int width, height, channels;
+		void* data;
+		stbi_set_flip_vertically_on_load_thread(settings.FlipVertically);
+		if (AssetSpan span = AssetPack::FindMounted(path))
+		{
+			if (settings.HDR)
+				data = stbi_loadf_from_memory(span.Data, (int)span.Size, &width, &height, &channels, 0);
+			else
+				data = stbi_load_from_memory(span.Data, (int)span.Size, &width, &height, &channels, 0);
+		}
+		else
+		{
+			if (settings.HDR)
+				data = stbi_loadf(path.c_str(), &width, &height, &channels, 0);
+			else
+				data = stbi_load(path.c_str(), &width, &height, &channels, 0);
+		}
+		stbi_set_flip_vertically_on_load_thread(false);
+
+		if (!data)
+		{
+			LOG_ERROR("Texture failed to load at path: {0}", path);
+			return nullptr;
+		}
+
+		size_t dataSize = (size_t)width * height * channels * (settings.HDR ? sizeof(float) : sizeof(uint8_t));
+		int header[] = { width, height, channels, settings.HDR, settings.SRGB };
+		uint64_t contentHash = HashBytes(data, dataSize, HashBytes(header, sizeof(header)));
+
+		GLenum internalFormat, dataFormat;
+		GetTextureFormats(channels, settings.HDR, settings.SRGB, internalFormat, dataFormat);
+		GLenum type = settings.HDR ? GL_FLOAT : GL_UNSIGNED_BYTE;
+
+		// Half-float storage rounds the fp32 source, so HDR content is matched on a second hash of the
+		// source instead of reading the texels back
+		uint64_t sourceHash = settings.HDR ? HashSource(data, dataSize) : 0;
+		std::shared_ptr<RegisteredTexture> texture = FindContent(contentHash);
+		if (texture && (settings.HDR ? texture->m_SourceHash != sourceHash : !HasPixels(*texture, internalFormat, dataFormat, type, data, dataSize)))
+			texture = nullptr;
+		if (!texture)
+		{
+			uint32_t mipCount = settings.HDR ? 1 : CalculateMipCount(width, height);
+
+			GLuint rendererID;
+			glCreateTextures(GL_TEXTURE_2D, 1, &rendererID);
+			glTextureStorage2D(rendererID, mipCount, internalFormat, width, height);
+
+			glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+			glTextureSubImage2D(rendererID, 0, 0, 0, width, height, dataFormat, type, data);
+			glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+			if (mipCount > 1)
+				glGenerateTextureMipmap(rendererID);
+
+			glTextureParameteri(rendererID, GL_TEXTURE_WRAP_S, GL_REPEAT);
+			glTextureParameteri(rendererID, GL_TEXTURE_WRAP_T, GL_REPEAT);
+			glTextureParameteri(rendererID, GL_TEXTURE_MIN_FILTER, mipCount > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+			glTextureParameteri(rendererID, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+			texture = Register(rendererID, width, height, contentHash);
+			texture->m_SourceHash = sourceHash;
+		}
+
+		stbi_image_free(data);
+
+		m_PathCache[key] = { texture, writeTime };
+		return texture;
+	}
+
+	std::shared_ptr<RegisteredTexture> TextureRegistry::FindContent(uint64_t contentHash)
+	{
+		auto it = m_ContentCache.find(contentHash);
+		return it != m_ContentCache.end() ? it->second.lock() : nullptr;
+	}
+
+	std::shared_ptr<RegisteredTexture> TextureRegistry::Register(GLuint rendererID, uint32_t width, uint32_t height, uint64_t contentHash)
+	{
+		std::shared_ptr<RegisteredTexture> texture = CreateHandle(rendererID, width, height, contentHash);
+		m_ContentCache[contentHash] = texture;
+		return texture;
+	}
+
+	std::shared_ptr<RegisteredTexture> TextureRegistry::LoadCompressed(const std::string& path, const TextureImportSettings& settings)
+	{
+		CompressedImage image;
+		const uint8_t* blocks = nullptr;
+		bool loaded;
+
+		// A packed cache is uploaded straight from the mapping
+		std::string cachePath = path + ".dds";
+		if (AssetSpan span = AssetPack::FindMounted(cachePath))
+		{
+			loaded = ParseDDS(span.Data, span.Size, cachePath, image, blocks);
+		}
+		else
+		{
+			loaded = LoadCompressedTexture(path, cachePath, settings.Compression, settings.Mips, settings.FlipVertically, image);
+			blocks = image.Data.data();
+		}
+
+		if (!loaded)
+		{
+			LOG_ERROR("Texture failed to load at path: {0}", path);
+			return nullptr;
+		}
+
+		uint32_t header[] = { image.Width, image.Height, image.MipCount, (uint32_t)image.Format, settings.SRGB };
+		uint64_t contentHash = HashBytes(blocks, GetCompressedMipOffset(image, image.MipCount), HashBytes(header, sizeof(header)));
+
+		GLenum internalFormat = GetBlockInternalFormat(image.Format, settings.SRGB);
+		std::shared_ptr<RegisteredTexture> texture = FindContent(contentHash);
+		if (texture && HasBlocks(*texture, internalFormat, image, blocks))
+			return texture;
+
+		GLuint rendererID;
+		glCreateTextures(GL_TEXTURE_2D, 1, &rendererID);
+		glTextureStorage2D(rendererID, image.MipCount, internalFormat, image.Width, image.Height);
+		for (uint32_t level = 0; level < image.MipCount; level++)
+		{
+			glCompressedTextureSubImage2D(rendererID, level, 0, 0, GetCompressedMipWidth(image, level), GetCompressedMipHeight(image, level),
+				internalFormat, (GLsizei)GetCompressedMipSize(image, level), blocks + GetCompressedMipOffset(image, level));
+		}
+
+		glTextureParameteri(rendererID, GL_TEXTURE_WRAP_S, GL_REPEAT);
+		glTextureParameteri(rendererID, GL_TEXTURE_WRAP_T, GL_REPEAT);
+		glTextureParameteri(rendererID, GL_TEXTURE_MIN_FILTER, image.MipCount > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+		glTextureParameteri(rendererID, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+		return Register(rendererID, image.Width, image.Height, contentHash);
+	}
+
+	void TextureRegistry::RemoveExpiredEntries()
+	{
+		for (auto it = m_PathCache.begin(); it != m_PathCache.end();)
+		{
+			if (it->second.Texture.expired())
+				it = m_PathCache.erase(it);
+			else
+				++it;
+		}
+
+		for (auto it = m_ContentCache.begin(); it != m_ContentCache.end();)
+		{
+			if (it->second.expired())
+				it = m_ContentCache.erase(it);
+			else
+				++it;
+		}
+	}
+
+	void TextureRegistry::Update()
+	{
+		DeletionQueue& queue = *m_DeletionQueue;
+		queue.FrameIndex++;
+
+		if (queue.Pending.empty())
+			return;
+
+		auto end = std::remove_if(queue.Pending.begin(), queue.Pending.end(), [&queue](PendingDeletion& deletion)
+		{
+			if (deletion.Frame + DELETION_LATENCY > queue.FrameIndex)
+				return false;
+
+			glDeleteTextures(1, &deletion.RendererID);
+			return true;
+		});
+		queue.Pending.erase(end, queue.Pending.end());
+
+		RemoveExpiredEntries();
+	}
+
+}
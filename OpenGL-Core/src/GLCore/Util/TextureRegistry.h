@@ -0,0 +1,93 @@
+#pragma once
+
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <glad/glad.h>
+
+#include "BlockCompression.h"
+
+namespace GLCore::Utils {
+
+	struct TextureImportSettings
+	{
+		bool HDR = false;
+		bool SRGB = false;
+		bool FlipVertically = false;
+
+		// Block compress on first load and cache the result next to the source (<path>.dds)
+		BlockFormat Compression = BlockFormat::None;
+		MipChainSettings Mips;
+	};
+
+	class RegisteredTexture
+	{
+	public:
+		GLuint GetRendererID() const { return m_RendererID; }
+		uint32_t GetWidth() const { return m_Width; }
+		uint32_t GetHeight() const { return m_Height; }
+		uint64_t GetContentHash() const { return m_ContentHash; }
+	private:
+		friend class TextureRegistry;
+
+		GLuint m_RendererID = 0;
+		uint32_t m_Width = 0, m_Height = 0;
+		uint64_t m_ContentHash = 0;
+		// Independent hash of the decoded HDR source, confirms a content hash match
+		uint64_t m_SourceHash = 0;
+	};
+
+	// Loads textures once per (path, import settings, modification time) and hands out
+	// shared handles. Files with byte-identical decoded content share one GL texture; LDR and
+	// compressed content is compared texel for texel, HDR content by two independent hashes.
+	// When the last handle is released the texture is deleted a few frames later, so
+	// draws already submitted with it are not affected. GL thread only; Update() once per frame.
+	class TextureRegistry
+	{
+	public:
+		TextureRegistry();
+		~TextureRegistry();
+
+		// Returns nullptr when the file cannot be loaded
+		std::shared_ptr<RegisteredTexture> Load(const std::string& path, const TextureImportSettings& settings = TextureImportSettings());
+
+		void Update();
+
+		uint32_t GetTextureCount() const { return (uint32_t)m_ContentCache.size(); }
+		uint32_t GetPendingDeletionCount() const { return (uint32_t)m_DeletionQueue->Pending.size(); }
+	private:
+		struct PathEntry
+		{
+			std::weak_ptr<RegisteredTexture> Texture;
+			std::filesystem::file_time_type WriteTime;
+		};
+
+		struct PendingDeletion
+		{
+			GLuint RendererID;
+			uint64_t Frame;
+		};
+
+		// Shared with the handle deleters so handles may outlive the registry
+		struct DeletionQueue
+		{
+			std::vector<PendingDeletion> Pending;
+			uint64_t FrameIndex = 0;
+			bool Closed = false;
+		};
+
+		std::shared_ptr<RegisteredTexture> LoadCompressed(const std::string& path, const TextureImportSettings& settings);
+		std::shared_ptr<RegisteredTexture> FindContent(uint64_t contentHash);
+		std::shared_ptr<RegisteredTexture> Register(GLuint rendererID, uint32_t width, uint32_t height, uint64_t contentHash);
+		std::shared_ptr<RegisteredTexture> CreateHandle(GLuint rendererID, uint32_t width, uint32_t height, uint64_t contentHash);
+		void RemoveExpiredEntries();
+	private:
+		std::unordered_map<std::string, PathEntry> m_PathCache;
+		std::unordered_map<uint64_t, std::weak_ptr<RegisteredTexture>> m_ContentCache;
+		std::shared_ptr<DeletionQueue> m_DeletionQueue;
+	};
+
+}
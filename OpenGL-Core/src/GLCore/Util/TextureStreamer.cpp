@@ -0,0 +1,467 @@
+#include "glpch.h"
+#include "TextureStreamer.h"
+
+#include "AssetPack.h"
+#include "BlockCompression.h"
+#include "ChannelPacker.h"
+#include "DDSFile.h"
+#include "ImageCache.h"
+#include "MipChainBuilder.h"
+#include "ParallelFor.h"
+#include "TextureFormat.h"
+
+#include <chrono>
+
+#include <stb_image.h>
+
+namespace GLCore::Utils {
+
+	// Upper bound for a single staging copy, keeps each step well inside the frame budget
+	static const size_t MAX_CHUNK_SIZE = 1024 * 1024;
+	static const size_t STAGING_ALIGNMENT = 16;
+
+	StreamedTexture::~StreamedTexture()
+	{
+		if (m_RendererID)
+			glDeleteTextures(1, &m_RendererID);
+	}
+
+	TextureStreamer::TextureStreamer(uint32_t workerCount, size_t stagingSize)
+		: m_StagingSize(stagingSize)
+	{
+		if (workerCount == 0)
+			workerCount = std::max(std::thread::hardware_concurrency(), 2u) - 1;
+
+		// Workers filter and compress in parallel too, split the cores between them rather than nesting full pools
+		m_FilterThreadCount = std::max(GetWorkerThreadCount() / workerCount, 1u);
+
+		CreateStaging(m_StagingSize);
+
+		for (uint32_t i = 0; i < workerCount; i++)
+			m_Workers.emplace_back(&TextureStreamer::WorkerThread, this);
+	}
+
+	TextureStreamer::~TextureStreamer()
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_RequestMutex);
+			m_Running = false;
+		}
+		m_RequestCondition.notify_all();
+		for (std::thread& worker : m_Workers)
+			worker.join();
+
+		for (Upload& upload : m_Decoded)
+			FreePixels(upload);
+		for (Upload& upload : m_Uploads)
+			FreePixels(upload);
+
+		for (StagingRange& range : m_StagingRanges)
+			glDeleteSync(range.Fence);
+
+		DestroyStaging();
+
+		for (auto& [color, placeholder] : m_Placeholders)
+			glDeleteTextures(1, &placeholder);
+	}
+
+	std::shared_ptr<StreamedTexture> TextureStreamer::Load(const std::string& path, const TextureSpecification& specification)
+	{
+		auto texture = std::make_shared<StreamedTexture>();
+		texture->m_Path = path;
+		texture->m_Placeholder = GetPlaceholder(specification.Placeholder);
+
+		Upload upload;
+		upload.Texture = texture;
+		upload.Specification = specification;
+
+		m_PendingCount++;
+		{
+			std::lock_guard<std::mutex> lock(m_RequestMutex);
+			m_Requests.push_back(std::move(upload));
+		}
+		m_RequestCondition.notify_one();
+
+		return texture;
+	}
+
+	void TextureStreamer::WorkerThread()
+	{
+		while (true)
+		{
+			Upload upload;
+			{
+				std::unique_lock<std::mutex> lock(m_RequestMutex);
+				m_RequestCondition.wait(lock, [this]() { return !m_Running || !m_Requests.empty(); });
+				if (!m_Running)
+					return;
+
+				upload = std::move(m_Requests.front());
+				m_Requests.pop_front();
+			}
+
+			if (upload.Specification.Mips.ThreadCount == 0)
+				upload.Specification.Mips.ThreadCount = m_FilterThreadCount;
+
+			stbi_set_flip_vertically_on_load_thread(upload.Specification.HDR);
+			const std::vector<ChannelSource>& packed = upload.Specification.PackedChannels;
+			if (packed.empty() || PackChannels(packed, upload.Texture->m_Path, m_FilterThreadCount))
+			{
+				if (!LoadFromPack(upload))
+					LoadFromDisk(upload);
+			}
+
+			std::lock_guard<std::mutex> lock(m_DecodedMutex);
+			m_Decoded.push_back(std::move(upload));
+		}
+	}
+
+	bool TextureStreamer::LoadFromPack(Upload& upload)
+	{
+		const std::string& path = upload.Texture->m_Path;
+		const TextureSpecification& specification = upload.Specification;
+		bool cached = IsImageCachePath(path);
+
+		// Processed forms are uploaded straight from the mapping
+		if (specification.Compression != BlockFormat::None && !cached)
+		{
+			std::string compressedPath = path + ".dds";
+			if (AssetSpan span = AssetPack::FindMounted(compressedPath))
+			{
+				CompressedImage image;
+				const uint8_t* blocks;
+				if (!ParseDDS(span.Data, span.Size, compressedPath, image, blocks))
+					return false;
+
+				upload.Width = image.Width;
+				upload.Height = image.Height;
+				upload.MipCount = image.MipCount;
+				upload.Compression = image.Format;
+				upload.Pixels = (void*)blocks;
+				upload.Mapped = true;
+				return true;
+			}
+		}
+
+		if (cached || specification.PrebuiltMips)
+		{
+			std::string cachePath = cached ? path : path + ".tex";
+			if (AssetSpan span = AssetPack::FindMounted(cachePath))
+			{
+				ImageData image;
+				const uint8_t* pixels;
+				if (!ParseImageCache(span.Data, span.Size, cachePath, image, pixels))
+					return false;
+
+				upload.Width = image.Width;
+				upload.Height = image.Height;
+				upload.Channels = image.Channels;
+				upload.MipCount = image.MipCount;
+				upload.Pixels = (void*)pixels;
+				upload.Mapped = true;
+				return true;
+			}
+		}
+
+		AssetSpan span = AssetPack::FindMounted(path);
+		if (!span || cached)
+			return false;
+
+		if (specification.HDR)
+			upload.Pixels = stbi_loadf_from_memory(span.Data, (int)span.Size, &upload.Width, &upload.Height, &upload.Channels, 0);
+		else
+			upload.Pixels = stbi_load_from_memory(span.Data, (int)span.Size, &upload.Width, &upload.Height, &upload.Channels, 0);
+		return true;
+	}
+
+	void TextureStreamer::LoadFromDisk(Upload& upload)
+	{
+		const std::string& path = upload.Texture->m_Path;
+		bool cached = IsImageCachePath(path);
+		if (upload.Specification.Compression != BlockFormat::None && !cached)
+		{
+			CompressedImage image;
+			if (LoadCompressedTexture(path, path + ".dds", upload.Specification.Compression, upload.Specification.Mips, upload.Specification.HDR, image))
+			{
+				upload.Width = image.Width;
+				upload.Height = image.Height;
+				upload.MipCount = image.MipCount;
+				upload.Compression = image.Format;
+				upload.Data = std::move(image.Data);
+				upload.Pixels = upload.Data.data();
+			}
+		}
+		else if (cached || upload.Specification.PrebuiltMips)
+		{
+			ImageData image;
+			bool loaded = cached ? ReadImageCache(path, image) : LoadMipChain(path, path + ".tex", upload.Specification.Mips, image);
+			if (loaded)
+			{
+				upload.Width = image.Width;
+				upload.Height = image.Height;
+				upload.Channels = image.Channels;
+				upload.MipCount = image.MipCount;
+				upload.Data = std::move(image.Pixels);
+				upload.Pixels = upload.Data.data();
+			}
+		}
+		else
+		{
+			if (upload.Specification.HDR)
+				upload.Pixels = stbi_loadf(path.c_str(), &upload.Width, &upload.Height, &upload.Channels, 0);
+			else
+				upload.Pixels = stbi_load(path.c_str(), &upload.Width, &upload.Height, &upload.Channels, 0);
+		}
+	}
+
+	void TextureStreamer::FreePixels(Upload& upload)
+	{
+		// Mapped pixels belong to the asset pack, image caches and compressed textures are read
+		// into Data, everything else is owned by stb_image
+		if (upload.Mapped)
+			upload.Mapped = false;
+		else if (upload.Data.empty())
+			stbi_image_free(upload.Pixels);
+		else
+			upload.Data = std::vector<uint8_t>();
+		upload.Pixels = nullptr;
+	}
+
+	GLuint TextureStreamer::GetPlaceholder(uint32_t color)
+	{
+		auto it = m_Placeholders.find(color);
+		if (it != m_Placeholders.end())
+			return it->second;
+
+		GLuint placeholder;
+		glCreateTextures(GL_TEXTURE_2D, 1, &placeholder);
+		glTextureStorage2D(placeholder, 1, GL_RGBA8, 1, 1);
+		glTextureSubImage2D(placeholder, 0, 0, 0, 1, 1, GL_RGBA, GL_UNSIGNED_BYTE, &color);
+
+		m_Placeholders[color] = placeholder;
+		return placeholder;
+	}
+
+	void TextureStreamer::CreateStaging(size_t size)
+	{
+		GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+		glCreateBuffers(1, &m_StagingBuffer);
+		glNamedBufferStorage(m_StagingBuffer, size, nullptr, flags);
+		m_StagingMemory = (uint8_t*)glMapNamedBufferRange(m_StagingBuffer, 0, size, flags);
+		m_StagingSize = size;
+		m_StagingHead = 0;
+	}
+
+	void TextureStreamer::DestroyStaging()
+	{
+		glUnmapNamedBuffer(m_StagingBuffer);
+		glDeleteBuffers(1, &m_StagingBuffer);
+		m_StagingBuffer = 0;
+		m_StagingMemory = nullptr;
+	}
+
+	void TextureStreamer::RetireStaging()
+	{
+		while (!m_StagingRanges.empty())
+		{
+			GLenum status = glClientWaitSync(m_StagingRanges.front().Fence, 0, 0);
+			if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED)
+				break;
+
+			glDeleteSync(m_StagingRanges.front().Fence);
+			m_StagingRanges.pop_front();
+		}
+	}
+
+	bool TextureStreamer::AllocateStaging(size_t size, size_t& offset)
+	{
+		RetireStaging();
+
+		size = (size + STAGING_ALIGNMENT - 1) & ~(STAGING_ALIGNMENT - 1);
+		if (size > m_StagingSize)
+		{
+			// A single row does not fit the ring, grow it once every copy in flight has retired
+			if (!m_StagingRanges.empty())
+				return false;
+
+			LOG_WARN("Growing texture staging buffer from {0} to {1} bytes", m_StagingSize, size);
+			DestroyStaging();
+			CreateStaging(size);
+		}
+
+		if (m_StagingRanges.empty())
+		{
+			offset = 0;
+		}
+		else
+		{
+			// Ring buffer: the oldest range still in flight is the tail
+			size_t tail = m_StagingRanges.front().Start;
+			if (m_StagingHead >= tail)
+			{
+				if (m_StagingHead + size <= m_StagingSize)
+					offset = m_StagingHead;
+				else if (size < tail)
+					offset = 0;
+				else
+					return false;
+			}
+			else
+			{
+				if (m_StagingHead + size < tail)
+					offset = m_StagingHead;
+				else
+					return false;
+			}
+		}
+
+		m_StagingHead = offset + size;
+		return true;
+	}
+
+	bool TextureStreamer::BeginUpload(Upload& upload)
+	{
+		StreamedTexture& texture = *upload.Texture;
+		if (!upload.Pixels)
+		{
+			LOG_ERROR("Texture failed to load at path: {0}", texture.m_Path);
+			texture.m_Failed = true;
+			m_PendingCount--;
+			return false;
+		}
+
+		GLenum internalFormat, dataFormat;
+		GetTextureFormats(upload.Channels, upload.Specification.HDR, upload.Specification.SRGB, internalFormat, dataFormat);
+
+		uint32_t mipCount = upload.Specification.HDR ? 1 : CalculateMipCount(upload.Width, upload.Height);
+		if (upload.MipCount > 1 || upload.Compression != BlockFormat::None)
+			mipCount = upload.MipCount;
+		if (upload.Compression != BlockFormat::None)
+			internalFormat = GetBlockInternalFormat(upload.Compression, upload.Specification.SRGB);
+
+		glCreateTextures(GL_TEXTURE_2D, 1, &texture.m_RendererID);
+		glTextureStorage2D(texture.m_RendererID, mipCount, internalFormat, upload.Width, upload.Height);
+
+		glTextureParameteri(texture.m_RendererID, GL_TEXTURE_WRAP_S, GL_REPEAT);
+		glTextureParameteri(texture.m_RendererID, GL_TEXTURE_WRAP_T, GL_REPEAT);
+		glTextureParameteri(texture.m_RendererID, GL_TEXTURE_MIN_FILTER, mipCount > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+		glTextureParameteri(texture.m_RendererID, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+		texture.m_Width = upload.Width;
+		texture.m_Height = upload.Height;
+		return true;
+	}
+
+	bool TextureStreamer::UploadRows(Upload& upload)
+	{
+		GLenum internalFormat, dataFormat;
+		GetTextureFormats(upload.Channels, upload.Specification.HDR, upload.Specification.SRGB, internalFormat, dataFormat);
+
+		uint32_t width = std::max((uint32_t)upload.Width >> upload.Level, 1u);
+		uint32_t height = std::max((uint32_t)upload.Height >> upload.Level, 1u);
+
+		// Compressed levels are copied in rows of 4x4 blocks
+		bool compressed = upload.Compression != BlockFormat::None;
+		uint32_t rowCount = compressed ? (height + 3) / 4 : height;
+		size_t rowSize;
+		if (compressed)
+			rowSize = ((width + 3) / 4) * GetBlockSize(upload.Compression);
+		else
+			rowSize = width * upload.Channels * (upload.Specification.HDR ? sizeof(float) : sizeof(uint8_t));
+
+		// Keep chunks well below the ring size so several can be in flight at once
+		size_t chunkSize = std::min(MAX_CHUNK_SIZE, m_StagingSize / 4);
+		uint32_t rows = (uint32_t)std::max(chunkSize / rowSize, (size_t)1);
+		rows = std::min(rows, rowCount - upload.RowsUploaded);
+
+		size_t offset;
+		if (!AllocateStaging(rows * rowSize, offset))
+			return false;
+
+		const uint8_t* source = (const uint8_t*)upload.Pixels + upload.LevelOffset + upload.RowsUploaded * rowSize;
+		memcpy(m_StagingMemory + offset, source, rows * rowSize);
+
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, m_StagingBuffer);
+		if (compressed)
+		{
+			uint32_t y = upload.RowsUploaded * 4;
+			glCompressedTextureSubImage2D(upload.Texture->m_RendererID, upload.Level, 0, y, width, std::min(rows * 4, height - y),
+				GetBlockInternalFormat(upload.Compression, upload.Specification.SRGB), (GLsizei)(rows * rowSize), (const void*)offset);
+		}
+		else
+		{
+			glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+			glTextureSubImage2D(upload.Texture->m_RendererID, upload.Level, 0, upload.RowsUploaded, width, rows,
+				dataFormat, upload.Specification.HDR ? GL_FLOAT : GL_UNSIGNED_BYTE, (const void*)offset);
+			glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+		}
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+		m_StagingRanges.push_back({ glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0), offset });
+
+		upload.RowsUploaded += rows;
+		m_UploadedBytes += rows * rowSize;
+
+		if (upload.RowsUploaded == rowCount)
+		{
+			upload.Level++;
+			upload.LevelOffset += rowCount * rowSize;
+			upload.RowsUploaded = 0;
+		}
+		return true;
+	}
+
+	void TextureStreamer::FinishUpload(Upload& upload)
+	{
+		StreamedTexture& texture = *upload.Texture;
+		if (!upload.Specification.HDR && upload.MipCount == 1 && upload.Compression == BlockFormat::None)
+			glGenerateTextureMipmap(texture.m_RendererID);
+
+		FreePixels(upload);
+
+		texture.m_Resident = true;
+		m_PendingCount--;
+	}
+
+	void TextureStreamer::Update(float budgetMilliseconds)
+	{
+		using Clock = std::chrono::high_resolution_clock;
+		auto start = Clock::now();
+
+		m_UploadedBytes = 0;
+
+		{
+			std::lock_guard<std::mutex> lock(m_DecodedMutex);
+			while (!m_Decoded.empty())
+			{
+				m_Uploads.push_back(std::move(m_Decoded.front()));
+				m_Decoded.pop_front();
+			}
+		}
+
+		while (!m_Uploads.empty())
+		{
+			std::chrono::duration<float, std::milli> elapsed = Clock::now() - start;
+			if (elapsed.count() >= budgetMilliseconds)
+				break;
+
+			Upload& upload = m_Uploads.front();
+			if (!upload.Texture->m_RendererID && !BeginUpload(upload))
+			{
+				m_Uploads.pop_front();
+				continue;
+			}
+
+			// Staging ring is full of in-flight copies, try again next frame
+			if (!UploadRows(upload))
+				break;
+
+			if (upload.Level == upload.MipCount)
+			{
+				FinishUpload(upload);
+				m_Uploads.pop_front();
+			}
+		}
+	}
+
+}
@@ -0,0 +1,142 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include <glad/glad.h>
+
+#include "BlockCompression.h"
+#include "ChannelPacker.h"
+#include "MipChainBuilder.h"
+
+namespace GLCore::Utils {
+
+	struct TextureSpecification
+	{
+		bool HDR = false;
+		bool SRGB = false;
+
+		// Shown until the texture is resident, RGBA8 packed as 0xAABBGGRR
+		uint32_t Placeholder = 0xFF808080;
+
+		// Use a CPU-filtered mip chain cached next to the source (<path>.tex) instead of glGenerateMipmap
+		bool PrebuiltMips = false;
+		MipChainSettings Mips;
+
+		// Block compress on first load and cache the result next to the source (<path>.dds)
+		BlockFormat Compression = BlockFormat::None;
+
+		// Pack these sources into the path (an image cache) on the worker before loading it, see ChannelPacker.h
+		std::vector<ChannelSource> PackedChannels;
+	};
+
+	class StreamedTexture
+	{
+	public:
+		~StreamedTexture();
+
+		GLuint GetRendererID() const { return m_Resident ? m_RendererID : m_Placeholder; }
+		bool IsResident() const { return m_Resident; }
+		bool IsFailed() const { return m_Failed; }
+
+		const std::string& GetPath() const { return m_Path; }
+		uint32_t GetWidth() const { return m_Width; }
+		uint32_t GetHeight() const { return m_Height; }
+	private:
+		friend class TextureStreamer;
+
+		std::string m_Path;
+		GLuint m_RendererID = 0;
+		GLuint m_Placeholder = 0;
+		uint32_t m_Width = 0, m_Height = 0;
+		bool m_Resident = false;
+		bool m_Failed = false;
+	};
+
+	// Decodes textures on a pool of worker threads and uploads them on the GL thread
+	// through a persistently mapped pixel buffer ring, a few rows at a time, within a
+	// per-frame time budget. Update() must be called once per frame on the GL thread.
+	// Paths ending in .tex are read as image caches (see ImageCache.h) without decoding.
+	// A mounted AssetPack is searched before the file system.
+	class TextureStreamer
+	{
+	public:
+		TextureStreamer(uint32_t workerCount = 0, size_t stagingSize = 32 * 1024 * 1024);
+		~TextureStreamer();
+
+		std::shared_ptr<StreamedTexture> Load(const std::string& path, const TextureSpecification& specification = TextureSpecification());
+
+		void Update(float budgetMilliseconds);
+
+		uint32_t GetPendingCount() const { return m_PendingCount; }
+		size_t GetUploadedBytes() const { return m_UploadedBytes; }
+	private:
+		struct Upload
+		{
+			std::shared_ptr<StreamedTexture> Texture;
+			TextureSpecification Specification;
+			void* Pixels = nullptr;
+			std::vector<uint8_t> Data;
+			bool Mapped = false;
+			int Width = 0, Height = 0, Channels = 0;
+			uint32_t MipCount = 1;
+			BlockFormat Compression = BlockFormat::None;
+			uint32_t Level = 0;
+			uint32_t RowsUploaded = 0;
+			size_t LevelOffset = 0;
+		};
+
+		struct StagingRange
+		{
+			GLsync Fence;
+			size_t Start;
+		};
+
+		void WorkerThread();
+		static bool LoadFromPack(Upload& upload);
+		static void LoadFromDisk(Upload& upload);
+		static void FreePixels(Upload& upload);
+
+		GLuint GetPlaceholder(uint32_t color);
+		void CreateStaging(size_t size);
+		void DestroyStaging();
+		bool AllocateStaging(size_t size, size_t& offset);
+		void RetireStaging();
+
+		bool BeginUpload(Upload& upload);
+		bool UploadRows(Upload& upload);
+		void FinishUpload(Upload& upload);
+	private:
+		std::vector<std::thread> m_Workers;
+		std::atomic<bool> m_Running = true;
+		uint32_t m_FilterThreadCount = 1;
+
+		std::mutex m_RequestMutex;
+		std::condition_variable m_RequestCondition;
+		std::deque<Upload> m_Requests;
+
+		std::mutex m_DecodedMutex;
+		std::deque<Upload> m_Decoded;
+
+		// Owned by the GL thread
+		std::deque<Upload> m_Uploads;
+		std::unordered_map<uint32_t, GLuint> m_Placeholders;
+
+		GLuint m_StagingBuffer = 0;
+		uint8_t* m_StagingMemory = nullptr;
+		size_t m_StagingSize;
+		size_t m_StagingHead = 0;
+		std::deque<StagingRange> m_StagingRanges;
+
+		std::atomic<uint32_t> m_PendingCount = 0;
+		size_t m_UploadedBytes = 0;
+	};
+
+}
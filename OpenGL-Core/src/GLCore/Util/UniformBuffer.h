@@ -0,0 +1,118 @@
+#pragma once
+
+#include <cstddef>
+#include <cstring>
+#include <type_traits>
+#include <vector>
+
+#include <glad/glad.h>
+
+#include "Shader.h"
+
+// Checks a member of a C++ mirror of a std140/std430 block against the offset the GLSL
+// layout rules give it in the shader
+#define GLCORE_BLOCK_OFFSET(type, member, offset) \
+	static_assert(offsetof(type, member) == (offset), #type "::" #member " does not match its offset in the block")
+
+namespace GLCore::Utils {
+
+	// Warns when the block the shader declares is not the size of its C++ mirror
+	template<typename T>
+	bool ValidateUniformBlock(const Shader& shader, const char* blockName)
+	{
+		GLint size = shader.GetUniformBlockSize(blockName);
+		if (size >= 0 && size != (GLint)sizeof(T))
+		{
+			LOG_WARN("Uniform block '{0}' is {1} bytes in the shader but {2} bytes in C++", blockName, size, sizeof(T));
+			return false;
+		}
+		return true;
+	}
+
+	// GPU copy of one std140 uniform block mirrored by T
+	template<typename T>
+	class UniformBuffer
+	{
+		static_assert(std::is_trivially_copyable_v<T>, "Block structs are uploaded as raw bytes");
+		static_assert(sizeof(T) % 16 == 0, "Block structs must be padded to a multiple of 16 bytes");
+	public:
+		UniformBuffer()
+		{
+			glCreateBuffers(1, &m_RendererID);
+			glNamedBufferStorage(m_RendererID, sizeof(T), nullptr, GL_DYNAMIC_STORAGE_BIT);
+		}
+
+		~UniformBuffer()
+		{
+			glDeleteBuffers(1, &m_RendererID);
+		}
+
+		UniformBuffer(const UniformBuffer&) = delete;
+		UniformBuffer& operator=(const UniformBuffer&) = delete;
+
+		void Upload(const T& data) { glNamedBufferSubData(m_RendererID, 0, sizeof(T), &data); }
+		void Bind(uint32_t binding) const { glBindBufferBase(GL_UNIFORM_BUFFER, binding, m_RendererID); }
+
+		uint32_t GetRendererID() const { return m_RendererID; }
+	private:
+		uint32_t m_RendererID;
+	};
+
+	// One block per element, each at an offset aligned for glBindBufferRange so a draw selects
+	// its element with a single bind instead of a set of uniform calls
+	template<typename T>
+	class UniformBufferArray
+	{
+		static_assert(std::is_trivially_copyable_v<T>, "Block structs are uploaded as raw bytes");
+		static_assert(sizeof(T) % 16 == 0, "Block structs must be padded to a multiple of 16 bytes");
+	public:
+		UniformBufferArray()
+		{
+			GLint alignment = 256;
+			glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+			m_Stride = (uint32_t)((sizeof(T) + alignment - 1) / alignment * alignment);
+			glCreateBuffers(1, &m_RendererID);
+		}
+
+		~UniformBufferArray()
+		{
+			glDeleteBuffers(1, &m_RendererID);
+		}
+
+		UniformBufferArray(const UniformBufferArray&) = delete;
+		UniformBufferArray& operator=(const UniformBufferArray&) = delete;
+
+		void Upload(const T* elements, uint32_t count)
+		{
+			std::vector<uint8_t> staging((size_t)count * m_Stride);
+			for (uint32_t i = 0; i < count; i++)
+				memcpy(staging.data() + (size_t)i * m_Stride, &elements[i], sizeof(T));
+
+			if (count > m_Capacity)
+			{
+				glNamedBufferData(m_RendererID, staging.size(), staging.data(), GL_STATIC_DRAW);
+				m_Capacity = count;
+			}
+			else if (count > 0)
+			{
+				glNamedBufferSubData(m_RendererID, 0, staging.size(), staging.data());
+			}
+			m_Count = count;
+		}
+
+		void Bind(uint32_t binding, uint32_t index) const
+		{
+			glBindBufferRange(GL_UNIFORM_BUFFER, binding, m_RendererID, (GLintptr)index * m_Stride, sizeof(T));
+		}
+
+		uint32_t GetRendererID() const { return m_RendererID; }
+		uint32_t GetCount() const { return m_Count; }
+		uint32_t GetStride() const { return m_Stride; }
+	private:
+		uint32_t m_RendererID;
+		uint32_t m_Stride;
+		uint32_t m_Count = 0;
+		uint32_t m_Capacity = 0;
+	};
+
+}
@@ -0,0 +1,175 @@
+#pragma once
+
+#include <cstring>
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/packing.hpp>
+#include <glm/gtc/type_precision.hpp>
+
+namespace GLCore::Utils {
+
+	// Vertex attribute encodings. Each one names the value it is built from (Input), what is
+	// stored per vertex (Storage) and how the vertex array reads it back (Components, Type, Normalized).
+
+	struct Float2
+	{
+		using Input = glm::vec2;
+		using Storage = glm::vec2;
+		static constexpr GLint Components = 2;
+		static constexpr GLenum Type = GL_FLOAT;
+		static constexpr GLboolean Normalized = GL_FALSE;
+
+		static Storage Encode(const Input& value) { return value; }
+	};
+
+	struct Float3
+	{
+		using Input = glm::vec3;
+		using Storage = glm::vec3;
+		static constexpr GLint Components = 3;
+		static constexpr GLenum Type = GL_FLOAT;
+		static constexpr GLboolean Normalized = GL_FALSE;
+
+		static Storage Encode(const Input& value) { return value; }
+	};
+
+	// Position as half floats, w = 1 so the shader can read a vec4 directly
+	struct HalfPosition
+	{
+		using Input = glm::vec3;
+		using Storage = glm::u16vec4;
+		static constexpr GLint Components = 4;
+		static constexpr GLenum Type = GL_HALF_FLOAT;
+		static constexpr GLboolean Normalized = GL_FALSE;
+
+		static Storage Encode(const Input& value)
+		{
+			return Storage(glm::packHalf1x16(value.x), glm::packHalf1x16(value.y), glm::packHalf1x16(value.z), glm::packHalf1x16(1.0f));
+		}
+	};
+
+	// Position in [-1, 1] as snorm16, w = 1. Larger meshes are scaled into the unit cube
+	// and the scale is folded back into the model matrix.
+	struct SNorm16Position
+	{
+		using Input = glm::vec3;
+		using Storage = glm::i16vec4;
+		static constexpr GLint Components = 4;
+		static constexpr GLenum Type = GL_SHORT;
+		static constexpr GLboolean Normalized = GL_TRUE;
+
+		static Storage Encode(const Input& value)
+		{
+			glm::vec3 snorm = glm::round(glm::clamp(value, -1.0f, 1.0f) * 32767.0f);
+			return Storage(snorm.x, snorm.y, snorm.z, 32767);
+		}
+	};
+
+	struct TangentFrame
+	{
+		glm::vec3 Normal;
+		glm::vec3 Tangent;
+		float Sign;          // bitangent = Sign * cross(Normal, Tangent)
+	};
+
+	// Unit vector to [-1, 1]^2, the lower hemisphere folded over the diagonals
+	inline glm::vec2 OctahedralEncode(glm::vec3 n)
+	{
+		n /= glm::abs(n.x) + glm::abs(n.y) + glm::abs(n.z);
+		glm::vec2 e(n.x, n.y);
+		if (n.z < 0.0f)
+		{
+			glm::vec2 sign(e.x >= 0.0f ? 1.0f : -1.0f, e.y >= 0.0f ? 1.0f : -1.0f);
+			e = (1.0f - glm::abs(glm::vec2(e.y, e.x))) * sign;
+		}
+		return e;
+	}
+
+	// Normal (xy) and tangent (zw), both octahedral encoded as snorm8, in 32 bits. The bitangent sign
+	// is folded into w: its magnitude holds the tangent's second component remapped to [1, 127], its
+	// sign the handedness. Decode with sign(w) and (|w| * 127 - 1) / 63 - 1.
+	struct OctahedralTangentFrame
+	{
+		using Input = TangentFrame;
+		using Storage = glm::i8vec4;
+		static constexpr GLint Components = 4;
+		static constexpr GLenum Type = GL_BYTE;
+		static constexpr GLboolean Normalized = GL_TRUE;
+
+		static Storage Encode(const Input& value)
+		{
+			glm::vec2 normal = OctahedralEncode(glm::normalize(value.Normal));
+			glm::vec2 tangent = glm::clamp(OctahedralEncode(glm::normalize(value.Tangent)), -1.0f, 1.0f);
+			glm::vec3 snorm = glm::round(glm::vec3(glm::clamp(normal, -1.0f, 1.0f), tangent.x) * 127.0f);
+			float handed = glm::round((tangent.y * 0.5f + 0.5f) * 126.0f) + 1.0f;
+			return Storage(snorm.x, snorm.y, snorm.z, value.Sign < 0.0f ? -handed : handed);
+		}
+	};
+
+	// Texture coordinates in [0, 1] as unorm16, tiling is applied in the shader
+	struct UNorm16TexCoord
+	{
+		using Input = glm::vec2;
+		using Storage = glm::u16vec2;
+		static constexpr GLint Components = 2;
+		static constexpr GLenum Type = GL_UNSIGNED_SHORT;
+		static constexpr GLboolean Normalized = GL_TRUE;
+
+		static Storage Encode(const Input& value)
+		{
+			glm::vec2 unorm = glm::round(glm::clamp(value, 0.0f, 1.0f) * 65535.0f);
+			return Storage(unorm.x, unorm.y);
+		}
+	};
+
+	// Interleaved vertex format built from a list of attribute encodings, attribute i is bound
+	// to location i. Vertices are encoded straight into a preallocated buffer:
+	//
+	//   using Layout = VertexLayout<SNorm16Position, OctahedralTangentFrame, UNorm16TexCoord>;
+	//   std::vector<uint8_t> vertices(count * Layout::Stride);
+	//   Layout::Write(&vertices[i * Layout::Stride], position, { normal, tangent, 1.0f }, uv);
+	//   Layout::Apply(vertexArray, vertexBuffer);
+	template<typename... Attributes>
+	class VertexLayout
+	{
+	public:
+		static constexpr uint32_t Stride = (sizeof(typename Attributes::Storage) + ...);
+		static constexpr uint32_t AttributeCount = sizeof...(Attributes);
+
+		static void Write(uint8_t* destination, const typename Attributes::Input&... values)
+		{
+			uint32_t offset = 0;
+			(WriteAttribute<Attributes>(destination, offset, values), ...);
+		}
+
+		// Describes the layout to a vertex array and attaches buffer at the given binding index
+		static void Apply(GLuint vertexArray, GLuint buffer, GLuint binding = 0, GLintptr bufferOffset = 0)
+		{
+			glVertexArrayVertexBuffer(vertexArray, binding, buffer, bufferOffset, Stride);
+
+			GLuint location = 0;
+			GLuint offset = 0;
+			(ApplyAttribute<Attributes>(vertexArray, binding, location, offset), ...);
+		}
+	private:
+		template<typename Attribute>
+		static void WriteAttribute(uint8_t* destination, uint32_t& offset, const typename Attribute::Input& value)
+		{
+			typename Attribute::Storage storage = Attribute::Encode(value);
+			memcpy(destination + offset, &storage, sizeof(storage));
+			offset += sizeof(storage);
+		}
+
+		template<typename Attribute>
+		static void ApplyAttribute(GLuint vertexArray, GLuint binding, GLuint& location, GLuint& offset)
+		{
+			glEnableVertexArrayAttrib(vertexArray, location);
+			glVertexArrayAttribFormat(vertexArray, location, Attribute::Components, Attribute::Type, Attribute::Normalized, offset);
+			glVertexArrayAttribBinding(vertexArray, location, binding);
+			location++;
+			offset += sizeof(typename Attribute::Storage);
+		}
+	};
+
+}
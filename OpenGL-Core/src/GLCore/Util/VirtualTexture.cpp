@@ -0,0 +1,641 @@
+#include "glpch.h"
+#include "VirtualTexture.h"
+
+#include "ParallelFor.h"
+#include "TextureFormat.h"
+
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+
+#include <stb_image.h>
+
+namespace GLCore::Utils {
+
+	static const char PAGE_FILE_MAGIC[4] = { 'G', 'L', 'V', 'T' };
+	static const uint32_t PAGE_FILE_VERSION = 1;
+
+	struct PageFileHeader
+	{
+		char Magic[4];
+		uint32_t Version;
+		uint32_t Width;
+		uint32_t Height;
+		uint32_t PageSize;
+		uint32_t Border;
+		uint32_t MipCount;
+		uint32_t Tag;
+	};
+
+	// Pages are addressed as level << 48 | y << 24 | x
+	static uint64_t MakePage(uint32_t level, uint32_t x, uint32_t y)
+	{
+		return ((uint64_t)level << 48) | ((uint64_t)y << 24) | x;
+	}
+
+	static uint32_t GetPageLevel(uint64_t page) { return (uint32_t)(page >> 48); }
+	static uint32_t GetPageY(uint64_t page) { return (uint32_t)(page >> 24) & 0xFFFFFF; }
+	static uint32_t GetPageX(uint64_t page) { return (uint32_t)page & 0xFFFFFF; }
+
+	static uint32_t GetLayoutTag(const VirtualTextureSpecification& specification)
+	{
+		return ((uint32_t)specification.Repeat << 16) | ((uint32_t)specification.Mips.Filter << 8) | (uint32_t)specification.Mips.Content;
+	}
+
+	// Level L covers the texture at exactly 1 / 2^L of its size, so every page has
+	// four children and the page grid forms a quadtree even for odd sizes
+	static uint32_t GetPageCount(uint32_t size, uint32_t pageSize, uint32_t level)
+	{
+		uint64_t levelPage = (uint64_t)pageSize << level;
+		return (uint32_t)((size + levelPage - 1) / levelPage);
+	}
+
+	static uint32_t CalculateVirtualMipCount(uint32_t width, uint32_t height, uint32_t pageSize)
+	{
+		uint32_t mipCount = 1;
+		while (((uint64_t)pageSize << (mipCount - 1)) < std::max(width, height))
+			mipCount++;
+		return mipCount;
+	}
+
+	static uint32_t NextPowerOfTwo(uint32_t value)
+	{
+		uint32_t result = 1;
+		while (result < value)
+			result <<= 1;
+		return result;
+	}
+
+	static inline uint32_t Address(int index, uint32_t size, bool repeat)
+	{
+		int n = (int)size;
+		return repeat ? (uint32_t)(((index % n) + n) % n) : (uint32_t)std::clamp(index, 0, n - 1);
+	}
+
+	// Bilinear fetch from an RGBA8 level, only blends when the level is not exactly 1 / 2^L of level 0
+	static void SampleLevel(const uint8_t* pixels, uint32_t width, uint32_t height, float x, float y, bool repeat, uint8_t* result)
+	{
+		float fx = std::floor(x), fy = std::floor(y);
+		float tx = x - fx, ty = y - fy;
+		uint32_t x0 = Address((int)fx, width, repeat), x1 = Address((int)fx + 1, width, repeat);
+		uint32_t y0 = Address((int)fy, height, repeat), y1 = Address((int)fy + 1, height, repeat);
+
+		const uint8_t* t00 = &pixels[((size_t)y0 * width + x0) * 4];
+		const uint8_t* t10 = &pixels[((size_t)y0 * width + x1) * 4];
+		const uint8_t* t01 = &pixels[((size_t)y1 * width + x0) * 4];
+		const uint8_t* t11 = &pixels[((size_t)y1 * width + x1) * 4];
+		for (uint32_t c = 0; c < 4; c++)
+		{
+			float top = t00[c] + (t10[c] - t00[c]) * tx;
+			float bottom = t01[c] + (t11[c] - t01[c]) * tx;
+			result[c] = (uint8_t)(top + (bottom - top) * ty + 0.5f);
+		}
+	}
+
+	static bool IsPageFileValid(const std::string& sourcePath, const std::string& pageFilePath, const VirtualTextureSpecification& specification)
+	{
+		std::error_code error;
+		auto pageFileTime = std::filesystem::last_write_time(pageFilePath, error);
+		if (error)
+			return false;
+
+		auto sourceTime = std::filesystem::last_write_time(sourcePath, error);
+		if (error || sourceTime > pageFileTime)
+			return false;
+
+		std::ifstream in(pageFilePath, std::ios::in | std::ios::binary);
+		PageFileHeader header;
+		if (!in.read((char*)&header, sizeof(header)))
+			return false;
+
+		return memcmp(header.Magic, PAGE_FILE_MAGIC, sizeof(PAGE_FILE_MAGIC)) == 0 && header.Version == PAGE_FILE_VERSION
+			&& header.PageSize == specification.PageSize && header.Border == specification.Border && header.Tag == GetLayoutTag(specification);
+	}
+
+	bool BuildPageFile(const std::string& sourcePath, const std::string& pageFilePath, const VirtualTextureSpecification& specification)
+	{
+		auto startTime = std::chrono::high_resolution_clock::now();
+
+		int width, height, channels;
+		uint8_t* pixels = stbi_load(sourcePath.c_str(), &width, &height, &channels, 4);
+		if (!pixels)
+			return false;
+
+		ImageData image;
+		image.Width = width;
+		image.Height = height;
+		image.Channels = 4;
+		image.Pixels.assign(pixels, pixels + (size_t)width * height * 4);
+		stbi_image_free(pixels);
+
+		BuildMipChain(image, specification.Mips);
+
+		std::ofstream out(pageFilePath, std::ios::out | std::ios::binary);
+		if (!out)
+		{
+			LOG_ERROR("Could not open file '{0}'", pageFilePath);
+			return false;
+		}
+
+		uint32_t pageSize = specification.PageSize, border = specification.Border;
+		uint32_t paddedSize = pageSize + 2 * border;
+		size_t pageBytes = (size_t)paddedSize * paddedSize * 4;
+
+		PageFileHeader header;
+		memcpy(header.Magic, PAGE_FILE_MAGIC, sizeof(PAGE_FILE_MAGIC));
+		header.Version = PAGE_FILE_VERSION;
+		header.Width = width;
+		header.Height = height;
+		header.PageSize = pageSize;
+		header.Border = border;
+		header.MipCount = CalculateVirtualMipCount(width, height, pageSize);
+		header.Tag = GetLayoutTag(specification);
+		out.write((const char*)&header, sizeof(header));
+
+		uint32_t threadCount = GetWorkerThreadCount(specification.Mips.ThreadCount);
+		size_t pageCount = 0;
+		std::vector<uint8_t> pages;
+		for (uint32_t level = 0; level < header.MipCount; level++)
+		{
+			uint32_t pagesX = GetPageCount(width, pageSize, level), pagesY = GetPageCount(height, pageSize, level);
+			pages.resize(pagesX * pagesY * pageBytes);
+
+			const uint8_t* source = &image.Pixels[GetMipOffset(image, level)];
+			uint32_t sourceWidth = GetMipWidth(image, level), sourceHeight = GetMipHeight(image, level);
+			float scaleX = (float)sourceWidth * (1u << level) / width;
+			float scaleY = (float)sourceHeight * (1u << level) / height;
+
+			ParallelFor(pagesY, threadCount, [&](uint32_t begin, uint32_t end)
+			{
+				for (uint32_t pageY = begin; pageY < end; pageY++)
+				{
+					for (uint32_t pageX = 0; pageX < pagesX; pageX++)
+					{
+						uint8_t* destination = &pages[((size_t)pageY * pagesX + pageX) * pageBytes];
+						for (uint32_t j = 0; j < paddedSize; j++)
+						{
+							float y = ((float)pageY * pageSize + j - border + 0.5f) * scaleY - 0.5f;
+							for (uint32_t i = 0; i < paddedSize; i++)
+							{
+								float x = ((float)pageX * pageSize + i - border + 0.5f) * scaleX - 0.5f;
+								SampleLevel(source, sourceWidth, sourceHeight, x, y, specification.Repeat, &destination[((size_t)j * paddedSize + i) * 4]);
+							}
+						}
+					}
+				}
+			});
+
+			out.write((const char*)pages.data(), pages.size());
+			pageCount += (size_t)pagesX * pagesY;
+		}
+
+		if (!out)
+		{
+			LOG_ERROR("Could not write page file '{0}'", pageFilePath);
+			return false;
+		}
+
+		float elapsed = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - startTime).count();
+		LOG_INFO("Built page file '{0}' ({1} pages, {2} levels) in {3} ms", pageFilePath, pageCount, header.MipCount, elapsed);
+		return true;
+	}
+
+	VirtualTexture::VirtualTexture(const std::string& path, const VirtualTextureSpecification& specification)
+		: m_Specification(specification), m_Path(path), m_PageFilePath(path + ".vt")
+	{
+		GLCORE_ASSERT(specification.CachePages > 0 && specification.CachePages <= 256, "Cache slots are stored as 8-bit page table coordinates");
+
+		m_Pages = AssetPack::FindMounted(m_PageFilePath);
+		if (m_Pages || IsPageFileValid(path, m_PageFilePath, specification))
+		{
+			Initialize();
+			return;
+		}
+
+		// Decoding the source and filtering its mip chain would stall the GL thread, Update() picks the result up
+		m_Build = std::async(std::launch::async, [path, pageFilePath = m_PageFilePath, specification]()
+		{
+			return BuildPageFile(path, pageFilePath, specification);
+		});
+	}
+
+	void VirtualTexture::Initialize()
+	{
+		const VirtualTextureSpecification& specification = m_Specification;
+		const std::string& pageFilePath = m_PageFilePath;
+		if (!m_Pages)
+		{
+			if (!m_PageFile.Open(pageFilePath))
+			{
+				LOG_ERROR("Could not open file '{0}'", pageFilePath);
+				return;
+			}
+			m_Pages = { m_PageFile.GetData(), m_PageFile.GetSize() };
+		}
+
+		const PageFileHeader* header = (const PageFileHeader*)m_Pages.Data;
+		if (m_Pages.Size < sizeof(PageFileHeader) || memcmp(header->Magic, PAGE_FILE_MAGIC, sizeof(PAGE_FILE_MAGIC)) != 0 || header->Version != PAGE_FILE_VERSION
+			|| header->PageSize != specification.PageSize || header->Border != specification.Border)
+		{
+			LOG_ERROR("'{0}' is not a valid page file for this texture", pageFilePath);
+			return;
+		}
+
+		m_Width = header->Width;
+		m_Height = header->Height;
+		m_MipCount = header->MipCount;
+
+		size_t pageCount = 0;
+		for (uint32_t level = 0; level < m_MipCount; level++)
+		{
+			m_LevelOffsets.push_back(pageCount);
+			pageCount += (size_t)GetPagesX(level) * GetPagesY(level);
+		}
+
+		size_t pageBytes = (size_t)GetPaddedPageSize() * GetPaddedPageSize() * 4;
+		if (m_Pages.Size < sizeof(PageFileHeader) + pageCount * pageBytes)
+		{
+			LOG_ERROR("Page file '{0}' is truncated", pageFilePath);
+			return;
+		}
+
+		uint32_t cacheSize = GetCacheSize();
+		glCreateTextures(GL_TEXTURE_2D, 1, &m_Cache);
+		glTextureStorage2D(m_Cache, 1, specification.SRGB ? GL_SRGB8_ALPHA8 : GL_RGBA8, cacheSize, cacheSize);
+		glTextureParameteri(m_Cache, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTextureParameteri(m_Cache, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+		glTextureParameteri(m_Cache, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+		glTextureParameteri(m_Cache, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+		// Power of two so each GL level is at least as large as the page grid of its level
+		glCreateTextures(GL_TEXTURE_2D, 1, &m_PageTable);
+		glTextureStorage2D(m_PageTable, m_MipCount, GL_RGBA8, NextPowerOfTwo(GetPagesX(0)), NextPowerOfTwo(GetPagesY(0)));
+		glTextureParameteri(m_PageTable, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+		glTextureParameteri(m_PageTable, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+		m_PageTableLevels.resize(m_MipCount);
+		for (uint32_t level = 0; level < m_MipCount; level++)
+			m_PageTableLevels[level].resize((size_t)GetPagesX(level) * GetPagesY(level));
+
+		m_Slots.resize(specification.CachePages * specification.CachePages);
+
+		// The coarsest page is the fallback for everything else
+		LoadedPage root;
+		root.Page = MakePage(m_MipCount - 1, 0, 0);
+		const uint8_t* rootData = GetPageData(root.Page);
+		root.Texels.assign(rootData, rootData + pageBytes);
+		UploadPage(root);
+		m_Slots[m_Resident[root.Page]].Locked = true;
+		UpdatePageTable();
+
+		for (Readback& readback : m_Readbacks)
+			glCreateBuffers(1, &readback.Buffer);
+
+		for (uint32_t i = 0; i < specification.WorkerCount; i++)
+			m_Workers.emplace_back(&VirtualTexture::WorkerThread, this);
+	}
+
+	VirtualTexture::~VirtualTexture()
+	{
+		if (m_Build.valid())
+			m_Build.wait();
+
+		{
+			std::lock_guard<std::mutex> lock(m_RequestMutex);
+			m_Running = false;
+		}
+		m_RequestCondition.notify_all();
+		for (std::thread& worker : m_Workers)
+			worker.join();
+
+		for (Readback& readback : m_Readbacks)
+		{
+			if (readback.Fence)
+				glDeleteSync(readback.Fence);
+			glDeleteBuffers(1, &readback.Buffer);
+		}
+
+		glDeleteFramebuffers(1, &m_FeedbackFBO);
+		glDeleteTextures(1, &m_FeedbackTexture);
+		glDeleteRenderbuffers(1, &m_FeedbackDepth);
+
+		glDeleteTextures(1, &m_PageTable);
+		glDeleteTextures(1, &m_Cache);
+	}
+
+	uint32_t VirtualTexture::GetPagesX(uint32_t level) const
+	{
+		return GetPageCount(m_Width, m_Specification.PageSize, level);
+	}
+
+	uint32_t VirtualTexture::GetPagesY(uint32_t level) const
+	{
+		return GetPageCount(m_Height, m_Specification.PageSize, level);
+	}
+
+	size_t VirtualTexture::GetPageIndex(uint64_t page) const
+	{
+		uint32_t level = GetPageLevel(page);
+		return m_LevelOffsets[level] + (size_t)GetPageY(page) * GetPagesX(level) + GetPageX(page);
+	}
+
+	const uint8_t* VirtualTexture::GetPageData(uint64_t page) const
+	{
+		size_t pageBytes = (size_t)GetPaddedPageSize() * GetPaddedPageSize() * 4;
+		return m_Pages.Data + sizeof(PageFileHeader) + GetPageIndex(page) * pageBytes;
+	}
+
+	float VirtualTexture::GetFeedbackBias() const
+	{
+		return -std::log2((float)m_Specification.FeedbackScale);
+	}
+
+	uint64_t VirtualTexture::GetCacheMemory() const
+	{
+		uint64_t pageTable = CalculateTextureSize(GL_RGBA8, NextPowerOfTwo(GetPagesX(0)), NextPowerOfTwo(GetPagesY(0)), m_MipCount);
+		return CalculateTextureSize(GL_RGBA8, GetCacheSize(), GetCacheSize(), 1) + pageTable;
+	}
+
+	uint64_t VirtualTexture::GetFullMemory() const
+	{
+		return CalculateTextureSize(GL_RGBA8, m_Width, m_Height, CalculateMipCount(m_Width, m_Height));
+	}
+
+	void VirtualTexture::WorkerThread()
+	{
+		size_t pageBytes = (size_t)GetPaddedPageSize() * GetPaddedPageSize() * 4;
+		while (true)
+		{
+			uint64_t page;
+			{
+				std::unique_lock<std::mutex> lock(m_RequestMutex);
+				m_RequestCondition.wait(lock, [this]() { return !m_Running || !m_Requests.empty(); });
+				if (!m_Running)
+					return;
+
+				page = m_Requests.front();
+				m_Requests.pop_front();
+			}
+
+			// Copying out of the mapping takes the page faults here rather than on the GL thread
+			LoadedPage loaded;
+			loaded.Page = page;
+			const uint8_t* data = GetPageData(page);
+			loaded.Texels.assign(data, data + pageBytes);
+
+			std::lock_guard<std::mutex> lock(m_LoadedMutex);
+			m_Loaded.push_back(std::move(loaded));
+		}
+	}
+
+	void VirtualTexture::BeginFeedback(uint32_t viewportWidth, uint32_t viewportHeight)
+	{
+		uint32_t width = std::max(viewportWidth / m_Specification.FeedbackScale, 1u);
+		uint32_t height = std::max(viewportHeight / m_Specification.FeedbackScale, 1u);
+		if (width != m_FeedbackWidth || height != m_FeedbackHeight)
+		{
+			glDeleteFramebuffers(1, &m_FeedbackFBO);
+			glDeleteTextures(1, &m_FeedbackTexture);
+			glDeleteRenderbuffers(1, &m_FeedbackDepth);
+
+			// Texels hold page x, page y, level and a coverage flag
+			glCreateTextures(GL_TEXTURE_2D, 1, &m_FeedbackTexture);
+			glTextureStorage2D(m_FeedbackTexture, 1, GL_RGBA16UI, width, height);
+			glCreateRenderbuffers(1, &m_FeedbackDepth);
+			glNamedRenderbufferStorage(m_FeedbackDepth, GL_DEPTH_COMPONENT24, width, height);
+
+			glCreateFramebuffers(1, &m_FeedbackFBO);
+			glNamedFramebufferTexture(m_FeedbackFBO, GL_COLOR_ATTACHMENT0, m_FeedbackTexture, 0);
+			glNamedFramebufferRenderbuffer(m_FeedbackFBO, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, m_FeedbackDepth);
+
+			m_FeedbackWidth = width;
+			m_FeedbackHeight = height;
+		}
+
+		glGetIntegerv(GL_VIEWPORT, m_PreviousViewport);
+		glBindFramebuffer(GL_FRAMEBUFFER, m_FeedbackFBO);
+		glViewport(0, 0, width, height);
+
+		GLuint clearColor[4] = { 0, 0, 0, 0 };
+		GLfloat clearDepth = 1.0f;
+		glClearNamedFramebufferuiv(m_FeedbackFBO, GL_COLOR, 0, clearColor);
+		glClearNamedFramebufferfv(m_FeedbackFBO, GL_DEPTH, 0, &clearDepth);
+	}
+
+	void VirtualTexture::EndFeedback()
+	{
+		// Read back asynchronously, Update() picks the result up once its fence has passed.
+		// When every buffer is still in flight this frame's feedback is dropped.
+		Readback& readback = m_Readbacks[m_ReadbackIndex];
+		if (!readback.Fence)
+		{
+			if (readback.Width != m_FeedbackWidth || readback.Height != m_FeedbackHeight)
+			{
+				glNamedBufferData(readback.Buffer, (size_t)m_FeedbackWidth * m_FeedbackHeight * 4 * sizeof(uint16_t), nullptr, GL_STREAM_READ);
+				readback.Width = m_FeedbackWidth;
+				readback.Height = m_FeedbackHeight;
+			}
+
+			glNamedFramebufferReadBuffer(m_FeedbackFBO, GL_COLOR_ATTACHMENT0);
+			glBindBuffer(GL_PIXEL_PACK_BUFFER, readback.Buffer);
+			glReadPixels(0, 0, m_FeedbackWidth, m_FeedbackHeight, GL_RGBA_INTEGER, GL_UNSIGNED_SHORT, nullptr);
+			glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+			readback.Fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+			m_ReadbackIndex = (m_ReadbackIndex + 1) % READBACK_COUNT;
+		}
+
+		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+		glViewport(m_PreviousViewport[0], m_PreviousViewport[1], m_PreviousViewport[2], m_PreviousViewport[3]);
+	}
+
+	void VirtualTexture::Update()
+	{
+		if (m_Build.valid() && m_Build.wait_for(std::chrono::seconds(0)) == std::future_status::ready)
+		{
+			if (m_Build.get())
+				Initialize();
+			else
+				LOG_ERROR("Virtual texture failed to load at path: {0}", m_Path);
+		}
+
+		if (!IsValid())
+			return;
+
+		m_FrameIndex++;
+
+		// Oldest readback first, it sits where the next one will be written
+		for (uint32_t i = 0; i < READBACK_COUNT; i++)
+		{
+			Readback& readback = m_Readbacks[(m_ReadbackIndex + i) % READBACK_COUNT];
+			if (!readback.Fence)
+				continue;
+
+			GLenum status = glClientWaitSync(readback.Fence, 0, 0);
+			if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED)
+				break;
+
+			glDeleteSync(readback.Fence);
+			readback.Fence = nullptr;
+
+			size_t size = (size_t)readback.Width * readback.Height * 4 * sizeof(uint16_t);
+			const uint16_t* texels = (const uint16_t*)glMapNamedBufferRange(readback.Buffer, 0, size, GL_MAP_READ_BIT);
+			if (texels)
+			{
+				ProcessFeedback(texels, readback.Width * readback.Height);
+				glUnmapNamedBuffer(readback.Buffer);
+			}
+		}
+
+		std::vector<LoadedPage> loaded;
+		{
+			std::lock_guard<std::mutex> lock(m_LoadedMutex);
+			while (!m_Loaded.empty() && loaded.size() < m_Specification.MaxUploadsPerFrame)
+			{
+				loaded.push_back(std::move(m_Loaded.front()));
+				m_Loaded.pop_front();
+			}
+		}
+
+		for (LoadedPage& page : loaded)
+		{
+			m_Requested.erase(page.Page);
+			if (m_Resident.find(page.Page) == m_Resident.end())
+				UploadPage(page);
+		}
+		m_PendingCount = (uint32_t)m_Requested.size();
+
+		if (m_PageTableDirty)
+			UpdatePageTable();
+	}
+
+	void VirtualTexture::ProcessFeedback(const uint16_t* texels, uint32_t count)
+	{
+		std::unordered_set<uint64_t> visible;
+		for (uint32_t i = 0; i < count; i++)
+		{
+			const uint16_t* texel = &texels[i * 4];
+			if (texel[3] == 0)
+				continue;
+
+			uint32_t level = texel[2];
+			if (level >= m_MipCount || texel[0] >= GetPagesX(level) || texel[1] >= GetPagesY(level))
+				continue;
+
+			visible.insert(MakePage(level, texel[0], texel[1]));
+		}
+
+		std::vector<uint64_t> missing;
+		for (uint64_t page : visible)
+			TouchPage(page, missing);
+
+		// Coarse pages first, they sharpen the fallback for the most texels
+		std::sort(missing.begin(), missing.end());
+		missing.erase(std::unique(missing.begin(), missing.end()), missing.end());
+		std::stable_sort(missing.begin(), missing.end(), [](uint64_t a, uint64_t b) { return GetPageLevel(a) > GetPageLevel(b); });
+		if (missing.size() > m_Slots.size())
+			missing.resize(m_Slots.size());
+
+		// Queued pages that went off screen are dropped, pages already being read are kept
+		{
+			std::lock_guard<std::mutex> lock(m_RequestMutex);
+			for (uint64_t page : m_Requests)
+				m_Requested.erase(page);
+			m_Requests.clear();
+
+			for (uint64_t page : missing)
+			{
+				if (m_Requested.insert(page).second)
+					m_Requests.push_back(page);
+			}
+		}
+		m_RequestCondition.notify_all();
+		m_PendingCount = (uint32_t)m_Requested.size();
+	}
+
+	void VirtualTexture::TouchPage(uint64_t page, std::vector<uint64_t>& missing)
+	{
+		uint32_t x = GetPageX(page), y = GetPageY(page);
+		for (uint32_t level = GetPageLevel(page); level < m_MipCount; level++, x >>= 1, y >>= 1)
+		{
+			uint64_t ancestor = MakePage(level, x, y);
+			auto it = m_Resident.find(ancestor);
+			if (it == m_Resident.end())
+			{
+				missing.push_back(ancestor);
+				continue;
+			}
+
+			// Everything above a page touched this frame has been touched already
+			Slot& slot = m_Slots[it->second];
+			if (slot.LastUsed == m_FrameIndex)
+				break;
+			slot.LastUsed = m_FrameIndex;
+		}
+	}
+
+	bool VirtualTexture::UploadPage(const LoadedPage& page)
+	{
+		// Free slots have never been used, so the least recently used search finds them first.
+		// Pages seen this frame are never evicted.
+		uint32_t victim = (uint32_t)m_Slots.size();
+		for (uint32_t i = 0; i < m_Slots.size(); i++)
+		{
+			const Slot& slot = m_Slots[i];
+			if (slot.Locked || slot.LastUsed >= m_FrameIndex)
+				continue;
+			if (victim == m_Slots.size() || slot.LastUsed < m_Slots[victim].LastUsed)
+				victim = i;
+		}
+
+		if (victim == m_Slots.size())
+			return false;
+
+		Slot& slot = m_Slots[victim];
+		if (slot.Page != INVALID_PAGE)
+			m_Resident.erase(slot.Page);
+
+		uint32_t paddedSize = GetPaddedPageSize();
+		uint32_t slotX = victim % m_Specification.CachePages, slotY = victim / m_Specification.CachePages;
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+		glTextureSubImage2D(m_Cache, 0, slotX * paddedSize, slotY * paddedSize, paddedSize, paddedSize, GL_RGBA, GL_UNSIGNED_BYTE, page.Texels.data());
+
+		slot.Page = page.Page;
+		slot.LastUsed = m_FrameIndex;
+		m_Resident[page.Page] = victim;
+		m_PageTableDirty = true;
+		return true;
+	}
+
+	void VirtualTexture::UpdatePageTable()
+	{
+		// Entries are RGBA8: cache slot x, cache slot y, level of the page in that slot.
+		// Filled top down so a missing page inherits its parent's entry.
+		for (int level = (int)m_MipCount - 1; level >= 0; level--)
+		{
+			uint32_t pagesX = GetPagesX(level), pagesY = GetPagesY(level);
+			std::vector<uint32_t>& entries = m_PageTableLevels[level];
+			for (uint32_t y = 0; y < pagesY; y++)
+			{
+				for (uint32_t x = 0; x < pagesX; x++)
+				{
+					auto it = m_Resident.find(MakePage(level, x, y));
+					if (it != m_Resident.end())
+					{
+						uint32_t slotX = it->second % m_Specification.CachePages, slotY = it->second / m_Specification.CachePages;
+						entries[y * pagesX + x] = 0xFF000000 | ((uint32_t)level << 16) | (slotY << 8) | slotX;
+					}
+					else
+					{
+						entries[y * pagesX + x] = m_PageTableLevels[level + 1][(y >> 1) * GetPagesX(level + 1) + (x >> 1)];
+					}
+				}
+			}
+
+			glTextureSubImage2D(m_PageTable, level, 0, 0, pagesX, pagesY, GL_RGBA, GL_UNSIGNED_BYTE, entries.data());
+		}
+
+		m_PageTableDirty = false;
+	}
+
+}
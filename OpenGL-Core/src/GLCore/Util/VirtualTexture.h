@@ -0,0 +1,163 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <future>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include <glad/glad.h>
+
+#include "AssetPack.h"
+#include "MappedFile.h"
+#include "MipChainBuilder.h"
+
+namespace GLCore::Utils {
+
+	struct VirtualTextureSpecification
+	{
+		uint32_t PageSize = 128;        // texels per page side, without the border
+		uint32_t Border = 4;            // texels duplicated around each page for bilinear filtering
+		uint32_t CachePages = 16;       // the physical cache holds CachePages x CachePages pages
+		uint32_t FeedbackScale = 8;     // feedback is rendered at 1 / FeedbackScale of the viewport
+		uint32_t MaxUploadsPerFrame = 16;
+		uint32_t WorkerCount = 2;
+		bool SRGB = false;
+		bool Repeat = true;             // wrap addressing for page borders, off = clamp
+		MipChainSettings Mips;
+	};
+
+	// Splits an 8-bit image into bordered RGBA8 pages for every level down to a single page,
+	// stored level by level in row-major order. Written next to the source (<path>.vt) on first
+	// use and rebuilt when the source is newer or the layout settings changed.
+	bool BuildPageFile(const std::string& sourcePath, const std::string& pageFilePath, const VirtualTextureSpecification& specification);
+
+	// Texture whose memory use follows what is on screen rather than its resolution.
+	// Only pages the feedback pass saw are read (from the page file, on worker threads) and
+	// uploaded into a fixed physical cache, least recently used pages are evicted. A page table
+	// (one texel per page, one mip per level) maps each page to its cache slot or, while it is
+	// not resident, to the slot of its nearest resident ancestor. The single page of the
+	// coarsest level is always resident.
+	//
+	// Per frame, on the GL thread: BeginFeedback(), draw the virtually textured geometry with a
+	// feedback shader, EndFeedback(), then Update() before drawing with the page table.
+	// A missing or stale page file is built on a background thread; the texture is not valid
+	// until Update() sees the build finish, so keep calling Update() until it is.
+	class VirtualTexture
+	{
+	public:
+		VirtualTexture(const std::string& path, const VirtualTextureSpecification& specification = VirtualTextureSpecification());
+		~VirtualTexture();
+
+		VirtualTexture(const VirtualTexture&) = delete;
+		VirtualTexture& operator=(const VirtualTexture&) = delete;
+
+		bool IsValid() const { return m_PageTable != 0; }
+
+		void BeginFeedback(uint32_t viewportWidth, uint32_t viewportHeight);
+		void EndFeedback();
+		void Update();
+
+		GLuint GetPageTable() const { return m_PageTable; }
+		GLuint GetCache() const { return m_Cache; }
+
+		uint32_t GetWidth() const { return m_Width; }
+		uint32_t GetHeight() const { return m_Height; }
+		uint32_t GetPageSize() const { return m_Specification.PageSize; }
+		uint32_t GetBorder() const { return m_Specification.Border; }
+		uint32_t GetMipCount() const { return m_MipCount; }
+		uint32_t GetCacheSize() const { return m_Specification.CachePages * GetPaddedPageSize(); }
+
+		// Lod offset for feedback shaders, compensates for the reduced feedback resolution
+		float GetFeedbackBias() const;
+
+		uint32_t GetResidentPageCount() const { return (uint32_t)m_Resident.size(); }
+		uint32_t GetCapacity() const { return (uint32_t)m_Slots.size(); }
+		uint32_t GetPendingCount() const { return m_PendingCount; }
+		uint64_t GetCacheMemory() const;
+		// Size of the whole mip chain as a regular texture, for comparison
+		uint64_t GetFullMemory() const;
+	private:
+		static const uint64_t INVALID_PAGE = ~0ull;
+		static const uint32_t READBACK_COUNT = 3;
+
+		struct Slot
+		{
+			uint64_t Page = INVALID_PAGE;
+			uint64_t LastUsed = 0;
+			bool Locked = false;
+		};
+
+		struct LoadedPage
+		{
+			uint64_t Page;
+			std::vector<uint8_t> Texels;
+		};
+
+		struct Readback
+		{
+			GLuint Buffer = 0;
+			GLsync Fence = nullptr;
+			uint32_t Width = 0, Height = 0;
+		};
+
+		uint32_t GetPaddedPageSize() const { return m_Specification.PageSize + 2 * m_Specification.Border; }
+		uint32_t GetPagesX(uint32_t level) const;
+		uint32_t GetPagesY(uint32_t level) const;
+		size_t GetPageIndex(uint64_t page) const;
+		const uint8_t* GetPageData(uint64_t page) const;
+
+		void Initialize();
+		void WorkerThread();
+		void ProcessFeedback(const uint16_t* texels, uint32_t count);
+		void TouchPage(uint64_t page, std::vector<uint64_t>& missing);
+		bool UploadPage(const LoadedPage& page);
+		void UpdatePageTable();
+	private:
+		VirtualTextureSpecification m_Specification;
+		std::string m_Path;
+		std::string m_PageFilePath;
+		std::future<bool> m_Build;
+		uint32_t m_Width = 0, m_Height = 0;
+		uint32_t m_MipCount = 0;
+		std::vector<size_t> m_LevelOffsets;  // first page index of each level
+
+		MappedFile m_PageFile;
+		AssetSpan m_Pages;
+
+		GLuint m_PageTable = 0;
+		GLuint m_Cache = 0;
+		std::vector<std::vector<uint32_t>> m_PageTableLevels;
+		bool m_PageTableDirty = true;
+
+		std::vector<Slot> m_Slots;
+		std::unordered_map<uint64_t, uint32_t> m_Resident;
+		uint64_t m_FrameIndex = 1;
+
+		GLuint m_FeedbackFBO = 0;
+		GLuint m_FeedbackTexture = 0;
+		GLuint m_FeedbackDepth = 0;
+		uint32_t m_FeedbackWidth = 0, m_FeedbackHeight = 0;
+		GLint m_PreviousViewport[4];
+		Readback m_Readbacks[READBACK_COUNT];
+		uint32_t m_ReadbackIndex = 0;
+
+		// Pages queued for or being read by a worker
+		std::unordered_set<uint64_t> m_Requested;
+		std::atomic<uint32_t> m_PendingCount = 0;
+
+		std::vector<std::thread> m_Workers;
+		std::atomic<bool> m_Running = true;
+		std::mutex m_RequestMutex;
+		std::condition_variable m_RequestCondition;
+		std::deque<uint64_t> m_Requests;
+		std::mutex m_LoadedMutex;
+		std::deque<LoadedPage> m_Loaded;
+	};
+
+}
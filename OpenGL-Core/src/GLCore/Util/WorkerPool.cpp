@@ -0,0 +1,85 @@
+#include "glpch.h"
+#include "WorkerPool.h"
+
+#include "ParallelFor.h"
+
+namespace GLCore::Utils {
+
+	WorkerPool::WorkerPool(uint32_t threadCount)
+	{
+		uint32_t workerCount = threadCount ? threadCount : GetWorkerThreadCount() - 1;
+		for (uint32_t i = 0; i < workerCount; i++)
+			m_Threads.emplace_back(&WorkerPool::WorkerThread, this);
+	}
+
+	WorkerPool::~WorkerPool()
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			m_Running = false;
+		}
+		m_WakeCondition.notify_all();
+		for (std::thread& thread : m_Threads)
+			thread.join();
+	}
+
+	void WorkerPool::Run(uint32_t taskCount, const std::function<void(uint32_t)>& task)
+	{
+		std::lock_guard<std::mutex> runLock(m_RunMutex);
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			m_Task = &task;
+			m_TaskCount = taskCount;
+			m_PendingTasks = taskCount;
+			m_NextTask = 0;
+			m_Generation++;
+		}
+		m_WakeCondition.notify_all();
+
+		uint32_t executed = ExecuteTasks(task, taskCount);
+
+		std::unique_lock<std::mutex> lock(m_Mutex);
+		m_PendingTasks -= executed;
+		m_DoneCondition.wait(lock, [this]() { return m_PendingTasks == 0 && m_ActiveWorkers == 0; });
+		m_Task = nullptr;
+	}
+
+	uint32_t WorkerPool::ExecuteTasks(const std::function<void(uint32_t)>& task, uint32_t taskCount)
+	{
+		uint32_t executed = 0;
+		for (uint32_t i = m_NextTask++; i < taskCount; i = m_NextTask++)
+		{
+			task(i);
+			executed++;
+		}
+		return executed;
+	}
+
+	void WorkerPool::WorkerThread()
+	{
+		uint64_t generation = 0;
+		std::unique_lock<std::mutex> lock(m_Mutex);
+		while (true)
+		{
+			// A worker that wakes after a loop has finished waits for the next one
+			m_WakeCondition.wait(lock, [&]() { return !m_Running || (m_Task && m_Generation != generation); });
+			if (!m_Running)
+				return;
+
+			generation = m_Generation;
+			const std::function<void(uint32_t)>& task = *m_Task;
+			uint32_t taskCount = m_TaskCount;
+			m_ActiveWorkers++;
+
+			lock.unlock();
+			uint32_t executed = ExecuteTasks(task, taskCount);
+			lock.lock();
+
+			m_PendingTasks -= executed;
+			m_ActiveWorkers--;
+			if (m_PendingTasks == 0 && m_ActiveWorkers == 0)
+				m_DoneCondition.notify_all();
+		}
+	}
+
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace GLCore::Utils {
+
+	// Threads started once and reused for every parallel loop, for work that runs each frame and
+	// is too short to pay for creating and joining threads (see ParallelFor for one-off jobs).
+	// The calling thread takes part in the loop. One loop runs at a time, calls from several
+	// threads are serialized, and a loop body must not start another loop on the same pool.
+	class WorkerPool
+	{
+	public:
+		// 0 starts one thread per hardware thread besides the caller
+		explicit WorkerPool(uint32_t threadCount = 0);
+		~WorkerPool();
+
+		WorkerPool(const WorkerPool&) = delete;
+		WorkerPool& operator=(const WorkerPool&) = delete;
+
+		// Splits [0, count) into at most threadCount contiguous ranges and calls fn(begin, end) for
+		// each, returning once all have finished
+		template<typename Fn>
+		void ParallelFor(uint32_t count, uint32_t threadCount, Fn&& fn)
+		{
+			threadCount = std::min(threadCount, count);
+			if (threadCount <= 1)
+			{
+				fn(0u, count);
+				return;
+			}
+
+			uint32_t chunk = (count + threadCount - 1) / threadCount;
+			uint32_t chunkCount = (count + chunk - 1) / chunk;
+			Run(chunkCount, [&](uint32_t i) { fn(i * chunk, std::min((i + 1) * chunk, count)); });
+		}
+
+		// Threads including the caller
+		uint32_t GetThreadCount() const { return (uint32_t)m_Threads.size() + 1; }
+	private:
+		void Run(uint32_t taskCount, const std::function<void(uint32_t)>& task);
+		void WorkerThread();
+		// Runs tasks until none are left, returns how many this thread ran
+		uint32_t ExecuteTasks(const std::function<void(uint32_t)>& task, uint32_t taskCount);
+	private:
+		std::vector<std::thread> m_Threads;
+		bool m_Running = true;
+
+		std::mutex m_RunMutex;
+		std::mutex m_Mutex;
+		std::condition_variable m_WakeCondition;
+		std::condition_variable m_DoneCondition;
+
+		// Current loop, written under m_Mutex
+		const std::function<void(uint32_t)>* m_Task = nullptr;
+		uint32_t m_TaskCount = 0;
+		uint64_t m_Generation = 0;
+		uint32_t m_PendingTasks = 0;
+		// Workers that joined the current loop and have not left it, a new loop waits for them
+		uint32_t m_ActiveWorkers = 0;
+		std::atomic<uint32_t> m_NextTask = 0;
+	};
+
+}
@@ -3,6 +3,33 @@
 // Utility header file - include into application for access to utility classes/functions
 
 #include "GLCore/Util/Shader.h"
+#include "GLCore/Util/ProgramCache.h"
+#include "GLCore/Util/ShaderPreprocessor.h"
+#include "GLCore/Util/ShaderWatcher.h"
+#include "GLCore/Util/ShaderVariantCache.h"
+#include "GLCore/Util/UniformBuffer.h"
+#include "GLCore/Util/RenderState.h"
+#include "GLCore/Util/RenderQueue.h"
+#include "GLCore/Util/WorkerPool.h"
+#include "GLCore/Util/CommandBuffer.h"
+#include "GLCore/Util/VertexLayout.h"
+#include "GLCore/Util/MeshLOD.h"
+#include "GLCore/Util/MeshOptimizer.h"
+#include "GLCore/Util/MeshCache.h"
+#include "GLCore/Util/MeshImporter.h"
+#include "GLCore/Util/Frustum.h"
+#include "GLCore/Util/BoundingVolumeHierarchy.h"
+#include "GLCore/Util/TextureFormat.h"
+#include "GLCore/Util/TextureStreamer.h"
+#include "GLCore/Util/TextureRegistry.h"
+#include "GLCore/Util/ImageCache.h"
+#include "GLCore/Util/MipChainBuilder.h"
+#include "GLCore/Util/BlockCompression.h"
+#include "GLCore/Util/DDSFile.h"
+#include "GLCore/Util/ChannelPacker.h"
+#include "GLCore/Util/MappedFile.h"
+#include "GLCore/Util/AssetPack.h"
+#include "GLCore/Util/VirtualTexture.h"
 #include "GLCore/Util/Camera.h"
 #include "GLCore/Util/OrthographicCamera.h"
 #include "GLCore/Util/OrthographicCameraController.h"
@@ -0,0 +1,139 @@
+#version 450 core
+
+// Frustum, occlusion and LOD selection per object, appending the visible ones to the
+// indirect draw command of their group and LOD
+layout(local_size_x = 64) in;
+
+struct Object
+{
+	vec4 Sphere;   // xyz center, w radius
+	uint Group;
+};
+
+struct DrawCommand
+{
+	uint Count;
+	uint InstanceCount;
+	uint FirstIndex;
+	int BaseVertex;
+	uint BaseInstance;
+};
+
+layout(std430, binding = 1) readonly buffer Objects
+{
+	Object u_Objects[];
+};
+
+layout(std430, binding = 2) buffer LODState
+{
+	uint u_LODState[];
+};
+
+layout(std430, binding = 3) buffer Commands
+{
+	DrawCommand u_Commands[];
+};
+
+layout(std430, binding = 4) writeonly buffer Visible
+{
+	uint u_Visible[];
+};
+
+uniform vec4 u_Planes[6];
+uniform vec3 u_ViewPos;
+uniform float u_ProjectionScale;
+uniform float u_Thresholds[8];
+uniform uint u_ThresholdCount;
+uniform float u_Hysteresis;
+uniform uint u_LODCount;
+uniform uint u_ObjectCount;
+
+uniform bool u_Occlusion;
+uniform mat4 u_PyramidViewProjection;
+uniform vec2 u_PyramidSize;
+uniform float u_PyramidMaxLevel;
+uniform sampler2D u_DepthPyramid;
+
+// Same box test as Frustum::Test on the CPU, so the visible sets match
+bool IsInFrustum(vec3 center, float radius)
+{
+	for (int i = 0; i < 6; i++)
+	{
+		float distance = dot(u_Planes[i].xyz, center) + u_Planes[i].w;
+		float extent = dot(abs(u_Planes[i].xyz), vec3(radius));
+		if (distance + extent < 0.0)
+			return false;
+	}
+	return true;
+}
+
+bool IsOccluded(vec3 center, float radius)
+{
+	// Screen rectangle and nearest depth of the bounding box in the frame the pyramid was built from
+	vec2 minUV = vec2(1.0);
+	vec2 maxUV = vec2(0.0);
+	float nearest = 1.0;
+	for (int i = 0; i < 8; i++)
+	{
+		vec3 corner = center + radius * vec3((i & 1) != 0 ? 1.0 : -1.0, (i & 2) != 0 ? 1.0 : -1.0, (i & 4) != 0 ? 1.0 : -1.0);
+		vec4 clip = u_PyramidViewProjection * vec4(corner, 1.0);
+		// Crosses the camera plane, nothing can be said about it
+		if (clip.w <= 0.0)
+			return false;
+
+		vec3 ndc = clip.xyz / clip.w;
+		minUV = min(minUV, ndc.xy * 0.5 + 0.5);
+		maxUV = max(maxUV, ndc.xy * 0.5 + 0.5);
+		nearest = min(nearest, ndc.z * 0.5 + 0.5);
+	}
+	minUV = clamp(minUV, 0.0, 1.0);
+	maxUV = clamp(maxUV, 0.0, 1.0);
+
+	// The level where the rectangle spans at most two texels per axis, so four samples cover it
+	vec2 size = (maxUV - minUV) * u_PyramidSize;
+	float level = min(ceil(log2(max(max(size.x, size.y), 1.0))), u_PyramidMaxLevel);
+
+	float farthest = max(
+		max(textureLod(u_DepthPyramid, minUV, level).r, textureLod(u_DepthPyramid, vec2(maxUV.x, minUV.y), level).r),
+		max(textureLod(u_DepthPyramid, vec2(minUV.x, maxUV.y), level).r, textureLod(u_DepthPyramid, maxUV, level).r));
+	return nearest > farthest;
+}
+
+// Same selection as SelectLOD on the CPU
+uint SelectLOD(float size, uint current)
+{
+	uint lod = 0;
+	while (lod < u_ThresholdCount && size < u_Thresholds[lod])
+		lod++;
+
+	if (lod == current || current > u_ThresholdCount)
+		return lod;
+
+	float lower = current < u_ThresholdCount ? u_Thresholds[current] * (1.0 - u_Hysteresis) : 0.0;
+	float upper = current > 0 ? u_Thresholds[current - 1] * (1.0 + u_Hysteresis) : 3.402823e38;
+	return size >= lower && size < upper ? current : lod;
+}
+
+void main()
+{
+	uint index = gl_GlobalInvocationID.x;
+	if (index >= u_ObjectCount)
+		return;
+
+	Object object = u_Objects[index];
+	vec3 center = object.Sphere.xyz;
+	float radius = object.Sphere.w;
+	if (!IsInFrustum(center, radius))
+		return;
+	if (u_Occlusion && IsOccluded(center, radius))
+		return;
+
+	float distance = length(center - u_ViewPos);
+	float size = distance <= radius ? 3.402823e38 : 2.0 * radius * u_ProjectionScale / distance;
+	uint lod = min(SelectLOD(size, u_LODState[index]), u_LODCount - 1);
+	u_LODState[index] = lod;
+
+	uint command = object.Group * u_LODCount + lod;
+	uint slot = atomicAdd(u_Commands[command].InstanceCount, 1u);
+	u_Visible[u_Commands[command].BaseInstance + slot] = index;
+}
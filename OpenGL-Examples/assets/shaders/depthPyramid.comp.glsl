@@ -0,0 +1,29 @@
+#version 450 core
+
+// One level of the depth pyramid: the farthest depth of the input texels each output texel covers
+layout(local_size_x = 8, local_size_y = 8) in;
+
+layout(r32f, binding = 0) uniform writeonly image2D u_Output;
+
+uniform sampler2D u_Input;
+uniform int u_InputLevel;
+uniform ivec2 u_InputSize;
+uniform ivec2 u_OutputSize;
+
+void main()
+{
+	ivec2 texel = ivec2(gl_GlobalInvocationID.xy);
+	if (any(greaterThanEqual(texel, u_OutputSize)))
+		return;
+
+	// The top level is smaller than the screen by a non-integer ratio, so a texel can cover up to three inputs per axis
+	ivec2 begin = texel * u_InputSize / u_OutputSize;
+	ivec2 end = min(((texel + 1) * u_InputSize + u_OutputSize - 1) / u_OutputSize, u_InputSize);
+
+	float depth = 0.0;
+	for (int y = begin.y; y < end.y; y++)
+		for (int x = begin.x; x < end.x; x++)
+			depth = max(depth, texelFetch(u_Input, ivec2(x, y), u_InputLevel).r);
+
+	imageStore(u_Output, texel, vec4(depth));
+}
@@ -0,0 +1,26 @@
+#version 450 core
+
+out vec4 o_Color;
+
+uniform sampler2D u_EquirectangularMap;
+uniform float u_Size;
+
+const vec2 coefs = vec2(0.15915, 0.31831);
+
+#include "include/octahedral.glsl"
+
+vec2 SphericalToRectangular(vec2 angles)
+{
+	vec2 coords = angles * coefs;
+	return coords + vec2(0.5);
+}
+
+void main()
+{
+	vec3 point = OctahedralDecode(OctahedralTexelToUV(gl_FragCoord.xy, u_Size));
+	vec2 angles = vec2(atan(point.z, point.x), asin(point.y));
+	vec2 texCoords = SphericalToRectangular(angles);
+
+	vec3 color = texture(u_EquirectangularMap, texCoords).rgb;
+	o_Color = vec4(color, 1.0);
+}
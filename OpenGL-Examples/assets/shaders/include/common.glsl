@@ -0,0 +1,3 @@
+// Constants shared by every shader
+
+const float PI = 3.14159265359;
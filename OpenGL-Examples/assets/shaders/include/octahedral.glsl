@@ -0,0 +1,67 @@
+// Octahedral mapping of directions onto a square 2D map, used by the octahedral IBL set
+
+vec2 SignNotZero(vec2 v)
+{
+	return vec2(v.x >= 0.0 ? 1.0 : -1.0, v.y >= 0.0 ? 1.0 : -1.0);
+}
+
+// Direction to octahedral map texel (+Y at the centre, -Y folded into the corners)
+vec2 OctahedralEncode(vec3 n)
+{
+	n /= abs(n.x) + abs(n.y) + abs(n.z);
+	vec2 uv = n.y >= 0.0 ? n.xz : (1.0 - abs(n.zx)) * SignNotZero(n.xz);
+	return uv * 0.5 + 0.5;
+}
+
+// Octahedral map texel to direction
+vec3 OctahedralDecode(vec2 uv)
+{
+	uv = uv * 2.0 - 1.0;
+	vec3 n = vec3(uv.x, 1.0 - abs(uv.x) - abs(uv.y), uv.y);
+	if (n.y < 0.0)
+		n.xz = (1.0 - abs(n.zx)) * SignNotZero(n.xz);
+	return normalize(n);
+}
+
+// Every level of an octahedral map is texel centred: the outermost texel centres lie on the edges
+// of the octahedron, where (0, v) and (0, 1 - v) are the same direction (likewise for the other
+// edges). Bilinear lookups then only blend texels that are neighbours on the sphere, as long as
+// the UV is remapped for the size of the level it samples.
+
+// UV of the texel a bake pass is writing, size is the level being rendered
+vec2 OctahedralTexelToUV(vec2 fragCoord, float size)
+{
+	return size > 1.0 ? (fragCoord - 0.5) / (size - 1.0) : vec2(0.5);
+}
+
+// Mirrors a UV that stepped past an edge back onto the point it reaches on the sphere
+vec2 OctahedralWrap(vec2 uv)
+{
+	if (uv.x < 0.0)
+		uv = vec2(-uv.x, 1.0 - uv.y);
+	else if (uv.x > 1.0)
+		uv = vec2(2.0 - uv.x, 1.0 - uv.y);
+	if (uv.y < 0.0)
+		uv = vec2(1.0 - uv.x, -uv.y);
+	else if (uv.y > 1.0)
+		uv = vec2(1.0 - uv.x, 2.0 - uv.y);
+	return uv;
+}
+
+vec3 SampleOctahedralLevel(sampler2D map, vec2 uv, int level)
+{
+	float size = float(textureSize(map, level).x);
+	return textureLod(map, (uv * (size - 1.0) + 0.5) / size, float(level)).rgb;
+}
+
+// Trilinear lookup, the two levels are fetched separately since each needs its own remap
+vec3 SampleOctahedral(sampler2D map, vec3 direction, float lod)
+{
+	vec2 uv = OctahedralEncode(direction);
+	lod = clamp(lod, 0.0, float(textureQueryLevels(map) - 1));
+	int level = int(lod);
+	vec3 color = SampleOctahedralLevel(map, uv, level);
+	if (lod > float(level))
+		color = mix(color, SampleOctahedralLevel(map, uv, level + 1), lod - float(level));
+	return color;
+}
@@ -6,7 +6,7 @@ out vec4 o_Color;
 
 uniform samplerCube u_Environment;
 
-const float PI = 3.14159265359;
+#include "include/common.glsl"
 
 void main()
 {
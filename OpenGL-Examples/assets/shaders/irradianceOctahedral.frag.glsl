@@ -0,0 +1,39 @@
+#version 450 core
+
+out vec4 o_Color;
+
+uniform sampler2D u_Environment;
+uniform float u_Size;
+
+#include "include/common.glsl"
+#include "include/octahedral.glsl"
+
+void main()
+{
+	vec3 N = OctahedralDecode(OctahedralTexelToUV(gl_FragCoord.xy, u_Size));
+	vec3 up = abs(N.y) < 0.999 ? vec3(0.0, 1.0, 0.0) : vec3(1.0, 0.0, 0.0);
+	vec3 right = normalize(cross(up, N));
+	up = cross(N, right);
+
+	// Environment level with about one texel per texel of the irradiance map
+	float lod = log2(float(textureSize(u_Environment, 0).x) / u_Size);
+
+	float delta = 0.025;
+	int samples = 0;
+	vec3 irradiance = vec3(0.0);
+	// Uniform sampling across the normal hemisphere and then averaged
+	for (float phi = 0; phi < 2 * PI; phi += delta)
+	{
+		for (float theta = 0; theta < PI / 2; theta += delta)
+		{
+			vec3 tangentSample = vec3(sin(theta) * cos(phi), sin(theta) * sin(phi), cos(theta));
+			vec3 sampleVec = tangentSample.x * right + tangentSample.y * up + tangentSample.z * N;
+
+			irradiance += SampleOctahedral(u_Environment, sampleVec, lod);
+			samples++;
+		}
+	}
+	irradiance = PI * irradiance / float(samples);
+
+	o_Color = vec4(irradiance, 1.0);
+}
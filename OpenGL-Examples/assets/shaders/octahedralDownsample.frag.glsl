@@ -0,0 +1,27 @@
+#version 450 core
+
+out vec4 o_Color;
+
+// Restricted to the level above the one being rendered, so level 0 here is the source
+uniform sampler2D u_Source;
+uniform float u_Size;
+
+#include "include/octahedral.glsl"
+
+// Fold-aware 2x reduction: four bilinear taps around the texel, each averaging a 2x2 block of the
+// source. Taps past an edge are mirrored to the side of the map they reach on the sphere, where a
+// box filter would have clamped.
+void main()
+{
+	vec2 uv = OctahedralTexelToUV(gl_FragCoord.xy, u_Size);
+	// A quarter of a texel of this level, the 1x1 level averages the four texels of the one above
+	float offset = u_Size > 1.0 ? 0.25 / (u_Size - 1.0) : 0.5;
+
+	vec3 color = vec3(0.0);
+	color += SampleOctahedralLevel(u_Source, OctahedralWrap(uv + vec2(-offset, -offset)), 0);
+	color += SampleOctahedralLevel(u_Source, OctahedralWrap(uv + vec2( offset, -offset)), 0);
+	color += SampleOctahedralLevel(u_Source, OctahedralWrap(uv + vec2(-offset,  offset)), 0);
+	color += SampleOctahedralLevel(u_Source, OctahedralWrap(uv + vec2( offset,  offset)), 0);
+
+	o_Color = vec4(color * 0.25, 1.0);
+}
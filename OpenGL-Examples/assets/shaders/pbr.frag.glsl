@@ -1,83 +1,122 @@
 #version 450 core
 
+// Permutations: each is either fixed by the variant's defines, so the compiler drops the unused
+// paths, or left to its runtime switch when the program is built without them
+#ifndef TEXTURED
+#define TEXTURED u_TextureToggle
+#endif
+#ifndef LIGHT_COUNT
+#define LIGHT_COUNT 4
+#endif
+#ifndef PARALLAX
+#define PARALLAX 1
+#endif
+
 in VS_OUT
 {
 	vec3 v_WorldPos;
 	vec3 v_Normal;
 	vec2 v_TexCoords;
 	vec3 v_ViewPos;
-	vec3 v_LightPositions[4];
+	vec3 v_LightPositions[LIGHT_COUNT];
+	flat vec3 v_Albedo;
+	flat vec3 v_Material;
 } fs_in;
 
 out vec4 o_Color;
 
-uniform vec3 u_Albedo;
-uniform float u_Metallic;
-uniform float u_Roughness;
-uniform float u_AO;
+layout(binding = 0) uniform sampler2D u_AlbedoMap;
+layout(binding = 5) uniform sampler2D u_HeightMap;
+layout(binding = 1) uniform sampler2D u_MetallicMap;
+layout(binding = 2) uniform sampler2D u_NormalMap;
+layout(binding = 3) uniform sampler2D u_RoughnessMap;
+layout(binding = 4) uniform sampler2D u_AOMap;
 
-uniform sampler2D u_AlbedoMap;
-uniform sampler2D u_HeightMap;
-uniform sampler2D u_MetallicMap;
-uniform sampler2D u_NormalMap;
-uniform sampler2D u_RoughnessMap;
-uniform sampler2D u_AOMap;
+// Packed material: R = AO, G = roughness, B = metallic, A = height
+layout(binding = 13) uniform sampler2D u_MaterialMap;
 
-uniform sampler2D u_BRDFLUT;
-uniform samplerCube u_IrradianceMap;
-uniform samplerCube u_PrefilterMap;
+layout(binding = 10) uniform sampler2D u_VTPageTable;
+layout(binding = 11) uniform sampler2D u_VTCache;
 
-uniform vec3 u_LightColors[4];
+layout(binding = 12) uniform sampler2D u_BRDFLUT;
+layout(binding = 6) uniform samplerCube u_IrradianceMap;
+layout(binding = 7) uniform samplerCube u_PrefilterMap;
+layout(binding = 8) uniform sampler2D u_IrradianceOctMap;
+layout(binding = 9) uniform sampler2D u_PrefilterOctMap;
 
-uniform bool u_TextureToggle;
+#ifndef IBL
 uniform bool u_IBL;
+#define IBL u_IBL
+#endif
+uniform bool u_OctahedralIBL;
+uniform bool u_SHIrradiance;
 
-uniform float u_Exposure;
-
-const float PI = 3.14159265359;
+// Irradiance / PI as 3-band spherical harmonics (convolution already applied)
+uniform vec3 u_SH[9];
 
-// Trowbridge-Reitz GGX Normal Distribution Function
-float Distribution(vec3 N, vec3 H, float roughness)
+// Per-frame camera and lights, shared by every program drawn in the main pass
+layout(std140, binding = 0) uniform Frame
 {
-	float a = roughness * roughness;
-	float a2 = a * a;
-	float NdotH = max(dot(N, H), 0.0);
-	float NdotH2 = clamp(NdotH * NdotH, 0.0, 1.0);
-
-	float num = a2;
-	float denom = NdotH2 * (a2 - 1.0) + 1.0;
-	denom = PI * denom * denom;
-
-	return num / max(denom, 0.0000001);
-}
-
-// Schlick GGX Geometry
-float GeometrySchlickGGX(float NdotV, float roughness)
+	mat4 u_ViewProjection;
+	mat4 u_SkyboxViewProjection;
+	vec3 u_ViewPos;
+	float u_Exposure;
+	vec4 u_LightPositions[4];
+	vec4 u_LightColors[4];
+};
+
+// Per-material parameters, shared by the feedback and shading programs
+layout(std140, binding = 1) uniform Material
 {
-	float r = roughness + 1.0;
-	float k = r * r / 8.0;
-
-	float num = NdotV;
-	float denum = NdotV * (1.0 - k) + k;
-
-	return num / denum;
+	vec2 u_TilingFactor;
+	bool u_TextureToggle;
+	bool u_PackedMaterial;
+	// Virtual albedo: page table entries hold the cache slot (xy) and the level of the page in it (z)
+	bool u_VirtualAlbedo;
+	float u_VTPageSize;
+	vec2 u_VTSize;
+	float u_VTBorder;
+	float u_VTCacheSize;
+	float u_VTMaxLevel;
+	float u_VTFeedbackBias;
+};
+
+#include "include/brdf.glsl"
+#include "include/octahedral.glsl"
+
+vec3 IrradianceSH(vec3 n)
+{
+	return u_SH[0] * 0.282095
+		+ u_SH[1] * 0.488603 * n.y
+		+ u_SH[2] * 0.488603 * n.z
+		+ u_SH[3] * 0.488603 * n.x
+		+ u_SH[4] * 1.092548 * n.x * n.y
+		+ u_SH[5] * 1.092548 * n.y * n.z
+		+ u_SH[6] * 0.315392 * (3.0 * n.z * n.z - 1.0)
+		+ u_SH[7] * 1.092548 * n.x * n.z
+		+ u_SH[8] * 0.546274 * (n.x * n.x - n.y * n.y);
 }
 
-// Smith Geometry
-float Geometry(vec3 N, vec3 L, vec3 V, float roughness)
+vec4 SampleVirtual(vec2 texCoord)
 {
-	float NdotL = max(dot(N, L), 0.0);
-	float NdotV = max(dot(N, V), 0.0);
-	float ggx1 = GeometrySchlickGGX(NdotL, roughness);
-	float ggx2 = GeometrySchlickGGX(NdotV, roughness);
-
-	return ggx1 * ggx2;
+	vec2 texel = texCoord * u_VTSize;
+	vec2 dx = dFdx(texel);
+	vec2 dy = dFdy(texel);
+	float lod = clamp(floor(0.5 * log2(max(dot(dx, dx), dot(dy, dy)))), 0.0, u_VTMaxLevel);
+
+	vec2 uv = fract(texCoord);
+	vec2 page = floor(uv * u_VTSize / (u_VTPageSize * exp2(lod)));
+	vec3 entry = floor(texelFetch(u_VTPageTable, ivec2(page), int(lod)).xyz * 255.0 + 0.5);
+
+	// The entry may belong to a coarser resident ancestor, locate uv inside that page
+	vec2 pageCoord = uv * u_VTSize / (u_VTPageSize * exp2(entry.z));
+	vec2 cacheTexel = entry.xy * (u_VTPageSize + 2.0 * u_VTBorder) + u_VTBorder + fract(pageCoord) * u_VTPageSize;
+	return textureLod(u_VTCache, cacheTexel / u_VTCacheSize, 0.0);
 }
 
-// Fresnel-Schlick approximation
-vec3 Fresnel(float cosTheta, vec3 F0, float roughness)
+float SampleHeight(vec2 texCoord)
 {
-	return F0 + (max(vec3(1.0 - roughness), F0) - F0) * pow(1.0 - cosTheta, 5.0);
+	return u_PackedMaterial ? texture(u_MaterialMap, texCoord).a : texture(u_HeightMap, texCoord).r;
 }
 
 vec2 ParallaxCalculation(vec2 texCoord, vec3 viewDir)
@@ -92,19 +131,19 @@ vec2 ParallaxCalculation(vec2 texCoord, vec3 viewDir)
 	vec2 deltaTexCoords = P / numLayers;
 
 	vec2 currentTexCoords = texCoord;
-	float currentDepthMapValue = texture(u_HeightMap, texCoord).r;
+	float currentDepthMapValue = SampleHeight(texCoord);
 
 	while (currentLayerDepth < currentDepthMapValue)
 	{
 		currentTexCoords -= deltaTexCoords;
-		currentDepthMapValue = 1.0 - texture(u_HeightMap, currentTexCoords).r;
+		currentDepthMapValue = 1.0 - SampleHeight(currentTexCoords);
 		currentLayerDepth += layerDepth;
 	}
 
 	vec2 prevTexCoords = currentTexCoords + deltaTexCoords;
 
 	float afterDepth = currentDepthMapValue - currentLayerDepth;
-	float beforeDepth = texture(u_HeightMap, prevTexCoords).r - currentLayerDepth + layerDepth;
+	float beforeDepth = SampleHeight(prevTexCoords) - currentLayerDepth + layerDepth;
 
 	float weight = afterDepth / (afterDepth - beforeDepth);
 	vec2 finalTexCoords = prevTexCoords * weight + currentTexCoords * (1.0 - weight);
@@ -118,10 +157,16 @@ void main()
 	
 	vec3 N;
 	vec2 texCoords;
-	if (u_TextureToggle)
+	if (bool(TEXTURED))
 	{
-		texCoords = ParallaxCalculation(fs_in.v_TexCoords, V); 
-		N = texture(u_NormalMap, texCoords).rgb * 2.0 - 1.0;
+#if PARALLAX
+		texCoords = ParallaxCalculation(fs_in.v_TexCoords, V);
+#else
+		texCoords = fs_in.v_TexCoords;
+#endif
+		// Only XY are stored when the normal map is BC5 compressed
+		vec2 normalXY = texture(u_NormalMap, texCoords).rg * 2.0 - 1.0;
+		N = vec3(normalXY, sqrt(max(1.0 - dot(normalXY, normalXY), 0.0)));
 	}
 	else
 	{
@@ -134,37 +179,49 @@ void main()
 	float metallic;
 	float roughness;
 	float ao;
-	if (u_TextureToggle)
+	if (bool(TEXTURED))
 	{
-		albedo = pow(texture(u_AlbedoMap, texCoords).rgb, vec3(2.2));
-		metallic = texture(u_MetallicMap, texCoords).r;
-		roughness = texture(u_RoughnessMap, texCoords).r;
-		ao = texture(u_AOMap, texCoords).r;
+		vec3 albedoSample = u_VirtualAlbedo ? SampleVirtual(texCoords).rgb : texture(u_AlbedoMap, texCoords).rgb;
+		albedo = pow(albedoSample, vec3(2.2));
+		if (u_PackedMaterial)
+		{
+			vec3 material = texture(u_MaterialMap, texCoords).rgb;
+			ao = material.r;
+			roughness = material.g;
+			metallic = material.b;
+		}
+		else
+		{
+			metallic = texture(u_MetallicMap, texCoords).r;
+			roughness = texture(u_RoughnessMap, texCoords).r;
+			ao = texture(u_AOMap, texCoords).r;
+		}
 	}
 	else
 	{
-		albedo = u_Albedo;
-		metallic = u_Metallic;
-		roughness = u_Roughness;
-		ao = u_AO;
+		// Constant per sphere, from the instance data or the object block
+		albedo = fs_in.v_Albedo;
+		metallic = fs_in.v_Material.x;
+		roughness = fs_in.v_Material.y;
+		ao = fs_in.v_Material.z;
 	}
 
 	vec3 F0 = vec3(0.04);
 	F0 = mix(F0, albedo, metallic);
 	vec3 Lo = vec3(0.0);
-	for (int i = 0; i < 4; i++)
+	for (int i = 0; i < LIGHT_COUNT; i++)
 	{
 		vec3 L = normalize(fs_in.v_LightPositions[i] - fs_in.v_WorldPos);
 		vec3 H = normalize(L + V);
 
 		float distance = length(fs_in.v_LightPositions[i] - fs_in.v_WorldPos);
 		float attenuation = 1.0 / (distance * distance);
-		vec3 radiance = u_LightColors[i] * attenuation;
+		vec3 radiance = u_LightColors[i].rgb * attenuation;
 
 		// Cook-Torrance BRDF
-		float NDF = Distribution(N, H, roughness);
-		float G = Geometry(N, L, V, roughness);
-		vec3 F = Fresnel(clamp(dot(H, V), 0.0, 1.0), F0, roughness);
+		float NDF = DistributionGGX(max(dot(N, H), 0.0), roughness);
+		float G = GeometrySmith(max(dot(N, L), 0.0), max(dot(N, V), 0.0), GeometryDirectK(roughness));
+		vec3 F = FresnelSchlickRoughness(clamp(dot(H, V), 0.0, 1.0), F0, roughness);
 
 		vec3 num = NDF * G * F;
 		float denom = 4 * max(dot(N, V), 0.0) * max(dot(N, L), 0.0);
@@ -181,16 +238,28 @@ void main()
 	}
 
 	vec3 ambient;
-	if (u_IBL)
+	if (bool(IBL))
 	{
 		// IBL
-		vec3 k_s = Fresnel(clamp(dot(N, V), 0.0, 1.0), F0, roughness);
+		vec3 k_s = FresnelSchlickRoughness(clamp(dot(N, V), 0.0, 1.0), F0, roughness);
 		vec3 k_d = 1.0 - k_s;
-		vec3 irradiance = texture(u_IrradianceMap, N).rgb;
+		const float MAX_REFLECTION_LOD = 4.0;
+		vec3 irradiance;
+		vec3 prefilteredColor;
+		if (u_OctahedralIBL)
+		{
+			irradiance = SampleOctahedral(u_IrradianceOctMap, N, 0.0);
+			prefilteredColor = SampleOctahedral(u_PrefilterOctMap, R, roughness * MAX_REFLECTION_LOD);
+		}
+		else
+		{
+			irradiance = texture(u_IrradianceMap, N).rgb;
+			prefilteredColor = textureLod(u_PrefilterMap, R, roughness * MAX_REFLECTION_LOD).rgb;
+		}
+		if (u_SHIrradiance)
+			irradiance = max(IrradianceSH(N), vec3(0.0));
 		vec3 diffuse = irradiance * albedo;
 
-		const float MAX_REFLECTION_LOD = 4.0;
-		vec3 prefilteredColor = textureLod(u_PrefilterMap, R, roughness * MAX_REFLECTION_LOD).rgb;
 		vec2 BRDF = texture(u_BRDFLUT, vec2(max(dot(N, V), 0.0), roughness)).rg;
 		vec3 specular = prefilteredColor * (F0 * BRDF.x + BRDF.y);
 
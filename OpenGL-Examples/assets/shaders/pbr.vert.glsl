@@ -1,9 +1,20 @@
 #version 450 core
 
-layout(location = 0) in vec3 a_Position;
-layout(location = 1) in vec3 a_Normal;
-layout(location = 2) in vec3 a_Tangent;
-layout(location = 3) in vec2 a_TexCoords;
+// Permutations, see pbr.frag.glsl
+#ifndef TEXTURED
+#define TEXTURED u_TextureToggle
+#endif
+#ifndef LIGHT_COUNT
+#define LIGHT_COUNT 4
+#endif
+
+// Packed vertex: snorm16 position (w = 1), octahedral normal (xy) and tangent (zw) with the
+// bitangent sign folded into w (see OctahedralTangentFrame), unorm16 UV
+layout(location = 0) in vec4 a_Position;
+layout(location = 1) in vec4 a_TangentFrame;
+layout(location = 2) in vec2 a_TexCoords;
+// Index into u_Instances, instances are grouped by LOD so gl_InstanceID alone is not enough
+layout(location = 3) in uint a_InstanceIndex;
 
 out VS_OUT
 {
@@ -11,49 +22,105 @@ out VS_OUT
 	vec3 v_Normal;
 	vec2 v_TexCoords;
 	vec3 v_ViewPos;
-	vec3 v_LightPositions[4];
+	vec3 v_LightPositions[LIGHT_COUNT];
+	flat vec3 v_Albedo;
+	flat vec3 v_Material;
 } vs_out;
 
-uniform mat4 u_ViewProjection;
-uniform mat4 u_Model;
-uniform mat3 u_NormalModel;
+struct Instance
+{
+	mat4 Model;
+	mat3 NormalModel;
+	vec4 Material;   // metallic, roughness, AO
+	vec4 Albedo;
+};
+
+layout(std430, binding = 0) readonly buffer Instances
+{
+	Instance u_Instances[];
+};
+
+uniform bool u_Instanced;
+
+// Per-frame camera and lights, shared by every program drawn in the main pass
+layout(std140, binding = 0) uniform Frame
+{
+	mat4 u_ViewProjection;
+	mat4 u_SkyboxViewProjection;
+	vec3 u_ViewPos;
+	float u_Exposure;
+	vec4 u_LightPositions[4];
+	vec4 u_LightColors[4];
+};
 
-uniform vec3 u_ViewPos;
-uniform vec3 u_LightPositions[4];
+// Per-material parameters, shared by the feedback and shading programs
+layout(std140, binding = 1) uniform Material
+{
+	vec2 u_TilingFactor;
+	bool u_TextureToggle;
+	bool u_PackedMaterial;
+	// Virtual albedo: page table entries hold the cache slot (xy) and the level of the page in it (z)
+	bool u_VirtualAlbedo;
+	float u_VTPageSize;
+	vec2 u_VTSize;
+	float u_VTBorder;
+	float u_VTCacheSize;
+	float u_VTMaxLevel;
+	float u_VTFeedbackBias;
+};
 
-uniform bool u_TextureToggle;
+// Transform and material of a draw that is not instanced
+layout(std140, binding = 2) uniform Object
+{
+	Instance u_Object;
+};
 
-uniform vec2 u_TilingFactor;
+vec3 OctahedralDecode(vec2 e)
+{
+	vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+	if (n.z < 0.0)
+		n.xy = (1.0 - abs(n.yx)) * vec2(n.x >= 0.0 ? 1.0 : -1.0, n.y >= 0.0 ? 1.0 : -1.0);
+	return normalize(n);
+}
 
 void main()
 {
-	vec4 worldPos = u_Model * vec4(a_Position, 1.0);
+	Instance instance = u_Instanced ? u_Instances[a_InstanceIndex] : u_Object;
+	mat4 model = instance.Model;
+	mat3 normalModel = instance.NormalModel;
+	vs_out.v_Albedo = instance.Albedo.rgb;
+	vs_out.v_Material = instance.Material.xyz;
+
+	vec4 worldPos = model * a_Position;
 
-	vec3 N = normalize(u_NormalModel * a_Normal);
+	vec3 N = normalize(normalModel * OctahedralDecode(a_TangentFrame.xy));
 	vs_out.v_Normal = N;
 	vs_out.v_TexCoords = a_TexCoords;
-	if (u_TextureToggle)
+	if (bool(TEXTURED))
 	{
 		if (u_TilingFactor.x > 0.0001 && u_TilingFactor.y > 0.0001)
 			vs_out.v_TexCoords *= u_TilingFactor;
 
-		vec3 T = u_NormalModel * a_Tangent;
+		float handedness = a_TangentFrame.w < 0.0 ? -1.0 : 1.0;
+		vec2 tangent = vec2(a_TangentFrame.z, (abs(a_TangentFrame.w) * 127.0 - 1.0) / 63.0 - 1.0);
+		vec3 T = normalModel * OctahedralDecode(tangent);
 		T = normalize(T - dot(N, T) * N);
-	
-		vec3 B = cross(N, T);
+
+		// Mirrored UVs flip the bitangent
+		vec3 B = cross(N, T) * handedness;
 
 		mat3 TBN = transpose(mat3(T, B, N));
 		vs_out.v_WorldPos = TBN * vec3(worldPos);
 		vs_out.v_ViewPos = TBN * u_ViewPos;
-		for (int i = 0; i < 4; i++)
-			vs_out.v_LightPositions[i] = TBN * u_LightPositions[i];
+		for (int i = 0; i < LIGHT_COUNT; i++)
+			vs_out.v_LightPositions[i] = TBN * u_LightPositions[i].xyz;
 	}
 	else
 	{
 		vs_out.v_WorldPos = vec3(worldPos);
 		vs_out.v_ViewPos = u_ViewPos;
-		for (int i = 0; i < 4; i++)
-			vs_out.v_LightPositions[i] = u_LightPositions[i];
+		for (int i = 0; i < LIGHT_COUNT; i++)
+			vs_out.v_LightPositions[i] = u_LightPositions[i].xyz;
 	}
 
 	gl_Position = u_ViewProjection * worldPos;
@@ -0,0 +1,54 @@
+#version 450 core
+
+out vec4 o_Color;
+
+uniform float u_Roughness;
+uniform float u_Resolution;
+uniform float u_Size;
+uniform sampler2D u_EnvironmentMap;
+
+#include "include/brdf.glsl"
+#include "include/octahedral.glsl"
+
+void main()
+{
+    vec3 N = OctahedralDecode(OctahedralTexelToUV(gl_FragCoord.xy, u_Size));
+    vec3 V = N;
+
+    const uint SAMPLE_COUNT = 1024u;
+    float totalWeight = 0.0;
+    vec3 prefilteredColor = vec3(0.0);
+
+    // Generate a quasi-random sample vector focused on V
+    // Use that to sample and average (weighted) the environment map
+    for (uint i = 0u; i < SAMPLE_COUNT; i++)
+    {
+        vec2 X_i = Hammersley(i, SAMPLE_COUNT);
+        vec3 H = ImportanceSampleGGX(X_i, N, u_Roughness);
+        vec3 L = normalize(2.0 * dot(V, H) * H - V);
+
+        float NdotL = max(dot(N, L), 0.0);
+        if (NdotL > 0.0)
+        {
+            // Probability distribution function of the samples
+            float NdotH = max(dot(N, H), 0.0);
+            float HdotV = max(dot(H, V), 0.0);
+            float D = DistributionGGX(NdotH, u_Roughness);
+            float pdf = (D * NdotH) / (4.0 * HdotV);
+
+            float saTexel = 4.0 * PI / (u_Resolution * u_Resolution);      // solid angle subtended by one texel
+            float saSample = 1.0 / (float(SAMPLE_COUNT) * pdf + 0.001);     // solid angle subtended by the sample
+
+            // Mip level chosen depending on the pdf value
+            // https://developer.nvidia.com/gpugems/gpugems3/part-iii-rendering/chapter-20-gpu-based-importance-sampling
+            // (Equation 13)
+            float mipLevel = u_Roughness == 0.0 ? 0.0 : 0.5 * log2(saSample / saTexel);
+
+            prefilteredColor += SampleOctahedral(u_EnvironmentMap, L, mipLevel) * NdotL;
+            totalWeight += NdotL;
+        }
+    }
+    prefilteredColor /= totalWeight;
+
+    o_Color = vec4(prefilteredColor, 1.0);
+}
\ No newline at end of file
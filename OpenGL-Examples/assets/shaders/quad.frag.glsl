@@ -5,7 +5,7 @@ in vec2 v_TexCoord;
 
 layout(location = 0) out vec4 o_Color;
 
-uniform sampler2D u_Texture;
+layout(binding = 0) uniform sampler2D u_Texture;
 
 void main()
 {
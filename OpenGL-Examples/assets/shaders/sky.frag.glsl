@@ -0,0 +1,54 @@
+#version 450 core
+
+in vec3 v_WorldPos;
+
+out vec4 o_Color;
+
+// Preetham daylight model, coefficients computed on the CPU (see ProceduralSky.cpp)
+// Each vec3 holds the Y, x and y channel of one Perez coefficient
+uniform vec3 u_A;
+uniform vec3 u_B;
+uniform vec3 u_C;
+uniform vec3 u_D;
+uniform vec3 u_E;
+uniform vec3 u_Zenith;
+
+uniform vec3 u_SunDirection;
+uniform vec3 u_SunRadiance;
+uniform float u_SunAngularRadius;
+
+vec3 Perez(float cosTheta, float gamma, float cosGamma)
+{
+	return (1.0 + u_A * exp(u_B / cosTheta)) * (1.0 + u_C * exp(u_D * gamma) + u_E * cosGamma * cosGamma);
+}
+
+vec3 YxyToRGB(vec3 Yxy)
+{
+	float Y = Yxy.x;
+	float X = Yxy.y / Yxy.z * Y;
+	float Z = (1.0 - Yxy.y - Yxy.z) / Yxy.z * Y;
+
+	return vec3(
+		 3.2406 * X - 1.5372 * Y - 0.4986 * Z,
+		-0.9689 * X + 1.8758 * Y + 0.0415 * Z,
+		 0.0557 * X - 0.2040 * Y + 1.0570 * Z);
+}
+
+void main()
+{
+	vec3 direction = normalize(v_WorldPos);
+
+	float cosTheta = max(direction.y, 0.01);
+	float cosGamma = clamp(dot(direction, u_SunDirection), -1.0, 1.0);
+	float gamma = acos(cosGamma);
+
+	vec3 color = max(YxyToRGB(u_Zenith * Perez(cosTheta, gamma, cosGamma)), vec3(0.0));
+
+	// Dim ground below the horizon
+	if (direction.y < 0.0)
+		color *= 0.3;
+	else if (gamma < u_SunAngularRadius)
+		color += u_SunRadiance;
+
+	o_Color = vec4(color, 1.0);
+}
@@ -4,12 +4,20 @@ in vec3 v_TexCoord;
 
 layout(location = 0) out vec4 o_Color;
 
-uniform samplerCube u_CubeMap;
+layout(binding = 0) uniform samplerCube u_CubeMap;
+layout(binding = 1) uniform sampler2D u_OctahedralMap;
+uniform bool u_Octahedral;
 uniform float u_Mip;
 
+#include "include/octahedral.glsl"
+
 void main()
 {
-	vec3 color = textureLod(u_CubeMap, v_TexCoord, u_Mip).rgb;
+	vec3 color;
+	if (u_Octahedral)
+		color = SampleOctahedral(u_OctahedralMap, normalize(v_TexCoord), u_Mip);
+	else
+		color = textureLod(u_CubeMap, v_TexCoord, u_Mip).rgb;
 	color = color / (color + vec3(1.0));
 	color = pow(color, vec3(1.0/2.2));
 
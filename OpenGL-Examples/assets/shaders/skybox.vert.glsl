@@ -4,11 +4,20 @@ layout(location = 0) in vec3 a_Position;
 
 out vec3 v_TexCoord;
 
-uniform mat4 u_ViewProjection;
+// Per-frame camera and lights, shared by every program drawn in the main pass
+layout(std140, binding = 0) uniform Frame
+{
+	mat4 u_ViewProjection;
+	mat4 u_SkyboxViewProjection;
+	vec3 u_ViewPos;
+	float u_Exposure;
+	vec4 u_LightPositions[4];
+	vec4 u_LightColors[4];
+};
 
 void main()
 {
 	v_TexCoord = a_Position;
-	vec4 position = u_ViewProjection * vec4(a_Position, 1.0f);
+	vec4 position = u_SkyboxViewProjection * vec4(a_Position, 1.0f);
 	gl_Position = position.xyww;
 }
\ No newline at end of file
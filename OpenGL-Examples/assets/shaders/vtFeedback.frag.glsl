@@ -0,0 +1,42 @@
+#version 450 core
+
+in VS_OUT
+{
+	vec3 v_WorldPos;
+	vec3 v_Normal;
+	vec2 v_TexCoords;
+	vec3 v_ViewPos;
+	vec3 v_LightPositions[4];
+	flat vec3 v_Albedo;
+	flat vec3 v_Material;
+} fs_in;
+
+// Page x, page y, level, coverage
+out uvec4 o_Page;
+
+// Per-material parameters, shared by the feedback and shading programs
+layout(std140, binding = 1) uniform Material
+{
+	vec2 u_TilingFactor;
+	bool u_TextureToggle;
+	bool u_PackedMaterial;
+	// Virtual albedo: page table entries hold the cache slot (xy) and the level of the page in it (z)
+	bool u_VirtualAlbedo;
+	float u_VTPageSize;
+	vec2 u_VTSize;
+	float u_VTBorder;
+	float u_VTCacheSize;
+	float u_VTMaxLevel;
+	float u_VTFeedbackBias;
+};
+
+void main()
+{
+	vec2 texel = fs_in.v_TexCoords * u_VTSize;
+	vec2 dx = dFdx(texel);
+	vec2 dy = dFdy(texel);
+	float lod = clamp(floor(0.5 * log2(max(dot(dx, dx), dot(dy, dy))) + u_VTFeedbackBias), 0.0, u_VTMaxLevel);
+
+	vec2 page = floor(fract(fs_in.v_TexCoords) * u_VTSize / (u_VTPageSize * exp2(lod)));
+	o_Page = uvec4(uvec2(page), uint(lod), 1u);
+}
@@ -1,4 +1,5 @@
 #include "GLCore.h"
+#include "GLCoreUtils.h"
 
 #include "ExampleLayer.h"
 #include "PBR.h"
@@ -11,6 +12,10 @@ public:
 	Example()
 		: Application("OpenGL Examples")
 	{
+		// Built with AssetPacker, loose files are used when there is no pack and, in debug builds,
+		// take precedence over it so the shader watcher's edits are what gets loaded
+		Utils::AssetPack::Mount("assets.pak");
+
 		PushLayer(new PBR());
 	}
 };
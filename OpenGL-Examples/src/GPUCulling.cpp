@@ -0,0 +1,244 @@
+#include "GPUCulling.h"
+
+using namespace GLCore::Utils;
+
+static const uint32_t CULL_GROUP_SIZE = 64;
+static const uint32_t PYRAMID_GROUP_SIZE = 8;
+// Size of u_Thresholds in cullInstances.comp.glsl
+static const uint32_t MAX_LOD_THRESHOLDS = 8;
+
+static uint32_t PreviousPowerOfTwo(uint32_t value)
+{
+    uint32_t result = 1;
+    while (result * 2 <= value)
+        result *= 2;
+    return result;
+}
+
+GPUCulling::GPUCulling(uint32_t width, uint32_t height)
+    : m_Width(width), m_Height(height)
+{
+    m_CullShader = Shader::FromGLSLComputeFile("assets/shaders/cullInstances.comp.glsl");
+    m_DepthPyramidShader = Shader::FromGLSLComputeFile("assets/shaders/depthPyramid.comp.glsl");
+
+    glCreateBuffers(1, &m_ObjectBuffer);
+    glCreateBuffers(1, &m_LODStateBuffer);
+    glCreateBuffers(1, &m_CommandBuffer);
+    glCreateBuffers(1, &m_VisibleBuffer);
+    glCreateBuffers(1, &m_ReadbackBuffer);
+
+    CreateDepthTargets();
+}
+
+GPUCulling::~GPUCulling()
+{
+    delete m_CullShader;
+    delete m_DepthPyramidShader;
+
+    glDeleteBuffers(1, &m_ObjectBuffer);
+    glDeleteBuffers(1, &m_LODStateBuffer);
+    glDeleteBuffers(1, &m_CommandBuffer);
+    glDeleteBuffers(1, &m_VisibleBuffer);
+    glDeleteBuffers(1, &m_ReadbackBuffer);
+    DestroyDepthTargets();
+}
+
+void GPUCulling::CreateDepthTargets()
+{
+    // Resolved copy of the scene depth, same format as the default framebuffer so it can be blitted
+    glCreateTextures(GL_TEXTURE_2D, 1, &m_DepthTexture);
+    glTextureStorage2D(m_DepthTexture, 1, GL_DEPTH24_STENCIL8, m_Width, m_Height);
+    glTextureParameteri(m_DepthTexture, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTextureParameteri(m_DepthTexture, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+    glCreateFramebuffers(1, &m_DepthFBO);
+    glNamedFramebufferTexture(m_DepthFBO, GL_DEPTH_STENCIL_ATTACHMENT, m_DepthTexture, 0);
+
+    // Farthest depth per texel, the top level is the previous power of two so every texel
+    // halves cleanly into the next mip
+    m_PyramidWidth = PreviousPowerOfTwo(m_Width);
+    m_PyramidHeight = PreviousPowerOfTwo(m_Height);
+    m_PyramidMipCount = (uint32_t)std::floor(std::log2((float)std::max(m_PyramidWidth, m_PyramidHeight))) + 1;
+
+    glCreateTextures(GL_TEXTURE_2D, 1, &m_DepthPyramid);
+    glTextureStorage2D(m_DepthPyramid, m_PyramidMipCount, GL_R32F, m_PyramidWidth, m_PyramidHeight);
+    glTextureParameteri(m_DepthPyramid, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+    glTextureParameteri(m_DepthPyramid, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTextureParameteri(m_DepthPyramid, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTextureParameteri(m_DepthPyramid, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+}
+
+void GPUCulling::DestroyDepthTargets()
+{
+    glDeleteFramebuffers(1, &m_DepthFBO);
+    glDeleteTextures(1, &m_DepthTexture);
+    glDeleteTextures(1, &m_DepthPyramid);
+}
+
+void GPUCulling::Resize(uint32_t width, uint32_t height)
+{
+    if ((width == m_Width && height == m_Height) || width == 0 || height == 0)
+        return;
+
+    m_Width = width;
+    m_Height = height;
+    DestroyDepthTargets();
+    CreateDepthTargets();
+
+    // The old pyramid went with its texture, occlusion waits for the next one
+    m_PyramidValid = false;
+}
+
+void GPUCulling::SetObjects(const std::vector<CullObject>& objects, uint32_t groupCount)
+{
+    glNamedBufferData(m_ObjectBuffer, objects.size() * sizeof(CullObject), objects.data(), GL_STATIC_DRAW);
+
+    // Moved objects keep their LOD, a different set starts over at full detail
+    if (objects.size() != m_ObjectCount || groupCount != m_GroupCount)
+    {
+        m_ObjectCount = (uint32_t)objects.size();
+        m_GroupCount = groupCount;
+
+        std::vector<uint32_t> lodState(objects.size(), 0);
+        glNamedBufferData(m_LODStateBuffer, lodState.size() * sizeof(uint32_t), lodState.data(), GL_DYNAMIC_COPY);
+
+        // Resized with the commands on the next Cull
+        m_CommandCount = 0;
+    }
+}
+
+void GPUCulling::Cull(const glm::mat4& viewProjection, const glm::vec3& viewPos, float projectionScale,
+    const std::vector<DrawElementsIndirectCommand>& lods, const float* thresholds, uint32_t thresholdCount, float hysteresis, bool occlusion)
+{
+    uint32_t lodCount = (uint32_t)lods.size();
+    uint32_t commandCount = lodCount * m_GroupCount;
+    if (m_ObjectCount == 0 || commandCount == 0)
+        return;
+
+    // Command c draws the visible indices written from c * objectCount on
+    if (commandCount != m_CommandCount)
+    {
+        m_CommandCount = commandCount;
+        m_Commands.resize(commandCount);
+        m_VisibleCounts.assign(commandCount, 0);
+        glNamedBufferData(m_CommandBuffer, commandCount * sizeof(DrawElementsIndirectCommand), nullptr, GL_DYNAMIC_COPY);
+        glNamedBufferData(m_VisibleBuffer, (size_t)commandCount * m_ObjectCount * sizeof(uint32_t), nullptr, GL_DYNAMIC_COPY);
+        glNamedBufferData(m_ReadbackBuffer, 2 * commandCount * sizeof(DrawElementsIndirectCommand), nullptr, GL_STREAM_READ);
+        m_FrameIndex = 0;
+    }
+
+    // Counts of the previous frame, its copy has had a frame to complete
+    size_t commandsSize = commandCount * sizeof(DrawElementsIndirectCommand);
+    if (m_FrameIndex > 0)
+    {
+        std::vector<DrawElementsIndirectCommand> previous(commandCount);
+        glGetNamedBufferSubData(m_ReadbackBuffer, ((m_FrameIndex + 1) % 2) * commandsSize, commandsSize, previous.data());
+        for (uint32_t i = 0; i < commandCount; i++)
+            m_VisibleCounts[i] = previous[i].InstanceCount;
+    }
+
+    for (uint32_t command = 0; command < commandCount; command++)
+    {
+        m_Commands[command] = lods[command % lodCount];
+        m_Commands[command].InstanceCount = 0;
+        m_Commands[command].BaseInstance = command * m_ObjectCount;
+    }
+    glNamedBufferSubData(m_CommandBuffer, 0, commandsSize, m_Commands.data());
+
+    Shader* shader = m_CullShader;
+    glUseProgram(shader->GetRendererID());
+
+    Frustum frustum(viewProjection);
+    glm::vec4 planes[6];
+    for (uint32_t i = 0; i < 6; i++)
+        planes[i] = frustum.GetPlane(i);
+    shader->SetFloat4Array("u_Planes", planes, 6);
+    shader->SetFloat3("u_ViewPos", viewPos);
+    shader->SetFloat("u_ProjectionScale", projectionScale);
+    thresholdCount = std::min(thresholdCount, MAX_LOD_THRESHOLDS);
+    if (thresholdCount > 0)
+        shader->SetFloatArray("u_Thresholds", thresholds, thresholdCount);
+    shader->SetUInt("u_ThresholdCount", thresholdCount);
+    shader->SetFloat("u_Hysteresis", hysteresis);
+    shader->SetUInt("u_LODCount", lodCount);
+    shader->SetUInt("u_ObjectCount", m_ObjectCount);
+
+    shader->SetInt("u_Occlusion", occlusion && m_PyramidValid);
+    shader->SetMat4("u_PyramidViewProjection", m_PyramidViewProjection);
+    shader->SetFloat2("u_PyramidSize", glm::vec2((float)m_PyramidWidth, (float)m_PyramidHeight));
+    shader->SetFloat("u_PyramidMaxLevel", (float)(m_PyramidMipCount - 1));
+    glBindTextureUnit(0, m_DepthPyramid);
+    shader->SetInt("u_DepthPyramid", 0);
+
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, m_ObjectBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, m_LODStateBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 3, m_CommandBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 4, m_VisibleBuffer);
+
+    glDispatchCompute((m_ObjectCount + CULL_GROUP_SIZE - 1) / CULL_GROUP_SIZE, 1, 1);
+    glMemoryBarrier(GL_COMMAND_BARRIER_BIT | GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT | GL_BUFFER_UPDATE_BARRIER_BIT);
+
+    glCopyNamedBufferSubData(m_CommandBuffer, m_ReadbackBuffer, 0, (m_FrameIndex % 2) * commandsSize, commandsSize);
+    m_FrameIndex++;
+}
+
+void GPUCulling::Draw(GLenum primitive, uint32_t vertexArray, uint32_t binding, uint32_t groupCount) const
+{
+    if (m_CommandCount == 0)
+        return;
+
+    uint32_t lodCount = m_CommandCount / m_GroupCount;
+    glVertexArrayVertexBuffer(vertexArray, binding, m_VisibleBuffer, 0, sizeof(uint32_t));
+    glBindVertexArray(vertexArray);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, m_CommandBuffer);
+    glMultiDrawElementsIndirect(primitive, GL_UNSIGNED_INT, nullptr, std::min(groupCount, m_GroupCount) * lodCount, 0);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+}
+
+void GPUCulling::BuildDepthPyramid(const glm::mat4& viewProjection, uint32_t width, uint32_t height)
+{
+    // A minimized window has nothing to test against
+    if (width == 0 || height == 0)
+    {
+        m_PyramidValid = false;
+        return;
+    }
+    Resize(width, height);
+
+    // Resolves the multisampled depth on the way
+    glBlitNamedFramebuffer(0, m_DepthFBO, 0, 0, m_Width, m_Height, 0, 0, m_Width, m_Height, GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+
+    Shader* shader = m_DepthPyramidShader;
+    glUseProgram(shader->GetRendererID());
+    shader->SetInt("u_Input", 0);
+
+    uint32_t inputWidth = m_Width, inputHeight = m_Height;
+    for (uint32_t level = 0; level < m_PyramidMipCount; level++)
+    {
+        uint32_t width = std::max(m_PyramidWidth >> level, 1u);
+        uint32_t height = std::max(m_PyramidHeight >> level, 1u);
+
+        glBindTextureUnit(0, level == 0 ? m_DepthTexture : m_DepthPyramid);
+        shader->SetInt("u_InputLevel", level == 0 ? 0 : level - 1);
+        shader->SetInt2("u_InputSize", glm::ivec2(inputWidth, inputHeight));
+        shader->SetInt2("u_OutputSize", glm::ivec2(width, height));
+        glBindImageTexture(0, m_DepthPyramid, level, GL_FALSE, 0, GL_WRITE_ONLY, GL_R32F);
+
+        glDispatchCompute((width + PYRAMID_GROUP_SIZE - 1) / PYRAMID_GROUP_SIZE, (height + PYRAMID_GROUP_SIZE - 1) / PYRAMID_GROUP_SIZE, 1);
+        glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT | GL_TEXTURE_FETCH_BARRIER_BIT);
+
+        inputWidth = width;
+        inputHeight = height;
+    }
+
+    m_PyramidViewProjection = viewProjection;
+    m_PyramidValid = true;
+}
+
+uint32_t GPUCulling::GetVisibleCount() const
+{
+    uint32_t count = 0;
+    for (uint32_t visible : m_VisibleCounts)
+        count += visible;
+    return count;
+}
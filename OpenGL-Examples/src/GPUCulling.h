@@ -0,0 +1,87 @@
+#pragma once
+
+#include <GLCore.h>
+#include <GLCoreUtils.h>
+
+// Matches the DrawCommand struct in cullInstances.comp.glsl and the layout
+// glMultiDrawElementsIndirect reads
+struct DrawElementsIndirectCommand
+{
+	uint32_t Count;
+	uint32_t InstanceCount;
+	uint32_t FirstIndex;
+	int32_t BaseVertex;
+	uint32_t BaseInstance;
+};
+
+// Matches the Object struct in cullInstances.comp.glsl (std430)
+struct CullObject
+{
+	glm::vec4 Sphere;   // xyz center, w radius
+	uint32_t Group;
+	uint32_t Padding[3];
+};
+
+// Frustum, occlusion and LOD selection for every object in a compute pass, written straight
+// into indirect draw commands so the CPU cost does not depend on the object count. Each group
+// gets one command per LOD; the visible object indices of command c are written from
+// c * objectCount on and fed to the vertex shader as an instanced attribute.
+//
+// Occlusion is tested against a depth pyramid built from the previous frame, reprojected with
+// the previous view-projection.
+class GPUCulling
+{
+public:
+	GPUCulling(uint32_t width, uint32_t height);
+	~GPUCulling();
+
+	// Objects that only moved keep their LOD state
+	void SetObjects(const std::vector<CullObject>& objects, uint32_t groupCount);
+
+	// lods holds the index range of each LOD (instance count and base instance are filled in),
+	// thresholds the projected size in pixels below which each LOD but the last is left
+	void Cull(const glm::mat4& viewProjection, const glm::vec3& viewPos, float projectionScale,
+		const std::vector<DrawElementsIndirectCommand>& lods, const float* thresholds, uint32_t thresholdCount, float hysteresis, bool occlusion);
+
+	// Draws the commands of the first groupCount groups with the visible indices on the given vertex buffer binding
+	void Draw(GLenum primitive, uint32_t vertexArray, uint32_t binding, uint32_t groupCount) const;
+
+	// Downsamples the depth of the default framebuffer, call after the occluders are drawn. The
+	// targets follow the framebuffer size, width and height are its current dimensions.
+	void BuildDepthPyramid(const glm::mat4& viewProjection, uint32_t width, uint32_t height);
+	// Recreates the depth copy and pyramid, the next Cull skips occlusion
+	void Resize(uint32_t width, uint32_t height);
+
+	// Instances drawn by each command, read back a frame late
+	const std::vector<uint32_t>& GetVisibleCounts() const { return m_VisibleCounts; }
+	uint32_t GetVisibleCount() const;
+	uint32_t GetObjectCount() const { return m_ObjectCount; }
+	uint32_t GetPyramidMipCount() const { return m_PyramidMipCount; }
+private:
+	void CreateDepthTargets();
+	void DestroyDepthTargets();
+private:
+	GLCore::Utils::Shader* m_CullShader;
+	GLCore::Utils::Shader* m_DepthPyramidShader;
+
+	uint32_t m_ObjectBuffer;
+	uint32_t m_LODStateBuffer;
+	uint32_t m_CommandBuffer;
+	uint32_t m_VisibleBuffer;
+	uint32_t m_ReadbackBuffer;
+	uint32_t m_ObjectCount = 0;
+	uint32_t m_GroupCount = 0;
+	uint32_t m_CommandCount = 0;
+	std::vector<DrawElementsIndirectCommand> m_Commands;
+	std::vector<uint32_t> m_VisibleCounts;
+	uint64_t m_FrameIndex = 0;
+
+	uint32_t m_Width, m_Height;
+	uint32_t m_DepthFBO;
+	uint32_t m_DepthTexture;
+	uint32_t m_DepthPyramid;
+	uint32_t m_PyramidWidth, m_PyramidHeight;
+	uint32_t m_PyramidMipCount;
+	glm::mat4 m_PyramidViewProjection = glm::mat4(1.0f);
+	bool m_PyramidValid = false;
+};
@@ -1,83 +1,126 @@
 #include "PBR.h"
 #include "Lighting.h"
 
-#include <stb_image/stb_image.h>
+#include <chrono>
 
 static const double PI = 3.14159265359;
 
 static const uint32_t SCR_WIDTH = 1280, SCR_HEIGHT = 720;
 static const uint32_t SHADOW_WIDTH = 720, SHADOW_HEIGHT = 720;
 
-PBR::PBR()
-    : m_Camera(glm::perspectiveFov(glm::radians(45.0f), float(SCR_WIDTH), float(SCR_HEIGHT), 0.1f, 50000.0f))
-{
-    m_Camera.SetPitch(0.0f);
-    m_Camera.SetYaw(0.0f);
-    m_Camera.UpdateCamera();
-}
+static const uint32_t ENVIRONMENT_SIZE = 512;
+static const uint32_t IRRADIANCE_SIZE = 32;
+static const uint32_t PREFILTER_SIZE = 256;
+static const uint32_t PREFILTER_MIP_COUNT = 5;
 
-PBR::~PBR()
-{
-}
+// Octahedral maps are sized to roughly match the texel count of the cubemaps
+static const uint32_t OCTAHEDRAL_ENVIRONMENT_SIZE = 1024;
+static const uint32_t OCTAHEDRAL_IRRADIANCE_SIZE = 64;
+static const uint32_t OCTAHEDRAL_PREFILTER_SIZE = 512;
 
-static uint32_t LoadTexture(char const* path, bool hdr = false, bool gammaCorrection = false)
-{
-    unsigned int textureID;
-    glGenTextures(1, &textureID);
+static const float SPHERE_SPACING = 2.5f;
 
-    if (hdr)
-        stbi_set_flip_vertically_on_load(true);
+// Segments per sphere LOD and the projected diameter in pixels each LOD is used down to
+static const uint32_t SPHERE_LOD_SEGMENTS[] = { 64, 32, 16, 8 };
+static const float SPHERE_LOD_SIZES[] = { 320.0f, 160.0f, 64.0f };
+static const float SPHERE_LOD_HYSTERESIS = 0.15f;
 
-    int width, height, channels;
-    void* data;
-    if (hdr)
-        data = stbi_loadf(path, &width, &height, &channels, 0);
-    else
-        data = stbi_load(path, &width, &height, &channels, 0);
-    if (data)
+// Below this many per-draw spheres per thread, recording is not worth the thread start-up
+static const uint32_t MIN_RECORDED_DRAWS_PER_THREAD = 1024;
+
+// Behind the sphere grid
+static const glm::vec3 MODEL_POSITION = glm::vec3(0.0f, 0.0f, -2.0f * SPHERE_SPACING);
+
+// Projected diameter in pixels each imported model LOD is used down to
+static const float MODEL_LOD_SIZES[] = { 480.0f, 240.0f, 120.0f };
+
+// Render queue passes, executed in this order
+static const uint32_t PASS_FEEDBACK = 0;
+static const uint32_t PASS_OPAQUE = 1;
+static const uint32_t PASS_OVERLAY = 2;
+static const uint32_t PASS_SKY = 3;
+
+// Uniform block binding points, fixed in the shaders
+static const uint32_t FRAME_BLOCK_BINDING = 0;
+static const uint32_t MATERIAL_BLOCK_BINDING = 1;
+static const uint32_t OBJECT_BLOCK_BINDING = 2;
+
+using SphereVertexLayout = VertexLayout<SNorm16Position, OctahedralTangentFrame, UNorm16TexCoord>;
+
+// Appends the vertices of a UV sphere and returns its positions and a serpentine triangle strip,
+// both relative to its first vertex
+static void GenerateSphere(uint32_t xSegments, uint32_t ySegments, std::vector<uint8_t>& vertices, std::vector<glm::vec3>& positions,
+    std::vector<uint32_t>& indices)
+{
+    size_t firstVertex = vertices.size();
+    vertices.resize(firstVertex + (xSegments + 1) * (ySegments + 1) * SphereVertexLayout::Stride);
+    uint8_t* vertex = vertices.data() + firstVertex;
+    for (uint32_t y = 0; y <= ySegments; y++)
     {
-        GLenum internalFormat;
-        GLenum dataFormat;
-        if (channels == 1)
+        for (uint32_t x = 0; x <= xSegments; x++)
         {
-            internalFormat = dataFormat = GL_RED;
+            float xSegment = (float)x / (float)xSegments;
+            float ySegment = (float)y / (float)ySegments;
+
+            float xpos = (float)(cos(2.0 * PI * xSegment) * sin(PI * ySegment));
+            float ypos = (float)(cos(PI * ySegment));
+            float zpos = (float)(sin(2.0 * PI * xSegment) * sin(PI * ySegment));
+
+            glm::vec3 position(xpos, ypos, zpos);
+            positions.push_back(position);
+            glm::vec3 tangent(-(float)sin(2.0 * PI * xSegment), 0.0f, (float)cos(2.0 * PI * xSegment));
+            SphereVertexLayout::Write(vertex, position, { position, tangent, 1.0f }, glm::vec2(xSegment, ySegment));
+            vertex += SphereVertexLayout::Stride;
         }
-        else if (channels == 3)
+    }
+
+    indices.reserve(indices.size() + ySegments * (xSegments + 1) * 2);
+    bool oddRow = false;
+    for (uint32_t y = 0; y < ySegments; y++)
+    {
+        if (!oddRow)
         {
-            if (hdr)
-                internalFormat = GL_RGB16F;
-            else
-                internalFormat = gammaCorrection ? GL_SRGB : GL_RGB;
-            dataFormat = GL_RGB;
+            for (uint32_t x = 0; x <= xSegments; x++)
+            {
+                indices.push_back(y       * (xSegments + 1) + x);
+                indices.push_back((y + 1) * (xSegments + 1) + x);
+            }
         }
-        else if (channels == 4)
+        else
         {
-            if (hdr)
-                internalFormat = GL_RGBA16F;
-            else
-                internalFormat = gammaCorrection ? GL_SRGB_ALPHA : GL_RGBA;
-            dataFormat = GL_RGBA;
+            for (int x = xSegments; x >= 0; x--)
+            {
+                indices.push_back((y + 1) * (xSegments + 1) + x);
+                indices.push_back(y       * (xSegments + 1) + x);
+            }
         }
+        oddRow = !oddRow;
+    }
+}
 
-        glBindTexture(GL_TEXTURE_2D, textureID);
-        glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, width, height, 0, dataFormat, hdr ? GL_FLOAT : GL_UNSIGNED_BYTE, data);
-        if (!hdr)
-            glGenerateMipmap(GL_TEXTURE_2D);
-
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, hdr ? GL_LINEAR : GL_LINEAR_MIPMAP_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+static const glm::vec3 LIGHT_POSITIONS[] = {
+    glm::vec3(-10.0f,  10.0f, 10.0f),
+    glm::vec3(10.0f,  10.0f, 10.0f),
+    glm::vec3(-10.0f, -10.0f, 10.0f),
+    glm::vec3(10.0f, -10.0f, 10.0f),
+};
+static const glm::vec3 LIGHT_COLORS[] = {
+    glm::vec3(1000.0f, 1000.0f, 1000.0f),
+    glm::vec3(300.0f, 300.0f, 300.0f),
+    glm::vec3(300.0f, 300.0f, 300.0f),
+    glm::vec3(300.0f, 300.0f, 300.0f)
+};
 
-        stbi_image_free(data);
-    }
-    else
-    {
-        std::cout << "Texture failed to load at path: " << path << std::endl;
-        stbi_image_free(data);
-    }
+PBR::PBR()
+    : m_Camera(glm::perspectiveFov(glm::radians(45.0f), float(SCR_WIDTH), float(SCR_HEIGHT), 0.1f, 50000.0f))
+{
+    m_Camera.SetPitch(0.0f);
+    m_Camera.SetYaw(0.0f);
+    m_Camera.UpdateCamera();
+}
 
-    return textureID;
+PBR::~PBR()
+{
 }
 
 void PBR::OnAttach()
@@ -139,117 +182,137 @@ void PBR::OnAttach()
     glDepthFunc(GL_LEQUAL);
     glEnable(GL_TEXTURE_CUBE_MAP_SEAMLESS);
 
-    // Generate sphere
-    glCreateVertexArrays(1, &m_SphereVAO);
-    glBindVertexArray(m_SphereVAO);
-
-    static const uint32_t X_SEGMENTS = 64, Y_SEGMENTS = 64;
-
-    std::vector<glm::vec3> positions;
-    std::vector<glm::vec3> normals;
-    std::vector<glm::vec3> tangents;
-    std::vector<glm::vec2> uv;
-    for (uint32_t y = 0; y <= Y_SEGMENTS; y++)
-    {
-        for (uint32_t x = 0; x <= X_SEGMENTS; x++)
-        {
-            float xSegment = (float)x / (float)X_SEGMENTS;
-            float ySegment = (float)y / (float)Y_SEGMENTS;
-
-            float xpos = (float)(cos(2.0 * PI * xSegment) * sin(PI * ySegment));
-            float ypos = (float)(cos(PI * ySegment));
-            float zpos = (float)(sin(2.0 * PI * xSegment) * sin(PI * ySegment));
-
-            positions.emplace_back(xpos, ypos, zpos);
-            normals.emplace_back(xpos, ypos, zpos);
-            tangents.emplace_back(-(float)sin(2.0 * PI * xSegment), 0, (float)(cos(2.0 * PI * xSegment)));
-            uv.emplace_back(xSegment, ySegment);
-        }
-    }
+    // Edited sources are rebuilt in the background and swapped in, see OnUpdate for the bakes they rerun
+    m_ShaderWatcher = std::make_unique<ShaderWatcher>();
 
+    // Every program is issued here and only waited on at first use, so the compiles and links run
+    // on the driver's threads (or come from the program binary cache) while the meshes and textures load.
+    // The shading program is specialized per feature set, further variants are built when first selected.
+    m_PBRVariants = std::make_unique<ShaderVariantCache>("assets/shaders/pbr.vert.glsl", "assets/shaders/pbr.frag.glsl", m_ShaderWatcher.get());
+    m_PBRShader = m_PBRVariants->Get(GetPBRDefines());
+    m_FeedbackShader = Shader::FromGLSLTextFiles("assets/shaders/pbr.vert.glsl", "assets/shaders/vtFeedback.frag.glsl");
+    m_SkyboxShader = Shader::FromGLSLTextFiles("assets/shaders/skybox.vert.glsl", "assets/shaders/skybox.frag.glsl");
+    m_QuadShader = Shader::FromGLSLTextFiles("assets/shaders/quad.vert.glsl", "assets/shaders/quad.frag.glsl");
+    m_EquirectangularToCubemapShader = Shader::FromGLSLTextFiles("assets/shaders/cubemap.vert.glsl", "assets/shaders/equirectangularToCubemap.frag.glsl");
+    m_IrradianceShader = Shader::FromGLSLTextFiles("assets/shaders/cubemap.vert.glsl", "assets/shaders/irradiance.frag.glsl");
+    m_PrefilterShader = Shader::FromGLSLTextFiles("assets/shaders/cubemap.vert.glsl", "assets/shaders/prefilter.frag.glsl");
+    m_EquirectangularToOctahedralShader = Shader::FromGLSLTextFiles("assets/shaders/brdf.vert.glsl", "assets/shaders/equirectangularToOctahedral.frag.glsl");
+    m_IrradianceOctahedralShader = Shader::FromGLSLTextFiles("assets/shaders/brdf.vert.glsl", "assets/shaders/irradianceOctahedral.frag.glsl");
+    m_PrefilterOctahedralShader = Shader::FromGLSLTextFiles("assets/shaders/brdf.vert.glsl", "assets/shaders/prefilterOctahedral.frag.glsl");
+    m_OctahedralDownsampleShader = Shader::FromGLSLTextFiles("assets/shaders/brdf.vert.glsl", "assets/shaders/octahedralDownsample.frag.glsl");
+    m_SkyShader = Shader::FromGLSLTextFiles("assets/shaders/cubemap.vert.glsl", "assets/shaders/sky.frag.glsl");
+    m_BRDFIntegrationShader = Shader::FromGLSLTextFiles("assets/shaders/brdf.vert.glsl", "assets/shaders/brdf.frag.glsl");
+    // Issues the culling and depth pyramid compute programs with the rest
+    m_GPUCulling = std::make_unique<GPUCulling>(SCR_WIDTH, SCR_HEIGHT);
+
+    for (Shader* shader : { m_FeedbackShader, m_SkyboxShader, m_QuadShader, m_EquirectangularToCubemapShader,
+        m_IrradianceShader, m_PrefilterShader, m_EquirectangularToOctahedralShader, m_IrradianceOctahedralShader,
+        m_PrefilterOctahedralShader, m_OctahedralDownsampleShader, m_SkyShader, m_BRDFIntegrationShader })
+        m_ShaderWatcher->Watch(shader);
+
+    // Generate sphere LODs: snorm16 position, octahedral normal + tangent and unorm16 UV, 16 bytes per vertex.
+    // All levels share one vertex and index buffer and are drawn with a base vertex. Each level is stored
+    // both as the generated strip and as a cache, overdraw and fetch optimized triangle list.
+    std::vector<uint8_t> vertices;
     std::vector<uint32_t> indices;
-    bool oddRow = false;
-    for (uint32_t y = 0; y < Y_SEGMENTS; y++)
+    for (uint32_t segments : SPHERE_LOD_SEGMENTS)
     {
-        if (!oddRow)
-        {
-            for (uint32_t x = 0; x <= X_SEGMENTS; x++)
-            {
-                indices.push_back(y       * (X_SEGMENTS + 1) + x);
-                indices.push_back((y + 1) * (X_SEGMENTS + 1) + x);
-            }
-        }
-        else
-        {
-            for (int x = X_SEGMENTS; x >= 0; x--)
-            {
-                indices.push_back((y + 1) * (X_SEGMENTS + 1) + x);
-                indices.push_back(y       * (X_SEGMENTS + 1) + x);
-            }
-        }
-        oddRow = !oddRow;
-    }
-    m_SphereIndexCount = indices.size();
-
-    std::vector<float> data;
-    for (uint32_t i = 0; i < positions.size(); i++)
-    {
-        data.push_back(positions[i].x);
-        data.push_back(positions[i].y);
-        data.push_back(positions[i].z);
-
-        if (!normals.empty())
-        {
-            data.push_back(normals[i].x);
-            data.push_back(normals[i].y);
-            data.push_back(normals[i].z);
-        }
-
-        if (!tangents.empty())
-        {
-            data.push_back(tangents[i].x);
-            data.push_back(tangents[i].y);
-            data.push_back(tangents[i].z);
-        }
-
-        if (!uv.empty())
-        {
-            data.push_back(uv[i].x);
-            data.push_back(uv[i].y);
-        }
+        SphereLOD lod;
+        lod.BaseVertex = (int32_t)(vertices.size() / SphereVertexLayout::Stride);
+
+        std::vector<glm::vec3> positions;
+        std::vector<uint32_t> strip;
+        GenerateSphere(segments, segments, vertices, positions, strip);
+        lod.StripStats = AnalyzeVertexCache(ConvertStripToList(strip), positions.size());
+
+        std::vector<uint32_t> list = OptimizeVertexCache(ConvertStripToList(strip), positions.size());
+        list = OptimizeOverdraw(list, positions.data(), positions.size());
+        lod.ListStats = AnalyzeVertexCache(list, positions.size());
+
+        // Vertices in the order the list first uses them, the strip is remapped to match
+        std::vector<uint32_t> remap = GenerateVertexFetchRemap(list, positions.size());
+        RemapVertexBuffer(&vertices[lod.BaseVertex * SphereVertexLayout::Stride], positions.size(), SphereVertexLayout::Stride, remap);
+        RemapIndexBuffer(list, remap);
+        RemapIndexBuffer(strip, remap);
+
+        lod.StripFirstIndex = (uint32_t)indices.size();
+        lod.StripIndexCount = (uint32_t)strip.size();
+        indices.insert(indices.end(), strip.begin(), strip.end());
+        lod.ListFirstIndex = (uint32_t)indices.size();
+        lod.ListIndexCount = (uint32_t)list.size();
+        indices.insert(indices.end(), list.begin(), list.end());
+
+        lod.TriangleCount = lod.ListIndexCount / 3;
+        m_SphereLODs.push_back(lod);
     }
+    m_SphereLODCounts.resize(m_SphereLODs.size());
+    m_SphereLODMarkerCounts.resize(m_SphereLODs.size());
 
-    uint32_t sphereVBO;
-    glCreateBuffers(1, &sphereVBO);
-    glBindBuffer(GL_ARRAY_BUFFER, sphereVBO);
-    glNamedBufferData(sphereVBO, data.size() * sizeof(float), data.data(), GL_STATIC_DRAW);
-
-    float stride = (3 + 3 + 3 + 2) * sizeof(float);
-
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, stride, (void*)0);
-    glEnableVertexAttribArray(0);
-
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, stride, (void*)(3 * sizeof(float)));
-    glEnableVertexAttribArray(1);
-
-    glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, stride, (void*)(6 * sizeof(float)));
-    glEnableVertexAttribArray(2);
-
-    glVertexAttribPointer(3, 2, GL_FLOAT, GL_FALSE, stride, (void*)(9 * sizeof(float)));
-    glEnableVertexAttribArray(3);
+    glCreateBuffers(1, &m_SphereVBO);
+    glNamedBufferStorage(m_SphereVBO, vertices.size(), vertices.data(), 0);
 
     glCreateBuffers(1, &m_SphereIBO);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_SphereIBO);
-    glNamedBufferData(m_SphereIBO, indices.size() * sizeof(uint32_t), indices.data(), GL_STATIC_DRAW);
+    glNamedBufferStorage(m_SphereIBO, indices.size() * sizeof(uint32_t), indices.data(), 0);
 
-    m_SphereAlbedoMap = LoadTexture("assets/textures/pirate-gold-bl/pirate-gold_albedo.png");
-    m_SphereAOMap = LoadTexture("assets/textures/pirate-gold-bl/pirate-gold_ao.png");
-    m_SphereMetallicMap = LoadTexture("assets/textures/pirate-gold-bl/pirate-gold_metallic.png");
-    m_SphereNormalMap = LoadTexture("assets/textures/pirate-gold-bl/pirate-gold_normal-ogl.png");
-    m_SphereRoughnessMap = LoadTexture("assets/textures/pirate-gold-bl/pirate-gold_roughness.png");
-    m_SphereHeightMap = LoadTexture("assets/textures/pirate-gold-bl/pirate-gold_height.png");
+    // Per-instance index into the instance buffer, advanced by the draw's base instance
+    glCreateBuffers(1, &m_SphereLODBuffer);
 
-    m_PBRShader = Shader::FromGLSLTextFiles("assets/shaders/pbr.vert.glsl", "assets/shaders/pbr.frag.glsl");
+    glCreateVertexArrays(1, &m_SphereVAO);
+    SphereVertexLayout::Apply(m_SphereVAO, m_SphereVBO);
+    glVertexArrayElementBuffer(m_SphereVAO, m_SphereIBO);
+    glEnableVertexArrayAttrib(m_SphereVAO, SphereVertexLayout::AttributeCount);
+    glVertexArrayAttribIFormat(m_SphereVAO, SphereVertexLayout::AttributeCount, 1, GL_UNSIGNED_INT, 0);
+    glVertexArrayAttribBinding(m_SphereVAO, SphereVertexLayout::AttributeCount, 1);
+    glVertexArrayVertexBuffer(m_SphereVAO, 1, m_SphereLODBuffer, 0, sizeof(uint32_t));
+    glVertexArrayBindingDivisor(m_SphereVAO, 1, 1);
+
+    // Per-instance transforms and materials, rebuilt only when the grid changes
+    glCreateBuffers(1, &m_SphereInstanceBuffer);
+    m_SphereObjectBuffer = std::make_unique<UniformBufferArray<SphereInstance>>();
+    m_ModelObjectBuffer = std::make_unique<UniformBuffer<SphereInstance>>();
+
+    m_FrameBuffer = std::make_unique<UniformBuffer<FrameUniforms>>();
+    m_MaterialBuffer = std::make_unique<UniformBuffer<MaterialUniforms>>();
+
+    m_TextureRegistry = std::make_unique<TextureRegistry>();
+
+    // Models are imported on demand from the settings panel
+    m_MeshLoader = std::make_unique<MeshLoader>();
+
+    // Material maps stream in over the first frames, shading with flat placeholders until resident
+    m_TextureStreamer = std::make_unique<TextureStreamer>();
+
+    // Mip chains are filtered on the CPU and block compressed once, then cached next to each source
+    TextureSpecification specification;
+    specification.Compression = BlockFormat::BC7;
+    specification.Mips.Content = MipContent::SRGB;
+    m_SphereAlbedoMap = m_TextureStreamer->Load("assets/textures/pirate-gold-bl/pirate-gold_albedo.png", specification);
+
+    // Paged copy of the albedo, only the pages the feedback pass sees are kept in memory
+    VirtualTextureSpecification virtualSpecification;
+    virtualSpecification.Mips.Content = MipContent::SRGB;
+    m_VirtualAlbedo = std::make_unique<VirtualTexture>("assets/textures/pirate-gold-bl/pirate-gold_albedo.png", virtualSpecification);
+
+    specification.Compression = BlockFormat::BC5;
+    specification.Mips.Content = MipContent::Normal;
+    specification.Placeholder = 0xFFFF8080;
+    m_SphereNormalMap = m_TextureStreamer->Load("assets/textures/pirate-gold-bl/pirate-gold_normal-ogl.png", specification);
+
+    // Import step: AO / roughness / metallic / height packed into one RGBA map on a streamer worker,
+    // rebuilt when a source changes. The separate maps are only streamed if packing fails.
+    TextureSpecification materialSpecification;
+    materialSpecification.Placeholder = 0x000080FF;
+    materialSpecification.PackedChannels = {
+        { "assets/textures/pirate-gold-bl/pirate-gold_ao.png", 0, 255 },
+        { "assets/textures/pirate-gold-bl/pirate-gold_roughness.png", 0, 128 },
+        { "assets/textures/pirate-gold-bl/pirate-gold_metallic.png", 0, 0 },
+        { "assets/textures/pirate-gold-bl/pirate-gold_height.png", 0, 0 }
+    };
+    m_SphereMaterialMap = m_TextureStreamer->Load("assets/textures/pirate-gold-bl/pirate-gold_orm.tex", materialSpecification);
+
+    ValidateUniformBlock<FrameUniforms>(*m_PBRShader, "Frame");
+    ValidateUniformBlock<MaterialUniforms>(*m_PBRShader, "Material");
+    ValidateUniformBlock<SphereInstance>(*m_PBRShader, "Object");
 
     // Cube
     glCreateVertexArrays(1, &m_CubeVAO);
@@ -269,83 +332,7 @@ void PBR::OnAttach()
     glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(6 * sizeof(float)));
     glEnableVertexAttribArray(2);
 
-    m_SkyboxShader = Shader::FromGLSLTextFiles("assets/shaders/skybox.vert.glsl", "assets/shaders/skybox.frag.glsl");
-
-    // Equirectangular to Cubemap
-    glCreateFramebuffers(1, &m_EnvironmentFBO);
-    glBindFramebuffer(GL_FRAMEBUFFER, m_EnvironmentFBO);
-
-    glCreateTextures(GL_TEXTURE_CUBE_MAP, 1, &m_CubemapTexture);
-    glBindTexture(GL_TEXTURE_CUBE_MAP, m_CubemapTexture);
-    for (uint32_t i = 0; i < 6; i++)
-    {
-        glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, GL_RGB16F, 512, 512, 0, GL_RGB, GL_FLOAT, nullptr);
-        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0 + i, GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, m_CubemapTexture, 0);
-    }
-    glTextureParameteri(m_CubemapTexture, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-    glTextureParameteri(m_CubemapTexture, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    glTextureParameteri(m_CubemapTexture, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-    glTextureParameteri(m_CubemapTexture, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-    glTextureParameteri(m_CubemapTexture, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
-
-    glCreateRenderbuffers(1, &m_CubemapDepthRBO);
-    glBindRenderbuffer(GL_RENDERBUFFER, m_CubemapDepthRBO);
-    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, 512, 512);
-    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, m_CubemapDepthRBO);
-
-    GLCORE_ASSERT(glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE, "Framebuffer incomplete!");
-
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
-
-    m_EquirectangularToCubemapShader = Shader::FromGLSLTextFiles("assets/shaders/cubemap.vert.glsl", "assets/shaders/equirectangularToCubemap.frag.glsl");
-
-    uint32_t hdrTexture = LoadTexture("assets/textures/Newport_Loft/Newport_Loft_Ref.hdr", true);
-    EquirectangularToCubemap(hdrTexture);
-
-    glBindTexture(GL_TEXTURE_CUBE_MAP, m_CubemapTexture);
-    glGenerateMipmap(GL_TEXTURE_CUBE_MAP);
-
-    // Irradiance
-    glBindFramebuffer(GL_FRAMEBUFFER, m_EnvironmentFBO);
-    
-    glCreateTextures(GL_TEXTURE_CUBE_MAP, 1, &m_IrradianceTexture);
-    glBindTexture(GL_TEXTURE_CUBE_MAP, m_IrradianceTexture);
-    for (uint32_t i = 0; i < 6; i++)
-    {
-        glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, GL_RGB16F, 32, 32, 0, GL_RGB, GL_FLOAT, nullptr);
-        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0 + i, GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, m_IrradianceTexture, 0);
-    }
-    glTextureParameteri(m_IrradianceTexture, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTextureParameteri(m_IrradianceTexture, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    glTextureParameteri(m_IrradianceTexture, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-    glTextureParameteri(m_IrradianceTexture, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-    glTextureParameteri(m_IrradianceTexture, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
-
-    glBindRenderbuffer(GL_RENDERBUFFER, m_CubemapDepthRBO);
-    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, 32, 32);
-
-    m_IrradianceShader = Shader::FromGLSLTextFiles("assets/shaders/cubemap.vert.glsl", "assets/shaders/irradiance.frag.glsl");
-
-    GenerateIrradiance(m_CubemapTexture);
-
-    // Prefiltered Environment Map
-    glCreateTextures(GL_TEXTURE_CUBE_MAP, 1, &m_PrefilteredEnvMap);
-    glBindTexture(GL_TEXTURE_CUBE_MAP, m_PrefilteredEnvMap);
-    for (uint32_t i = 0; i < 6; i++)
-        glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, GL_RGB16F, 256, 256, 0, GL_RGB, GL_FLOAT, nullptr);
-
-    glTextureParameteri(m_PrefilteredEnvMap, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-    glTextureParameteri(m_PrefilteredEnvMap, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    glTextureParameteri(m_PrefilteredEnvMap, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-    glTextureParameteri(m_PrefilteredEnvMap, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-    glTextureParameteri(m_PrefilteredEnvMap, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
-    glGenerateMipmap(GL_TEXTURE_CUBE_MAP);
-
-    m_PrefilterShader = Shader::FromGLSLTextFiles("assets/shaders/cubemap.vert.glsl", "assets/shaders/prefilter.frag.glsl");
-
-    GeneratePrefilteredEnvMap(m_CubemapTexture);
-
-    // BRDF LUT
+    // Quad
     glCreateVertexArrays(1, &m_QuadVAO);
     glBindVertexArray(m_QuadVAO);
     
@@ -359,7 +346,31 @@ void PBR::OnAttach()
     
     glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)(2 * sizeof(float)));
     glEnableVertexAttribArray(1);
-    
+
+    // Environment
+    glCreateFramebuffers(1, &m_EnvironmentFBO);
+    glCreateRenderbuffers(1, &m_CubemapDepthRBO);
+    glNamedRenderbufferStorage(m_CubemapDepthRBO, GL_DEPTH_COMPONENT24, ENVIRONMENT_SIZE, ENVIRONMENT_SIZE);
+    glNamedFramebufferRenderbuffer(m_EnvironmentFBO, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, m_CubemapDepthRBO);
+
+    glCreateQueries(GL_TIME_ELAPSED, 2, m_ShadingTimeQueries);
+
+    TextureImportSettings hdrSettings;
+    hdrSettings.HDR = true;
+    hdrSettings.FlipVertically = true;
+    hdrSettings.Compression = BlockFormat::BC6H;
+    m_EquirectangularMap = m_TextureRegistry->Load("assets/textures/Newport_Loft/Newport_Loft_Ref.hdr", hdrSettings);
+    if (!m_EquirectangularMap)
+    {
+        // Bake from a black environment instead, so the IBL set exists and the procedural sky still works
+        float black[3] = { 0.0f, 0.0f, 0.0f };
+        glCreateTextures(GL_TEXTURE_2D, 1, &m_FallbackEnvironmentMap);
+        glTextureStorage2D(m_FallbackEnvironmentMap, 1, GL_RGB16F, 1, 1);
+        glTextureSubImage2D(m_FallbackEnvironmentMap, 0, 0, 0, 1, 1, GL_RGB, GL_FLOAT, black);
+    }
+    BakeEnvironment();
+
+    // BRDF LUT
     glCreateTextures(GL_TEXTURE_2D, 1, &m_BRDFLUT);
     glBindTexture(GL_TEXTURE_2D, m_BRDFLUT);
     glTextureStorage2D(m_BRDFLUT, 1, GL_RG16F, 512, 512);
@@ -368,17 +379,68 @@ void PBR::OnAttach()
     glTextureParameteri(m_BRDFLUT, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
     glTextureParameteri(m_BRDFLUT, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
 
-    m_BRDFIntegrationShader = Shader::FromGLSLTextFiles("assets/shaders/brdf.vert.glsl", "assets/shaders/brdf.frag.glsl");
-
     GenerateBRDFIntegration(m_CubemapTexture);
-
-    m_QuadShader = Shader::FromGLSLTextFiles("assets/shaders/quad.vert.glsl", "assets/shaders/quad.frag.glsl");
 }
 
 void PBR::OnDetach()
 {
-    glDeleteBuffers(1, &m_SphereVAO);
+    // Variants are watched, so they go after the watcher
+    m_ShaderWatcher.reset();
+    m_PBRVariants.reset();
+    m_PBRShader = nullptr;
+
+    glDeleteVertexArrays(1, &m_SphereVAO);
+    glDeleteBuffers(1, &m_SphereVBO);
     glDeleteBuffers(1, &m_SphereIBO);
+    glDeleteBuffers(1, &m_SphereInstanceBuffer);
+    glDeleteBuffers(1, &m_SphereLODBuffer);
+    m_SphereObjectBuffer.reset();
+    m_ModelObjectBuffer.reset();
+    m_FrameBuffer.reset();
+    m_MaterialBuffer.reset();
+    m_GPUCulling.reset();
+
+    m_EquirectangularMap.reset();
+    if (m_FallbackEnvironmentMap)
+        glDeleteTextures(1, &m_FallbackEnvironmentMap);
+    m_FinalTexture.reset();
+    m_TextureRegistry.reset();
+
+    m_SphereAlbedoMap.reset();
+    m_SphereAOMap.reset();
+    m_SphereMetallicMap.reset();
+    m_SphereNormalMap.reset();
+    m_SphereRoughnessMap.reset();
+    m_SphereHeightMap.reset();
+    m_SphereMaterialMap.reset();
+    m_TextureStreamer.reset();
+    m_VirtualAlbedo.reset();
+    m_Model.reset();
+    m_MeshLoader.reset();
+}
+
+void PBR::LoadSeparateMaterialMaps()
+{
+    TextureSpecification specification;
+    specification.Compression = BlockFormat::BC4;
+    specification.Mips.Content = MipContent::Linear;
+    specification.Placeholder = 0xFFFFFFFF;
+    m_SphereAOMap = m_TextureStreamer->Load("assets/textures/pirate-gold-bl/pirate-gold_ao.png", specification);
+    specification.Placeholder = 0xFF000000;
+    m_SphereMetallicMap = m_TextureStreamer->Load("assets/textures/pirate-gold-bl/pirate-gold_metallic.png", specification);
+    m_SphereHeightMap = m_TextureStreamer->Load("assets/textures/pirate-gold-bl/pirate-gold_height.png", specification);
+    specification.Placeholder = 0xFF808080;
+    m_SphereRoughnessMap = m_TextureStreamer->Load("assets/textures/pirate-gold-bl/pirate-gold_roughness.png", specification);
+}
+
+ShaderDefines PBR::GetPBRDefines() const
+{
+    return {
+        { "TEXTURED", m_Textured ? "1" : "0" },
+        { "IBL", m_IBL ? "1" : "0" },
+        { "LIGHT_COUNT", std::to_string(m_LightCount) },
+        { "PARALLAX", m_Parallax ? "1" : "0" }
+    };
 }
 
 void PBR::OnEvent(GLCore::Event& e)
@@ -386,37 +448,288 @@ void PBR::OnEvent(GLCore::Event& e)
     m_Camera.OnEvent(e);
 }
 
-void PBR::EquirectangularToCubemap(uint32_t equirectangularMap)
+static uint32_t CreateEnvironmentTexture(GLenum target, uint32_t size, uint32_t mipCount, GLenum internalFormat)
+{
+    uint32_t texture;
+    glCreateTextures(target, 1, &texture);
+    glTextureStorage2D(texture, mipCount, internalFormat, size, size);
+    glTextureParameteri(texture, GL_TEXTURE_MIN_FILTER, mipCount > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+    glTextureParameteri(texture, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTextureParameteri(texture, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTextureParameteri(texture, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTextureParameteri(texture, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+    return texture;
+}
+
+static uint64_t EnvironmentSetSize(GLenum format, uint32_t environmentSize, uint32_t irradianceSize, uint32_t prefilterSize, uint32_t layers)
+{
+    return CalculateTextureSize(format, environmentSize, environmentSize, CalculateMipCount(environmentSize, environmentSize), layers)
+        + CalculateTextureSize(format, irradianceSize, irradianceSize, 1, layers)
+        + CalculateTextureSize(format, prefilterSize, prefilterSize, PREFILTER_MIP_COUNT, layers);
+}
+
+uint32_t PBR::GetEnvironmentSource() const
 {
-    static glm::mat4 viewMatrices[] =
+    return m_EquirectangularMap ? m_EquirectangularMap->GetRendererID() : m_FallbackEnvironmentMap;
+}
+
+void PBR::BakeEnvironment()
+{
+    BakeCubemapEnvironment();
+    BakeOctahedralEnvironment();
+
+    // Error budget of the storage format, measured over the source radiance
+    uint32_t equirectangularMap = GetEnvironmentSource();
+    int width, height;
+    glGetTextureLevelParameteriv(equirectangularMap, 0, GL_TEXTURE_WIDTH, &width);
+    glGetTextureLevelParameteriv(equirectangularMap, 0, GL_TEXTURE_HEIGHT, &height);
+
+    std::vector<float> source((size_t)width * height * 3);
+    glGetTextureImage(equirectangularMap, 0, GL_RGB, GL_FLOAT, (GLsizei)(source.size() * sizeof(float)), source.data());
+    m_EnvironmentError = MeasurePackingError(m_EnvironmentFormat, source.data(), (size_t)width * height);
+
+    for (uint32_t i = 0; i < 2; i++)
     {
-        glm::lookAt(glm::vec3(0.0f), glm::vec3( 1.0f,  0.0f,  0.0f), glm::vec3(0.0f, -1.0f,  0.0f)),
-        glm::lookAt(glm::vec3(0.0f), glm::vec3(-1.0f,  0.0f,  0.0f), glm::vec3(0.0f, -1.0f,  0.0f)),
-        glm::lookAt(glm::vec3(0.0f), glm::vec3( 0.0f,  1.0f,  0.0f), glm::vec3(0.0f, 0.0f,  1.0f)),
-        glm::lookAt(glm::vec3(0.0f), glm::vec3( 0.0f, -1.0f,  0.0f), glm::vec3(0.0f, 0.0f, -1.0f)),
-        glm::lookAt(glm::vec3(0.0f), glm::vec3( 0.0f,  0.0f,  1.0f), glm::vec3(0.0f, -1.0f,  0.0f)),
-        glm::lookAt(glm::vec3(0.0f), glm::vec3( 0.0f,  0.0f, -1.0f), glm::vec3(0.0f, -1.0f,  0.0f))
-    };
+        const EnvironmentStats& stats = m_EnvironmentStats[i];
+        LOG_INFO("{0} environment baked as {1}: {2} draws, {3:.2f} ms, {4:.2f} MB (RGB16F: {5:.2f} MB)",
+            i == (uint32_t)EnvironmentEncoding::Cubemap ? "Cubemap" : "Octahedral", GetFormatName(m_EnvironmentFormat),
+            stats.DrawCount, stats.BakeTime, stats.Memory / (1024.0 * 1024.0), stats.MemoryRGB16F / (1024.0 * 1024.0));
+    }
+    LOG_INFO("Environment packing error: {0:.3f}% max, {1:.4f}% mean", m_EnvironmentError.MaxRelative * 100.0f, m_EnvironmentError.MeanRelative * 100.0f);
+}
+
+void PBR::BakeCubemapEnvironment()
+{
+    if (m_CubemapTexture)
+    {
+        glDeleteTextures(1, &m_CubemapTexture);
+        glDeleteTextures(1, &m_IrradianceTexture);
+        glDeleteTextures(1, &m_PrefilteredEnvMap);
+    }
+
+    uint32_t query;
+    glCreateQueries(GL_TIME_ELAPSED, 1, &query);
+    glBeginQuery(GL_TIME_ELAPSED, query);
+
+    // Shared-exponent formats are not renderable, so the bakes go to an RGBA16F
+    // scratch cubemap which is then packed into the final storage
+    bool packed = !IsColorRenderable(m_EnvironmentFormat);
+    GLenum renderFormat = packed ? GL_RGBA16F : m_EnvironmentFormat;
+
+    uint32_t environmentMipCount = CalculateMipCount(ENVIRONMENT_SIZE, ENVIRONMENT_SIZE);
+    m_CubemapTexture = CreateEnvironmentTexture(GL_TEXTURE_CUBE_MAP, ENVIRONMENT_SIZE, environmentMipCount, m_EnvironmentFormat);
+    m_IrradianceTexture = CreateEnvironmentTexture(GL_TEXTURE_CUBE_MAP, IRRADIANCE_SIZE, 1, m_EnvironmentFormat);
+    m_PrefilteredEnvMap = CreateEnvironmentTexture(GL_TEXTURE_CUBE_MAP, PREFILTER_SIZE, PREFILTER_MIP_COUNT, m_EnvironmentFormat);
+
+    uint32_t environment = packed ? CreateEnvironmentTexture(GL_TEXTURE_CUBE_MAP, ENVIRONMENT_SIZE, environmentMipCount, renderFormat) : m_CubemapTexture;
+    uint32_t irradiance = packed ? CreateEnvironmentTexture(GL_TEXTURE_CUBE_MAP, IRRADIANCE_SIZE, 1, renderFormat) : m_IrradianceTexture;
+    uint32_t prefiltered = packed ? CreateEnvironmentTexture(GL_TEXTURE_CUBE_MAP, PREFILTER_SIZE, PREFILTER_MIP_COUNT, renderFormat) : m_PrefilteredEnvMap;
+
+    EquirectangularToCubemap(GetEnvironmentSource(), environment);
+    glGenerateTextureMipmap(environment);
+
+    GenerateIrradiance(environment, irradiance);
+    GeneratePrefilteredEnvMap(environment, prefiltered);
+
+    if (packed)
+    {
+        PackTexture(environment, m_CubemapTexture, ENVIRONMENT_SIZE, environmentMipCount, 6);
+        PackTexture(irradiance, m_IrradianceTexture, IRRADIANCE_SIZE, 1, 6);
+        PackTexture(prefiltered, m_PrefilteredEnvMap, PREFILTER_SIZE, PREFILTER_MIP_COUNT, 6);
+
+        glDeleteTextures(1, &environment);
+        glDeleteTextures(1, &irradiance);
+        glDeleteTextures(1, &prefiltered);
+    }
+
+    glEndQuery(GL_TIME_ELAPSED);
+    uint64_t elapsed;
+    glGetQueryObjectui64v(query, GL_QUERY_RESULT, &elapsed);
+    glDeleteQueries(1, &query);
+
+    EnvironmentStats& stats = m_EnvironmentStats[(uint32_t)EnvironmentEncoding::Cubemap];
+    stats.BakeTime = elapsed / 1000000.0f;
+    stats.DrawCount = 6 + 6 + 6 * PREFILTER_MIP_COUNT;
+    stats.Memory = EnvironmentSetSize(m_EnvironmentFormat, ENVIRONMENT_SIZE, IRRADIANCE_SIZE, PREFILTER_SIZE, 6);
+    stats.MemoryRGB16F = EnvironmentSetSize(GL_RGB16F, ENVIRONMENT_SIZE, IRRADIANCE_SIZE, PREFILTER_SIZE, 6);
+}
+
+void PBR::BakeOctahedralEnvironment()
+{
+    if (m_OctahedralEnvironmentMap)
+    {
+        glDeleteTextures(1, &m_OctahedralEnvironmentMap);
+        glDeleteTextures(1, &m_OctahedralIrradianceMap);
+        glDeleteTextures(1, &m_OctahedralPrefilteredMap);
+    }
+
+    uint32_t query;
+    glCreateQueries(GL_TIME_ELAPSED, 1, &query);
+    glBeginQuery(GL_TIME_ELAPSED, query);
+
+    bool packed = !IsColorRenderable(m_EnvironmentFormat);
+    GLenum renderFormat = packed ? GL_RGBA16F : m_EnvironmentFormat;
+
+    uint32_t environmentMipCount = CalculateMipCount(OCTAHEDRAL_ENVIRONMENT_SIZE, OCTAHEDRAL_ENVIRONMENT_SIZE);
+    m_OctahedralEnvironmentMap = CreateEnvironmentTexture(GL_TEXTURE_2D, OCTAHEDRAL_ENVIRONMENT_SIZE, environmentMipCount, m_EnvironmentFormat);
+    m_OctahedralIrradianceMap = CreateEnvironmentTexture(GL_TEXTURE_2D, OCTAHEDRAL_IRRADIANCE_SIZE, 1, m_EnvironmentFormat);
+    m_OctahedralPrefilteredMap = CreateEnvironmentTexture(GL_TEXTURE_2D, OCTAHEDRAL_PREFILTER_SIZE, PREFILTER_MIP_COUNT, m_EnvironmentFormat);
+
+    uint32_t environment = packed ? CreateEnvironmentTexture(GL_TEXTURE_2D, OCTAHEDRAL_ENVIRONMENT_SIZE, environmentMipCount, renderFormat) : m_OctahedralEnvironmentMap;
+    uint32_t irradiance = packed ? CreateEnvironmentTexture(GL_TEXTURE_2D, OCTAHEDRAL_IRRADIANCE_SIZE, 1, renderFormat) : m_OctahedralIrradianceMap;
+    uint32_t prefiltered = packed ? CreateEnvironmentTexture(GL_TEXTURE_2D, OCTAHEDRAL_PREFILTER_SIZE, PREFILTER_MIP_COUNT, renderFormat) : m_OctahedralPrefilteredMap;
 
     glBindFramebuffer(GL_FRAMEBUFFER, m_EnvironmentFBO);
-    glViewport(0, 0, 512, 512);
+    glDrawBuffer(GL_COLOR_ATTACHMENT0);
+    glNamedFramebufferRenderbuffer(m_EnvironmentFBO, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, 0);
+    glBindVertexArray(m_QuadVAO);
+
+    // Every bake is a single full-screen pass over the 2D map
+    // Every level is texel centred (see octahedral.glsl), so each pass is told the size it renders
+    Shader* shader = m_EquirectangularToOctahedralShader;
+    glUseProgram(shader->GetRendererID());
+    glBindTextureUnit(0, GetEnvironmentSource());
+    shader->SetInt("u_EquirectangularMap", 0);
+    shader->SetFloat("u_Size", (float)OCTAHEDRAL_ENVIRONMENT_SIZE);
+
+    glNamedFramebufferTexture(m_EnvironmentFBO, GL_COLOR_ATTACHMENT0, environment, 0);
+    glViewport(0, 0, OCTAHEDRAL_ENVIRONMENT_SIZE, OCTAHEDRAL_ENVIRONMENT_SIZE);
+    glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+    GenerateOctahedralMips(environment, OCTAHEDRAL_ENVIRONMENT_SIZE, environmentMipCount);
+
+    shader = m_IrradianceOctahedralShader;
+    glUseProgram(shader->GetRendererID());
+    glBindTextureUnit(0, environment);
+    shader->SetInt("u_Environment", 0);
+    shader->SetFloat("u_Size", (float)OCTAHEDRAL_IRRADIANCE_SIZE);
+
+    glNamedFramebufferTexture(m_EnvironmentFBO, GL_COLOR_ATTACHMENT0, irradiance, 0);
+    glViewport(0, 0, OCTAHEDRAL_IRRADIANCE_SIZE, OCTAHEDRAL_IRRADIANCE_SIZE);
+    glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
 
-    uint32_t shader = m_EquirectangularToCubemapShader->GetRendererID();
-    glUseProgram(shader);
+    shader = m_PrefilterOctahedralShader;
+    glUseProgram(shader->GetRendererID());
+    shader->SetInt("u_EnvironmentMap", 0);
+    shader->SetFloat("u_Resolution", (float)OCTAHEDRAL_ENVIRONMENT_SIZE);
+
+    for (uint32_t mip = 0; mip < PREFILTER_MIP_COUNT; mip++)
+    {
+        uint32_t mipSize = OCTAHEDRAL_PREFILTER_SIZE >> mip;
+
+        float roughness = (float)mip / (float)(PREFILTER_MIP_COUNT - 1);
+        shader->SetFloat("u_Roughness", roughness);
+        shader->SetFloat("u_Size", (float)mipSize);
+
+        glNamedFramebufferTexture(m_EnvironmentFBO, GL_COLOR_ATTACHMENT0, prefiltered, mip);
+        glViewport(0, 0, mipSize, mipSize);
+        glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+    }
+
+    glNamedFramebufferRenderbuffer(m_EnvironmentFBO, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, m_CubemapDepthRBO);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glViewport(0, 0, SCR_WIDTH, SCR_HEIGHT);
+
+    if (packed)
+    {
+        PackTexture(environment, m_OctahedralEnvironmentMap, OCTAHEDRAL_ENVIRONMENT_SIZE, environmentMipCount, 1);
+        PackTexture(irradiance, m_OctahedralIrradianceMap, OCTAHEDRAL_IRRADIANCE_SIZE, 1, 1);
+        PackTexture(prefiltered, m_OctahedralPrefilteredMap, OCTAHEDRAL_PREFILTER_SIZE, PREFILTER_MIP_COUNT, 1);
+
+        glDeleteTextures(1, &environment);
+        glDeleteTextures(1, &irradiance);
+        glDeleteTextures(1, &prefiltered);
+    }
+
+    glEndQuery(GL_TIME_ELAPSED);
+    uint64_t elapsed;
+    glGetQueryObjectui64v(query, GL_QUERY_RESULT, &elapsed);
+    glDeleteQueries(1, &query);
+
+    EnvironmentStats& stats = m_EnvironmentStats[(uint32_t)EnvironmentEncoding::Octahedral];
+    stats.BakeTime = elapsed / 1000000.0f;
+    stats.DrawCount = environmentMipCount + 1 + PREFILTER_MIP_COUNT;
+    stats.Memory = EnvironmentSetSize(m_EnvironmentFormat, OCTAHEDRAL_ENVIRONMENT_SIZE, OCTAHEDRAL_IRRADIANCE_SIZE, OCTAHEDRAL_PREFILTER_SIZE, 1);
+    stats.MemoryRGB16F = EnvironmentSetSize(GL_RGB16F, OCTAHEDRAL_ENVIRONMENT_SIZE, OCTAHEDRAL_IRRADIANCE_SIZE, OCTAHEDRAL_PREFILTER_SIZE, 1);
+}
+
+void PBR::GenerateOctahedralMips(uint32_t texture, uint32_t size, uint32_t mipCount)
+{
+    // Replaces glGenerateTextureMipmap, whose box filter clamps at the edges instead of following
+    // the folds. Each level reads only the one above it, the texture's level range is narrowed to
+    // that level so the attached level is not sampled.
+    Shader* shader = m_OctahedralDownsampleShader;
+    glUseProgram(shader->GetRendererID());
+    glBindTextureUnit(0, texture);
+    shader->SetInt("u_Source", 0);
+
+    for (uint32_t mip = 1; mip < mipCount; mip++)
+    {
+        uint32_t mipSize = std::max(size >> mip, 1u);
+        glTextureParameteri(texture, GL_TEXTURE_BASE_LEVEL, mip - 1);
+        glTextureParameteri(texture, GL_TEXTURE_MAX_LEVEL, mip - 1);
+        shader->SetFloat("u_Size", (float)mipSize);
+
+        glNamedFramebufferTexture(m_EnvironmentFBO, GL_COLOR_ATTACHMENT0, texture, mip);
+        glViewport(0, 0, mipSize, mipSize);
+        glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+    }
+
+    glTextureParameteri(texture, GL_TEXTURE_BASE_LEVEL, 0);
+    glTextureParameteri(texture, GL_TEXTURE_MAX_LEVEL, mipCount - 1);
+}
+
+void PBR::PackTexture(uint32_t source, uint32_t destination, uint32_t size, uint32_t mipCount, uint32_t layers)
+{
+    // The driver converts the float texels to the packed destination format on upload
+    std::vector<float> pixels;
+    for (uint32_t mip = 0; mip < mipCount; mip++)
+    {
+        uint32_t mipSize = std::max(size >> mip, 1u);
+        pixels.resize((size_t)mipSize * mipSize * layers * 3);
+
+        glGetTextureImage(source, mip, GL_RGB, GL_FLOAT, (GLsizei)(pixels.size() * sizeof(float)), pixels.data());
+        if (layers > 1)
+            glTextureSubImage3D(destination, mip, 0, 0, 0, mipSize, mipSize, layers, GL_RGB, GL_FLOAT, pixels.data());
+        else
+            glTextureSubImage2D(destination, mip, 0, 0, mipSize, mipSize, GL_RGB, GL_FLOAT, pixels.data());
+    }
+}
+
+// View matrices for the six cubemap faces, looking out from the origin
+static const glm::mat4 s_CubemapViewMatrices[] =
+{
+    glm::lookAt(glm::vec3(0.0f), glm::vec3( 1.0f,  0.0f,  0.0f), glm::vec3(0.0f, -1.0f,  0.0f)),
+    glm::lookAt(glm::vec3(0.0f), glm::vec3(-1.0f,  0.0f,  0.0f), glm::vec3(0.0f, -1.0f,  0.0f)),
+    glm::lookAt(glm::vec3(0.0f), glm::vec3( 0.0f,  1.0f,  0.0f), glm::vec3(0.0f, 0.0f,  1.0f)),
+    glm::lookAt(glm::vec3(0.0f), glm::vec3( 0.0f, -1.0f,  0.0f), glm::vec3(0.0f, 0.0f, -1.0f)),
+    glm::lookAt(glm::vec3(0.0f), glm::vec3( 0.0f,  0.0f,  1.0f), glm::vec3(0.0f, -1.0f,  0.0f)),
+    glm::lookAt(glm::vec3(0.0f), glm::vec3( 0.0f,  0.0f, -1.0f), glm::vec3(0.0f, -1.0f,  0.0f))
+};
+
+void PBR::EquirectangularToCubemap(uint32_t equirectangularMap, uint32_t target)
+{
+    glBindFramebuffer(GL_FRAMEBUFFER, m_EnvironmentFBO);
+    glDrawBuffer(GL_COLOR_ATTACHMENT0);
+
+    glNamedRenderbufferStorage(m_CubemapDepthRBO, GL_DEPTH_COMPONENT24, ENVIRONMENT_SIZE, ENVIRONMENT_SIZE);
+    glViewport(0, 0, ENVIRONMENT_SIZE, ENVIRONMENT_SIZE);
+
+    Shader* shader = m_EquirectangularToCubemapShader;
+    glUseProgram(shader->GetRendererID());
 
     glm::mat4 projection = glm::perspective(glm::radians(90.0f), 1.0f, 0.1f, 10.0f);
-    glUniformMatrix4fv(glGetUniformLocation(shader, "u_Projection"), 1, GL_FALSE, glm::value_ptr(projection));
+    shader->SetMat4("u_Projection", projection);
 
     glBindTextureUnit(0, equirectangularMap);
-    glUniform1i(glGetUniformLocation(shader, "u_EquirectangularMap"), 0);
+    shader->SetInt("u_EquirectangularMap", 0);
 
     glBindVertexArray(m_CubeVAO);
 
     for (uint32_t i = 0; i < 6; i++)
     {
-        glUniformMatrix4fv(glGetUniformLocation(shader, "u_View"), 1, GL_FALSE, glm::value_ptr(viewMatrices[i]));
+        shader->SetMat4("u_View", s_CubemapViewMatrices[i]);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, target, 0);
 
-        glDrawBuffer(GL_COLOR_ATTACHMENT0 + i);
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
         glDrawArrays(GL_TRIANGLES, 0, 36);
     }
@@ -432,14 +745,13 @@ void PBR::GenerateBRDFIntegration(uint32_t environment)
     glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, m_BRDFLUT, 0);
     glDrawBuffer(GL_COLOR_ATTACHMENT0);
 
-    glBindRenderbuffer(GL_RENDERBUFFER, m_CubemapDepthRBO);
-    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, 512, 512);
+    glNamedRenderbufferStorage(m_CubemapDepthRBO, GL_DEPTH_COMPONENT24, 512, 512);
 
     glViewport(0, 0, 512, 512);
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-    uint32_t shader = m_BRDFIntegrationShader->GetRendererID();
-    glUseProgram(shader);
+    Shader* shader = m_BRDFIntegrationShader;
+    glUseProgram(shader->GetRendererID());
 
     glBindVertexArray(m_QuadVAO);
     glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
@@ -448,37 +760,30 @@ void PBR::GenerateBRDFIntegration(uint32_t environment)
     glViewport(0, 0, SCR_WIDTH, SCR_HEIGHT);
 }
 
-void PBR::GenerateIrradiance(uint32_t environment)
+void PBR::GenerateIrradiance(uint32_t environment, uint32_t target)
 {
-    static glm::mat4 viewMatrices[] =
-    {
-        glm::lookAt(glm::vec3(0.0f), glm::vec3(1.0f,  0.0f,  0.0f), glm::vec3(0.0f, -1.0f,  0.0f)),
-        glm::lookAt(glm::vec3(0.0f), glm::vec3(-1.0f,  0.0f,  0.0f), glm::vec3(0.0f, -1.0f,  0.0f)),
-        glm::lookAt(glm::vec3(0.0f), glm::vec3(0.0f,  1.0f,  0.0f), glm::vec3(0.0f, 0.0f,  1.0f)),
-        glm::lookAt(glm::vec3(0.0f), glm::vec3(0.0f, -1.0f,  0.0f), glm::vec3(0.0f, 0.0f, -1.0f)),
-        glm::lookAt(glm::vec3(0.0f), glm::vec3(0.0f,  0.0f,  1.0f), glm::vec3(0.0f, -1.0f,  0.0f)),
-        glm::lookAt(glm::vec3(0.0f), glm::vec3(0.0f,  0.0f, -1.0f), glm::vec3(0.0f, -1.0f,  0.0f))
-    };
-
     glBindFramebuffer(GL_FRAMEBUFFER, m_EnvironmentFBO);
-    glViewport(0, 0, 32, 32);
+    glDrawBuffer(GL_COLOR_ATTACHMENT0);
+
+    glNamedRenderbufferStorage(m_CubemapDepthRBO, GL_DEPTH_COMPONENT24, IRRADIANCE_SIZE, IRRADIANCE_SIZE);
+    glViewport(0, 0, IRRADIANCE_SIZE, IRRADIANCE_SIZE);
 
-    uint32_t shader = m_IrradianceShader->GetRendererID();
-    glUseProgram(shader);
+    Shader* shader = m_IrradianceShader;
+    glUseProgram(shader->GetRendererID());
 
     glm::mat4 projection = glm::perspective(glm::radians(90.0f), 1.0f, 0.1f, 10.0f);
-    glUniformMatrix4fv(glGetUniformLocation(shader, "u_Projection"), 1, GL_FALSE, glm::value_ptr(projection));
+    shader->SetMat4("u_Projection", projection);
 
     glBindTextureUnit(0, environment);
-    glUniform1i(glGetUniformLocation(shader, "u_Environment"), 0);
+    shader->SetInt("u_Environment", 0);
 
     glBindVertexArray(m_CubeVAO);
 
     for (uint32_t i = 0; i < 6; i++)
     {
-        glUniformMatrix4fv(glGetUniformLocation(shader, "u_View"), 1, GL_FALSE, glm::value_ptr(viewMatrices[i]));
+        shader->SetMat4("u_View", s_CubemapViewMatrices[i]);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, target, 0);
 
-        glDrawBuffer(GL_COLOR_ATTACHMENT0 + i);
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
         glDrawArrays(GL_TRIANGLES, 0, 36);
     }
@@ -487,204 +792,692 @@ void PBR::GenerateIrradiance(uint32_t environment)
     glViewport(0, 0, SCR_WIDTH, SCR_HEIGHT);
 }
 
-void PBR::GeneratePrefilteredEnvMap(uint32_t environment)
+void PBR::GeneratePrefilteredEnvMap(uint32_t environment, uint32_t target, uint32_t mipMask)
 {
-    static glm::mat4 viewMatrices[] =
-    {
-        glm::lookAt(glm::vec3(0.0f), glm::vec3(1.0f,  0.0f,  0.0f), glm::vec3(0.0f, -1.0f,  0.0f)),
-        glm::lookAt(glm::vec3(0.0f), glm::vec3(-1.0f,  0.0f,  0.0f), glm::vec3(0.0f, -1.0f,  0.0f)),
-        glm::lookAt(glm::vec3(0.0f), glm::vec3(0.0f,  1.0f,  0.0f), glm::vec3(0.0f, 0.0f,  1.0f)),
-        glm::lookAt(glm::vec3(0.0f), glm::vec3(0.0f, -1.0f,  0.0f), glm::vec3(0.0f, 0.0f, -1.0f)),
-        glm::lookAt(glm::vec3(0.0f), glm::vec3(0.0f,  0.0f,  1.0f), glm::vec3(0.0f, -1.0f,  0.0f)),
-        glm::lookAt(glm::vec3(0.0f), glm::vec3(0.0f,  0.0f, -1.0f), glm::vec3(0.0f, -1.0f,  0.0f))
-    };
-
-    static const uint32_t MAX_MIP_COUNT = 5;
-
+    // A cube seen from its centre has no overlapping faces, so the faces are
+    // rendered without depth instead of resizing the depth buffer for every mip
     glBindFramebuffer(GL_FRAMEBUFFER, m_EnvironmentFBO);
+    glNamedFramebufferRenderbuffer(m_EnvironmentFBO, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, 0);
     glDrawBuffer(GL_COLOR_ATTACHMENT0);
-    glViewport(0, 0, 256, 256);
 
-    uint32_t shader = m_PrefilterShader->GetRendererID();
-    glUseProgram(shader);
+    Shader* shader = m_PrefilterShader;
+    glUseProgram(shader->GetRendererID());
 
     glm::mat4 projection = glm::perspective(glm::radians(90.0f), 1.0f, 0.1f, 10.0f);
-    glUniformMatrix4fv(glGetUniformLocation(shader, "u_Projection"), 1, GL_FALSE, glm::value_ptr(projection));
+    shader->SetMat4("u_Projection", projection);
 
     glBindTextureUnit(0, environment);
-    glUniform1i(glGetUniformLocation(shader, "u_EnvironmentMap"), 0);
+    shader->SetInt("u_EnvironmentMap", 0);
 
     glBindVertexArray(m_CubeVAO);
 
-    for (uint32_t mip = 0; mip < MAX_MIP_COUNT; mip++)
+    for (uint32_t mip = 0; mip < PREFILTER_MIP_COUNT; mip++)
     {
-        uint32_t mipWidth  = 256 * pow(0.5, mip);
-        uint32_t mipHeight = 256 * pow(0.5, mip);
-    
-        glBindRenderbuffer(GL_RENDERBUFFER, m_CubemapDepthRBO);
-        glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, mipWidth, mipHeight);
-        glViewport(0, 0, mipWidth, mipHeight);
-    
-        float roughness = (float)mip / (float)(MAX_MIP_COUNT - 1);
-        glUniform1f(glGetUniformLocation(shader, "u_Roughness"), roughness);
+        if (!(mipMask & BIT(mip)))
+            continue;
+
+        uint32_t mipSize = PREFILTER_SIZE >> mip;
+        glViewport(0, 0, mipSize, mipSize);
+
+        float roughness = (float)mip / (float)(PREFILTER_MIP_COUNT - 1);
+        shader->SetFloat("u_Roughness", roughness);
         for (uint32_t i = 0; i < 6; i++)
         {
-            glUniformMatrix4fv(glGetUniformLocation(shader, "u_View"), 1, GL_FALSE, glm::value_ptr(viewMatrices[i]));
-            glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, m_PrefilteredEnvMap, mip);
+            shader->SetMat4("u_View", s_CubemapViewMatrices[i]);
+            glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, target, mip);
 
-            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+            glClear(GL_COLOR_BUFFER_BIT);
             glDrawArrays(GL_TRIANGLES, 0, 36);
         }
     }
 
+    glNamedFramebufferRenderbuffer(m_EnvironmentFBO, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, m_CubemapDepthRBO);
     glBindFramebuffer(GL_FRAMEBUFFER, 0);
     glViewport(0, 0, SCR_WIDTH, SCR_HEIGHT);
 }
 
-void PBR::OnUpdate(GLCore::Timestep ts)
+void PBR::RenderSky()
 {
-    static glm::vec3 lightPositions[] = {
-        glm::vec3(-10.0f,  10.0f, 10.0f),
-        glm::vec3(10.0f,  10.0f, 10.0f),
-        glm::vec3(-10.0f, -10.0f, 10.0f),
-        glm::vec3(10.0f, -10.0f, 10.0f),
-    };
-    static glm::vec3 lightColors[] = {
-        glm::vec3(1000.0f, 1000.0f, 1000.0f),
-        glm::vec3(300.0f, 300.0f, 300.0f),
-        glm::vec3(300.0f, 300.0f, 300.0f),
-        glm::vec3(300.0f, 300.0f, 300.0f)
-    };
+    glBindFramebuffer(GL_FRAMEBUFFER, m_EnvironmentFBO);
+    glNamedFramebufferRenderbuffer(m_EnvironmentFBO, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, 0);
+    glDrawBuffer(GL_COLOR_ATTACHMENT0);
+    glViewport(0, 0, ENVIRONMENT_SIZE, ENVIRONMENT_SIZE);
 
-    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    Shader* shader = m_SkyShader;
+    glUseProgram(shader->GetRendererID());
 
-    glm::mat4 viewProj = m_Camera.GetViewProjection();
-    glm::vec3 viewPos = m_Camera.GetPosition();
+    glm::mat4 projection = glm::perspective(glm::radians(90.0f), 1.0f, 0.1f, 10.0f);
+    shader->SetMat4("u_Projection", projection);
+
+    SkyCoefficients coefficients = m_Sky.GetCoefficients();
+    shader->SetFloat3("u_A", coefficients.A);
+    shader->SetFloat3("u_B", coefficients.B);
+    shader->SetFloat3("u_C", coefficients.C);
+    shader->SetFloat3("u_D", coefficients.D);
+    shader->SetFloat3("u_E", coefficients.E);
+    shader->SetFloat3("u_Zenith", coefficients.Zenith);
+
+    glm::vec3 sunDirection = m_Sky.GetSunDirection();
+    glm::vec3 sunRadiance = m_Sky.GetSunRadiance();
+    shader->SetFloat3("u_SunDirection", sunDirection);
+    shader->SetFloat3("u_SunRadiance", sunRadiance);
+    shader->SetFloat("u_SunAngularRadius", ProceduralSky::SunAngularRadius);
 
-    glm::mat4 model(1.0f);
-    glm::mat3 normalModel(1.0f);
-    uint32_t shader = 0;
+    glBindVertexArray(m_CubeVAO);
 
-    static int rows = 7;
-    static int columns = 7;
-    static float spacing = 2.5f;
+    for (uint32_t i = 0; i < 6; i++)
+    {
+        shader->SetMat4("u_View", s_CubemapViewMatrices[i]);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, m_CubemapTexture, 0);
 
-    shader = m_PBRShader->GetRendererID();
-    glUseProgram(shader);
-    glUniformMatrix4fv(glGetUniformLocation(shader, "u_ViewProjection"), 1, GL_FALSE, glm::value_ptr(viewProj));
-    glUniform3f(glGetUniformLocation(shader, "u_ViewPos"), viewPos.x, viewPos.y, viewPos.z);
-    
-    glUniform1i(glGetUniformLocation(shader, "u_TextureToggle"), m_Textured);
-    if (m_Textured)
+        glDrawArrays(GL_TRIANGLES, 0, 36);
+    }
+
+    glNamedFramebufferRenderbuffer(m_EnvironmentFBO, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, m_CubemapDepthRBO);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glViewport(0, 0, SCR_WIDTH, SCR_HEIGHT);
+
+    glGenerateTextureMipmap(m_CubemapTexture);
+}
+
+void PBR::UpdateSky(GLCore::Timestep ts)
+{
+    if (m_AnimateSun)
     {
-        glBindTextureUnit(0, m_SphereAlbedoMap);
-        glUniform1i(glGetUniformLocation(shader, "u_AlbedoMap"), 0);
-        glBindTextureUnit(1, m_SphereMetallicMap);
-        glUniform1i(glGetUniformLocation(shader, "u_MetallicMap"), 1);
-        glBindTextureUnit(2, m_SphereNormalMap);
-        glUniform1i(glGetUniformLocation(shader, "u_NormalMap"), 2);
-        glBindTextureUnit(3, m_SphereRoughnessMap);
-        glUniform1i(glGetUniformLocation(shader, "u_RoughnessMap"), 3);
-        glBindTextureUnit(4, m_SphereMetallicMap);
-        glUniform1i(glGetUniformLocation(shader, "u_AOMap"), 4);
-        glBindTextureUnit(5, m_SphereHeightMap);
-        glUniform1i(glGetUniformLocation(shader, "u_HeightMap"), 5);
-
-        glUniform2f(glGetUniformLocation(shader, "u_TilingFactor"), 9.0f, 5.0f);
+        m_SunPhase += ts * m_SunSpeed;
+        m_Sky.SunElevation = 1.2f * (float)sin(m_SunPhase);
+        m_Sky.SunAzimuth = m_SunPhase;
     }
-    else
+
+    SkyState state = { m_Sky.GetSunDirection(), m_Sky.Turbidity, m_Sky.Intensity };
+    if (m_SkyValid && state.SunDirection == m_SkyState.SunDirection && state.Turbidity == m_SkyState.Turbidity && state.Intensity == m_SkyState.Intensity)
     {
-        glUniform3f(glGetUniformLocation(shader, "u_Albedo"), 0.5f, 0.0f, 0.0f);
-        glUniform1f(glGetUniformLocation(shader, "u_AO"), 1.0f);
+        m_PrefilteredMipCount = 0;
+        return;
     }
 
-    glBindVertexArray(m_SphereVAO);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_SphereIBO);
+    // The environment itself and the SH irradiance are cheap enough to refresh every change
+    RenderSky();
+    m_Sky.ComputeIrradianceSH(m_SkySH);
+    m_SkyState = state;
+    m_SkyValid = true;
 
-    // Spheres
-    for (int row = 0; row < rows; row++)
+    // Prefiltered mips are only redone once the sun has moved by a fraction of the
+    // lobe that mip integrates over (never less than one texel), or the sky changed
+    m_PrefilteredSkyStates.resize(PREFILTER_MIP_COUNT);
+
+    uint32_t mipMask = 0;
+    for (uint32_t mip = 0; mip < PREFILTER_MIP_COUNT; mip++)
     {
-        if (!m_Textured)
-            glUniform1f(glGetUniformLocation(shader, "u_Metallic"), (float)row / (float)rows);
+        const SkyState& baked = m_PrefilteredSkyStates[mip];
+
+        float roughness = (float)mip / (float)(PREFILTER_MIP_COUNT - 1);
+        float texelAngle = (float)(PI / 2.0) / (float)(PREFILTER_SIZE >> mip);
+        float lobeAngle = std::max(roughness * roughness * (float)(PI / 2.0), texelAngle);
 
-        for (int col = 0; col < columns; col++)
+        float sunDelta = acos(glm::clamp(glm::dot(state.SunDirection, baked.SunDirection), -1.0f, 1.0f));
+        float turbidityDelta = std::abs(state.Turbidity - baked.Turbidity) / std::max(baked.Turbidity, 0.001f);
+        float intensityDelta = std::abs(state.Intensity - baked.Intensity) / std::max(baked.Intensity, 0.001f);
+
+        if (!m_PrefilteredSkyValid || sunDelta > m_PrefilterThreshold * lobeAngle || turbidityDelta > 0.05f || intensityDelta > 0.05f)
         {
-            if (!m_Textured)
-                glUniform1f(glGetUniformLocation(shader, "u_Roughness"), glm::clamp((float)col / (float)columns, 0.05f, 1.0f));
+            mipMask |= BIT(mip);
+            m_PrefilteredSkyStates[mip] = state;
+        }
+    }
+    m_PrefilteredSkyValid = true;
+
+    m_PrefilteredMipCount = 0;
+    for (uint32_t mip = 0; mip < PREFILTER_MIP_COUNT; mip++)
+        m_PrefilteredMipCount += (mipMask & BIT(mip)) ? 1 : 0;
+
+    if (mipMask)
+        GeneratePrefilteredEnvMap(m_CubemapTexture, m_PrefilteredEnvMap, mipMask);
+}
+
+void PBR::CreateSceneEntities()
+{
+    m_Scene.Clear();
+    m_SphereEntities.clear();
+    m_LightEntities.clear();
 
-            model = glm::translate(glm::mat4(1.0f), glm::vec3(
-                (col - columns / 2) * spacing,
-                (row - rows / 2) * spacing,
+    m_GridRoot = m_Scene.CreateEntity();
+    for (int row = 0; row < m_GridSize; row++)
+    {
+        for (int col = 0; col < m_GridSize; col++)
+        {
+            Entity sphere = m_Scene.CreateEntity(m_GridRoot);
+            m_Scene.SetPosition(sphere, glm::vec3(
+                (col - m_GridSize / 2) * SPHERE_SPACING,
+                (row - m_GridSize / 2) * SPHERE_SPACING,
                 0.0f
             ));
-            normalModel = glm::transpose(glm::inverse(glm::mat3(model)));
-            glUniformMatrix4fv(glGetUniformLocation(shader, "u_Model"), 1, GL_FALSE, glm::value_ptr(model));
-            glUniformMatrix3fv(glGetUniformLocation(shader, "u_NormalModel"), 1, GL_FALSE, glm::value_ptr(normalModel));
+            glm::vec4 material((float)row / (float)m_GridSize, glm::clamp((float)col / (float)m_GridSize, 0.05f, 1.0f), 1.0f, 0.0f);
+            m_Scene.AddComponent<SphereMaterial>(sphere, { material, glm::vec4(0.5f, 0.0f, 0.0f, 1.0f) });
+            m_SphereEntities.push_back(sphere);
+        }
+    }
+
+    // Light markers keep the material of the last sphere
+    SphereMaterial markerMaterial = m_Scene.GetComponent<SphereMaterial>(m_SphereEntities.back());
+    for (uint32_t i = 0; i < 4; i++)
+    {
+        Entity light = m_Scene.CreateEntity();
+        m_Scene.SetPosition(light, LIGHT_POSITIONS[i]);
+        m_Scene.SetScale(light, glm::vec3(0.5f));
+        m_Scene.AddComponent<SphereMaterial>(light, markerMaterial);
+        m_Scene.AddComponent<PointLight>(light, { LIGHT_COLORS[i] });
+        m_SphereEntities.push_back(light);
+        m_LightEntities.push_back(light);
+    }
+
+    m_SceneValid = true;
+}
+
+void PBR::UpdateSphereInstances()
+{
+    // Spheres first, then the light markers
+    m_SphereInstances.resize(m_SphereEntities.size());
+    for (uint32_t i = 0; i < m_SphereEntities.size(); i++)
+    {
+        Entity entity = m_SphereEntities[i];
+        const SphereMaterial& material = m_Scene.GetComponent<SphereMaterial>(entity);
+        SphereInstance& instance = m_SphereInstances[i];
+        instance.Model = m_Scene.GetWorldMatrix(entity);
+        instance.NormalModel = glm::mat3x4(m_Scene.GetNormalMatrix(entity));
+        instance.Material = material.Material;
+        instance.Albedo = material.Albedo;
+    }
+
+    glNamedBufferData(m_SphereInstanceBuffer, m_SphereInstances.size() * sizeof(SphereInstance), m_SphereInstances.data(), GL_STATIC_DRAW);
+    m_SphereInstancesValid = true;
+    m_SphereObjectsValid = false;
+
+    std::vector<BoundingBox> bounds;
+    bounds.reserve(m_SphereInstances.size());
+    for (const SphereInstance& sphere : m_SphereInstances)
+        bounds.push_back(BoundingBox::FromSphere(glm::vec3(sphere.Model[3]), glm::length(glm::vec3(sphere.Model[0]))));
+    m_SphereBVH.Build(bounds);
+
+    // Spheres and light markers are culled together but drawn as separate groups, so the feedback pass can skip the markers
+    uint32_t sphereCount = m_GridSize * m_GridSize;
+    std::vector<CullObject> objects(bounds.size());
+    for (uint32_t i = 0; i < bounds.size(); i++)
+    {
+        objects[i].Sphere = glm::vec4(bounds[i].GetCenter(), bounds[i].GetExtent().x);
+        objects[i].Group = i < sphereCount ? 0 : 1;
+    }
+    m_GPUCulling->SetObjects(objects, 2);
+    m_ReferenceValid = false;
+
+    // LOD state survives transform updates so the hysteresis holds while the grid moves
+    if (m_SphereLODState.size() != m_SphereInstances.size())
+    {
+        m_SphereLODState.assign(m_SphereInstances.size(), 0);
+        m_SphereLODIndices.resize(m_SphereInstances.size());
+        glNamedBufferData(m_SphereLODBuffer, m_SphereLODIndices.size() * sizeof(uint32_t), nullptr, GL_STREAM_DRAW);
+    }
+}
+
+void PBR::SelectSphereLODs()
+{
+    uint32_t lodCount = (uint32_t)m_SphereLODs.size();
+    uint32_t sphereCount = m_GridSize * m_GridSize;
+
+    auto cullStart = std::chrono::high_resolution_clock::now();
+    m_VisibleSpheres.clear();
+    if (m_FrustumCulling)
+    {
+        m_SphereBVH.Cull(m_Camera.GetFrustum(), m_VisibleSpheres);
+    }
+    else
+    {
+        for (uint32_t i = 0; i < m_SphereInstances.size(); i++)
+            m_VisibleSpheres.push_back(i);
+    }
+    m_CullTime = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - cullStart).count();
+
+    float projectionScale = m_Camera.GetProjectionMatrix()[1][1] * SCR_HEIGHT * 0.5f * m_LODScale;
+    glm::vec3 viewPos = m_Camera.GetPosition();
 
-            glDrawElements(GL_TRIANGLE_STRIP, m_SphereIndexCount, GL_UNSIGNED_INT, nullptr);
+    std::fill(m_SphereLODCounts.begin(), m_SphereLODCounts.end(), 0);
+    std::fill(m_SphereLODMarkerCounts.begin(), m_SphereLODMarkerCounts.end(), 0);
+    for (uint32_t i : m_VisibleSpheres)
+    {
+        uint32_t lod = 0;
+        if (m_MeshLOD)
+        {
+            const glm::mat4& model = m_SphereInstances[i].Model;
+            float size = GetProjectedSize(glm::vec3(model[3]), glm::length(glm::vec3(model[0])), viewPos, projectionScale);
+            lod = SelectLOD(size, m_SphereLODState[i], SPHERE_LOD_SIZES, lodCount - 1, SPHERE_LOD_HYSTERESIS);
         }
+        m_SphereLODState[i] = (uint8_t)lod;
+        m_SphereLODCounts[lod]++;
+        if (i >= sphereCount)
+            m_SphereLODMarkerCounts[lod]++;
     }
 
-    glUniform1f(glGetUniformLocation(shader, "u_IBL"), m_IBL);
+    // Counting sort by LOD, the light markers are placed last in each group so the feedback pass can skip them
+    std::vector<uint32_t> offsets(lodCount, 0);
+    for (uint32_t lod = 1; lod < lodCount; lod++)
+        offsets[lod] = offsets[lod - 1] + m_SphereLODCounts[lod - 1];
+    for (uint32_t i : m_VisibleSpheres)
+        if (i < sphereCount)
+            m_SphereLODIndices[offsets[m_SphereLODState[i]]++] = i;
+    for (uint32_t i : m_VisibleSpheres)
+        if (i >= sphereCount)
+            m_SphereLODIndices[offsets[m_SphereLODState[i]]++] = i;
+
+    m_SphereTriangleCount = 0;
+    for (uint32_t lod = 0; lod < lodCount; lod++)
+        m_SphereTriangleCount += (uint64_t)m_SphereLODCounts[lod] * m_SphereLODs[m_InstancedDraw ? lod : 0].TriangleCount;
+
+    if (!m_VisibleSpheres.empty())
+        glNamedBufferSubData(m_SphereLODBuffer, 0, m_VisibleSpheres.size() * sizeof(uint32_t), m_SphereLODIndices.data());
+}
 
-    if (m_IBL)
+void PBR::CullSpheresOnGPU()
+{
+    uint32_t lodCount = (uint32_t)m_SphereLODs.size();
+    std::vector<DrawElementsIndirectCommand> lods(lodCount);
+    for (uint32_t lod = 0; lod < lodCount; lod++)
     {
-        glBindTextureUnit(5, m_BRDFLUT);
-        glUniform1i(glGetUniformLocation(shader, "u_BRDFLUT"), 5);
+        const SphereLOD& range = m_SphereLODs[lod];
+        lods[lod].Count = m_OptimizedIndices ? range.ListIndexCount : range.StripIndexCount;
+        lods[lod].FirstIndex = m_OptimizedIndices ? range.ListFirstIndex : range.StripFirstIndex;
+        lods[lod].BaseVertex = range.BaseVertex;
+    }
 
-        glBindTextureUnit(6, m_IrradianceTexture);
-        glUniform1i(glGetUniformLocation(shader, "u_IrradianceMap"), 6);
+    float projectionScale = m_Camera.GetProjectionMatrix()[1][1] * SCR_HEIGHT * 0.5f * m_LODScale;
+    m_GPUCulling->Cull(m_Camera.GetViewProjection(), m_Camera.GetPosition(), projectionScale, lods,
+        SPHERE_LOD_SIZES, m_MeshLOD ? lodCount - 1 : 0, SPHERE_LOD_HYSTERESIS, m_OcclusionCulling);
 
-        glBindTextureUnit(7, m_PrefilteredEnvMap);
-        glUniform1i(glGetUniformLocation(shader, "u_PrefilterMap"), 7);
+    // Counts of the previous frame, summed over the sphere and light marker groups
+    const std::vector<uint32_t>& counts = m_GPUCulling->GetVisibleCounts();
+    m_SphereTriangleCount = 0;
+    for (uint32_t lod = 0; lod < lodCount; lod++)
+    {
+        m_SphereLODCounts[lod] = counts.size() == 2 * lodCount ? counts[lod] + counts[lodCount + lod] : 0;
+        m_SphereTriangleCount += (uint64_t)m_SphereLODCounts[lod] * m_SphereLODs[lod].TriangleCount;
     }
 
-    glUniform1f(glGetUniformLocation(shader, "u_Exposure"), m_Exposure);
+    // Without occlusion the GPU must see exactly what the BVH sees; both counts belong to the previous frame when compared
+    if (m_ValidateCulling && !m_OcclusionCulling)
+    {
+        if (m_ReferenceValid)
+            m_CullingMismatch = m_GPUCulling->GetVisibleCount() != m_ReferenceVisibleCount;
 
-    // Light sources
+        m_VisibleSpheres.clear();
+        m_SphereBVH.Cull(m_Camera.GetFrustum(), m_VisibleSpheres);
+        m_ReferenceVisibleCount = (uint32_t)m_VisibleSpheres.size();
+        m_ReferenceValid = true;
+    }
+    else
+    {
+        m_ReferenceValid = false;
+        m_CullingMismatch = false;
+    }
+}
+
+void PBR::DrawSpheres(Shader* shader, bool lightMarkers)
+{
+    shader->SetInt("u_Instanced", m_InstancedDraw);
+
+    GLenum primitive = m_OptimizedIndices ? GL_TRIANGLES : GL_TRIANGLE_STRIP;
+    if (m_InstancedDraw && m_GPUCullingEnabled)
+    {
+        // Light markers are the second group
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, m_SphereInstanceBuffer);
+        m_GPUCulling->Draw(primitive, m_SphereVAO, 1, lightMarkers ? 2 : 1);
+        return;
+    }
+
+    if (m_InstancedDraw)
+    {
+        // One instanced draw per LOD over its group of instance indices
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, m_SphereInstanceBuffer);
+        glVertexArrayVertexBuffer(m_SphereVAO, 1, m_SphereLODBuffer, 0, sizeof(uint32_t));
+        uint32_t baseInstance = 0;
+        for (uint32_t lod = 0; lod < m_SphereLODs.size(); lod++)
+        {
+            const SphereLOD& range = m_SphereLODs[lod];
+            uint32_t instanceCount = m_SphereLODCounts[lod] - (lightMarkers ? 0 : m_SphereLODMarkerCounts[lod]);
+            if (instanceCount > 0)
+            {
+                uint32_t firstIndex = m_OptimizedIndices ? range.ListFirstIndex : range.StripFirstIndex;
+                uint32_t indexCount = m_OptimizedIndices ? range.ListIndexCount : range.StripIndexCount;
+                glDrawElementsInstancedBaseVertexBaseInstance(primitive, indexCount, GL_UNSIGNED_INT,
+                    (const void*)(firstIndex * sizeof(uint32_t)), instanceCount, range.BaseVertex, baseInstance);
+            }
+            baseInstance += m_SphereLODCounts[lod];
+        }
+        return;
+    }
+
+    // One draw per visible sphere, kept for comparison, recorded ahead by RecordSphereDraws
+    for (const CommandBuffer& commands : lightMarkers ? m_SphereCommands : m_SphereFeedbackCommands)
+        commands.Execute(m_RenderState);
+}
+
+void PBR::RecordSphereDraws(std::vector<CommandBuffer>& buffers, bool lightMarkers)
+{
+    if (!m_SphereObjectsValid)
+    {
+        m_SphereObjectBuffer->Upload(m_SphereInstances.data(), (uint32_t)m_SphereInstances.size());
+        m_SphereObjectsValid = true;
+    }
+
+    PrimitiveType primitive = m_OptimizedIndices ? PrimitiveType::Triangles : PrimitiveType::TriangleStrip;
+    const SphereLOD& fullDetail = m_SphereLODs[0];
+    uint32_t firstIndex = m_OptimizedIndices ? fullDetail.ListFirstIndex : fullDetail.StripFirstIndex;
+    uint32_t indexCount = m_OptimizedIndices ? fullDetail.ListIndexCount : fullDetail.StripIndexCount;
+    uint32_t objectBuffer = m_SphereObjectBuffer->GetRendererID();
+    uint32_t objectStride = m_SphereObjectBuffer->GetStride();
+    uint32_t sphereCount = m_GridSize * m_GridSize;
+
+    // Each sphere selects its Object block with one range bind
+    uint32_t visibleCount = (uint32_t)m_VisibleSpheres.size();
+    // Below MIN_RECORDED_DRAWS_PER_THREAD draws the grid is recorded inline
+    WorkerPool& pool = Application::Get().GetWorkerPool();
+    uint32_t threadCount = std::min(pool.GetThreadCount(), std::max(visibleCount / MIN_RECORDED_DRAWS_PER_THREAD, 1u));
+    RecordParallel(pool, buffers, visibleCount, threadCount, [&](CommandBuffer& commands, uint32_t begin, uint32_t end)
+    {
+        for (uint32_t v = begin; v < end; v++)
+        {
+            uint32_t i = m_VisibleSpheres[v];
+            if (i >= sphereCount && !lightMarkers)
+                continue;
+
+            commands.BindUniformBuffer(OBJECT_BLOCK_BINDING, objectBuffer, (uint64_t)i * objectStride, sizeof(SphereInstance));
+            commands.DrawIndexed(primitive, indexCount, firstIndex, fullDetail.BaseVertex);
+        }
+    });
+    m_RecordThreadCount = (uint32_t)buffers.size();
+}
+
+void PBR::DrawModel(Shader* shader)
+{
+    if (!m_Model || !m_Model->IsLoaded())
+        return;
+
+    // Positions are dequantized before the placement
+    glm::mat4 model = glm::translate(glm::mat4(1.0f), MODEL_POSITION);
+    model = glm::scale(model, glm::vec3(m_ModelScale)) * m_Model->GetDequantize();
+
+    SphereInstance object;
+    object.Model = model;
+    object.NormalModel = glm::mat3x4(glm::transpose(glm::inverse(glm::mat3(model))));
+    object.Material = glm::vec4(0.0f, 0.5f, 1.0f, 0.0f);
+    object.Albedo = glm::vec4(0.8f, 0.8f, 0.8f, 1.0f);
+    m_ModelObjectBuffer->Upload(object);
+    m_ModelObjectBuffer->Bind(OBJECT_BLOCK_BINDING);
+
+    shader->SetInt("u_Instanced", 0);
+
+    m_Model->DrawSubMeshes(m_ModelLOD);
+}
+
+void PBR::OnUpdate(GLCore::Timestep ts)
+{
+    m_TextureStreamer->Update(m_StreamingBudget);
+    if (m_SphereMaterialMap->IsFailed())
+        m_PackedMaterial = false;
+    if (!m_PackedMaterial && !m_SphereAOMap)
+        LoadSeparateMaterialMaps();
+    m_MeshLoader->Update();
+    m_TextureRegistry->Update();
+
+    // Finishes the page file build, once valid the virtual albedo updates after its feedback pass
+    if (!m_VirtualAlbedo->IsValid())
+        m_VirtualAlbedo->Update();
+
+    // Only the bakes fed by a reloaded program are redone
+    bool bakeCubemap = false, bakeOctahedral = false, bakeBRDF = false;
+    for (Shader* shader : m_ShaderWatcher->Update())
+    {
+        if (shader == m_EquirectangularToCubemapShader || shader == m_IrradianceShader || shader == m_PrefilterShader)
+            bakeCubemap = true;
+        else if (shader == m_EquirectangularToOctahedralShader || shader == m_IrradianceOctahedralShader || shader == m_PrefilterOctahedralShader)
+            bakeOctahedral = true;
+        else if (shader == m_BRDFIntegrationShader)
+            bakeBRDF = true;
+        else if (shader == m_SkyShader)
+            m_SkyValid = m_PrefilteredSkyValid = false;
+    }
+    if (bakeCubemap)
+    {
+        // The sky renders over the fresh cubemap set
+        BakeCubemapEnvironment();
+        m_SkyValid = m_PrefilteredSkyValid = false;
+    }
+    if (bakeOctahedral)
+        BakeOctahedralEnvironment();
+    if (bakeBRDF)
+        GenerateBRDFIntegration(m_CubemapTexture);
+
+    if (m_ProceduralSky)
+        UpdateSky(ts);
+
+    if (!m_SceneValid)
+        CreateSceneEntities();
+
+    if (m_RotateGrid)
+    {
+        m_GridAngle += ts * 0.2f;
+        m_Scene.SetRotation(m_GridRoot, glm::angleAxis(m_GridAngle, glm::vec3(0.0f, 1.0f, 0.0f)));
+    }
+
+    // Only the changed subtrees are recomputed, instances are rebuilt when anything moved
+    auto transformStart = std::chrono::high_resolution_clock::now();
+    m_TransformUpdateCount = m_Scene.UpdateTransforms();
+    m_TransformTime = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - transformStart).count();
+    if (m_TransformUpdateCount > 0)
+        m_SphereInstancesValid = false;
+
+    if (!m_SphereInstancesValid)
+        UpdateSphereInstances();
+
+    bool gpuCulling = m_GPUCullingEnabled && m_InstancedDraw;
+    if (gpuCulling)
+        CullSpheresOnGPU();
+    else
+        SelectSphereLODs();
+
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+    // Camera, lights and material go into blocks once per frame, every program that declares them reads the same buffers
+    FrameUniforms frame;
+    frame.ViewProjection = m_Camera.GetViewProjection();
+    frame.SkyboxViewProjection = m_Camera.GetProjectionMatrix() * glm::mat4(glm::mat3(m_Camera.GetViewMatrix()));
+    frame.ViewPos = m_Camera.GetPosition();
+    frame.Exposure = m_Exposure;
     for (uint32_t i = 0; i < 4; i++)
     {
-        glUniform3f(glGetUniformLocation(shader, ("u_LightPositions[" + std::to_string(i) + "]").c_str()), lightPositions[i].x, lightPositions[i].y, lightPositions[i].z);
-        glUniform3f(glGetUniformLocation(shader, ("u_LightColors[" + std::to_string(i) + "]").c_str()), lightColors[i].r, lightColors[i].g, lightColors[i].b);
+        bool active = i < m_LightEntities.size();
+        frame.LightPositions[i] = active ? glm::vec4(m_Scene.GetWorldPosition(m_LightEntities[i]), 1.0f) : glm::vec4(0.0f);
+        frame.LightColors[i] = active ? glm::vec4(m_Scene.GetComponent<PointLight>(m_LightEntities[i]).Color, 0.0f) : glm::vec4(0.0f);
+    }
+    m_FrameBuffer->Upload(frame);
+    m_FrameBuffer->Bind(FRAME_BLOCK_BINDING);
+
+    bool virtualAlbedo = m_Textured && m_VirtualTexturing && m_VirtualAlbedo->IsValid();
+    MaterialUniforms material = {};
+    material.TilingFactor = glm::vec2(9.0f, 5.0f);
+    material.TextureToggle = m_Textured;
+    material.PackedMaterial = m_PackedMaterial;
+    material.VirtualAlbedo = virtualAlbedo;
+    material.VTPageSize = (float)m_VirtualAlbedo->GetPageSize();
+    material.VTSize = glm::vec2((float)m_VirtualAlbedo->GetWidth(), (float)m_VirtualAlbedo->GetHeight());
+    material.VTBorder = (float)m_VirtualAlbedo->GetBorder();
+    material.VTCacheSize = (float)m_VirtualAlbedo->GetCacheSize();
+    material.VTMaxLevel = (float)(m_VirtualAlbedo->GetMipCount() - 1);
+    material.VTFeedbackBias = m_VirtualAlbedo->GetFeedbackBias();
+    m_MaterialBuffer->Upload(material);
+    m_MaterialBuffer->Bind(MATERIAL_BLOCK_BINDING);
+
+    // Everything above binds through GL directly, the tracked state starts over for the queued draws
+    m_RenderState.Invalidate();
+    glm::vec3 viewPos = m_Camera.GetPosition();
+    float gridDepth = glm::distance(viewPos, m_Scene.GetWorldPosition(m_GridRoot));
+    float modelDepth = glm::distance(viewPos, MODEL_POSITION);
+    bool drawModel = m_Model && m_Model->IsLoaded();
+    if (drawModel)
+    {
+        // Bounding sphere of the placed model, the dequantize transform maps the unit cube to its bounds
+        glm::vec3 center = MODEL_POSITION + (m_Model->GetBoundsMin() + m_Model->GetBoundsMax()) * 0.5f * m_ModelScale;
+        float radius = glm::length(m_Model->GetBoundsMax() - m_Model->GetBoundsMin()) * 0.5f * m_ModelScale;
+        float projectionScale = m_Camera.GetProjectionMatrix()[1][1] * SCR_HEIGHT * 0.5f * m_LODScale;
+        uint32_t thresholdCount = std::min(m_Model->GetLODCount() - 1, (uint32_t)std::size(MODEL_LOD_SIZES));
+        float size = GetProjectedSize(center, radius, viewPos, projectionScale);
+        m_ModelLOD = m_MeshLOD ? SelectLOD(size, m_ModelLOD, MODEL_LOD_SIZES, thresholdCount, SPHERE_LOD_HYSTERESIS) : 0;
+    }
 
-        model = glm::translate(glm::mat4(1.0f), lightPositions[i]);
-        model = glm::scale(model, glm::vec3(0.5f));
-        normalModel = glm::transpose(glm::inverse(glm::mat3(model)));
-        glUniformMatrix4fv(glGetUniformLocation(shader, "u_Model"), 1, GL_FALSE, glm::value_ptr(model));
-        glUniformMatrix3fv(glGetUniformLocation(shader, "u_NormalModel"), 1, GL_FALSE, glm::value_ptr(normalModel));
+    // Per-draw sphere commands are recorded across threads here and replayed inside the queued draws
+    if (!m_InstancedDraw)
+    {
+        // Recording makes no GL call, every program it references is resolved here first
+        m_PBRShader->Wait();
+        if (virtualAlbedo)
+            m_FeedbackShader->Wait();
+
+        auto recordStart = std::chrono::high_resolution_clock::now();
+        RecordSphereDraws(m_SphereCommands, true);
+        if (virtualAlbedo)
+            RecordSphereDraws(m_SphereFeedbackCommands, false);
+        m_RecordTime = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - recordStart).count();
+    }
 
-        glDrawElements(GL_TRIANGLE_STRIP, m_SphereIndexCount, GL_UNSIGNED_INT, nullptr);
+    // Virtual texture feedback at reduced resolution, read back a few frames later
+    if (virtualAlbedo)
+    {
+        Shader* shader = m_FeedbackShader;
+        uint32_t program = shader->GetRendererID();
+        m_RenderQueue.Submit(MakeSortKey(PASS_FEEDBACK, program, 0, gridDepth), program, m_SphereVAO, {}, [this, shader]()
+        {
+            DrawSpheres(shader, false);
+        });
+        if (drawModel)
+            m_RenderQueue.Submit(MakeSortKey(PASS_FEEDBACK, program, 0, modelDepth), program, m_Model->GetVertexArray(), {}, [this, shader]() { DrawModel(shader); });
+
+        m_VirtualAlbedo->BeginFeedback(SCR_WIDTH, SCR_HEIGHT);
+        m_RenderQueue.Execute(m_RenderState, PASS_FEEDBACK);
+        m_VirtualAlbedo->EndFeedback();
+        m_VirtualAlbedo->Update();
     }
 
-    char* argv[] = { m_IBL ? "1" : "0", std::string(m_Exposure).c_str() };
-    execv("pbr.exe", argv);
+    // Sampler units are fixed in pbr.frag.glsl
+    std::vector<TextureBinding> textures;
+    if (m_Textured)
+    {
+        textures.push_back({ 0, m_SphereAlbedoMap->GetRendererID() });
+        if (virtualAlbedo)
+        {
+            textures.push_back({ 10, m_VirtualAlbedo->GetPageTable() });
+            textures.push_back({ 11, m_VirtualAlbedo->GetCache() });
+        }
+        textures.push_back({ 2, m_SphereNormalMap->GetRendererID() });
+        if (m_PackedMaterial)
+        {
+            textures.push_back({ 13, m_SphereMaterialMap->GetRendererID() });
+        }
+        else
+        {
+            textures.push_back({ 1, m_SphereMetallicMap->GetRendererID() });
+            textures.push_back({ 3, m_SphereRoughnessMap->GetRendererID() });
+            textures.push_back({ 4, m_SphereAOMap->GetRendererID() });
+            textures.push_back({ 5, m_SphereHeightMap->GetRendererID() });
+        }
+    }
+    if (m_IBL)
+    {
+        textures.push_back({ 6, m_IrradianceTexture });
+        textures.push_back({ 7, m_PrefilteredEnvMap });
+        textures.push_back({ 8, m_OctahedralIrradianceMap });
+        textures.push_back({ 9, m_OctahedralPrefilteredMap });
+        textures.push_back({ 12, m_BRDFLUT });
+    }
 
-    shader = m_QuadShader->GetRendererID();
-    glUseProgram(shader);
+    // Textures, IBL, light count and parallax are compiled into the program rather than branched on.
+    // A newly selected variant links in the background, the previous one keeps drawing until it is ready.
+    Shader* variant = m_PBRVariants->Get(GetPBRDefines());
+    if (variant != m_PBRShader && variant->IsReady())
+        m_PBRShader = variant;
+    Shader* shader = m_PBRShader;
+
+    // The procedural sky only drives the cubemap set, with SH for irradiance
+    bool octahedral = m_EnvironmentEncoding == EnvironmentEncoding::Octahedral && !m_ProceduralSky;
+    shader->SetInt("u_OctahedralIBL", octahedral);
+    shader->SetInt("u_SHIrradiance", m_ProceduralSky);
+    if (m_ProceduralSky)
+        shader->SetFloat3Array("u_SH", m_SkySH, 9);
+
+    // Spheres, light markers and the model share the program and texture set, so they sort by depth
+    uint32_t program = shader->GetRendererID();
+    uint32_t materialKey = m_Textured ? (m_PackedMaterial ? 1 : 2) : 0;
+    m_RenderQueue.Submit(MakeSortKey(PASS_OPAQUE, program, materialKey, gridDepth), program, m_SphereVAO, textures, [this, shader]()
+    {
+        auto drawStart = std::chrono::high_resolution_clock::now();
+        DrawSpheres(shader, true);
+        m_DrawTime[m_InstancedDraw] = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - drawStart).count();
+    });
+    if (drawModel)
+        m_RenderQueue.Submit(MakeSortKey(PASS_OPAQUE, program, materialKey, modelDepth), program, m_Model->GetVertexArray(), textures, [this, shader]() { DrawModel(shader); });
+
+    // Shading cost is read back a frame late to avoid stalling on the query, and charged to the
+    // encoding that was active when it was measured
+    uint32_t frameSlot = m_FrameIndex % 2;
+    uint32_t previousSlot = (m_FrameIndex + 1) % 2;
+    if (m_FrameIndex > 0)
+    {
+        uint64_t elapsed;
+        glGetQueryObjectui64v(m_ShadingTimeQueries[previousSlot], GL_QUERY_RESULT, &elapsed);
+        m_ShadingTime[(uint32_t)m_ShadingTimeEncodings[previousSlot]] = elapsed / 1000000.0f;
+    }
+    m_ShadingTimeEncodings[frameSlot] = m_EnvironmentEncoding;
+    glBeginQuery(GL_TIME_ELAPSED, m_ShadingTimeQueries[frameSlot]);
+    m_FrameIndex++;
 
-    uint32_t finalTexture = LoadTexture("assets/textures/lighting.png");
-    glBindTextureUnit(0, finalTexture);
-    glUniform1i(glGetUniformLocation(m_QuadShader, "u_Texture"), 0);
+    m_RenderQueue.Execute(m_RenderState, PASS_OPAQUE);
 
-    glBindVertexArray(m_QuadVAO);
-    glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+    glEndQuery(GL_TIME_ELAPSED);
+
+    char* argv[] = { m_IBL ? "1" : "0", std::string(m_Exposure).c_str() };
+    execv("pbr.exe", argv);
+
+    // Rewritten every frame; the registry reloads it only when its modification time changes
+    // and deletes the previous texture once the GPU is done with it
+    m_FinalTexture = m_TextureRegistry->Load("assets/textures/lighting.png");
+    program = m_QuadShader->GetRendererID();
+    m_RenderQueue.Submit(MakeSortKey(PASS_OVERLAY, program, 0, 0.0f), program, m_QuadVAO,
+        { { 0, m_FinalTexture ? m_FinalTexture->GetRendererID() : 0 } }, []()
+    {
+        glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+    });
+    m_RenderQueue.Execute(m_RenderState, PASS_OVERLAY);
 
     execv("rm", "assets/textures/lighting.png");
 
     // Skybox
-    shader = m_SkyboxShader->GetRendererID();
-    glUseProgram(shader);
-    
-    auto view = glm::mat4(glm::mat3(m_Camera.GetViewMatrix()));
-    auto proj = m_Camera.GetProjectionMatrix();
-    viewProj = proj * view;
-    glUniformMatrix4fv(glGetUniformLocation(shader, "u_ViewProjection"), 1, GL_FALSE, glm::value_ptr(viewProj));
-    
-    glBindTextureUnit(0, m_CubemapTexture);
-    glUniform1i(glGetUniformLocation(shader, "u_CubeMap"), 0);
-    
-    glBindVertexArray(m_CubeVAO);
-    glDrawArrays(GL_TRIANGLES, 0, 36);
+    shader = m_SkyboxShader;
+    shader->SetInt("u_Octahedral", octahedral);
+    program = shader->GetRendererID();
+    m_RenderQueue.Submit(MakeSortKey(PASS_SKY, program, 0, 0.0f), program, m_CubeVAO,
+        { { 0, m_CubemapTexture }, { 1, m_OctahedralEnvironmentMap } }, []()
+    {
+        glDrawArrays(GL_TRIANGLES, 0, 36);
+    });
+    m_RenderQueue.Execute(m_RenderState, PASS_SKY);
+    m_RenderQueue.Clear();
+
+    m_RenderStateStats = m_RenderState.GetStats();
+    m_RenderState.ResetStats();
+
+    // Occluders for the next frame's culling
+    if (gpuCulling && m_OcclusionCulling)
+    {
+        Window& window = Application::Get().GetWindow();
+        m_GPUCulling->BuildDepthPyramid(m_Camera.GetViewProjection(), window.GetWidth(), window.GetHeight());
+    }
 
     m_Camera.OnUpdate(ts);
 }
@@ -693,7 +1486,141 @@ void PBR::OnImGuiRender()
 {
     ImGui::Begin("Settings");
     ImGui::Checkbox("Textured", &m_Textured);
+    if (m_Textured)
+        ImGui::Checkbox("Parallax", &m_Parallax);
+    if (!m_SphereMaterialMap->IsFailed())
+        ImGui::Checkbox("Packed Material (ORM)", &m_PackedMaterial);
+    if (m_VirtualAlbedo->IsValid())
+        ImGui::Checkbox("Virtual Albedo", &m_VirtualTexturing);
     ImGui::Checkbox("IBL", &m_IBL);
+    ImGui::SliderInt("Lights", &m_LightCount, 1, 4);
+    ImGui::Text("Shading variants: %u built", m_PBRVariants->GetVariantCount());
+    if (ImGui::SliderInt("Sphere Grid", &m_GridSize, 1, 316))
+        m_SceneValid = false;
+    ImGui::Checkbox("Rotate Grid", &m_RotateGrid);
+    ImGui::Text("Scene: %u entities, %u transforms updated in %.3f ms", m_Scene.GetEntityCount(), m_TransformUpdateCount, m_TransformTime);
+    ImGui::Checkbox("Instanced Draw", &m_InstancedDraw);
+    ImGui::Text("Sphere submission (CPU): %.3f ms per-draw, %.3f ms instanced", m_DrawTime[0], m_DrawTime[1]);
+    if (!m_InstancedDraw)
+        ImGui::Text("Per-draw recording: %.3f ms on %u threads", m_RecordTime, m_RecordThreadCount);
+    const RenderStateStats& state = m_RenderStateStats;
+    ImGui::Text("State changes: %u issued, %u eliminated (programs %u / %u, vertex arrays %u / %u, textures %u / %u)",
+        state.GetChanges(), state.GetSkips(), state.ProgramChanges, state.ProgramSkips,
+        state.VertexArrayChanges, state.VertexArraySkips, state.TextureChanges, state.TextureSkips);
+    const ProgramCacheStats& programs = GetProgramCacheStats();
+    ImGui::Text("Programs: %u from the binary cache, %u compiled%s", programs.Loaded, programs.Compiled,
+        IsParallelShaderCompileSupported() ? " in parallel" : "");
+    ImGui::Text("Hot reload: %u shaders watched, %u rebuilding, %u reloaded, %u failed", m_ShaderWatcher->GetWatchedCount(),
+        m_ShaderWatcher->GetPendingCount(), m_ShaderWatcher->GetReloadCount(), m_ShaderWatcher->GetFailedCount());
+    ImGui::InputText("Model", m_ModelPath, sizeof(m_ModelPath));
+    ImGui::SameLine();
+    if (ImGui::Button("Load"))
+        m_Model = m_MeshLoader->Load(m_ModelPath);
+    if (m_Model)
+    {
+        if (m_Model->IsLoaded())
+        {
+            ImGui::Text("Model: %u vertices, %u triangles, %u submeshes, loaded in %.1f ms", m_Model->GetVertexCount(), m_Model->GetTriangleCount(), (uint32_t)m_Model->GetSubMeshes().size(), m_Model->GetLoadTime());
+            ImGui::Text("Model LOD: %u / %u, %u triangles", m_ModelLOD, m_Model->GetLODCount(), m_Model->GetTriangleCount(m_ModelLOD));
+        }
+        else
+            ImGui::Text("Model: %s", m_Model->IsFailed() ? "import failed" : "importing...");
+        ImGui::SliderFloat("Model Scale", &m_ModelScale, 0.1f, 20.0f);
+    }
+    ImGui::Checkbox("GPU Culling", &m_GPUCullingEnabled);
+    if (m_GPUCullingEnabled && m_InstancedDraw)
+    {
+        ImGui::Checkbox("Occlusion Culling", &m_OcclusionCulling);
+        ImGui::Checkbox("Validate Against CPU", &m_ValidateCulling);
+        uint32_t visible = m_GPUCulling->GetVisibleCount();
+        ImGui::Text("GPU culling: %u visible, %u culled, one indirect draw", visible, m_GPUCulling->GetObjectCount() - visible);
+        if (m_ValidateCulling && !m_OcclusionCulling)
+            ImGui::Text("CPU reference: %u visible%s", m_ReferenceVisibleCount, m_CullingMismatch ? " (mismatch)" : "");
+    }
+    else
+    {
+        ImGui::Checkbox("Frustum Culling", &m_FrustumCulling);
+        ImGui::Text("Culling: %u visible, %u culled, %u box tests, %.3f ms", (uint32_t)m_VisibleSpheres.size(),
+            (uint32_t)(m_SphereInstances.size() - m_VisibleSpheres.size()), m_FrustumCulling ? m_SphereBVH.GetTestCount() : 0, m_CullTime);
+    }
+    ImGui::Checkbox("Mesh LOD", &m_MeshLOD);
+    ImGui::Checkbox("Optimized Index Lists", &m_OptimizedIndices);
+    for (uint32_t lod = 0; lod < m_SphereLODs.size(); lod++)
+    {
+        const SphereLOD& range = m_SphereLODs[lod];
+        ImGui::Text("LOD %u: ACMR %.3f -> %.3f, ATVR %.3f -> %.3f (strip -> optimized)", lod,
+            range.StripStats.ACMR, range.ListStats.ACMR, range.StripStats.ATVR, range.ListStats.ATVR);
+    }
+    ImGui::SliderFloat("LOD Scale", &m_LODScale, 0.25f, 4.0f);
+    ImGui::Text("Sphere LODs: %u / %u / %u / %u instances, %.2f M triangles", m_SphereLODCounts[0], m_SphereLODCounts[1], m_SphereLODCounts[2], m_SphereLODCounts[3], m_SphereTriangleCount / 1000000.0);
     ImGui::SliderFloat("Exposure", &m_Exposure, 0.0f, 2.0f);
+    ImGui::SliderFloat("Streaming Budget (ms)", &m_StreamingBudget, 0.1f, 8.0f);
+    ImGui::Text("Registry: %u textures, %u pending deletion", m_TextureRegistry->GetTextureCount(), m_TextureRegistry->GetPendingDeletionCount());
+    ImGui::Text("Streaming: %u pending, %.2f MB uploaded this frame", m_TextureStreamer->GetPendingCount(), m_TextureStreamer->GetUploadedBytes() / (1024.0 * 1024.0));
+    if (m_VirtualAlbedo->IsValid())
+    {
+        ImGui::Text("Virtual albedo: %u / %u pages resident, %u pending", m_VirtualAlbedo->GetResidentPageCount(), m_VirtualAlbedo->GetCapacity(), m_VirtualAlbedo->GetPendingCount());
+        ImGui::Text("Virtual albedo memory: %.2f MB (full mip chain: %.2f MB)", m_VirtualAlbedo->GetCacheMemory() / (1024.0 * 1024.0), m_VirtualAlbedo->GetFullMemory() / (1024.0 * 1024.0));
+    }
+
+    static const GLenum environmentFormats[] = { GL_R11F_G11F_B10F, GL_RGB9_E5, GL_RGB16F };
+    if (ImGui::BeginCombo("Environment Format", GetFormatName(m_EnvironmentFormat)))
+    {
+        for (GLenum format : environmentFormats)
+        {
+            // The sky is rendered straight into the environment, which needs a renderable format
+            ImGuiSelectableFlags flags = m_ProceduralSky && !IsColorRenderable(format) ? ImGuiSelectableFlags_Disabled : 0;
+            if (ImGui::Selectable(GetFormatName(format), format == m_EnvironmentFormat, flags) && format != m_EnvironmentFormat)
+            {
+                m_EnvironmentFormat = format;
+                BakeEnvironment();
+                m_SkyValid = m_PrefilteredSkyValid = false;
+            }
+        }
+        ImGui::EndCombo();
+    }
+
+    static const char* encodings[] = { "Cubemap", "Octahedral" };
+    int encoding = (int)m_EnvironmentEncoding;
+    if (ImGui::Combo("Environment Encoding", &encoding, encodings, 2))
+        m_EnvironmentEncoding = (EnvironmentEncoding)encoding;
+
+    ImGui::Columns(4);
+    ImGui::Text("Encoding");     ImGui::NextColumn();
+    ImGui::Text("Bake");         ImGui::NextColumn();
+    ImGui::Text("Memory");       ImGui::NextColumn();
+    ImGui::Text("Shading");      ImGui::NextColumn();
+    for (uint32_t i = 0; i < 2; i++)
+    {
+        const EnvironmentStats& stats = m_EnvironmentStats[i];
+        ImGui::Text("%s", encodings[i]);                                            ImGui::NextColumn();
+        ImGui::Text("%.2f ms (%u draws)", stats.BakeTime, stats.DrawCount);         ImGui::NextColumn();
+        ImGui::Text("%.2f MB (RGB16F: %.2f MB)", stats.Memory / (1024.0 * 1024.0), stats.MemoryRGB16F / (1024.0 * 1024.0)); ImGui::NextColumn();
+        ImGui::Text("%.3f ms", m_ShadingTime[i]);                                   ImGui::NextColumn();
+    }
+    ImGui::Columns(1);
+
+    ImGui::Separator();
+    if (ImGui::Checkbox("Procedural Sky", &m_ProceduralSky))
+    {
+        if (m_ProceduralSky && !IsColorRenderable(m_EnvironmentFormat))
+            m_EnvironmentFormat = GL_R11F_G11F_B10F;
+
+        // Back to the HDR environment, or a clean set for the sky to update
+        BakeEnvironment();
+        m_SkyValid = m_PrefilteredSkyValid = false;
+    }
+    if (m_ProceduralSky)
+    {
+        ImGui::SliderFloat("Sun Elevation", &m_Sky.SunElevation, -0.2f, (float)(PI / 2.0));
+        ImGui::SliderFloat("Sun Azimuth", &m_Sky.SunAzimuth, 0.0f, (float)(2.0 * PI));
+        ImGui::SliderFloat("Turbidity", &m_Sky.Turbidity, 1.7f, 10.0f);
+        ImGui::SliderFloat("Sky Intensity", &m_Sky.Intensity, 0.0f, 0.2f);
+        ImGui::Checkbox("Animate Sun", &m_AnimateSun);
+        ImGui::SliderFloat("Sun Speed", &m_SunSpeed, 0.0f, 1.0f);
+        ImGui::SliderFloat("Prefilter Threshold", &m_PrefilterThreshold, 0.0f, 2.0f);
+        ImGui::Text("Prefiltered mips this frame: %u / %u", m_PrefilteredMipCount, PREFILTER_MIP_COUNT);
+    }
+    ImGui::Text("Packing error: %.3f%% max, %.4f%% mean", m_EnvironmentError.MaxRelative * 100.0f, m_EnvironmentError.MeanRelative * 100.0f);
     ImGui::End();
 }
@@ -3,9 +3,107 @@
 #include <GLCore.h>
 #include <GLCoreUtils.h>
 
+#include "GPUCulling.h"
+#include "ProceduralSky.h"
+
 using namespace GLCore;
 using namespace GLCore::Utils;
 
+enum class EnvironmentEncoding
+{
+	Cubemap = 0, Octahedral = 1
+};
+
+// Sky parameters the prefiltered mips were last generated with
+struct SkyState
+{
+	glm::vec3 SunDirection = glm::vec3(0.0f);
+	float Turbidity = 0.0f;
+	float Intensity = 0.0f;
+};
+
+// Matches the Instance struct in pbr.vert.glsl, the same under std430 in the instance buffer
+// and std140 in the Object block
+struct SphereInstance
+{
+	glm::mat4 Model;
+	glm::mat3x4 NormalModel;
+	glm::vec4 Material;   // metallic, roughness, AO
+	glm::vec4 Albedo;
+};
+GLCORE_BLOCK_OFFSET(SphereInstance, NormalModel, 64);
+GLCORE_BLOCK_OFFSET(SphereInstance, Material, 112);
+GLCORE_BLOCK_OFFSET(SphereInstance, Albedo, 128);
+
+// Matches the Frame block (std140), uploaded once per frame
+struct FrameUniforms
+{
+	glm::mat4 ViewProjection;
+	glm::mat4 SkyboxViewProjection;
+	glm::vec3 ViewPos;
+	float Exposure;
+	glm::vec4 LightPositions[4];
+	glm::vec4 LightColors[4];
+};
+GLCORE_BLOCK_OFFSET(FrameUniforms, SkyboxViewProjection, 64);
+GLCORE_BLOCK_OFFSET(FrameUniforms, ViewPos, 128);
+GLCORE_BLOCK_OFFSET(FrameUniforms, Exposure, 140);
+GLCORE_BLOCK_OFFSET(FrameUniforms, LightPositions, 144);
+GLCORE_BLOCK_OFFSET(FrameUniforms, LightColors, 208);
+
+// Matches the Material block (std140), bools are 4 bytes
+struct MaterialUniforms
+{
+	glm::vec2 TilingFactor;
+	int32_t TextureToggle;
+	int32_t PackedMaterial;
+	int32_t VirtualAlbedo;
+	float VTPageSize;
+	glm::vec2 VTSize;
+	float VTBorder;
+	float VTCacheSize;
+	float VTMaxLevel;
+	float VTFeedbackBias;
+};
+GLCORE_BLOCK_OFFSET(MaterialUniforms, TextureToggle, 8);
+GLCORE_BLOCK_OFFSET(MaterialUniforms, VirtualAlbedo, 16);
+GLCORE_BLOCK_OFFSET(MaterialUniforms, VTSize, 24);
+GLCORE_BLOCK_OFFSET(MaterialUniforms, VTFeedbackBias, 44);
+
+// Index ranges of one sphere LOD in the shared vertex and index buffers, as the generated strip
+// and as an optimized triangle list
+struct SphereLOD
+{
+	uint32_t StripFirstIndex;
+	uint32_t StripIndexCount;
+	uint32_t ListFirstIndex;
+	uint32_t ListIndexCount;
+	int32_t BaseVertex;
+	uint32_t TriangleCount;
+	VertexCacheStats StripStats;
+	VertexCacheStats ListStats;
+};
+
+// Scene components, the transforms live in the scene itself
+struct SphereMaterial
+{
+	glm::vec4 Material;   // metallic, roughness, AO
+	glm::vec4 Albedo;
+};
+
+struct PointLight
+{
+	glm::vec3 Color;
+};
+
+struct EnvironmentStats
+{
+	float BakeTime = 0.0f;
+	uint32_t DrawCount = 0;
+	uint64_t Memory = 0;
+	uint64_t MemoryRGB16F = 0;
+};
+
 class PBR : public Layer
 {
 public:
@@ -28,35 +126,177 @@ private:
 	Shader* m_PrefilterShader;
 	Shader* m_SkyboxShader;
 	Shader* m_QuadShader;
+	Shader* m_EquirectangularToOctahedralShader;
+	Shader* m_IrradianceOctahedralShader;
+	Shader* m_PrefilterOctahedralShader;
+	Shader* m_OctahedralDownsampleShader;
+	Shader* m_SkyShader;
+	std::unique_ptr<ShaderWatcher> m_ShaderWatcher;
 
 	uint32_t m_EnvironmentFBO;
-	uint32_t m_CubemapTexture;
+	std::shared_ptr<RegisteredTexture> m_EquirectangularMap;
+	uint32_t m_FallbackEnvironmentMap = 0;
+	std::shared_ptr<RegisteredTexture> m_FinalTexture;
+	std::unique_ptr<TextureRegistry> m_TextureRegistry;
+	uint32_t m_CubemapTexture = 0;
 	uint32_t m_CubemapDepthRBO;
 
 	uint32_t m_BRDFLUT;
-	uint32_t m_IrradianceTexture;
-	uint32_t m_PrefilteredEnvMap;
+	uint32_t m_IrradianceTexture = 0;
+	uint32_t m_PrefilteredEnvMap = 0;
+
+	uint32_t m_OctahedralEnvironmentMap = 0;
+	uint32_t m_OctahedralIrradianceMap = 0;
+	uint32_t m_OctahedralPrefilteredMap = 0;
+
+	GLenum m_EnvironmentFormat = GL_R11F_G11F_B10F;
+	EnvironmentEncoding m_EnvironmentEncoding = EnvironmentEncoding::Cubemap;
+	EnvironmentStats m_EnvironmentStats[2];
+	PackingError m_EnvironmentError;
+
+	ProceduralSky m_Sky;
+	bool m_ProceduralSky = false;
+	bool m_AnimateSun = false;
+	float m_SunSpeed = 0.1f;
+	float m_SunPhase = 0.0f;
+	float m_PrefilterThreshold = 0.5f;
+	glm::vec3 m_SkySH[9];
+
+	SkyState m_SkyState;
+	bool m_SkyValid = false;
+	std::vector<SkyState> m_PrefilteredSkyStates;
+	bool m_PrefilteredSkyValid = false;
+	uint32_t m_PrefilteredMipCount = 0;
+
+	uint32_t m_ShadingTimeQueries[2];
+	EnvironmentEncoding m_ShadingTimeEncodings[2] = { EnvironmentEncoding::Cubemap, EnvironmentEncoding::Cubemap };
+	float m_ShadingTime[2] = { 0.0f, 0.0f };
+	uint64_t m_FrameIndex = 0;
 
 	uint32_t m_CubeVAO;
 	uint32_t m_QuadVAO;
 
+	// Main pass draws are queued with sort keys and bind through the state cache
+	RenderQueue m_RenderQueue;
+	RenderStateCache m_RenderState;
+	RenderStateStats m_RenderStateStats;
+
 	uint32_t m_SphereVAO;
+	uint32_t m_SphereVBO;
 	uint32_t m_SphereIBO;
-	uint32_t m_SphereIndexCount;
+	std::vector<SphereLOD> m_SphereLODs;
+
+	// Sphere grid under one root and the lights, which double as the light markers
+	Scene m_Scene;
+	Entity m_GridRoot = NullEntity;
+	std::vector<Entity> m_SphereEntities;
+	std::vector<Entity> m_LightEntities;
+	bool m_SceneValid = false;
+	bool m_RotateGrid = false;
+	float m_GridAngle = 0.0f;
+	uint32_t m_TransformUpdateCount = 0;
+	float m_TransformTime = 0.0f;
+
+	std::vector<SphereInstance> m_SphereInstances;
+	uint32_t m_SphereInstanceBuffer;
+	bool m_SphereInstancesValid = false;
+	// One Object block per sphere for the per-draw path, filled the first time that path runs
+	std::unique_ptr<UniformBufferArray<SphereInstance>> m_SphereObjectBuffer;
+	bool m_SphereObjectsValid = false;
+	// Per-draw path recorded in one command buffer per thread, with and without the light markers
+	std::vector<CommandBuffer> m_SphereCommands;
+	std::vector<CommandBuffer> m_SphereFeedbackCommands;
+	float m_RecordTime = 0.0f;
+	uint32_t m_RecordThreadCount = 0;
+	int m_GridSize = 7;
+	bool m_InstancedDraw = true;
+	float m_DrawTime[2] = { 0.0f, 0.0f };
 
-	uint32_t m_SphereAlbedoMap;
-	uint32_t m_SphereAOMap;
-	uint32_t m_SphereMetallicMap;
-	uint32_t m_SphereNormalMap;
-	uint32_t m_SphereRoughnessMap;
-	uint32_t m_SphereHeightMap;
+	BoundingVolumeHierarchy m_SphereBVH;
+	std::vector<uint32_t> m_VisibleSpheres;
+	bool m_FrustumCulling = true;
+	float m_CullTime = 0.0f;
+
+	// Culling and LOD selection in a compute pass feeding one multi-draw-indirect call,
+	// the CPU path above is kept as the reference
+	std::unique_ptr<GPUCulling> m_GPUCulling;
+	bool m_GPUCullingEnabled = true;
+	bool m_OcclusionCulling = true;
+	bool m_ValidateCulling = false;
+	uint32_t m_ReferenceVisibleCount = 0;
+	bool m_ReferenceValid = false;
+	bool m_CullingMismatch = false;
+
+	// Instance indices grouped by LOD, fed to the vertex shader as an instanced attribute
+	uint32_t m_SphereLODBuffer;
+	std::vector<uint32_t> m_SphereLODIndices;
+	std::vector<uint8_t> m_SphereLODState;
+	std::vector<uint32_t> m_SphereLODCounts;
+	std::vector<uint32_t> m_SphereLODMarkerCounts;
+	uint64_t m_SphereTriangleCount = 0;
+	bool m_MeshLOD = true;
+	float m_LODScale = 1.0f;
+	bool m_OptimizedIndices = true;
+
+	std::unique_ptr<TextureStreamer> m_TextureStreamer;
+	float m_StreamingBudget = 2.0f;
+
+	std::shared_ptr<StreamedTexture> m_SphereAlbedoMap;
+	std::shared_ptr<StreamedTexture> m_SphereAOMap;
+	std::shared_ptr<StreamedTexture> m_SphereMetallicMap;
+	std::shared_ptr<StreamedTexture> m_SphereNormalMap;
+	std::shared_ptr<StreamedTexture> m_SphereRoughnessMap;
+	std::shared_ptr<StreamedTexture> m_SphereHeightMap;
+	std::shared_ptr<StreamedTexture> m_SphereMaterialMap;
+	bool m_PackedMaterial = true;
+
+	std::unique_ptr<MeshLoader> m_MeshLoader;
+	std::shared_ptr<Mesh> m_Model;
+	char m_ModelPath[256] = "assets/models/model.fbx";
+	float m_ModelScale = 5.0f;
+	uint32_t m_ModelLOD = 0;
+	std::unique_ptr<UniformBuffer<SphereInstance>> m_ModelObjectBuffer;
+
+	std::unique_ptr<VirtualTexture> m_VirtualAlbedo;
+	Shader* m_FeedbackShader;
+	bool m_VirtualTexturing = true;
+
+	// Blocks bound once per frame and shared by every program that declares them
+	std::unique_ptr<UniformBuffer<FrameUniforms>> m_FrameBuffer;
+	std::unique_ptr<UniformBuffer<MaterialUniforms>> m_MaterialBuffer;
 
 	bool m_Textured = true;
 	float m_Exposure = 0.5f;
 	bool m_IBL = true;
+	bool m_Parallax = true;
+	int m_LightCount = 4;
+
+	// Specializations of pbr.vert/pbr.frag, m_PBRShader is the linked one in use
+	std::unique_ptr<ShaderVariantCache> m_PBRVariants;
+
+	ShaderDefines GetPBRDefines() const;
+	void LoadSeparateMaterialMaps();
 
-	void EquirectangularToCubemap(uint32_t equirectangularMap);
+	uint32_t GetEnvironmentSource() const;
+	void BakeEnvironment();
+	void BakeCubemapEnvironment();
+	void BakeOctahedralEnvironment();
+	void GenerateOctahedralMips(uint32_t texture, uint32_t size, uint32_t mipCount);
+	void PackTexture(uint32_t source, uint32_t destination, uint32_t size, uint32_t mipCount, uint32_t layers);
+
+	void EquirectangularToCubemap(uint32_t equirectangularMap, uint32_t target);
 	void GenerateBRDFIntegration(uint32_t environment);
-	void GenerateIrradiance(uint32_t environment);
-	void GeneratePrefilteredEnvMap(uint32_t environment);
+	void GenerateIrradiance(uint32_t environment, uint32_t target);
+	void GeneratePrefilteredEnvMap(uint32_t environment, uint32_t target, uint32_t mipMask = 0xFFFFFFFF);
+
+	void CreateSceneEntities();
+	void UpdateSphereInstances();
+	void SelectSphereLODs();
+	void CullSpheresOnGPU();
+	void RecordSphereDraws(std::vector<CommandBuffer>& buffers, bool lightMarkers);
+	void DrawSpheres(Shader* shader, bool lightMarkers);
+	void DrawModel(Shader* shader);
+
+	void RenderSky();
+	void UpdateSky(GLCore::Timestep ts);
 };
@@ -0,0 +1,152 @@
+#include "ProceduralSky.h"
+
+#include <algorithm>
+#include <cmath>
+
+static const float PI = 3.14159265359f;
+
+static float Perez(float A, float B, float C, float D, float E, float cosTheta, float gamma, float cosGamma)
+{
+    return (1.0f + A * std::exp(B / cosTheta)) * (1.0f + C * std::exp(D * gamma) + E * cosGamma * cosGamma);
+}
+
+static glm::vec3 YxyToRGB(const glm::vec3& Yxy)
+{
+    float Y = Yxy.x;
+    float X = Yxy.y / Yxy.z * Y;
+    float Z = (1.0f - Yxy.y - Yxy.z) / Yxy.z * Y;
+
+    return glm::vec3(
+         3.2406f * X - 1.5372f * Y - 0.4986f * Z,
+        -0.9689f * X + 1.8758f * Y + 0.0415f * Z,
+         0.0557f * X - 0.2040f * Y + 1.0570f * Z);
+}
+
+glm::vec3 ProceduralSky::GetSunDirection() const
+{
+    return glm::vec3(
+        std::cos(SunElevation) * std::cos(SunAzimuth),
+        std::sin(SunElevation),
+        std::cos(SunElevation) * std::sin(SunAzimuth));
+}
+
+glm::vec3 ProceduralSky::GetSunRadiance() const
+{
+    if (SunElevation <= 0.0f)
+        return glm::vec3(0.0f);
+
+    // Rough Beer-Lambert extinction through an air mass of 1 / sin(elevation),
+    // stronger for blue so the sun reddens towards the horizon
+    float airMass = 1.0f / std::max(std::sin(SunElevation), 0.01f);
+    glm::vec3 extinction = glm::vec3(0.02f, 0.04f, 0.08f) * Turbidity;
+    return SunIntensity * glm::exp(-extinction * airMass);
+}
+
+SkyCoefficients ProceduralSky::GetCoefficients() const
+{
+    float T = Turbidity;
+    float thetaS = PI / 2.0f - std::max(SunElevation, 0.0f);
+    float thetaS2 = thetaS * thetaS;
+    float thetaS3 = thetaS2 * thetaS;
+
+    SkyCoefficients coefficients;
+    coefficients.A = glm::vec3( 0.1787f * T - 1.4630f, -0.0193f * T - 0.2592f, -0.0167f * T - 0.2608f);
+    coefficients.B = glm::vec3(-0.3554f * T + 0.4275f, -0.0665f * T + 0.0008f, -0.0950f * T + 0.0092f);
+    coefficients.C = glm::vec3(-0.0227f * T + 5.3251f, -0.0004f * T + 0.2125f, -0.0079f * T + 0.2102f);
+    coefficients.D = glm::vec3( 0.1206f * T - 2.5771f, -0.0641f * T - 0.8989f, -0.0441f * T - 1.6537f);
+    coefficients.E = glm::vec3(-0.0670f * T + 0.3703f, -0.0033f * T + 0.0452f, -0.0109f * T + 0.0529f);
+
+    float chi = (4.0f / 9.0f - T / 120.0f) * (PI - 2.0f * thetaS);
+    float zenithY = std::max((4.0453f * T - 4.9710f) * std::tan(chi) - 0.2155f * T + 2.4192f, 0.0f);
+
+    float zenithX =
+        T * T * ( 0.00166f * thetaS3 - 0.00375f * thetaS2 + 0.00209f * thetaS) +
+        T *     (-0.02903f * thetaS3 + 0.06377f * thetaS2 - 0.03202f * thetaS + 0.00394f) +
+                ( 0.11693f * thetaS3 - 0.21196f * thetaS2 + 0.06052f * thetaS + 0.25886f);
+    float zenithY2 =
+        T * T * ( 0.00275f * thetaS3 - 0.00610f * thetaS2 + 0.00317f * thetaS) +
+        T *     (-0.04214f * thetaS3 + 0.08970f * thetaS2 - 0.04153f * thetaS + 0.00516f) +
+                ( 0.15346f * thetaS3 - 0.26756f * thetaS2 + 0.06670f * thetaS + 0.26688f);
+
+    // Fade the dome out once the sun has set
+    float twilight = std::clamp(SunElevation / 0.1f + 1.0f, 0.0f, 1.0f);
+    coefficients.Zenith = glm::vec3(zenithY * Intensity * twilight, zenithX, zenithY2);
+
+    // Fold the Perez normalisation at the zenith into the zenith value
+    float cosThetaS = std::cos(thetaS);
+    for (int i = 0; i < 3; i++)
+    {
+        float norm = Perez(coefficients.A[i], coefficients.B[i], coefficients.C[i], coefficients.D[i], coefficients.E[i], 1.0f, thetaS, cosThetaS);
+        coefficients.Zenith[i] /= norm;
+    }
+
+    return coefficients;
+}
+
+glm::vec3 ProceduralSky::Evaluate(const glm::vec3& direction, const SkyCoefficients& coefficients) const
+{
+    glm::vec3 sun = GetSunDirection();
+
+    float cosTheta = std::max(direction.y, 0.01f);
+    float cosGamma = std::clamp(glm::dot(direction, sun), -1.0f, 1.0f);
+    float gamma = std::acos(cosGamma);
+
+    glm::vec3 Yxy;
+    for (int i = 0; i < 3; i++)
+        Yxy[i] = coefficients.Zenith[i] * Perez(coefficients.A[i], coefficients.B[i], coefficients.C[i], coefficients.D[i], coefficients.E[i], cosTheta, gamma, cosGamma);
+
+    glm::vec3 color = glm::max(YxyToRGB(Yxy), glm::vec3(0.0f));
+
+    // Dim ground below the horizon
+    if (direction.y < 0.0f)
+        color *= 0.3f;
+
+    return color;
+}
+
+static void AccumulateSH(glm::vec3 sh[9], const glm::vec3& d, const glm::vec3& value)
+{
+    sh[0] += value * 0.282095f;
+    sh[1] += value * 0.488603f * d.y;
+    sh[2] += value * 0.488603f * d.z;
+    sh[3] += value * 0.488603f * d.x;
+    sh[4] += value * 1.092548f * d.x * d.y;
+    sh[5] += value * 1.092548f * d.y * d.z;
+    sh[6] += value * 0.315392f * (3.0f * d.z * d.z - 1.0f);
+    sh[7] += value * 1.092548f * d.x * d.z;
+    sh[8] += value * 0.546274f * (d.x * d.x - d.y * d.y);
+}
+
+void ProceduralSky::ComputeIrradianceSH(glm::vec3 sh[9]) const
+{
+    static const uint32_t THETA_SAMPLES = 32, PHI_SAMPLES = 64;
+
+    for (uint32_t i = 0; i < 9; i++)
+        sh[i] = glm::vec3(0.0f);
+
+    SkyCoefficients coefficients = GetCoefficients();
+
+    float dTheta = PI / THETA_SAMPLES;
+    float dPhi = 2.0f * PI / PHI_SAMPLES;
+    for (uint32_t t = 0; t < THETA_SAMPLES; t++)
+    {
+        float theta = (t + 0.5f) * dTheta;
+        float solidAngle = std::sin(theta) * dTheta * dPhi;
+        for (uint32_t p = 0; p < PHI_SAMPLES; p++)
+        {
+            float phi = (p + 0.5f) * dPhi;
+            glm::vec3 direction(std::sin(theta) * std::cos(phi), std::cos(theta), std::sin(theta) * std::sin(phi));
+            AccumulateSH(sh, direction, Evaluate(direction, coefficients) * solidAngle);
+        }
+    }
+
+    // The sun disk is far smaller than a grid cell, so it is added analytically
+    float sunSolidAngle = 2.0f * PI * (1.0f - std::cos(SunAngularRadius));
+    AccumulateSH(sh, GetSunDirection(), GetSunRadiance() * sunSolidAngle);
+
+    // Clamped cosine convolution (A_l / PI): 1, 2/3, 1/4
+    for (uint32_t i = 1; i < 4; i++)
+        sh[i] *= 2.0f / 3.0f;
+    for (uint32_t i = 4; i < 9; i++)
+        sh[i] *= 0.25f;
+}
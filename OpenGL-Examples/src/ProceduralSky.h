@@ -0,0 +1,35 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+// Preetham analytic daylight model ("A Practical Analytic Model for Daylight", 1999).
+// The same model is evaluated in sky.frag.glsl; the CPU side feeds it the
+// per-frame coefficients and projects the sky into spherical harmonics.
+struct SkyCoefficients
+{
+	// Perez coefficients A-E, one channel per component of Yxy
+	glm::vec3 A, B, C, D, E;
+	glm::vec3 Zenith;
+};
+
+class ProceduralSky
+{
+public:
+	float SunElevation = 0.6f;   // radians above the horizon
+	float SunAzimuth = 1.2f;     // radians around +Y
+	float Turbidity = 2.5f;
+	float Intensity = 0.05f;     // scales the model's kcd/m^2 output to scene units
+	float SunIntensity = 50.0f;
+
+	static constexpr float SunAngularRadius = 0.00465f * 2.0f;
+
+	glm::vec3 GetSunDirection() const;
+	glm::vec3 GetSunRadiance() const;
+	SkyCoefficients GetCoefficients() const;
+
+	// Radiance of the sky dome (without the sun disk) along a unit direction
+	glm::vec3 Evaluate(const glm::vec3& direction, const SkyCoefficients& coefficients) const;
+
+	// Irradiance / PI as 3-band SH, cosine convolution already applied (sun disk included)
+	void ComputeIrradianceSH(glm::vec3 sh[9]) const;
+};
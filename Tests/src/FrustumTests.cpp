@@ -0,0 +1,83 @@
+#include "Test.h"
+
+#include "GLCore/Util/BoundingVolumeHierarchy.h"
+#include "GLCore/Util/Frustum.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <random>
+
+using namespace GLCore::Utils;
+
+static Frustum MakeFrustum(const glm::vec3& position, const glm::vec3& target)
+{
+	glm::mat4 projection = glm::perspective(glm::radians(60.0f), 16.0f / 9.0f, 0.1f, 100.0f);
+	return Frustum(projection * glm::lookAt(position, target, glm::vec3(0.0f, 1.0f, 0.0f)));
+}
+
+TEST(FrustumClassifiesBoxes)
+{
+	// Looking down -Z from the origin
+	Frustum frustum = MakeFrustum(glm::vec3(0.0f), glm::vec3(0.0f, 0.0f, -1.0f));
+
+	CHECK(frustum.Test(BoundingBox::FromSphere(glm::vec3(0.0f, 0.0f, -10.0f), 1.0f)) == FrustumTest::Inside);
+	CHECK(frustum.Test(BoundingBox::FromSphere(glm::vec3(0.0f, 0.0f, 10.0f), 1.0f)) == FrustumTest::Outside);
+	CHECK(frustum.Test(BoundingBox::FromSphere(glm::vec3(0.0f, 0.0f, -200.0f), 1.0f)) == FrustumTest::Outside);
+	CHECK(frustum.Test(BoundingBox::FromSphere(glm::vec3(100.0f, 0.0f, -10.0f), 1.0f)) == FrustumTest::Outside);
+	// Straddling the near plane and the right plane
+	CHECK(frustum.Test(BoundingBox::FromSphere(glm::vec3(0.0f), 1.0f)) == FrustumTest::Intersecting);
+	CHECK(frustum.Test(BoundingBox(glm::vec3(0.0f, -1.0f, -11.0f), glm::vec3(40.0f, 1.0f, -9.0f))) == FrustumTest::Intersecting);
+	// Enclosing the whole frustum
+	CHECK(frustum.IsVisible(BoundingBox(glm::vec3(-500.0f), glm::vec3(500.0f))));
+}
+
+// Reference test against the planes one at a time, the SSE path has to agree on visibility
+static bool IsVisibleReference(const Frustum& frustum, const BoundingBox& box)
+{
+	for (uint32_t i = 0; i < 6; i++)
+	{
+		glm::vec4 plane = frustum.GetPlane(i);
+		glm::vec3 positive = glm::mix(box.Min, box.Max, glm::greaterThanEqual(glm::vec3(plane), glm::vec3(0.0f)));
+		if (glm::dot(glm::vec3(plane), positive) + plane.w < 0.0f)
+			return false;
+	}
+	return true;
+}
+
+TEST(BVHCullMatchesBruteForce)
+{
+	std::mt19937 random(42);
+	std::uniform_real_distribution<float> coordinate(-50.0f, 50.0f);
+	std::uniform_real_distribution<float> size(0.1f, 3.0f);
+
+	std::vector<BoundingBox> bounds;
+	for (uint32_t i = 0; i < 2000; i++)
+		bounds.push_back(BoundingBox::FromSphere(glm::vec3(coordinate(random), coordinate(random), coordinate(random)), size(random)));
+
+	BoundingVolumeHierarchy bvh;
+	bvh.Build(bounds);
+	CHECK(bvh.GetObjectCount() == bounds.size());
+
+	for (uint32_t view = 0; view < 32; view++)
+	{
+		glm::vec3 position(coordinate(random), coordinate(random), coordinate(random));
+		glm::vec3 target(coordinate(random), coordinate(random), coordinate(random));
+		Frustum frustum = MakeFrustum(position, target);
+
+		std::vector<uint32_t> visible;
+		bvh.Cull(frustum, visible);
+		std::sort(visible.begin(), visible.end());
+		CHECK(std::adjacent_find(visible.begin(), visible.end()) == visible.end());
+
+		std::vector<uint32_t> expected;
+		for (uint32_t i = 0; i < bounds.size(); i++)
+		{
+			bool visibleSSE = frustum.IsVisible(bounds[i]);
+			CHECK(visibleSSE == IsVisibleReference(frustum, bounds[i]));
+			if (visibleSSE)
+				expected.push_back(i);
+		}
+		CHECK(visible == expected);
+	}
+}
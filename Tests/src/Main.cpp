@@ -0,0 +1,49 @@
+#include "Test.h"
+
+#include "GLCore/Core/Log.h"
+
+#include <string>
+
+using namespace GLCore;
+
+static uint32_t s_FailureCount = 0;
+
+std::vector<TestCase>& GetTestCases()
+{
+	static std::vector<TestCase> testCases;
+	return testCases;
+}
+
+void ReportFailure(const char* file, int line, const char* expression)
+{
+	LOG_ERROR("  {0}({1}): CHECK({2}) failed", file, line, expression);
+	s_FailureCount++;
+}
+
+// Usage: Tests [name], runs every test or only the one named. Returns the number of failed tests.
+int main(int argc, char** argv)
+{
+	Log::Init();
+
+	uint32_t failedTests = 0, testCount = 0;
+	for (const TestCase& testCase : GetTestCases())
+	{
+		if (argc > 1 && std::string(argv[1]) != testCase.Name)
+			continue;
+
+		uint32_t failures = s_FailureCount;
+		testCase.Function();
+		testCount++;
+		if (s_FailureCount != failures)
+		{
+			LOG_ERROR("{0} failed", testCase.Name);
+			failedTests++;
+		}
+	}
+
+	if (failedTests)
+		LOG_ERROR("{0} of {1} tests failed", failedTests, testCount);
+	else
+		LOG_INFO("{0} tests passed", testCount);
+	return (int)failedTests;
+}
@@ -0,0 +1,126 @@
+#include "Test.h"
+#include "TestMeshes.h"
+
+#include "GLCore/Util/MeshLOD.h"
+
+#include <algorithm>
+#include <unordered_set>
+
+using namespace GLCore::Utils;
+
+static bool IsValidTriangleList(const std::vector<uint32_t>& indices, size_t vertexCount)
+{
+	if (indices.size() % 3 != 0)
+		return false;
+	for (size_t i = 0; i < indices.size(); i += 3)
+	{
+		uint32_t a = indices[i], b = indices[i + 1], c = indices[i + 2];
+		if (a >= vertexCount || b >= vertexCount || c >= vertexCount || a == b || b == c || a == c)
+			return false;
+	}
+	return true;
+}
+
+TEST(SimplifyMeshReachesTargetOnClosedMesh)
+{
+	std::vector<glm::vec3> positions;
+	std::vector<uint32_t> indices;
+	GenerateSphere(16, positions, indices);
+	CHECK(AllFacingOutward(positions, indices));
+
+	float error = -1.0f;
+	std::vector<uint32_t> simplified = SimplifyMesh(positions.data(), positions.size(), indices, indices.size() / 4, &error);
+
+	CHECK(IsValidTriangleList(simplified, positions.size()));
+	CHECK(simplified.size() <= indices.size() / 4 + 6);
+	CHECK(simplified.size() >= 3 * 8);
+	CHECK(error >= 0.0f && error < 0.05f);
+	// Collapses that would flip a triangle are rejected
+	CHECK(AllFacingOutward(positions, simplified));
+}
+
+TEST(SimplifyMeshCollapsesFlatInteriorWithoutError)
+{
+	std::vector<glm::vec3> positions;
+	std::vector<uint32_t> indices;
+	GenerateGrid(8, positions, indices);
+
+	float error = -1.0f;
+	std::vector<uint32_t> simplified = SimplifyMesh(positions.data(), positions.size(), indices, 0, &error);
+
+	CHECK(IsValidTriangleList(simplified, positions.size()));
+	CHECK(simplified.size() < indices.size() / 2);
+	CHECK_NEAR(error, 0.0f, 1e-5f);
+
+	// The outer ring is an open border and keeps every vertex
+	std::unordered_set<uint32_t> used(simplified.begin(), simplified.end());
+	for (uint32_t i = 0; i <= 8; i++)
+	{
+		CHECK(used.count(i));
+		CHECK(used.count(8 * 9 + i));
+		CHECK(used.count(i * 9));
+		CHECK(used.count(i * 9 + 8));
+	}
+}
+
+TEST(SimplifyMeshKeepsSeamVertices)
+{
+	// Two triangles sharing an edge by position only, as at a UV seam
+	std::vector<glm::vec3> positions = { { 0, 0, 0 }, { 1, 0, 0 }, { 0, 0, 1 }, { 1, 0, 0 }, { 0, 0, 1 }, { 1, 0, 1 } };
+	std::vector<uint32_t> indices = { 0, 2, 1, 3, 4, 5 };
+
+	std::vector<uint32_t> simplified = SimplifyMesh(positions.data(), positions.size(), indices, 0);
+	CHECK(simplified == indices);
+}
+
+TEST(BuildLODChainShrinksEveryLevel)
+{
+	std::vector<glm::vec3> positions;
+	std::vector<uint32_t> indices;
+	GenerateSphere(16, positions, indices);
+
+	std::vector<std::vector<uint32_t>> chain = BuildLODChain(positions.data(), positions.size(), indices, 4);
+	CHECK(!chain.empty() && chain.size() <= 4);
+	CHECK(chain[0] == indices);
+	for (size_t level = 1; level < chain.size(); level++)
+	{
+		CHECK(IsValidTriangleList(chain[level], positions.size()));
+		CHECK(chain[level].size() < chain[level - 1].size());
+		CHECK(chain[level].size() <= chain[level - 1].size() * 3 / 4);
+	}
+}
+
+TEST(GetProjectedSizeFallsWithDistance)
+{
+	CHECK_NEAR(GetProjectedSize(glm::vec3(0, 0, -10), 1.0f, glm::vec3(0.0f), 100.0f), 20.0f, 1e-4f);
+	CHECK_NEAR(GetProjectedSize(glm::vec3(0, 0, -20), 1.0f, glm::vec3(0.0f), 100.0f), 10.0f, 1e-4f);
+	// Inside the sphere it covers the screen
+	CHECK(GetProjectedSize(glm::vec3(0.0f), 1.0f, glm::vec3(0.5f, 0.0f, 0.0f), 100.0f) > 1e30f);
+}
+
+TEST(SelectLODAppliesHysteresis)
+{
+	const float thresholds[] = { 100.0f, 50.0f };
+
+	// Without a previous LOD in range the thresholds decide
+	CHECK(SelectLOD(120.0f, 0, thresholds, 2) == 0);
+	CHECK(SelectLOD(75.0f, 1, thresholds, 2) == 1);
+	CHECK(SelectLOD(10.0f, 2, thresholds, 2) == 2);
+
+	// Slightly past a boundary the current LOD is kept, 15% by default
+	CHECK(SelectLOD(90.0f, 0, thresholds, 2) == 0);
+	CHECK(SelectLOD(110.0f, 1, thresholds, 2) == 1);
+	CHECK(SelectLOD(45.0f, 1, thresholds, 2) == 1);
+	CHECK(SelectLOD(55.0f, 2, thresholds, 2) == 2);
+
+	// Further out it switches
+	CHECK(SelectLOD(80.0f, 0, thresholds, 2) == 1);
+	CHECK(SelectLOD(120.0f, 1, thresholds, 2) == 0);
+	CHECK(SelectLOD(40.0f, 1, thresholds, 2) == 2);
+	CHECK(SelectLOD(60.0f, 2, thresholds, 2) == 1);
+	CHECK(SelectLOD(30.0f, 0, thresholds, 2) == 2);
+
+	// A stale LOD out of range is replaced outright
+	CHECK(SelectLOD(120.0f, 7, thresholds, 2) == 0);
+	CHECK(SelectLOD(90.0f, 0, thresholds, 2, 0.0f) == 1);
+}
@@ -0,0 +1,116 @@
+#include "Test.h"
+#include "TestMeshes.h"
+
+#include "GLCore/Util/MeshOptimizer.h"
+
+#include <algorithm>
+#include <array>
+#include <random>
+
+using namespace GLCore::Utils;
+
+// Triangles as rotation-independent keys, so reordered lists can be compared as multisets
+static std::vector<std::array<uint32_t, 3>> GetTriangles(const std::vector<uint32_t>& indices)
+{
+	std::vector<std::array<uint32_t, 3>> triangles;
+	for (size_t i = 0; i < indices.size(); i += 3)
+	{
+		std::array<uint32_t, 3> triangle = { indices[i], indices[i + 1], indices[i + 2] };
+		std::rotate(triangle.begin(), std::min_element(triangle.begin(), triangle.end()), triangle.end());
+		triangles.push_back(triangle);
+	}
+	std::sort(triangles.begin(), triangles.end());
+	return triangles;
+}
+
+static std::vector<uint32_t> ShuffleTriangles(const std::vector<uint32_t>& indices)
+{
+	std::vector<uint32_t> order(indices.size() / 3);
+	for (uint32_t i = 0; i < order.size(); i++)
+		order[i] = i;
+	std::shuffle(order.begin(), order.end(), std::mt19937(1234));
+
+	std::vector<uint32_t> shuffled;
+	for (uint32_t triangle : order)
+		shuffled.insert(shuffled.end(), { indices[triangle * 3], indices[triangle * 3 + 1], indices[triangle * 3 + 2] });
+	return shuffled;
+}
+
+TEST(AnalyzeVertexCacheCountsMisses)
+{
+	VertexCacheStats single = AnalyzeVertexCache({ 0, 1, 2 }, 3);
+	CHECK_NEAR(single.ACMR, 3.0f, 1e-6f);
+	CHECK_NEAR(single.ATVR, 1.0f, 1e-6f);
+
+	// The second triangle reuses two cached vertices
+	VertexCacheStats pair = AnalyzeVertexCache({ 0, 1, 2, 2, 1, 3 }, 4);
+	CHECK_NEAR(pair.ACMR, 2.0f, 1e-6f);
+	CHECK_NEAR(pair.ATVR, 1.0f, 1e-6f);
+}
+
+TEST(ConvertStripToListKeepsWindingAndDropsDegenerates)
+{
+	std::vector<uint32_t> list = ConvertStripToList({ 0, 1, 2, 3, 3, 4, 4, 5, 6, 7 });
+	CHECK((list == std::vector<uint32_t>{ 0, 1, 2, 2, 1, 3, 4, 5, 6, 6, 5, 7 }));
+	CHECK(ConvertStripToList({ 0, 1 }).empty());
+}
+
+TEST(OptimizeVertexCacheReordersTrianglesOnly)
+{
+	std::vector<glm::vec3> positions;
+	std::vector<uint32_t> indices;
+	GenerateSphere(16, positions, indices);
+	std::vector<uint32_t> shuffled = ShuffleTriangles(indices);
+
+	std::vector<uint32_t> optimized = OptimizeVertexCache(shuffled, positions.size());
+	CHECK(GetTriangles(optimized) == GetTriangles(shuffled));
+	// Each triangle keeps its winding
+	CHECK(AllFacingOutward(positions, optimized));
+
+	float before = AnalyzeVertexCache(shuffled, positions.size()).ACMR;
+	float after = AnalyzeVertexCache(optimized, positions.size()).ACMR;
+	CHECK(after < before * 0.5f);
+	CHECK(after < 0.8f);
+}
+
+TEST(OptimizeOverdrawStaysWithinThreshold)
+{
+	std::vector<glm::vec3> positions;
+	std::vector<uint32_t> indices;
+	GenerateSphere(16, positions, indices);
+	std::vector<uint32_t> optimized = OptimizeVertexCache(indices, positions.size());
+
+	std::vector<uint32_t> sorted = OptimizeOverdraw(optimized, positions.data(), positions.size(), 1.05f);
+	CHECK(GetTriangles(sorted) == GetTriangles(optimized));
+	CHECK(AnalyzeVertexCache(sorted, positions.size()).ACMR <= AnalyzeVertexCache(optimized, positions.size()).ACMR * 1.05f + 1e-5f);
+}
+
+TEST(VertexFetchRemapFollowsFirstUse)
+{
+	std::vector<glm::vec3> positions;
+	std::vector<uint32_t> indices;
+	GenerateSphere(8, positions, indices);
+	// An unreferenced vertex goes to the end
+	positions.push_back(glm::vec3(9.0f));
+	indices = ShuffleTriangles(indices);
+
+	std::vector<uint32_t> remap = GenerateVertexFetchRemap(indices, positions.size());
+	CHECK(remap.size() == positions.size());
+	CHECK(remap.back() == positions.size() - 1);
+
+	std::vector<glm::vec3> remappedPositions = positions;
+	RemapVertexBuffer((uint8_t*)remappedPositions.data(), positions.size(), sizeof(glm::vec3), remap);
+	std::vector<uint32_t> remappedIndices = indices;
+	RemapIndexBuffer(remappedIndices, remap);
+
+	uint32_t next = 0;
+	for (size_t i = 0; i < indices.size(); i++)
+	{
+		// Same geometry, and every index is either seen before or the next new one
+		CHECK(remappedPositions[remappedIndices[i]] == positions[indices[i]]);
+		CHECK(remappedIndices[i] <= next);
+		if (remappedIndices[i] == next)
+			next++;
+	}
+	CHECK(next == positions.size() - 1);
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <cmath>
+#include <vector>
+
+// Minimal test registry: TEST(Name) defines a test, CHECK records a failure and carries on.
+// Tests cover the GL-free parts of OpenGL-Core and need no context.
+struct TestCase
+{
+	const char* Name;
+	void (*Function)();
+};
+
+std::vector<TestCase>& GetTestCases();
+void ReportFailure(const char* file, int line, const char* expression);
+
+struct TestRegistrar
+{
+	TestRegistrar(const char* name, void (*function)()) { GetTestCases().push_back({ name, function }); }
+};
+
+#define TEST(name) \
+	static void name(); \
+	static TestRegistrar name##Registrar(#name, name); \
+	static void name()
+
+#define CHECK(expression) do { if (!(expression)) ReportFailure(__FILE__, __LINE__, #expression); } while (0)
+#define CHECK_NEAR(a, b, tolerance) CHECK(std::abs((a) - (b)) <= (tolerance))
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <unordered_map>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+// Flat n x n quad grid in the XZ plane facing +Y, an open mesh whose border is the outer ring
+inline void GenerateGrid(uint32_t n, std::vector<glm::vec3>& positions, std::vector<uint32_t>& indices)
+{
+	for (uint32_t z = 0; z <= n; z++)
+		for (uint32_t x = 0; x <= n; x++)
+			positions.push_back(glm::vec3((float)x, 0.0f, (float)z));
+
+	for (uint32_t z = 0; z < n; z++)
+	{
+		for (uint32_t x = 0; x < n; x++)
+		{
+			uint32_t i = z * (n + 1) + x;
+			indices.insert(indices.end(), { i, i + n + 1, i + 1, i + 1, i + n + 1, i + n + 2 });
+		}
+	}
+}
+
+// Cube with n x n quads per face projected onto the unit sphere. Vertices are welded, so the mesh
+// is closed and has no seams; triangles wind counter-clockwise seen from outside.
+inline void GenerateSphere(uint32_t n, std::vector<glm::vec3>& positions, std::vector<uint32_t>& indices)
+{
+	std::unordered_map<uint32_t, uint32_t> vertices;
+	auto vertex = [&](glm::ivec3 p)
+	{
+		uint32_t key = (uint32_t)((p.x * (n + 1) + p.y) * (n + 1) + p.z);
+		auto [it, inserted] = vertices.try_emplace(key, (uint32_t)positions.size());
+		if (inserted)
+			positions.push_back(glm::normalize(glm::vec3(p) - glm::vec3(n * 0.5f)));
+		return it->second;
+	};
+
+	for (int axis = 0; axis < 3; axis++)
+	{
+		for (int side = 0; side < 2; side++)
+		{
+			for (uint32_t v = 0; v < n; v++)
+			{
+				for (uint32_t u = 0; u < n; u++)
+				{
+					glm::ivec3 corners[4];
+					for (int c = 0; c < 4; c++)
+					{
+						glm::ivec3 p;
+						p[axis] = side * n;
+						p[(axis + 1) % 3] = u + (c & 1);
+						p[(axis + 2) % 3] = v + (c >> 1);
+						corners[c] = p;
+					}
+
+					uint32_t quad[4] = { vertex(corners[0]), vertex(corners[1]), vertex(corners[2]), vertex(corners[3]) };
+					uint32_t triangles[6] = { quad[0], quad[1], quad[2], quad[2], quad[1], quad[3] };
+					glm::vec3 normal = glm::cross(positions[quad[1]] - positions[quad[0]], positions[quad[2]] - positions[quad[0]]);
+					if (glm::dot(normal, positions[quad[0]]) < 0.0f)
+					{
+						std::swap(triangles[1], triangles[2]);
+						std::swap(triangles[4], triangles[5]);
+					}
+					indices.insert(indices.end(), std::begin(triangles), std::end(triangles));
+				}
+			}
+		}
+	}
+}
+
+inline bool AllFacingOutward(const std::vector<glm::vec3>& positions, const std::vector<uint32_t>& indices)
+{
+	for (size_t i = 0; i < indices.size(); i += 3)
+	{
+		const glm::vec3& a = positions[indices[i]];
+		const glm::vec3& b = positions[indices[i + 1]];
+		const glm::vec3& c = positions[indices[i + 2]];
+		if (glm::dot(glm::cross(b - a, c - a), a + b + c) <= 0.0f)
+			return false;
+	}
+	return true;
+}
@@ -34,4 +34,6 @@ group "Dependencies"
 group ""
 
 includeexternal "OpenGL-Core"
-include "OpenGL-Examples"
\ No newline at end of file
+include "OpenGL-Examples"
+include "AssetPacker"
+include "Tests"
\ No newline at end of file